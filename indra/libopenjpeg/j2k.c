@@ -1845,6 +1845,7 @@ void j2k_setup_decoder(opj_j2k_t *j2k, opj_dparameters_t *parameters) {
 		cp->reduce = parameters->cp_reduce;	
 		cp->layer = parameters->cp_layer;
 		cp->limit_decoding = parameters->cp_limit_decoding;
+		cp->t1_cache = parameters->cp_t1_cache;
 
 #ifdef USE_JPWL
 		cp->correct = parameters->jpwl_correct;
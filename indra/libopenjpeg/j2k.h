@@ -228,6 +228,8 @@ typedef struct opj_cp {
 	int layer;
 	/** if == NO_LIMITATION, decode entire codestream; if == LIMIT_TO_MAIN_HEADER then only decode the main header */
 	OPJ_LIMIT_DECODING limit_decoding;
+	/** code-blocks decoded by an earlier decode of the same codestream, may be NULL */
+	opj_t1_cache_t *t1_cache;
 	/** XTOsiz */
 	int tx0;
 	/** YTOsiz */
@@ -360,6 +360,12 @@ typedef struct opj_cparameters {
 /**
 Decompression parameters
 */
+/**
+Decoded code-blocks kept between decodes of a growing codestream
+@see opj_create_t1_cache
+*/
+typedef struct opj_t1_cache opj_t1_cache_t;
+
 typedef struct opj_dparameters {
 	/** 
 	Set the number of highest resolution levels to be discarded. 
@@ -410,6 +416,15 @@ typedef struct opj_dparameters {
 	OPJ_LIMIT_DECODING cp_limit_decoding;
 
 	unsigned int flags;
+
+	/**
+	Optional cache of tier-1 decoded code-blocks, owned by the caller.
+	When the same codestream is decoded again, possibly with more data or a
+	lower reduce factor, code-blocks whose compressed data didn't change are
+	taken from the cache instead of being decoded again.
+	if == NULL, every code-block is decoded
+	*/
+	opj_t1_cache_t *cp_t1_cache;
 } opj_dparameters_t;
 
 /** Common fields between JPEG-2000 compression and decompression master structs. */
@@ -826,6 +841,27 @@ Decoding parameters are returned in j2k->cp.
 @param parameters decompression parameters
 */
 OPJ_API void OPJ_CALLCONV opj_setup_decoder(opj_dinfo_t *dinfo, opj_dparameters_t *parameters);
+/** Defined when opj_create_t1_cache and opj_dparameters_t::cp_t1_cache are available */
+#define OPJ_HAS_T1_CACHE 1
+/**
+Create a tier-1 cache for progressive decoding of one codestream
+@param max_bytes Memory limit; code-blocks that don't fit are decoded but not kept
+@return Returns a new cache, to be set in opj_dparameters_t::cp_t1_cache
+*/
+OPJ_API opj_t1_cache_t* OPJ_CALLCONV opj_create_t1_cache(int max_bytes);
+/**
+Destroy a tier-1 cache
+@param cache Cache to free
+*/
+OPJ_API void OPJ_CALLCONV opj_destroy_t1_cache(opj_t1_cache_t *cache);
+/**
+Get tier-1 cache counters
+@param cache Cache
+@param hits Code-blocks taken from the cache, since creation
+@param misses Code-blocks decoded, since creation
+@param bytes Memory used by the cache
+*/
+OPJ_API void OPJ_CALLCONV opj_get_t1_cache_stats(opj_t1_cache_t *cache, int *hits, int *misses, int *bytes);
 /**
 Decode an image from a JPEG-2000 codestream 
 @param dinfo decompressor handle
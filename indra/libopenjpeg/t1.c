@@ -1378,6 +1378,165 @@ static void t1_decode_cblk(
 	}
 }
 
+/* ----------------------------------------------------------------------- */
+/* Tier-1 cache */
+
+/** A decoded code-block and the input it was decoded from */
+typedef struct opj_t1_cache_cblk {
+	int resno, bandno, precno, cblkno;
+	int numbps;
+	int len;
+	int numsegs;
+	int *segs;				/* numpasses and len of each segment */
+	unsigned char *src;		/* compressed data */
+	int w, h;
+	int *data;				/* t1->data after t1_decode_cblk */
+} opj_t1_cache_cblk_t;
+
+/** Code-blocks of one tile-component, in decoding order */
+typedef struct opj_t1_cache_tilecomp {
+	int tileno, compno;
+	opj_t1_cache_cblk_t *cblks;
+	int numcblks;
+} opj_t1_cache_tilecomp_t;
+
+struct opj_t1_cache {
+	opj_t1_cache_tilecomp_t *tilecomps;
+	int numtilecomps;
+	int bytes;
+	int max_bytes;
+	int hits;
+	int misses;
+};
+
+static void t1_cache_free_cblk(opj_t1_cache_t *cache, opj_t1_cache_cblk_t *entry) {
+	if (entry->data) {
+		cache->bytes -= entry->w * entry->h * sizeof(int) + entry->len + entry->numsegs * 2 * sizeof(int);
+		opj_free(entry->data);
+		opj_free(entry->src);
+		opj_free(entry->segs);
+	}
+	memset(entry, 0, sizeof(opj_t1_cache_cblk_t));
+}
+
+static opj_t1_cache_tilecomp_t* t1_cache_get_tilecomp(opj_t1_cache_t *cache, int tileno, int compno) {
+	int i;
+	opj_t1_cache_tilecomp_t *tilecomps;
+	for (i = 0; i < cache->numtilecomps; ++i) {
+		if (cache->tilecomps[i].tileno == tileno && cache->tilecomps[i].compno == compno) {
+			return &cache->tilecomps[i];
+		}
+	}
+	tilecomps = (opj_t1_cache_tilecomp_t*) opj_realloc(cache->tilecomps, (cache->numtilecomps + 1) * sizeof(opj_t1_cache_tilecomp_t));
+	if (!tilecomps) {
+		return NULL;
+	}
+	cache->tilecomps = tilecomps;
+	tilecomps = &cache->tilecomps[cache->numtilecomps++];
+	memset(tilecomps, 0, sizeof(opj_t1_cache_tilecomp_t));
+	tilecomps->tileno = tileno;
+	tilecomps->compno = compno;
+	return tilecomps;
+}
+
+/* Entry number index of the tile-component, grown as needed. */
+static opj_t1_cache_cblk_t* t1_cache_get_cblk(opj_t1_cache_tilecomp_t *tilecomp, int index) {
+	if (index >= tilecomp->numcblks) {
+		int numcblks = index + 64;
+		opj_t1_cache_cblk_t *cblks = (opj_t1_cache_cblk_t*) opj_realloc(tilecomp->cblks, numcblks * sizeof(opj_t1_cache_cblk_t));
+		if (!cblks) {
+			return NULL;
+		}
+		memset(cblks + tilecomp->numcblks, 0, (numcblks - tilecomp->numcblks) * sizeof(opj_t1_cache_cblk_t));
+		tilecomp->cblks = cblks;
+		tilecomp->numcblks = numcblks;
+	}
+	return &tilecomp->cblks[index];
+}
+
+/* True when entry was decoded from exactly the same input as cblk. */
+static opj_bool t1_cache_match(opj_t1_cache_cblk_t *entry, opj_tcd_cblk_dec_t *cblk, int resno, int bandno, int precno, int cblkno) {
+	int segno;
+	if (!entry->data ||
+		entry->resno != resno || entry->bandno != bandno || entry->precno != precno || entry->cblkno != cblkno ||
+		entry->w != cblk->x1 - cblk->x0 || entry->h != cblk->y1 - cblk->y0 ||
+		entry->numbps != cblk->numbps || entry->len != cblk->len || entry->numsegs != cblk->numsegs) {
+		return OPJ_FALSE;
+	}
+	for (segno = 0; segno < cblk->numsegs; ++segno) {
+		opj_tcd_seg_t *seg = &cblk->segs[segno];
+		if (entry->segs[segno * 2] != (seg->data ? seg->numpasses : -1) || entry->segs[segno * 2 + 1] != seg->len) {
+			return OPJ_FALSE;
+		}
+	}
+	return entry->len == 0 || memcmp(entry->src, cblk->data, entry->len) == 0;
+}
+
+static void t1_cache_store(opj_t1_cache_t *cache, opj_t1_cache_cblk_t *entry, opj_t1_t *t1, opj_tcd_cblk_dec_t *cblk, int resno, int bandno, int precno, int cblkno) {
+	int segno;
+	int bytes = t1->w * t1->h * sizeof(int) + cblk->len + cblk->numsegs * 2 * sizeof(int);
+	t1_cache_free_cblk(cache, entry);
+	if (cache->bytes + bytes > cache->max_bytes) {
+		return;
+	}
+	entry->data = (int*) opj_malloc(t1->w * t1->h * sizeof(int));
+	entry->src = (unsigned char*) opj_malloc(cblk->len > 0 ? cblk->len : 1);
+	entry->segs = (int*) opj_malloc(cblk->numsegs > 0 ? cblk->numsegs * 2 * sizeof(int) : sizeof(int));
+	if (!entry->data || !entry->src || !entry->segs) {
+		opj_free(entry->data);
+		opj_free(entry->src);
+		opj_free(entry->segs);
+		memset(entry, 0, sizeof(opj_t1_cache_cblk_t));
+		return;
+	}
+	entry->resno = resno;
+	entry->bandno = bandno;
+	entry->precno = precno;
+	entry->cblkno = cblkno;
+	entry->numbps = cblk->numbps;
+	entry->len = cblk->len;
+	entry->numsegs = cblk->numsegs;
+	for (segno = 0; segno < cblk->numsegs; ++segno) {
+		opj_tcd_seg_t *seg = &cblk->segs[segno];
+		entry->segs[segno * 2] = seg->data ? seg->numpasses : -1;
+		entry->segs[segno * 2 + 1] = seg->len;
+	}
+	memcpy(entry->src, cblk->data, cblk->len);
+	entry->w = t1->w;
+	entry->h = t1->h;
+	memcpy(entry->data, t1->data, t1->w * t1->h * sizeof(int));
+	cache->bytes += bytes;
+}
+
+opj_t1_cache_t* OPJ_CALLCONV opj_create_t1_cache(int max_bytes) {
+	opj_t1_cache_t *cache = (opj_t1_cache_t*) opj_calloc(1, sizeof(opj_t1_cache_t));
+	if (cache) {
+		cache->max_bytes = max_bytes;
+	}
+	return cache;
+}
+
+void OPJ_CALLCONV opj_destroy_t1_cache(opj_t1_cache_t *cache) {
+	int i, j;
+	if (!cache) {
+		return;
+	}
+	for (i = 0; i < cache->numtilecomps; ++i) {
+		for (j = 0; j < cache->tilecomps[i].numcblks; ++j) {
+			t1_cache_free_cblk(cache, &cache->tilecomps[i].cblks[j]);
+		}
+		opj_free(cache->tilecomps[i].cblks);
+	}
+	opj_free(cache->tilecomps);
+	opj_free(cache);
+}
+
+void OPJ_CALLCONV opj_get_t1_cache_stats(opj_t1_cache_t *cache, int *hits, int *misses, int *bytes) {
+	*hits = cache ? cache->hits : 0;
+	*misses = cache ? cache->misses : 0;
+	*bytes = cache ? cache->bytes : 0;
+}
+
 /* ----------------------------------------------------------------------- */
 
 opj_t1_t* t1_create(opj_common_ptr cinfo) {
@@ -1507,11 +1666,19 @@ void t1_encode_cblks(
 void t1_decode_cblks(
 		opj_t1_t* t1,
 		opj_tcd_tilecomp_t* tilec,
-		opj_tccp_t* tccp)
+		opj_tccp_t* tccp,
+		int reduce,
+		opj_t1_cache_t* cache,
+		int tileno,
+		int compno)
 {
 	int resno, bandno, precno, cblkno;
+	int cblkindex = 0;
 
 	int tile_w = tilec->x1 - tilec->x0;
+	/* The DWT doesn't look at the resolutions dropped by reduce, so neither do we. */
+	int numres2decode = tilec->numresolutions - reduce;
+	opj_t1_cache_tilecomp_t *cache_tilec = cache ? t1_cache_get_tilecomp(cache, tileno, compno) : NULL;
 
 	for (resno = 0; resno < tilec->numresolutions; ++resno) {
 		opj_tcd_resolution_t* res = &tilec->resolutions[resno];
@@ -1522,19 +1689,44 @@ void t1_decode_cblks(
 			for (precno = 0; precno < res->pw * res->ph; ++precno) {
 				opj_tcd_precinct_t* precinct = &band->precincts[precno];
 
-				for (cblkno = 0; cblkno < precinct->cw * precinct->ch; ++cblkno) {
+				for (cblkno = 0; cblkno < precinct->cw * precinct->ch; ++cblkno, ++cblkindex) {
 					opj_tcd_cblk_dec_t* cblk = &precinct->cblks.dec[cblkno];
+					opj_t1_cache_cblk_t *entry = NULL;
 					int* restrict datap;
 					int cblk_w, cblk_h;
 					int x, y;
 					int i, j;
 
-					t1_decode_cblk(
-							t1,
-							cblk,
-							band->bandno,
-							tccp->roishift,
-							tccp->cblksty);
+					if (resno >= numres2decode) {
+						opj_free(cblk->data);
+						opj_free(cblk->segs);
+						continue;
+					}
+
+					/* Code-blocks without data decode to zeros, not worth caching. */
+					if (cache_tilec && cblk->numsegs > 0) {
+						entry = t1_cache_get_cblk(cache_tilec, cblkindex);
+					}
+					if (entry && t1_cache_match(entry, cblk, resno, bandno, precno, cblkno)) {
+						if (!allocate_buffers(t1, entry->w, entry->h)) {
+							opj_free(cblk->data);
+							opj_free(cblk->segs);
+							continue;
+						}
+						memcpy(t1->data, entry->data, entry->w * entry->h * sizeof(int));
+						++cache->hits;
+					} else {
+						t1_decode_cblk(
+								t1,
+								cblk,
+								band->bandno,
+								tccp->roishift,
+								tccp->cblksty);
+						if (entry) {
+							t1_cache_store(cache, entry, t1, cblk, resno, bandno, precno, cblkno);
+							++cache->misses;
+						}
+					}
 
 					x = cblk->x0 - band->x0;
 					y = cblk->y0 - band->y0;
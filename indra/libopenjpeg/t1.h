@@ -137,8 +137,12 @@ Decode the code-blocks of a tile
 @param t1 T1 handle
 @param tilec The tile to decode
 @param tccp Tile coding parameters
+@param reduce Number of highest resolution levels that won't be used
+@param cache Code-blocks decoded earlier, may be NULL
+@param tileno Number of the tile (cache key)
+@param compno Number of the component (cache key)
 */
-void t1_decode_cblks(opj_t1_t* t1, opj_tcd_tilecomp_t* tilec, opj_tccp_t* tccp);
+void t1_decode_cblks(opj_t1_t* t1, opj_tcd_tilecomp_t* tilec, opj_tccp_t* tccp, int reduce, opj_t1_cache_t* cache, int tileno, int compno);
 /* ----------------------------------------------------------------------- */
 /*@}*/
 
@@ -1404,7 +1404,7 @@ opj_bool tcd_decode_tile(opj_tcd_t *tcd, unsigned char *src, int len, int tileno
             return OPJ_FALSE;
         }
 
-		t1_decode_cblks(t1, tilec, &tcd->tcp->tccps[compno]);
+		t1_decode_cblks(t1, tilec, &tcd->tcp->tccps[compno], tcd->cp->reduce, tcd->cp->t1_cache, tileno, compno);
 	}
 	t1_destroy(t1);
 	t1_time = opj_clock() - t1_time;
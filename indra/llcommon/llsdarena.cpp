@@ -0,0 +1,531 @@
+/**
+ * @file llsdarena.cpp
+ * @brief Read-only LLSD documents stored in an arena.
+ *
+ * $LicenseInfo:firstyear=2006&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llsdarena.h"
+
+#include <algorithm>
+#include <new>
+
+namespace
+{
+	bool entry_less(const LLSDArenaMapEntry& entry, const std::string& key)
+	{
+		return entry.first < key;
+	}
+}
+
+//---------------------------------------------------------------------------
+// LLSDArenaValue
+//---------------------------------------------------------------------------
+
+//static
+const LLSDArenaValue& LLSDArenaValue::undefined()
+{
+	// Zero initialized, which is TypeUndefined.
+	static LLSDArenaValue sUndefined;
+	return sUndefined;
+}
+
+LLSD LLSDArenaValue::asScalar() const
+{
+	switch (mType)
+	{
+	case LLSD::TypeBoolean:
+		return LLSD(mBoolean);
+	case LLSD::TypeInteger:
+		return LLSD(mInteger);
+	case LLSD::TypeReal:
+		return LLSD(mReal);
+	case LLSD::TypeString:
+		return LLSD(asString());
+	case LLSD::TypeUUID:
+		return LLSD(asUUID());
+	case LLSD::TypeDate:
+		return LLSD(asDate());
+	case LLSD::TypeURI:
+		return LLSD(asURI());
+	case LLSD::TypeBinary:
+		return LLSD(asBinary());
+	default:
+		return LLSD();
+	}
+}
+
+LLSD::Boolean LLSDArenaValue::asBoolean() const
+{
+	return mType == LLSD::TypeBoolean ? mBoolean : asScalar().asBoolean();
+}
+
+LLSD::Integer LLSDArenaValue::asInteger() const
+{
+	return mType == LLSD::TypeInteger ? mInteger : asScalar().asInteger();
+}
+
+LLSD::Real LLSDArenaValue::asReal() const
+{
+	return mType == LLSD::TypeReal ? mReal : asScalar().asReal();
+}
+
+LLSD::String LLSDArenaValue::asString() const
+{
+	if (mType == LLSD::TypeString || mType == LLSD::TypeURI)
+	{
+		return std::string(data(), mSize);
+	}
+	return asScalar().asString();
+}
+
+LLSD::UUID LLSDArenaValue::asUUID() const
+{
+	if (mType == LLSD::TypeUUID)
+	{
+		LLUUID id;
+		memcpy(id.mData, mInline, UUID_BYTES);		/* Flawfinder: ignore */
+		return id;
+	}
+	return asScalar().asUUID();
+}
+
+LLSD::Date LLSDArenaValue::asDate() const
+{
+	return mType == LLSD::TypeDate ? LLDate(mReal) : asScalar().asDate();
+}
+
+LLSD::URI LLSDArenaValue::asURI() const
+{
+	return mType == LLSD::TypeURI ? LLURI(asString()) : asScalar().asURI();
+}
+
+LLSD::Binary LLSDArenaValue::asBinary() const
+{
+	if (mType == LLSD::TypeBinary)
+	{
+		const U8* bytes = (const U8*)data();
+		return LLSD::Binary(bytes, bytes + mSize);
+	}
+	return asScalar().asBinary();
+}
+
+LLSD LLSDArenaValue::asLLSD() const
+{
+	switch (mType)
+	{
+	case LLSD::TypeMap:
+	{
+		LLSD map = LLSD::emptyMap();
+		for (map_const_iterator iter = beginMap(); iter != endMap(); ++iter)
+		{
+			map.insert(iter->first, iter->second.asLLSD());
+		}
+		return map;
+	}
+	case LLSD::TypeArray:
+	{
+		LLSD array = LLSD::emptyArray();
+		for (array_const_iterator iter = beginArray(); iter != endArray(); ++iter)
+		{
+			array.append(iter->asLLSD());
+		}
+		return array;
+	}
+	default:
+		return asScalar();
+	}
+}
+
+S32 LLSDArenaValue::size() const
+{
+	return (mType == LLSD::TypeMap || mType == LLSD::TypeArray) ? (S32)mSize : 0;
+}
+
+bool LLSDArenaValue::has(const std::string& key) const
+{
+	if (mType != LLSD::TypeMap)
+	{
+		return false;
+	}
+	map_const_iterator iter = std::lower_bound(beginMap(), endMap(), key, entry_less);
+	return iter != endMap() && iter->first == key;
+}
+
+const LLSDArenaValue& LLSDArenaValue::get(const std::string& key) const
+{
+	if (mType != LLSD::TypeMap)
+	{
+		return undefined();
+	}
+	map_const_iterator iter = std::lower_bound(beginMap(), endMap(), key, entry_less);
+	if (iter == endMap() || iter->first != key)
+	{
+		return undefined();
+	}
+	return iter->second;
+}
+
+LLSDArenaValue::map_const_iterator LLSDArenaValue::beginMap() const
+{
+	return mType == LLSD::TypeMap ? mMap : NULL;
+}
+
+LLSDArenaValue::map_const_iterator LLSDArenaValue::endMap() const
+{
+	return mType == LLSD::TypeMap ? mMap + mSize : NULL;
+}
+
+const LLSDArenaValue& LLSDArenaValue::get(S32 index) const
+{
+	if (mType != LLSD::TypeArray || index < 0 || (U32)index >= mSize)
+	{
+		return undefined();
+	}
+	return mArray[index];
+}
+
+LLSDArenaValue::array_const_iterator LLSDArenaValue::beginArray() const
+{
+	return mType == LLSD::TypeArray ? mArray : NULL;
+}
+
+LLSDArenaValue::array_const_iterator LLSDArenaValue::endArray() const
+{
+	return mType == LLSD::TypeArray ? mArray + mSize : NULL;
+}
+
+//---------------------------------------------------------------------------
+// LLSDArenaDocument
+//---------------------------------------------------------------------------
+
+LLSDArenaDocument::LLSDArenaDocument(size_t chunk_size)
+:	mChunkSize(chunk_size),
+	mFree(NULL),
+	mFreeBytes(0),
+	mUsedBytes(0)
+{
+	mRoot.mType = LLSD::TypeUndefined;
+	mRoot.mSize = 0;
+}
+
+LLSDArenaDocument::~LLSDArenaDocument()
+{
+	clear();
+	if (!mChunks.empty())
+	{
+		delete [] mChunks[0];
+	}
+}
+
+void LLSDArenaDocument::assign(const LLSD& sd)
+{
+	LLSDArenaBuilder builder(*this);
+	builder.visit(sd);
+}
+
+void LLSDArenaDocument::clear()
+{
+	mRoot.mType = LLSD::TypeUndefined;
+	mRoot.mSize = 0;
+	mKeys.clear();
+	mUsedBytes = 0;
+	for (std::vector<char*>::iterator iter = mLargeChunks.begin(); iter != mLargeChunks.end(); ++iter)
+	{
+		delete [] *iter;
+	}
+	mLargeChunks.clear();
+	if (mChunks.empty())
+	{
+		return;
+	}
+	for (size_t i = 1; i < mChunks.size(); ++i)
+	{
+		delete [] mChunks[i];
+	}
+	mChunks.resize(1);
+	mFree = mChunks[0];
+	mFreeBytes = mChunkSize;
+}
+
+void* LLSDArenaDocument::allocate(size_t bytes)
+{
+	bytes = (bytes + 7) & ~(size_t)7;
+	mUsedBytes += bytes;
+	if (bytes > mFreeBytes)
+	{
+		if (bytes > mChunkSize / 4)
+		{
+			// Big arrays get a chunk of their own, so that the current one
+			// isn't wasted.
+			mLargeChunks.push_back(new char[bytes]);
+			return mLargeChunks.back();
+		}
+		mChunks.push_back(new char[mChunkSize]);
+		mFree = mChunks.back();
+		mFreeBytes = mChunkSize;
+	}
+	void* result = mFree;
+	mFree += bytes;
+	mFreeBytes -= bytes;
+	return result;
+}
+
+const std::string& LLSDArenaDocument::intern(const std::string& key)
+{
+	return *mKeys.insert(key).first;
+}
+
+//---------------------------------------------------------------------------
+// LLSDArenaBuilder
+//---------------------------------------------------------------------------
+
+LLSDArenaBuilder::LLSDArenaBuilder(LLSDArenaDocument& document)
+:	mDocument(document),
+	mKey(NULL),
+	mStarted(false)
+{
+}
+
+void LLSDArenaBuilder::startMap()
+{
+	start(true);
+}
+
+void LLSDArenaBuilder::key(const std::string& name)
+{
+	mKey = &mDocument.intern(name);
+}
+
+void LLSDArenaBuilder::endMap()
+{
+	end();
+}
+
+void LLSDArenaBuilder::startArray()
+{
+	start(false);
+}
+
+void LLSDArenaBuilder::endArray()
+{
+	end();
+}
+
+void LLSDArenaBuilder::value(const LLSD& data)
+{
+	// Before anything is allocated: a root string's bytes live in the document too.
+	if (!mStarted)
+	{
+		mDocument.clear();
+		mStarted = true;
+	}
+	LLSDArenaValue value;
+	value.mType = data.type();
+	value.mSize = 0;
+	switch (data.type())
+	{
+	case LLSD::TypeMap:
+	case LLSD::TypeArray:
+		visit(data);
+		return;
+
+	case LLSD::TypeBoolean:
+		value.mBoolean = data.asBoolean();
+		break;
+
+	case LLSD::TypeInteger:
+		value.mInteger = data.asInteger();
+		break;
+
+	case LLSD::TypeReal:
+		value.mReal = data.asReal();
+		break;
+
+	case LLSD::TypeDate:
+		value.mReal = data.asDate().secondsSinceEpoch();
+		break;
+
+	case LLSD::TypeUUID:
+		memcpy(value.mInline, data.asUUID().mData, UUID_BYTES);		/* Flawfinder: ignore */
+		break;
+
+	case LLSD::TypeString:
+	case LLSD::TypeURI:
+	case LLSD::TypeBinary:
+	{
+		std::string str;
+		LLSD::Binary binary;
+		const char* bytes;
+		if (data.isBinary())
+		{
+			binary = data.asBinary();
+			bytes = binary.empty() ? NULL : (const char*)&binary[0];
+			value.mSize = (U32)binary.size();
+		}
+		else
+		{
+			str = data.asString();
+			bytes = str.data();
+			value.mSize = (U32)str.size();
+		}
+		if (value.mSize <= LLSDArenaValue::INLINE_BYTES)
+		{
+			if (value.mSize)
+			{
+				memcpy(value.mInline, bytes, value.mSize);		/* Flawfinder: ignore */
+			}
+		}
+		else
+		{
+			char* chars = (char*)mDocument.allocate(value.mSize);
+			memcpy(chars, bytes, value.mSize);		/* Flawfinder: ignore */
+			value.mChars = chars;
+		}
+		break;
+	}
+
+	default:
+		break;
+	}
+	add(mKey, value);
+	mKey = NULL;
+}
+
+void LLSDArenaBuilder::start(bool is_map)
+{
+	if (!mStarted)
+	{
+		mDocument.clear();
+		mStarted = true;
+	}
+	Container container;
+	container.mIsMap = is_map;
+	container.mKey = mKey;
+	container.mFirst = mElements.size();
+	mContainers.push_back(container);
+	mKey = NULL;
+}
+
+void LLSDArenaBuilder::end()
+{
+	if (mContainers.empty())
+	{
+		return;
+	}
+	Container container = mContainers.back();
+	mContainers.pop_back();
+
+	std::vector<Element>::iterator first = mElements.begin() + container.mFirst;
+	size_t count = mElements.end() - first;
+
+	LLSDArenaValue value;
+	value.mSize = 0;
+	value.mArray = NULL;
+	if (container.mIsMap)
+	{
+		value.mType = LLSD::TypeMap;
+		std::sort(first, mElements.end());
+		LLSDArenaMapEntry* entries = count ? (LLSDArenaMapEntry*)mDocument.allocate(count * sizeof(LLSDArenaMapEntry)) : NULL;
+		for (std::vector<Element>::iterator iter = first; iter != mElements.end(); ++iter)
+		{
+			if (value.mSize && &entries[value.mSize - 1].first == iter->mKey)
+			{
+				// Duplicate key.
+				continue;
+			}
+			new (&entries[value.mSize++]) LLSDArenaMapEntry(*iter->mKey, iter->mValue);
+		}
+		value.mMap = entries;
+	}
+	else
+	{
+		value.mType = LLSD::TypeArray;
+		LLSDArenaValue* values = count ? (LLSDArenaValue*)mDocument.allocate(count * sizeof(LLSDArenaValue)) : NULL;
+		for (std::vector<Element>::iterator iter = first; iter != mElements.end(); ++iter)
+		{
+			values[value.mSize++] = iter->mValue;
+		}
+		value.mArray = values;
+	}
+	mElements.erase(first, mElements.end());
+	add(container.mKey, value);
+}
+
+void LLSDArenaBuilder::add(const std::string* key, const LLSDArenaValue& value)
+{
+	if (mContainers.empty())
+	{
+		mDocument.mRoot = value;
+		return;
+	}
+	const Container& container = mContainers.back();
+	if (container.mIsMap && !key)
+	{
+		// A value without a key; the parsers don't do that.
+		return;
+	}
+	Element element;
+	element.mKey = container.mIsMap ? key : NULL;
+	element.mOrder = (U32)(mElements.size() - container.mFirst);
+	element.mValue = value;
+	mElements.push_back(element);
+}
+
+//---------------------------------------------------------------------------
+// LLSDSerialize
+//---------------------------------------------------------------------------
+
+namespace
+{
+	S32 parse_document(LLSDParser* parser, LLSDArenaDocument& document, std::istream& str, S32 max_bytes)
+	{
+		LLPointer<LLSDParser> p = parser;
+		LLSDArenaBuilder builder(document);
+		S32 parse_count = p->parse(str, builder, max_bytes);
+		if (parse_count == LLSDParser::PARSE_FAILURE)
+		{
+			document.clear();
+		}
+		return parse_count;
+	}
+}
+
+//static
+S32 LLSDSerialize::fromNotation(LLSDArenaDocument& document, std::istream& str, S32 max_bytes)
+{
+	return parse_document(new LLSDNotationParser, document, str, max_bytes);
+}
+
+//static
+S32 LLSDSerialize::fromXML(LLSDArenaDocument& document, std::istream& str)
+{
+	return parse_document(new LLSDXMLParser, document, str, SIZE_UNLIMITED);
+}
+
+//static
+S32 LLSDSerialize::fromBinary(LLSDArenaDocument& document, std::istream& str, S32 max_bytes)
+{
+	return parse_document(new LLSDBinaryParser, document, str, max_bytes);
+}
@@ -0,0 +1,242 @@
+/**
+ * @file llsdarena.h
+ * @brief Read-only LLSD documents stored in an arena.
+ *
+ * $LicenseInfo:firstyear=2006&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLSDARENA_H
+#define LL_LLSDARENA_H
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "llsd.h"
+#include "llsdserialize.h"
+
+struct LLSDArenaMapEntry;
+
+/**
+ * @class LLSDArenaValue
+ * @brief One value of an LLSDArenaDocument.
+ *
+ * The const part of the LLSD API, so code that reads a parsed document
+ * works with both. Scalars, including uuids and strings or binaries of
+ * up to 16 bytes, are stored in the value itself. Longer strings, and
+ * the elements of arrays and maps, live in the arena of the document.
+ * Maps are arrays of entries sorted by key.
+ *
+ * Values are only valid as long as their document is, and are never
+ * copied by the user: get them by reference from the document.
+ */
+class LL_COMMON_API LLSDArenaValue
+{
+public:
+	typedef const LLSDArenaValue*		array_const_iterator;
+	typedef const LLSDArenaMapEntry*	map_const_iterator;
+
+	LLSD::Type type() const			{ return (LLSD::Type)mType; }
+
+	bool isUndefined() const		{ return mType == LLSD::TypeUndefined; }
+	bool isDefined() const			{ return mType != LLSD::TypeUndefined; }
+	bool isBoolean() const			{ return mType == LLSD::TypeBoolean; }
+	bool isInteger() const			{ return mType == LLSD::TypeInteger; }
+	bool isReal() const				{ return mType == LLSD::TypeReal; }
+	bool isString() const			{ return mType == LLSD::TypeString; }
+	bool isUUID() const				{ return mType == LLSD::TypeUUID; }
+	bool isDate() const				{ return mType == LLSD::TypeDate; }
+	bool isURI() const				{ return mType == LLSD::TypeURI; }
+	bool isBinary() const			{ return mType == LLSD::TypeBinary; }
+	bool isMap() const				{ return mType == LLSD::TypeMap; }
+	bool isArray() const			{ return mType == LLSD::TypeArray; }
+
+	// Same conversions as LLSD.
+	LLSD::Boolean	asBoolean() const;
+	LLSD::Integer	asInteger() const;
+	LLSD::Real		asReal() const;
+	LLSD::String	asString() const;
+	LLSD::UUID		asUUID() const;
+	LLSD::Date		asDate() const;
+	LLSD::URI		asURI() const;
+	LLSD::Binary	asBinary() const;
+
+	// Deep copy into a regular LLSD.
+	LLSD asLLSD() const;
+
+	// Number of elements of a map or an array, 0 for everything else.
+	S32 size() const;
+
+	// Maps. Missing keys give an undefined value.
+	bool has(const std::string& key) const;
+	const LLSDArenaValue& get(const std::string& key) const;
+	const LLSDArenaValue& operator[](const std::string& key) const	{ return get(key); }
+	const LLSDArenaValue& operator[](const char* key) const			{ return get(std::string(key)); }
+
+	map_const_iterator beginMap() const;
+	map_const_iterator endMap() const;
+
+	// Arrays. Out of range indices give an undefined value.
+	const LLSDArenaValue& get(S32 index) const;
+	const LLSDArenaValue& operator[](S32 index) const				{ return get(index); }
+
+	array_const_iterator beginArray() const;
+	array_const_iterator endArray() const;
+
+	static const LLSDArenaValue& undefined();
+
+private:
+	friend class LLSDArenaDocument;
+	friend class LLSDArenaBuilder;
+
+	enum { INLINE_BYTES = 16 };
+
+	// Strings, URIs and binaries.
+	const char* data() const		{ return mSize <= INLINE_BYTES ? mInline : mChars; }
+	LLSD asScalar() const;
+
+	U8 mType;
+	U32 mSize;
+	union
+	{
+		LLSD::Boolean mBoolean;
+		LLSD::Integer mInteger;
+		LLSD::Real mReal;							// Also dates, in seconds since the epoch.
+		char mInline[INLINE_BYTES];					// UUIDs, and short strings and binaries.
+		const char* mChars;
+		const LLSDArenaValue* mArray;				// mSize values.
+		const LLSDArenaMapEntry* mMap;				// mSize entries, sorted by key.
+	};
+};
+
+struct LLSDArenaMapEntry
+{
+	LLSDArenaMapEntry(const std::string& key, const LLSDArenaValue& value) : first(key), second(value) { }
+
+	const std::string& first;						// Interned in the document.
+	const LLSDArenaValue second;
+};
+
+/**
+ * @class LLSDArenaDocument
+ * @brief A parsed LLSD document that is read, not modified.
+ *
+ * Building an LLSD allocates every node and every map entry separately;
+ * a multi-megabyte inventory reply costs hundreds of thousands of mallocs.
+ * An LLSDArenaDocument puts the values in big chunks instead, stores map
+ * keys only once, and frees everything at once in clear() or the
+ * destructor. It is filled straight from the parser events, see
+ * LLSDSerialize::fromBinary() and friends, or from an existing LLSD.
+ */
+class LL_COMMON_API LLSDArenaDocument
+{
+public:
+	LLSDArenaDocument(size_t chunk_size = DEFAULT_CHUNK_SIZE);
+	~LLSDArenaDocument();
+
+	// The whole document; undefined until something was parsed.
+	const LLSDArenaValue& root() const		{ return mRoot; }
+
+	// Replaces the content with a copy of sd.
+	void assign(const LLSD& sd);
+
+	// Frees everything but the first chunk, which is kept for reuse.
+	void clear();
+
+	// Bytes of arena in use, and the number of distinct map keys.
+	size_t getArenaBytes() const			{ return mUsedBytes; }
+	S32 getKeyCount() const					{ return (S32)mKeys.size(); }
+
+	enum { DEFAULT_CHUNK_SIZE = 64 * 1024 };
+
+private:
+	friend class LLSDArenaBuilder;
+
+	// Uninitialized, 8 byte aligned storage that lives until clear().
+	void* allocate(size_t bytes);
+	const std::string& intern(const std::string& key);
+
+	LLSDArenaDocument(const LLSDArenaDocument&);
+	LLSDArenaDocument& operator=(const LLSDArenaDocument&);
+
+	LLSDArenaValue mRoot;
+	std::set<std::string> mKeys;
+	std::vector<char*> mChunks;
+	std::vector<char*> mLargeChunks;				// Single allocations bigger than a quarter chunk.
+	size_t mChunkSize;
+	char* mFree;									// In the last chunk.
+	size_t mFreeBytes;
+	size_t mUsedBytes;
+};
+
+/**
+ * @class LLSDArenaBuilder
+ * @brief Fills an LLSDArenaDocument from parser events.
+ *
+ * Replaces what the document had when the first value arrives. Elements
+ * are collected on a stack that is reused for the whole document, and a
+ * map or array goes to the arena in one piece when it ends.
+ */
+class LL_COMMON_API LLSDArenaBuilder : public LLSDParserVisitor
+{
+public:
+	LLSDArenaBuilder(LLSDArenaDocument& document);
+
+	/*virtual*/ void startMap();
+	/*virtual*/ void key(const std::string& name);
+	/*virtual*/ void endMap();
+	/*virtual*/ void startArray();
+	/*virtual*/ void endArray();
+	/*virtual*/ void value(const LLSD& data);
+
+private:
+	struct Element
+	{
+		const std::string* mKey;					// NULL in arrays.
+		U32 mOrder;									// Keeps the first of duplicate keys first.
+		LLSDArenaValue mValue;
+
+		bool operator<(const Element& rhs) const
+		{
+			return mKey == rhs.mKey ? mOrder < rhs.mOrder : *mKey < *rhs.mKey;
+		}
+	};
+
+	struct Container
+	{
+		bool mIsMap;
+		const std::string* mKey;					// Key of this container in its parent map.
+		size_t mFirst;								// First element in mElements.
+	};
+
+	void start(bool is_map);
+	void end();
+	void add(const std::string* key, const LLSDArenaValue& value);
+
+	LLSDArenaDocument& mDocument;
+	std::vector<Container> mContainers;
+	std::vector<Element> mElements;
+	const std::string* mKey;						// Last key() in the current map.
+	bool mStarted;
+};
+
+#endif // LL_LLSDARENA_H
@@ -47,8 +47,11 @@
 #include "lldate.h"
 #include "llsd.h"
 #include "llstring.h"
+#include "llthread.h"
 #include "lluri.h"
 
+#include <limits>
+
 // File constants
 static const int MAX_HDR_LEN = 20;
 static const char LEGACY_NON_HEADER[] = "<llsd>";
@@ -305,6 +308,47 @@ static const char BINARY_TRUE_SERIAL = '1';
 static const char BINARY_FALSE_SERIAL = '0';
 
 
+/**
+ * LLSDParserVisitor
+ */
+void LLSDParserVisitor::visit(const LLSD& data)
+{
+	switch(data.type())
+	{
+	case LLSD::TypeMap:
+	{
+		startMap();
+		LLSD::map_const_iterator iter = data.beginMap();
+		LLSD::map_const_iterator end = data.endMap();
+		for(; iter != end; ++iter)
+		{
+			key((*iter).first);
+			visit((*iter).second);
+		}
+		endMap();
+		break;
+	}
+
+	case LLSD::TypeArray:
+	{
+		startArray();
+		LLSD::array_const_iterator iter = data.beginArray();
+		LLSD::array_const_iterator end = data.endArray();
+		for(; iter != end; ++iter)
+		{
+			visit(*iter);
+		}
+		endArray();
+		break;
+	}
+
+	default:
+		value(data);
+		break;
+	}
+}
+
+
 /**
  * LLSDParser
  */
@@ -325,6 +369,25 @@ S32 LLSDParser::parse(std::istream& istr, LLSD& data, S32 max_bytes)
 }
 
 
+S32 LLSDParser::parse(std::istream& istr, LLSDParserVisitor& visitor, S32 max_bytes)
+{
+	mCheckLimits = (LLSDSerialize::SIZE_UNLIMITED == max_bytes) ? false : true;
+	mMaxBytesLeft = max_bytes;
+	return doParse(istr, visitor);
+}
+
+// virtual
+S32 LLSDParser::doParse(std::istream& istr, LLSDParserVisitor& visitor) const
+{
+	LLSD data;
+	S32 parse_count = doParse(istr, data);
+	if(parse_count > 0)
+	{
+		visitor.visit(data);
+	}
+	return parse_count;
+}
+
 // Parse using routine to get() lines, faster than parse()
 S32 LLSDParser::parseLines(std::istream& istr, LLSD& data)
 {
@@ -658,6 +721,54 @@ S32 LLSDNotationParser::doParse(std::istream& istr, LLSD& data) const
 	return parse_count;
 }
 
+// virtual
+S32 LLSDNotationParser::doParse(std::istream& istr, LLSDParserVisitor& visitor) const
+{
+	// Maps and arrays are reported as they are read, everything else
+	// is parsed as usual and handed over as a value.
+	char c;
+	c = istr.peek();
+	while(isspace(c))
+	{
+		// pop the whitespace.
+		c = get(istr);
+		c = istr.peek();
+		continue;
+	}
+	if(!istr.good())
+	{
+		return 0;
+	}
+	S32 parse_count = 1;
+	if((c == '{') || (c == '['))
+	{
+		S32 child_count = (c == '{') ? parseMap(istr, visitor) : parseArray(istr, visitor);
+		if(child_count == PARSE_FAILURE)
+		{
+			parse_count = PARSE_FAILURE;
+		}
+		else
+		{
+			parse_count += child_count;
+		}
+		if(istr.fail())
+		{
+			llinfos << "STREAM FAILURE reading " << ((c == '{') ? "map." : "array.") << llendl;
+			parse_count = PARSE_FAILURE;
+		}
+	}
+	else
+	{
+		LLSD data;
+		parse_count = doParse(istr, data);
+		if(parse_count > 0)
+		{
+			visitor.value(data);
+		}
+	}
+	return parse_count;
+}
+
 S32 LLSDNotationParser::parseMap(std::istream& istr, LLSD& map) const
 {
 	// map: { string:object, string:object }
@@ -757,6 +868,100 @@ S32 LLSDNotationParser::parseArray(std::istream& istr, LLSD& array) const
 	return parse_count;
 }
 
+S32 LLSDNotationParser::parseMap(std::istream& istr, LLSDParserVisitor& visitor) const
+{
+	// map: { string:object, string:object }
+	S32 parse_count = 0;
+	char c = get(istr);
+	if(c != '{')
+	{
+		return PARSE_FAILURE;
+	}
+	visitor.startMap();
+	// eat commas, white
+	bool found_name = false;
+	std::string name;
+	c = get(istr);
+	while(c != '}' && istr.good())
+	{
+		if(!found_name)
+		{
+			if((c == '\"') || (c == '\'') || (c == 's'))
+			{
+				putback(istr, c);
+				found_name = true;
+				int count = deserialize_string(istr, name, mMaxBytesLeft);
+				if(PARSE_FAILURE == count) return PARSE_FAILURE;
+				account(count);
+				visitor.key(name);
+			}
+			c = get(istr);
+		}
+		else
+		{
+			if(isspace(c) || (c == ':'))
+			{
+				c = get(istr);
+				continue;
+			}
+			putback(istr, c);
+			S32 count = doParse(istr, visitor);
+			if(count > 0)
+			{
+				parse_count += count;
+			}
+			else
+			{
+				return PARSE_FAILURE;
+			}
+			found_name = false;
+			c = get(istr);
+		}
+	}
+	if(c != '}')
+	{
+		return PARSE_FAILURE;
+	}
+	visitor.endMap();
+	return parse_count;
+}
+
+S32 LLSDNotationParser::parseArray(std::istream& istr, LLSDParserVisitor& visitor) const
+{
+	// array: [ object, object, object ]
+	S32 parse_count = 0;
+	char c = get(istr);
+	if(c != '[')
+	{
+		return PARSE_FAILURE;
+	}
+	visitor.startArray();
+	// eat commas, white
+	c = get(istr);
+	while((c != ']') && istr.good())
+	{
+		if(isspace(c) || (c == ','))
+		{
+			c = get(istr);
+			continue;
+		}
+		putback(istr, c);
+		S32 count = doParse(istr, visitor);
+		if(PARSE_FAILURE == count)
+		{
+			return PARSE_FAILURE;
+		}
+		parse_count += count;
+		c = get(istr);
+	}
+	if(c != ']')
+	{
+		return PARSE_FAILURE;
+	}
+	visitor.endArray();
+	return parse_count;
+}
+
 bool LLSDNotationParser::parseString(std::istream& istr, LLSD& data) const
 {
 	std::string value;
@@ -1098,6 +1303,45 @@ S32 LLSDBinaryParser::doParse(std::istream& istr, LLSD& data) const
 	return parse_count;
 }
 
+// virtual
+S32 LLSDBinaryParser::doParse(std::istream& istr, LLSDParserVisitor& visitor) const
+{
+	// Maps and arrays are reported as they are read, everything else
+	// is parsed as usual and handed over as a value.
+	char c = istr.peek();
+	if(!istr.good())
+	{
+		return 0;
+	}
+	if((c != '{') && (c != '['))
+	{
+		LLSD data;
+		S32 parse_count = doParse(istr, data);
+		if(parse_count > 0)
+		{
+			visitor.value(data);
+		}
+		return parse_count;
+	}
+	get(istr);
+	S32 parse_count = 1;
+	S32 child_count = (c == '{') ? parseMap(istr, visitor) : parseArray(istr, visitor);
+	if(child_count == PARSE_FAILURE)
+	{
+		parse_count = PARSE_FAILURE;
+	}
+	else
+	{
+		parse_count += child_count;
+	}
+	if(istr.fail())
+	{
+		llinfos << "STREAM FAILURE reading binary " << ((c == '{') ? "map." : "array.") << llendl;
+		parse_count = PARSE_FAILURE;
+	}
+	return parse_count;
+}
+
 S32 LLSDBinaryParser::parseMap(std::istream& istr, LLSD& map) const
 {
 	map = LLSD::emptyMap();
@@ -1191,6 +1435,86 @@ S32 LLSDBinaryParser::parseArray(std::istream& istr, LLSD& array) const
 	return parse_count;
 }
 
+S32 LLSDBinaryParser::parseMap(std::istream& istr, LLSDParserVisitor& visitor) const
+{
+	U32 value_nbo = 0;
+	read(istr, (char*)&value_nbo, sizeof(U32));		 /*Flawfinder: ignore*/
+	S32 size = (S32)ntohl(value_nbo);
+	S32 parse_count = 0;
+	S32 count = 0;
+	visitor.startMap();
+	std::string name;
+	char c = get(istr);
+	while(c != '}' && (count < size) && istr.good())
+	{
+		name.clear();
+		switch(c)
+		{
+		case 'k':
+			if(!parseString(istr, name))
+			{
+				return PARSE_FAILURE;
+			}
+			break;
+		case '\'':
+		case '"':
+		{
+			int cnt = deserialize_string_delim(istr, name, c);
+			if(PARSE_FAILURE == cnt) return PARSE_FAILURE;
+			account(cnt);
+			break;
+		}
+		}
+		visitor.key(name);
+		S32 child_count = doParse(istr, visitor);
+		if(child_count > 0)
+		{
+			parse_count += child_count;
+		}
+		else
+		{
+			return PARSE_FAILURE;
+		}
+		++count;
+		c = get(istr);
+	}
+	if((c != '}') || (count < size))
+	{
+		return PARSE_FAILURE;
+	}
+	visitor.endMap();
+	return parse_count;
+}
+
+S32 LLSDBinaryParser::parseArray(std::istream& istr, LLSDParserVisitor& visitor) const
+{
+	U32 value_nbo = 0;
+	read(istr, (char*)&value_nbo, sizeof(U32));		 /*Flawfinder: ignore*/
+	S32 size = (S32)ntohl(value_nbo);
+	S32 parse_count = 0;
+	S32 count = 0;
+	visitor.startArray();
+	char c = istr.peek();
+	while((c != ']') && (count < size) && istr.good())
+	{
+		S32 child_count = doParse(istr, visitor);
+		if(PARSE_FAILURE == child_count)
+		{
+			return PARSE_FAILURE;
+		}
+		parse_count += child_count;
+		++count;
+		c = istr.peek();
+	}
+	c = get(istr);
+	if((c != ']') || (count < size))
+	{
+		return PARSE_FAILURE;
+	}
+	visitor.endArray();
+	return parse_count;
+}
+
 bool LLSDBinaryParser::parseString(
 	std::istream& istr,
 	std::string& value) const
@@ -1999,74 +2323,256 @@ std::ostream& operator<<(std::ostream& s, const LLSD& llsd)
 
 //dirty little zippers -- yell at davep if these are horrid
 
-//return a string containing gzipped bytes of binary serialized LLSD
-// VERY inefficient -- creates several copies of LLSD block in memory
-std::string zip_llsd(LLSD& data)
-{ 
-	std::stringstream llsd_strm;
-
-	LLSDSerialize::toBinary(data, llsd_strm);
+namespace
+{
+	const U32 ZIP_CHUNK = 65536;
 
-	const U32 CHUNK = 65536;
+	// zlib can't do better than about 1032:1, so this bounds what a block of
+	// compressed LLSD can claim to contain.
+	const S32 MAX_INFLATE_RATIO = 1032;
 
-	z_stream strm;
-	strm.zalloc = Z_NULL;
-	strm.zfree = Z_NULL;
-	strm.opaque = Z_NULL;
+	const std::string DEPRECATED_BINARY_HEADER("<? LLSD/Binary ?>");
 
-	S32 ret = deflateInit(&strm, Z_BEST_COMPRESSION);
-	if (ret != Z_OK)
+	// zlib streams and buffers of zip_llsd and unzip_llsd, one set per thread
+	// so that the mesh threads don't allocate them for every block.
+	class LLZipBuffers : public LLThreadLocalDataMember
 	{
-		llwarns << "Failed to compress LLSD block." << llendl;
-		return std::string();
-	}
+	public:
+		LLZipBuffers() : mDeflateInit(false), mInflateInit(false)
+		{
+			memset(&mDeflate, 0, sizeof(mDeflate));
+			memset(&mInflate, 0, sizeof(mInflate));
+		}
 
-	std::string source = llsd_strm.str();
+		/*virtual*/ ~LLZipBuffers()
+		{
+			if (mDeflateInit)
+			{
+				deflateEnd(&mDeflate);
+			}
+			if (mInflateInit)
+			{
+				inflateEnd(&mInflate);
+			}
+		}
 
-	U8 out[CHUNK];
+		z_stream* getDeflate()
+		{
+			if (mDeflateInit)
+			{
+				deflateReset(&mDeflate);
+			}
+			else if (deflateInit(&mDeflate, Z_BEST_COMPRESSION) == Z_OK)
+			{
+				mDeflateInit = true;
+			}
+			else
+			{
+				return NULL;
+			}
+			return &mDeflate;
+		}
 
-	strm.avail_in = source.size();
-	strm.next_in = (U8*) source.data();
-	U8* output = NULL;
+		z_stream* getInflate()
+		{
+			if (mInflateInit)
+			{
+				inflateReset(&mInflate);
+			}
+			else if (inflateInit(&mInflate) == Z_OK)
+			{
+				mInflateInit = true;
+			}
+			else
+			{
+				return NULL;
+			}
+			return &mInflate;
+		}
 
-	U32 cur_size = 0;
+		static LLZipBuffers& get()
+		{
+			LLThreadLocalDataMember*& buffers = LLThreadLocalData::tldata().mZipBuffers;
+			if (!buffers)
+			{
+				buffers = new LLZipBuffers;
+			}
+			return *static_cast<LLZipBuffers*>(buffers);
+		}
 
-	U32 have = 0;
+		U8 mIn[ZIP_CHUNK];
+		U8 mOut[ZIP_CHUNK];
 
-	do
+	private:
+		z_stream mDeflate;
+		z_stream mInflate;
+		bool mDeflateInit;
+		bool mInflateInit;
+	};
+
+	// Deflates what is written to it and appends the result to a string.
+	class LLDeflateStreamBuf : public std::streambuf
 	{
-		strm.avail_out = CHUNK;
-		strm.next_out = out;
+	public:
+		LLDeflateStreamBuf(std::string& result, LLZipBuffers& buffers)
+		:	mResult(result),
+			mBuffers(buffers),
+			mStream(buffers.getDeflate()),
+			mFailed(!mStream)
+		{
+			char* in = (char*)mBuffers.mIn;
+			setp(in, in + ZIP_CHUNK);
+		}
 
-		ret = deflate(&strm, Z_FINISH);
-		if (ret == Z_OK || ret == Z_STREAM_END)
-		{ //copy result into output
-			if (strm.avail_out >= CHUNK)
+		// Flushes the rest, returns false on failure.
+		bool finish()
+		{
+			return deflateInput(Z_FINISH) && !mFailed;
+		}
+
+	protected:
+		/*virtual*/ int_type overflow(int_type c)
+		{
+			if (!deflateInput(Z_NO_FLUSH))
+			{
+				return traits_type::eof();
+			}
+			if (!traits_type::eq_int_type(c, traits_type::eof()))
 			{
-				free(output);
-				llwarns << "Failed to compress LLSD block." << llendl;
-				return std::string();
+				*pptr() = traits_type::to_char_type(c);
+				pbump(1);
 			}
+			return traits_type::not_eof(c);
+		}
 
-			have = CHUNK-strm.avail_out;
-			output = (U8*) realloc(output, cur_size+have);
-			memcpy(output+cur_size, out, have);
-			cur_size += have;
+	private:
+		bool deflateInput(int flush)
+		{
+			if (mFailed)
+			{
+				return false;
+			}
+			mStream->next_in = (Bytef*)pbase();
+			mStream->avail_in = (uInt)(pptr() - pbase());
+			S32 ret;
+			do
+			{
+				mStream->next_out = mBuffers.mOut;
+				mStream->avail_out = ZIP_CHUNK;
+				ret = deflate(mStream, flush);
+				if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR)
+				{
+					mFailed = true;
+					return false;
+				}
+				mResult.append((char*)mBuffers.mOut, ZIP_CHUNK - mStream->avail_out);
+			}
+			while (mStream->avail_out == 0 || (flush == Z_FINISH && ret != Z_STREAM_END));
+			setp(pbase(), epptr());
+			return true;
+		}
+
+		std::string& mResult;
+		LLZipBuffers& mBuffers;
+		z_stream* mStream;
+		bool mFailed;
+	};
+
+	// Reads up to size bytes of zlib compressed data from a stream, and
+	// makes the inflated data available for reading.
+	class LLInflateStreamBuf : public std::streambuf
+	{
+	public:
+		LLInflateStreamBuf(std::istream& source, S32 size, LLZipBuffers& buffers)
+		:	mSource(source),
+			mSourceLeft(llmax(size, 0)),
+			mBuffers(buffers),
+			mStream(buffers.getInflate()),
+			mStatus(mStream ? Z_OK : Z_STREAM_ERROR)
+		{
+			if (mStream)
+			{
+				mStream->next_in = mBuffers.mIn;
+				mStream->avail_in = 0;
+			}
 		}
-		else 
+
+		~LLInflateStreamBuf()
 		{
-			free(output);
-			llwarns << "Failed to compress LLSD block." << llendl;
-			return std::string();
+			// Leave the source after the compressed block, as if it was read in one go.
+			if (mSourceLeft > 0)
+			{
+				mSource.ignore(mSourceLeft);
+			}
 		}
-	}
-	while (ret == Z_OK);
 
-	std::string::size_type size = cur_size;
+		// True when the end of the compressed data was reached, and its checksum matched.
+		bool isComplete() const		{ return mStatus == Z_STREAM_END; }
 
-	std::string result((char*) output, size);
-	deflateEnd(&strm);
-	free(output);
+	protected:
+		/*virtual*/ int_type underflow()
+		{
+			while (mStatus == Z_OK)
+			{
+				if (!mStream->avail_in && mSourceLeft > 0)
+				{
+					mSource.read((char*)mBuffers.mIn, llmin(mSourceLeft, (S32)ZIP_CHUNK));
+					S32 count = (S32)mSource.gcount();
+					mSourceLeft = count > 0 ? mSourceLeft - count : 0;
+					mStream->next_in = mBuffers.mIn;
+					mStream->avail_in = count;
+				}
+				mStream->next_out = mBuffers.mOut;
+				mStream->avail_out = ZIP_CHUNK;
+				S32 ret = inflate(mStream, Z_NO_FLUSH);
+				switch (ret)
+				{
+				case Z_OK:
+					break;
+				case Z_STREAM_END:
+					mStatus = Z_STREAM_END;
+					break;
+				case Z_BUF_ERROR:
+					// No progress possible: the input is truncated.
+					mStatus = Z_DATA_ERROR;
+					break;
+				default:
+					mStatus = ret;
+					break;
+				}
+				U32 have = ZIP_CHUNK - mStream->avail_out;
+				if (have)
+				{
+					char* out = (char*)mBuffers.mOut;
+					setg(out, out, out + have);
+					return traits_type::to_int_type(*out);
+				}
+			}
+			return traits_type::eof();
+		}
+
+	private:
+		std::istream& mSource;
+		S32 mSourceLeft;
+		LLZipBuffers& mBuffers;
+		z_stream* mStream;
+		S32 mStatus;
+	};
+}
+
+// Formats data straight into the deflate stream, with per thread zlib state and
+// buffers. The only allocation is the growth of the result.
+std::string zip_llsd(LLSD& data)
+{ 
+	std::string result;
+	LLDeflateStreamBuf buf(result, LLZipBuffers::get());
+	std::ostream ostr(&buf);
+	LLSDSerialize::toBinary(data, ostr);
+	if (!buf.finish())
+	{
+		llwarns << "Failed to compress LLSD block." << llendl;
+		return std::string();
+	}
 
 #if 0 //verify results work with unzip_llsd
 	std::istringstream test(result);
@@ -2081,97 +2587,46 @@ std::string zip_llsd(LLSD& data)
 }
 
 //decompress a block of LLSD from provided istream
-// not very efficient -- creats a copy of decompressed LLSD block in memory
-// and deserializes from that copy using LLSDSerialize
+// The binary parser reads from the inflate stream directly, so neither the
+// compressed nor the decompressed block is copied in memory.
 bool unzip_llsd(LLSD& data, std::istream& is, S32 size)
 {
-	U8* result = NULL;
-	U32 cur_size = 0;
-	z_stream strm;
-		
-	const U32 CHUNK = 65536;
-
-	U8 *in = new U8[size];
-	is.read((char*) in, size); 
-
-	U8 out[CHUNK];
-		
-	strm.zalloc = Z_NULL;
-	strm.zfree = Z_NULL;
-	strm.opaque = Z_NULL;
-	strm.avail_in = size;
-	strm.next_in = in;
+	LLInflateStreamBuf buf(is, size, LLZipBuffers::get());
+	std::istream istr(&buf);
 
-	S32 ret = inflateInit(&strm);
-	
-	do
+	if (istr.peek() == '<')
 	{
-		strm.avail_out = CHUNK;
-		strm.next_out = out;
-		ret = inflate(&strm, Z_NO_FLUSH);
-		if (ret == Z_STREAM_ERROR)
+		char header[sizeof("<? LLSD/Binary ?>")];
+		istr.read(header, sizeof(header));
+		if (istr.gcount() != sizeof(header) ||
+			DEPRECATED_BINARY_HEADER.compare(0, std::string::npos, header, DEPRECATED_BINARY_HEADER.size()))
 		{
-			inflateEnd(&strm);
-			free(result);
-			delete [] in;
-			return false;
-		}
-		
-		switch (ret)
-		{
-		case Z_NEED_DICT:
-			ret = Z_DATA_ERROR;
-		case Z_DATA_ERROR:
-		case Z_MEM_ERROR:
-			inflateEnd(&strm);
-			free(result);
-			delete [] in;
+			llwarns << "Failed to unzip LLSD block" << llendl;
 			return false;
-			break;
 		}
+	}
 
-		U32 have = CHUNK-strm.avail_out;
-
-		result = (U8*) realloc(result, cur_size + have);
-		memcpy(result+cur_size, out, have);
-		cur_size += have;
-
-	} while (ret == Z_OK);
-
-	inflateEnd(&strm);
-	delete [] in;
-
-	if (ret != Z_STREAM_END)
+	// Parsed aside, so that data is left alone when the block turns out to be bad.
+	LLSD result;
+	S32 max_bytes = size < S32_MAX / MAX_INFLATE_RATIO ? size * MAX_INFLATE_RATIO : S32_MAX;
+	LLPointer<LLSDBinaryParser> parser = new LLSDBinaryParser;
+	if (parser->parse(istr, result, max_bytes) <= 0)
 	{
-		free(result);
+		llwarns << "Failed to unzip LLSD block" << llendl;
 		return false;
 	}
 
-	//result now points to the decompressed LLSD block
+	// Check the rest of the block, like the checksum.
+	istr.ignore(std::numeric_limits<std::streamsize>::max());
+	if (!buf.isComplete())
 	{
-		std::string res_str((char*) result, cur_size);
-
-		std::string deprecated_header("<? LLSD/Binary ?>");
-
-		if (res_str.substr(0, deprecated_header.size()) == deprecated_header)
-		{
-			res_str = res_str.substr(deprecated_header.size()+1, cur_size);
-		}
-		cur_size = res_str.size();
-
-		std::istringstream istr(res_str);
-		
-		if (!LLSDSerialize::fromBinary(data, istr, cur_size))
-		{
-			llwarns << "Failed to unzip LLSD block" << llendl;
-			free(result);
-			return false;
-		}		
+		llwarns << "Failed to unzip LLSD block" << llendl;
+		return false;
 	}
-
-	free(result);
+	data = result;
 	return true;
 }
+
 //This unzip function will only work with a gzip header and trailer - while the contents
 //of the actual compressed data is the same for either format (gzip vs zlib ), the headers
 //and trailers are different for the formats.
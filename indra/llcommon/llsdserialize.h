@@ -40,6 +40,37 @@
 #include "llrefcount.h"
 #include "llsd.h"
 
+class LLSDArenaDocument;
+
+/** 
+ * @class LLSDParserVisitor
+ * @brief Receives the structure of LLSD as it is parsed, instead of a tree.
+ *
+ * Pass one to LLSDParser::parse() to consume large documents without
+ * building an LLSD for all of them. Maps produce startMap(), then key()
+ * followed by the events of its value for every entry, then endMap().
+ * Arrays produce startArray(), the events of every element, and endArray().
+ * Everything else is passed to value(). Keys are reported as they are in
+ * the document, duplicates included. The default implementations do nothing.
+ */
+class LL_COMMON_API LLSDParserVisitor
+{
+public:
+	virtual ~LLSDParserVisitor() { }
+
+	virtual void startMap() { }
+	virtual void key(const std::string& name) { }
+	virtual void endMap() { }
+	virtual void startArray() { }
+	virtual void endArray() { }
+	virtual void value(const LLSD& data) { }
+
+	/** 
+	 * @brief Produce the events for data, as if it was parsed.
+	 */
+	void visit(const LLSD& data);
+};
+
 /** 
  * @class LLSDParser
  * @brief Abstract base class for LLSD parsers.
@@ -85,6 +116,15 @@ public:
 	 */
 	S32 parse(std::istream& istr, LLSD& data, S32 max_bytes);
 
+	/** 
+	 * @brief Like parse(), but passes the data to visitor as it is parsed.
+	 *
+	 * On failure the visitor may have received part of the data.
+	 * @return Returns the number of LLSD objects parsed, or
+	 * PARSE_FAILURE (-1) on parse failure.
+	 */
+	S32 parse(std::istream& istr, LLSDParserVisitor& visitor, S32 max_bytes);
+
 	/** Like parse(), but uses a different call (istream.getline()) to read by lines
 	 *  This API is better suited for XML, where the parse cannot tell
 	 *  where the document actually ends.
@@ -114,6 +154,14 @@ protected:
 	 */
 	virtual S32 doParse(std::istream& istr, LLSD& data) const = 0;
 
+	/** 
+	 * @brief Parse for a visitor.
+	 *
+	 * The default parses into an LLSD and then visits that; the
+	 * parsers in this file override it to produce the events directly.
+	 */
+	virtual S32 doParse(std::istream& istr, LLSDParserVisitor& visitor) const;
+
 	/** 
 	 * @brief Virtual default function for resetting the parser
 	 */
@@ -251,6 +299,7 @@ protected:
 	 * data. Returns PARSE_FAILURE (-1) on parse failure.
 	 */
 	virtual S32 doParse(std::istream& istr, LLSD& data) const;
+	virtual S32 doParse(std::istream& istr, LLSDParserVisitor& visitor) const;
 
 private:
 	/** 
@@ -271,6 +320,14 @@ private:
 	 */
 	S32 parseArray(std::istream& istr, LLSD& array) const;
 
+	/** 
+	 * @brief Parse a map or an array from the istream for a visitor.
+	 *
+	 * @return Returns The number of LLSD objects parsed.
+	 */
+	S32 parseMap(std::istream& istr, LLSDParserVisitor& visitor) const;
+	S32 parseArray(std::istream& istr, LLSDParserVisitor& visitor) const;
+
 	/** 
 	 * @brief Parse a string from the istream and assign it to data.
 	 *
@@ -324,6 +381,7 @@ protected:
 	 * data. Returns PARSE_FAILURE (-1) on parse failure.
 	 */
 	virtual S32 doParse(std::istream& istr, LLSD& data) const;
+	virtual S32 doParse(std::istream& istr, LLSDParserVisitor& visitor) const;
 
 	/** 
 	 * @brief Virtual default function for resetting the parser
@@ -372,6 +430,7 @@ protected:
 	 * data. Returns -1 on parse failure.
 	 */
 	virtual S32 doParse(std::istream& istr, LLSD& data) const;
+	virtual S32 doParse(std::istream& istr, LLSDParserVisitor& visitor) const;
 
 private:
 	/** 
@@ -392,6 +451,14 @@ private:
 	 */
 	S32 parseArray(std::istream& istr, LLSD& array) const;
 
+	/** 
+	 * @brief Parse a map or an array from the istream for a visitor.
+	 *
+	 * @return Returns The number of LLSD objects parsed.
+	 */
+	S32 parseMap(std::istream& istr, LLSDParserVisitor& visitor) const;
+	S32 parseArray(std::istream& istr, LLSDParserVisitor& visitor) const;
+
 	/** 
 	 * @brief Parse a string from the istream and assign it to data.
 	 *
@@ -733,6 +800,13 @@ public:
 		(void)p->parse(str, sd, max_bytes);
 		return sd;
 	}
+	static S32 fromNotation(LLSDParserVisitor& visitor, std::istream& str, S32 max_bytes)
+	{
+		LLPointer<LLSDNotationParser> p = new LLSDNotationParser;
+		return p->parse(str, visitor, max_bytes);
+	}
+	// Into an arena; see llsdarena.h. The document is cleared on failure.
+	static S32 fromNotation(LLSDArenaDocument& document, std::istream& str, S32 max_bytes);
 	
 	/*
 	 * XML Methods
@@ -768,6 +842,12 @@ public:
 		return fromXMLEmbedded(sd, str);
 //		return fromXMLDocument(sd, str);
 	}
+	static S32 fromXML(LLSDParserVisitor& visitor, std::istream& str)
+	{
+		LLPointer<LLSDXMLParser> p = new LLSDXMLParser;
+		return p->parse(str, visitor, LLSDSerialize::SIZE_UNLIMITED);
+	}
+	static S32 fromXML(LLSDArenaDocument& document, std::istream& str);
 
 	/*
 	 * Binary Methods
@@ -789,6 +869,12 @@ public:
 		(void)p->parse(str, sd, max_bytes);
 		return sd;
 	}
+	static S32 fromBinary(LLSDParserVisitor& visitor, std::istream& str, S32 max_bytes)
+	{
+		LLPointer<LLSDBinaryParser> p = new LLSDBinaryParser;
+		return p->parse(str, visitor, max_bytes);
+	}
+	static S32 fromBinary(LLSDArenaDocument& document, std::istream& str, S32 max_bytes);
 };
 
 //dirty little zip functions -- yell at davep
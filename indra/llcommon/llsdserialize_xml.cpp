@@ -259,6 +259,8 @@ public:
 	
 	S32 parse(std::istream& input, LLSD& data);
 	S32 parseLines(std::istream& input, LLSD& data);
+	S32 parse(std::istream& input, LLSDParserVisitor& visitor);
+	S32 parseLines(std::istream& input, LLSDParserVisitor& visitor);
 
 	void parsePart(const char *buf, int len);
 	
@@ -309,6 +311,11 @@ private:
 	
 	typedef std::deque<LLSD*> LLSDRefStack;
 	LLSDRefStack mStack;
+
+	// When set, the values go to mVisitor instead of mResult, and
+	// mVisitStack takes the place of mStack.
+	LLSDParserVisitor* mVisitor;
+	std::vector<Element> mVisitStack;
 	
 	int mDepth;
 	bool mSkipping;
@@ -320,6 +327,7 @@ private:
 
 
 LLSDXMLParser::Impl::Impl()
+	: mVisitor(NULL)
 {
 	mParser = XML_ParserCreate(NULL);
 	reset();
@@ -494,6 +502,25 @@ S32 LLSDXMLParser::Impl::parseLines(std::istream& input, LLSD& data)
 }
 
 
+S32 LLSDXMLParser::Impl::parse(std::istream& input, LLSDParserVisitor& visitor)
+{
+	LLSD unused;
+	mVisitor = &visitor;
+	S32 parse_count = parse(input, unused);
+	mVisitor = NULL;
+	return parse_count;
+}
+
+S32 LLSDXMLParser::Impl::parseLines(std::istream& input, LLSDParserVisitor& visitor)
+{
+	LLSD unused;
+	mVisitor = &visitor;
+	S32 parse_count = parseLines(input, unused);
+	mVisitor = NULL;
+	return parse_count;
+}
+
+
 void LLSDXMLParser::Impl::reset()
 {
 	mResult.clear();
@@ -505,6 +532,7 @@ void LLSDXMLParser::Impl::reset()
 	mGracefullStop = false;
 
 	mStack.clear();
+	mVisitStack.clear();
 	
 	mSkipping = false;
 	
@@ -608,7 +636,8 @@ void LLSDXMLParser::Impl::startElementHandler(const XML_Char* name, const XML_Ch
 			return;
 	
 		case ELEMENT_KEY:
-			if (mStack.empty()  ||  !(mStack.back()->isMap()))
+			if (mVisitor ? (mVisitStack.empty() || mVisitStack.back() != ELEMENT_MAP)
+						 : (mStack.empty() || !(mStack.back()->isMap())))
 			{
 				return startSkipping();
 			}
@@ -628,6 +657,35 @@ void LLSDXMLParser::Impl::startElementHandler(const XML_Char* name, const XML_Ch
 	
 
 	if (!mInLLSDElement) { return startSkipping(); }
+
+	if (mVisitor)
+	{
+		if (!mVisitStack.empty())
+		{
+			if (mVisitStack.back() == ELEMENT_MAP)
+			{
+				if (mCurrentKey.empty()) { return startSkipping(); }
+				mVisitor->key(mCurrentKey);
+				mCurrentKey.clear();
+			}
+			else if (mVisitStack.back() != ELEMENT_ARRAY)
+			{
+				// improperly nested value in a non-structure
+				return startSkipping();
+			}
+		}
+		mVisitStack.push_back(element);
+		++mParseCount;
+		if (element == ELEMENT_MAP)
+		{
+			mVisitor->startMap();
+		}
+		else if (element == ELEMENT_ARRAY)
+		{
+			mVisitor->startArray();
+		}
+		return;
+	}
 	
 	if (mStack.empty())
 	{
@@ -716,8 +774,16 @@ void LLSDXMLParser::Impl::endElementHandler(const XML_Char* name)
 	
 	if (!mInLLSDElement) { return; }
 
-	LLSD& value = *mStack.back();
-	mStack.pop_back();
+	LLSD visited;
+	if (mVisitor)
+	{
+		mVisitStack.pop_back();
+	}
+	LLSD& value = mVisitor ? visited : *mStack.back();
+	if (!mVisitor)
+	{
+		mStack.pop_back();
+	}
 	
 	switch (element)
 	{
@@ -805,6 +871,22 @@ void LLSDXMLParser::Impl::endElementHandler(const XML_Char* name)
 			break;
 	}
 
+	if (mVisitor)
+	{
+		if (element == ELEMENT_MAP)
+		{
+			mVisitor->endMap();
+		}
+		else if (element == ELEMENT_ARRAY)
+		{
+			mVisitor->endArray();
+		}
+		else
+		{
+			mVisitor->value(value);
+		}
+	}
+
 	mCurrentContent.clear();
 }
 
@@ -940,6 +1022,17 @@ S32 LLSDXMLParser::doParse(std::istream& input, LLSD& data) const
 	return impl.parse(input, data);
 }
 
+// virtual
+S32 LLSDXMLParser::doParse(std::istream& input, LLSDParserVisitor& visitor) const
+{
+	if (mParseLines)
+	{
+		return impl.parseLines(input, visitor);
+	}
+
+	return impl.parse(input, visitor);
+}
+
 //	virtual 
 void LLSDXMLParser::doReset()
 {
@@ -66,6 +66,7 @@ public:
 	LLAPRRootPool mRootPool;
 	LLVolatileAPRPool mVolatileAPRPool;
 	LLThreadLocalDataMember* mCurlMultiHandle;	// Initialized by AICurlMultiHandle::getInstance
+	LLThreadLocalDataMember* mZipBuffers;		// Initialized by zip_llsd and unzip_llsd
 	char* mCurlErrorBuffer;						// NULL, or pointing to a buffer used by libcurl.
 	std::string mName;							// "main thread", or a copy of LLThread::mName.
 
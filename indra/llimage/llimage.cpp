@@ -37,6 +37,7 @@
 #include "llimagejpeg.h"
 #include "llimagepng.h"
 #include "llimagedxt.h"
+#include "llimagekernels.h"
 #include "llimageworker.h"
 #include "llmemory.h"
 
@@ -314,27 +315,24 @@ LLImageRaw::LLImageRaw(U8 *data, U16 width, U16 height, S8 components, bool no_c
 	++sRawImageCount;
 }
 
-LLImageRaw::LLImageRaw(LLImageRaw const* src, U16 width, U16 height, U16 crop_offset, bool crop_vertically) : mCacheEntries(0)
+LLImageRaw::LLImageRaw(LLImageRawView const* src) : mCacheEntries(0)
 {
 	llassert_always(src);
-	S8 const components = src->getComponents();
-	U8 const* const data = src->getData();
-	if (allocateDataSize(width, height, components))
+	mComment = src->getParent()->mComment;
+	if (allocateDataSize(src->getWidth(), src->getHeight(), src->getComponents()))
 	{
-		if (crop_vertically)
-		{
-			llassert_always(width == src->getWidth());
-			memcpy(getData(), data + width * crop_offset * components, width * height * components);
-		}
-		else
-		{
-			llassert_always(height == src->getHeight());
-			U16 const src_width = src->getWidth();
-			for (U16 row = 0; row < height; ++row)
-			{
-				memcpy(getData() + width * row * components, data + (src_width * row + crop_offset) * components, width * components);
-			}
-		}
+		copyScaled(src->getData(), src->getWidth(), src->getHeight(), src->getRowStride());
+	}
+	++sRawImageCount;
+}
+
+LLImageRaw::LLImageRaw(LLImageRawView const* src, U16 width, U16 height) : mCacheEntries(0)
+{
+	llassert_always(src);
+	mComment = src->getParent()->mComment;
+	if (allocateDataSize(width, height, src->getComponents()))
+	{
+		copyScaled(src->getData(), src->getWidth(), src->getHeight(), src->getRowStride());
 	}
 	++sRawImageCount;
 }
@@ -647,10 +645,7 @@ void LLImageRaw::compositeScaled4onto3(LLImageRaw* src)
 	std::vector<U8> temp_buffer(temp_data_size);
 
 	// Vertical: scale but no composite
-	for( S32 col = 0; col < src->getWidth(); col++ )
-	{
-		copyLineScaled( src->getData() + (src->getComponents() * col), &temp_buffer[0] + (src->getComponents() * col), src->getHeight(), dst->getHeight(), src->getWidth(), src->getWidth() );
-	}
+	LLImageKernels::scaleColumns( src->getData(), &temp_buffer[0], src->getComponents() * src->getWidth(), src->getHeight(), dst->getHeight() );
 
 	// Horizontal: scale and composite
 	for( S32 row = 0; row < dst->getHeight(); row++ )
@@ -689,33 +684,7 @@ void LLImageRaw::compositeUnscaled4onto3( LLImageRaw* src )
 	llassert( (src->getWidth() == dst->getWidth()) && (src->getHeight() == dst->getHeight()) );
 
 
-	U8* src_data = src->getData();
-	U8* dst_data = dst->getData();
-	S32 pixels = getWidth() * getHeight();
-	while( pixels-- )
-	{
-		U8 alpha = src_data[3];
-		if( alpha )
-		{
-			if( 255 == alpha )
-			{
-				dst_data[0] = src_data[0];
-				dst_data[1] = src_data[1];
-				dst_data[2] = src_data[2];
-			}
-			else
-			{
-
-				U8 transparency = 255 - alpha;
-				dst_data[0] = fastFractionalMult( dst_data[0], transparency ) + fastFractionalMult( src_data[0], alpha );
-				dst_data[1] = fastFractionalMult( dst_data[1], transparency ) + fastFractionalMult( src_data[1], alpha );
-				dst_data[2] = fastFractionalMult( dst_data[2], transparency ) + fastFractionalMult( src_data[2], alpha );
-			}
-		}
-
-		src_data += 4;
-		dst_data += 3;
-	}
+	LLImageKernels::composite4onto3( src->getData(), dst->getData(), getWidth() * getHeight() );
 }
 
 void LLImageRaw::copyUnscaledAlphaMask( LLImageRaw* src, const LLColor4U& fill)
@@ -917,40 +886,55 @@ void LLImageRaw::copyUnscaled3onto4( LLImageRaw* src )
 // Src and dst can be any size.  Src and dst have same number of components.
 void LLImageRaw::copyScaled( LLImageRaw* src )
 {
-	LLImageRaw* dst = this;  // Just for clarity.
-
 	llassert_always( (1 == src->getComponents()) || (3 == src->getComponents()) || (4 == src->getComponents()) );
-	llassert_always( src->getComponents() == dst->getComponents() );
+	llassert_always( src->getComponents() == getComponents() );
 
-	if( (src->getWidth() == dst->getWidth()) && (src->getHeight() == dst->getHeight()) )
+	copyScaled( src->getData(), src->getWidth(), src->getHeight(), src->getWidth() * src->getComponents() );
+}
+
+void LLImageRaw::copyScaled( const U8* src, S32 src_width, S32 src_height, S32 row_stride )
+{
+	const S32 components = getComponents();
+	const S32 src_row_bytes = src_width * components;
+	const S32 dst_row_bytes = getWidth() * components;
+
+	if( src_height == getHeight() )
+	{
+		if( src_width == getWidth() )
+		{
+			for( S32 row = 0; row < src_height; row++ )
+			{
+				memcpy( getData() + dst_row_bytes * row, src + row_stride * row, dst_row_bytes );	/* Flawfinder: ignore */
+			}
+		}
+		else
+		{
+			LLImageKernels::scaleRows( src, getData(), src_width, getWidth(), components, src_height, row_stride );
+		}
+		return;
+	}
+	if( src_width == getWidth() )
 	{
-		memcpy( dst->getData(), src->getData(), getWidth() * getHeight() * getComponents() );	/* Flawfinder: ignore */
+		LLImageKernels::scaleColumns( src, getData(), src_row_bytes, src_height, getHeight(), row_stride );
 		return;
 	}
 
-	S32 temp_data_size = src->getWidth() * dst->getHeight() * getComponents();
+	S32 temp_data_size = src_row_bytes * getHeight();
 	llassert_always(temp_data_size > 0);
 	try
 	{
 	std::vector<U8> temp_buffer(temp_data_size);
 
 	// Vertical
-	for( S32 col = 0; col < src->getWidth(); col++ )
-	{
-		copyLineScaled( src->getData() + (getComponents() * col), &temp_buffer[0] + (getComponents() * col), src->getHeight(), dst->getHeight(), src->getWidth(), src->getWidth() );
-	}
+	LLImageKernels::scaleColumns( src, &temp_buffer[0], src_row_bytes, src_height, getHeight(), row_stride );
 
 	// Horizontal
-	for( S32 row = 0; row < dst->getHeight(); row++ )
-	{
-		copyLineScaled( &temp_buffer[0] + (getComponents() * src->getWidth() * row), dst->getData() + (getComponents() * dst->getWidth() * row), src->getWidth(), dst->getWidth(), 1, 1 );
-	}
+	LLImageKernels::scaleRows( &temp_buffer[0], getData(), src_width, getWidth(), components, getHeight() );
 	}
 	catch(std::bad_alloc)
 	{
 		llerrs << "Out of memory in LLImageRaw::copyScaled()" << llendl;
 	}
-	
 }
 
 #if 0
@@ -1025,10 +1009,7 @@ BOOL LLImageRaw::scale( S32 new_width, S32 new_height, BOOL scale_image_data )
 			// Resize vertically.
 			old_buffer = LLImageBase::release();
 			new_buffer = allocateDataSize(old_width, new_height, getComponents());
-			for (S32 col = 0; col < old_width; ++col)
-			{
-				copyLineScaled(old_buffer + getComponents() * col, new_buffer + getComponents() * col, old_height, new_height, old_width, old_width);
-			}
+			LLImageKernels::scaleColumns(old_buffer, new_buffer, old_width_bytes, old_height, new_height);
 			LLImageBase::deleteData(old_buffer);
 		}
 		if (new_width != old_width)
@@ -1036,10 +1017,7 @@ BOOL LLImageRaw::scale( S32 new_width, S32 new_height, BOOL scale_image_data )
 			// Resize horizontally.
 			old_buffer = LLImageBase::release();
 			new_buffer = allocateDataSize(new_width, new_height, getComponents());
-			for (S32 row = 0; row < new_height; ++row)
-			{
-				copyLineScaled(old_buffer + old_width_bytes * row, new_buffer + new_width_bytes * row, old_width, new_width, 1, 1);
-			}
+			LLImageKernels::scaleRows(old_buffer, new_buffer, old_width, new_width, getComponents(), new_height);
 			LLImageBase::deleteData(old_buffer);
 		}
 	}
@@ -1423,6 +1401,27 @@ bool LLImageRaw::createFromFile(const std::string &filename, bool j2c_lowest_mip
 	return true;
 }
 #endif
+
+//---------------------------------------------------------------------------
+// LLImageRawView
+//---------------------------------------------------------------------------
+
+LLImageRawView::LLImageRawView(LLImageRaw* parent)
+	: mParent(parent), mX(0), mY(0), mWidth(parent->getWidth()), mHeight(parent->getHeight())
+{
+}
+
+LLImageRawView::LLImageRawView(LLImageRaw* parent, U16 x, U16 y, U16 width, U16 height)
+	: mParent(parent), mX(x), mY(y), mWidth(width), mHeight(height)
+{
+	llassert_always(x + width <= parent->getWidth() && y + height <= parent->getHeight());
+}
+
+const U8* LLImageRawView::getData() const
+{
+	return mParent->getData() + mY * getRowStride() + mX * getComponents();
+}
+
 //---------------------------------------------------------------------------
 // LLImageFormatted
 //---------------------------------------------------------------------------
@@ -60,6 +60,7 @@ const S32 MAX_IMG_PACKET_SIZE = 1000;
 
 class LLImageFormatted;
 class LLImageRaw;
+class LLImageRawView;
 class LLColor4U;
 class LLPrivateMemoryPool;
 
@@ -174,7 +175,10 @@ public:
 	LLImageRaw();
 	LLImageRaw(U16 width, U16 height, S8 components);
 	LLImageRaw(U8 *data, U16 width, U16 height, S8 components, bool no_copy = false);
-	LLImageRaw(LLImageRaw const* src, U16 width, U16 height, U16 crop_offset, bool crop_vertically);
+	// Packed copy of the pixels under a view.
+	LLImageRaw(LLImageRawView const* src);
+	// Box filtered copy of the pixels under a view, scaled straight to width x height.
+	LLImageRaw(LLImageRawView const* src, U16 width, U16 height);
 	// Construct using createFromFile (used by tools)
 	//LLImageRaw(const std::string& filename, bool j2c_lowest_mip_only = false);
 
@@ -249,6 +253,9 @@ protected:
 	// Create an image from a local file (generally used in tools)
 	//bool createFromFile(const std::string& filename, bool j2c_lowest_mip_only = false);
 
+	// Src rectangle and dst can be any size, same number of components.  Rows of src are row_stride bytes apart.
+	void copyScaled( const U8* src, S32 src_width, S32 src_height, S32 row_stride );
+
 	void copyLineScaled( U8* in, U8* out, S32 in_pixel_len, S32 out_pixel_len, S32 in_pixel_step, S32 out_pixel_step );
 	void compositeRowScaled4onto3( U8* in, U8* out, S32 in_pixel_len, S32 out_pixel_len );
 
@@ -283,6 +290,37 @@ public:
 	}
 };
 
+// Read-only window onto all or part of another raw image's pixels, without a copy.
+// The view holds a reference to its parent, so the parent's duplicate() copies
+// before anyone writes to pixels a view may still be reading. Do not resize the
+// parent in place while views of it exist.
+class LLImageRawView : public LLThreadSafeRefCount
+{
+protected:
+	~LLImageRawView() { }
+
+public:
+	LLImageRawView(LLImageRaw* parent);
+	LLImageRawView(LLImageRaw* parent, U16 x, U16 y, U16 width, U16 height);
+
+	U16 getWidth() const			{ return mWidth; }
+	U16 getHeight() const			{ return mHeight; }
+	S8	getComponents() const		{ return mParent->getComponents(); }
+	// Bytes from one row to the next; more than width * components for a sub-rectangle.
+	S32 getRowStride() const		{ return mParent->getWidth() * mParent->getComponents(); }
+	bool isContiguous() const		{ return mWidth == mParent->getWidth(); }
+
+	const U8* getData() const;
+	LLImageRaw* getParent() const	{ return mParent; }
+
+private:
+	LLPointer<LLImageRaw> mParent;
+	U16 mX;
+	U16 mY;
+	U16 mWidth;
+	U16 mHeight;
+};
+
 // Compressed representation of image.
 // Subclass from this class for the different representations (J2C, bmp)
 class LLImageFormatted : public LLImageBase
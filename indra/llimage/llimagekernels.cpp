@@ -0,0 +1,339 @@
+/**
+ * @file llimagekernels.cpp
+ * @brief Row kernels for scaling and compositing raw images.
+ *
+ * $LicenseInfo:firstyear=2001&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llimagekernels.h"
+#include "llmath.h"
+
+#include <vector>
+
+#if LL_IMAGE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	bool sUseSIMD = true;
+
+	// Where output pixel x samples the input, exactly as copyLineScaled() computes it.
+	struct Sample
+	{
+		S32 mIndex0;			// left straddle
+		S32 mIndex1;			// right straddle, if mUseRight
+		F32 mFract0;
+		F32 mFract1;
+		bool mSingle;			// interval lies inside input pixel mIndex0
+		bool mUseRight;
+	};
+
+	F32 make_samples(S32 in_len, S32 out_len, std::vector<Sample>& samples)
+	{
+		const F32 ratio = F32(in_len) / out_len; // ratio of old to new
+		samples.resize(out_len);
+		for (S32 x = 0; x < out_len; ++x)
+		{
+			// Avoid floating point accumulation error... don't just add ratio each time.  JC
+			const F32 sample0 = x * ratio;
+			const F32 sample1 = (x + 1) * ratio;
+			Sample& s = samples[x];
+			s.mIndex0 = llfloor(sample0);
+			s.mIndex1 = llfloor(sample1);
+			s.mFract0 = 1.f - (sample0 - F32(s.mIndex0));
+			s.mFract1 = sample1 - F32(s.mIndex1);
+			s.mSingle = s.mIndex0 == s.mIndex1;
+			s.mUseRight = s.mFract1 && s.mIndex1 < in_len;
+		}
+		return 1.f / ratio;
+	}
+
+	// One output value from the samples at in[index * step].
+	inline U8 box_sample(const U8* in, S32 step, const Sample& s, F32 norm_factor)
+	{
+		F32 v = in[s.mIndex0 * step] * s.mFract0;
+		for (S32 u = s.mIndex0 + 1; u < s.mIndex1; ++u)
+		{
+			v += in[u * step];
+		}
+		if (s.mUseRight)
+		{
+			v += in[s.mIndex1 * step] * s.mFract1;
+		}
+		v *= norm_factor;
+		return U8(llmath::llround(v));
+	}
+
+	// Calculates (U8)(255*(a/255.f)*(b/255.f) + 0.5f), like LLImageRaw::fastFractionalMult().
+	inline U8 fast_fractional_mult(U8 a, U8 b)
+	{
+		U32 i = a * b + 128;
+		return U8((i + (i >> 8)) >> 8);
+	}
+
+#if LL_IMAGE_SSE2
+	// Four bytes to four floats.
+	inline __m128 load4(const U8* in)
+	{
+		S32 bytes;
+		memcpy(&bytes, in, 4);		/* Flawfinder: ignore */
+		__m128i v = _mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), _mm_setzero_si128());
+		return _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, _mm_setzero_si128()));
+	}
+
+	inline __m128 load3(const U8* in)
+	{
+		S32 bytes = in[0] | (in[1] << 8) | (in[2] << 16);
+		__m128i v = _mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), _mm_setzero_si128());
+		return _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, _mm_setzero_si128()));
+	}
+
+	// Round half away from zero like llmath::llround(), for non-negative values.
+	inline __m128i round_positive(__m128 v)
+	{
+		__m128i t = _mm_cvttps_epi32(v);
+		__m128 up = _mm_cmpge_ps(_mm_sub_ps(v, _mm_cvtepi32_ps(t)), _mm_set1_ps(0.5f));
+		return _mm_sub_epi32(t, _mm_castps_si128(up));
+	}
+
+	// Sixteen bytes of each of the rows in[index * stride], box filtered.
+	inline void box_sample16(const U8* in, S32 stride, const Sample& s, const __m128& norm_factor, U8* out)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		__m128 acc[4];
+		__m128i v = _mm_loadu_si128((const __m128i*)(in + s.mIndex0 * stride));
+		__m128i lo = _mm_unpacklo_epi8(v, zero);
+		__m128i hi = _mm_unpackhi_epi8(v, zero);
+		const __m128 fract0 = _mm_set1_ps(s.mFract0);
+		acc[0] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), fract0);
+		acc[1] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), fract0);
+		acc[2] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), fract0);
+		acc[3] = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), fract0);
+		for (S32 u = s.mIndex0 + 1; u < s.mIndex1; ++u)
+		{
+			v = _mm_loadu_si128((const __m128i*)(in + u * stride));
+			lo = _mm_unpacklo_epi8(v, zero);
+			hi = _mm_unpackhi_epi8(v, zero);
+			acc[0] = _mm_add_ps(acc[0], _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)));
+			acc[1] = _mm_add_ps(acc[1], _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)));
+			acc[2] = _mm_add_ps(acc[2], _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)));
+			acc[3] = _mm_add_ps(acc[3], _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)));
+		}
+		if (s.mUseRight)
+		{
+			const __m128 fract1 = _mm_set1_ps(s.mFract1);
+			v = _mm_loadu_si128((const __m128i*)(in + s.mIndex1 * stride));
+			lo = _mm_unpacklo_epi8(v, zero);
+			hi = _mm_unpackhi_epi8(v, zero);
+			acc[0] = _mm_add_ps(acc[0], _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), fract1));
+			acc[1] = _mm_add_ps(acc[1], _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), fract1));
+			acc[2] = _mm_add_ps(acc[2], _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), fract1));
+			acc[3] = _mm_add_ps(acc[3], _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), fract1));
+		}
+		__m128i r0 = round_positive(_mm_mul_ps(acc[0], norm_factor));
+		__m128i r1 = round_positive(_mm_mul_ps(acc[1], norm_factor));
+		__m128i r2 = round_positive(_mm_mul_ps(acc[2], norm_factor));
+		__m128i r3 = round_positive(_mm_mul_ps(acc[3], norm_factor));
+		_mm_storeu_si128((__m128i*)out, _mm_packus_epi16(_mm_packs_epi32(r0, r1), _mm_packs_epi32(r2, r3)));
+	}
+
+	// One 3 or 4 component pixel, box filtered.
+	inline S32 box_sample_pixel(const U8* in, S32 components, const Sample& s, const __m128& norm_factor)
+	{
+		const S32 c = components;
+		__m128 acc = _mm_mul_ps(c == 4 ? load4(in + s.mIndex0 * c) : load3(in + s.mIndex0 * c), _mm_set1_ps(s.mFract0));
+		for (S32 u = s.mIndex0 + 1; u < s.mIndex1; ++u)
+		{
+			acc = _mm_add_ps(acc, c == 4 ? load4(in + u * c) : load3(in + u * c));
+		}
+		if (s.mUseRight)
+		{
+			acc = _mm_add_ps(acc, _mm_mul_ps(c == 4 ? load4(in + s.mIndex1 * c) : load3(in + s.mIndex1 * c), _mm_set1_ps(s.mFract1)));
+		}
+		__m128i r = round_positive(_mm_mul_ps(acc, norm_factor));
+		r = _mm_packs_epi32(r, r);
+		return _mm_cvtsi128_si32(_mm_packus_epi16(r, r));
+	}
+
+	// (a * b + 128 + ((a * b + 128) >> 8)) >> 8 on 16 bit lanes.
+	inline __m128i fast_fractional_mult8(__m128i a, __m128i b)
+	{
+		__m128i i = _mm_add_epi16(_mm_mullo_epi16(a, b), _mm_set1_epi16(128));
+		return _mm_srli_epi16(_mm_add_epi16(i, _mm_srli_epi16(i, 8)), 8);
+	}
+
+	// Two RGBA pixels over two RGB0 pixels, as 16 bit lanes.
+	inline __m128i composite2(__m128i src, __m128i dst)
+	{
+		__m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(src, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+		__m128i transparency = _mm_sub_epi16(_mm_set1_epi16(255), alpha);
+		return _mm_add_epi16(fast_fractional_mult8(dst, transparency), fast_fractional_mult8(src, alpha));
+	}
+#endif
+}
+
+void LLImageKernels::setUseSIMD(bool use_simd)
+{
+	sUseSIMD = use_simd;
+}
+
+bool LLImageKernels::getUseSIMD()
+{
+#if LL_IMAGE_SSE2
+	return sUseSIMD;
+#else
+	return false;
+#endif
+}
+
+void LLImageKernels::scaleColumns(const U8* in, U8* out, S32 row_bytes, S32 in_rows, S32 out_rows, S32 in_stride)
+{
+	if (!in_stride)
+	{
+		in_stride = row_bytes;
+	}
+	std::vector<Sample> samples;
+	const F32 norm_factor = make_samples(in_rows, out_rows, samples);
+	const bool use_simd = getUseSIMD();
+
+	for (S32 y = 0; y < out_rows; ++y, out += row_bytes)
+	{
+		const Sample& s = samples[y];
+		if (s.mSingle)
+		{
+			memcpy(out, in + s.mIndex0 * in_stride, row_bytes);		/* Flawfinder: ignore */
+			continue;
+		}
+		S32 i = 0;
+#if LL_IMAGE_SSE2
+		if (use_simd)
+		{
+			const __m128 norm = _mm_set1_ps(norm_factor);
+			for ( ; i + 16 <= row_bytes; i += 16)
+			{
+				box_sample16(in + i, in_stride, s, norm, out + i);
+			}
+		}
+#endif
+		for ( ; i < row_bytes; ++i)
+		{
+			out[i] = box_sample(in + i, in_stride, s, norm_factor);
+		}
+	}
+}
+
+void LLImageKernels::scaleRows(const U8* in, U8* out, S32 in_pixels, S32 out_pixels, S32 components, S32 rows, S32 in_stride)
+{
+	if (!in_stride)
+	{
+		in_stride = in_pixels * components;
+	}
+	std::vector<Sample> samples;
+	const F32 norm_factor = make_samples(in_pixels, out_pixels, samples);
+	const bool use_simd = getUseSIMD() && components >= 3;
+
+	for (S32 row = 0; row < rows; ++row)
+	{
+		const U8* inp = in + row * in_stride;
+		U8* outp = out + row * out_pixels * components;
+		for (S32 x = 0; x < out_pixels; ++x, outp += components)
+		{
+			const Sample& s = samples[x];
+			if (s.mSingle)
+			{
+				memcpy(outp, inp + s.mIndex0 * components, components);		/* Flawfinder: ignore */
+				continue;
+			}
+#if LL_IMAGE_SSE2
+			if (use_simd)
+			{
+				S32 pixel = box_sample_pixel(inp, components, s, _mm_set1_ps(norm_factor));
+				memcpy(outp, &pixel, components);		/* Flawfinder: ignore */
+				continue;
+			}
+#endif
+			for (S32 c = 0; c < components; ++c)
+			{
+				outp[c] = box_sample(inp + c, components, s, norm_factor);
+			}
+		}
+	}
+}
+
+void LLImageKernels::composite4onto3(const U8* src, U8* dst, S32 pixels)
+{
+	S32 i = 0;
+#if LL_IMAGE_SSE2
+	if (getUseSIMD())
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i rgb_mask = _mm_set1_epi32(0x00ffffff);
+		const __m128i lane0_mask = _mm_cvtsi32_si128(0x00ffffff);
+		for ( ; i + 4 <= pixels; i += 4, src += 16, dst += 12)
+		{
+			// Spread the 12 destination bytes over four 32 bit lanes.
+			U8 dst_bytes[16];
+			memcpy(dst_bytes, dst, 12);		/* Flawfinder: ignore */
+			__m128i d = _mm_loadu_si128((const __m128i*)dst_bytes);
+			__m128i d01 = _mm_unpacklo_epi32(d, _mm_srli_si128(d, 3));
+			__m128i d23 = _mm_unpacklo_epi32(_mm_srli_si128(d, 6), _mm_srli_si128(d, 9));
+			d = _mm_and_si128(_mm_unpacklo_epi64(d01, d23), rgb_mask);
+
+			__m128i s = _mm_loadu_si128((const __m128i*)src);
+			__m128i lo = composite2(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero));
+			__m128i hi = composite2(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero));
+			__m128i r = _mm_packus_epi16(lo, hi);
+
+			// And back to 12 bytes.
+			__m128i packed = _mm_and_si128(r, lane0_mask);
+			packed = _mm_or_si128(packed, _mm_slli_si128(_mm_and_si128(_mm_srli_si128(r, 4), lane0_mask), 3));
+			packed = _mm_or_si128(packed, _mm_slli_si128(_mm_and_si128(_mm_srli_si128(r, 8), lane0_mask), 6));
+			packed = _mm_or_si128(packed, _mm_slli_si128(_mm_and_si128(_mm_srli_si128(r, 12), lane0_mask), 9));
+			_mm_storeu_si128((__m128i*)dst_bytes, packed);
+			memcpy(dst, dst_bytes, 12);		/* Flawfinder: ignore */
+		}
+	}
+#endif
+	for ( ; i < pixels; ++i, src += 4, dst += 3)
+	{
+		U8 alpha = src[3];
+		if (alpha)
+		{
+			if (255 == alpha)
+			{
+				dst[0] = src[0];
+				dst[1] = src[1];
+				dst[2] = src[2];
+			}
+			else
+			{
+				U8 transparency = 255 - alpha;
+				dst[0] = fast_fractional_mult(dst[0], transparency) + fast_fractional_mult(src[0], alpha);
+				dst[1] = fast_fractional_mult(dst[1], transparency) + fast_fractional_mult(src[1], alpha);
+				dst[2] = fast_fractional_mult(dst[2], transparency) + fast_fractional_mult(src[2], alpha);
+			}
+		}
+	}
+}
@@ -0,0 +1,58 @@
+/**
+ * @file llimagekernels.h
+ * @brief Row kernels for scaling and compositing raw images.
+ *
+ * $LicenseInfo:firstyear=2001&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLIMAGEKERNELS_H
+#define LL_LLIMAGEKERNELS_H
+
+#include "stdtypes.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LL_IMAGE_SSE2 1
+#endif
+
+// Whole-image versions of the LLImageRaw per-pixel loops. They do the
+// same float arithmetic in the same order as LLImageRaw::copyLineScaled()
+// and compositeUnscaled4onto3(), so results match the old code byte for
+// byte, but walk memory row by row and use SSE2 where the build has it.
+namespace LLImageKernels
+{
+	// False forces the scalar versions (for testing and benchmarking).
+	void setUseSIMD(bool use_simd);
+	bool getUseSIMD();
+
+	// Box filter resize along columns: in_rows rows of row_bytes become out_rows rows.
+	// Input rows are in_stride bytes apart (0 for row_bytes); output rows are packed.
+	void scaleColumns(const U8* in, U8* out, S32 row_bytes, S32 in_rows, S32 out_rows, S32 in_stride = 0);
+
+	// Box filter resize along rows: rows rows of in_pixels pixels become rows of out_pixels.
+	// Input rows are in_stride bytes apart (0 for packed); output rows are packed.
+	void scaleRows(const U8* in, U8* out, S32 in_pixels, S32 out_pixels, S32 components, S32 rows, S32 in_stride = 0);
+
+	// Alpha blends RGBA src over RGB dst, both pixels long.
+	void composite4onto3(const U8* src, U8* dst, S32 pixels);
+}
+
+#endif // LL_LLIMAGEKERNELS_H
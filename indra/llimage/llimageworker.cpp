@@ -28,18 +28,66 @@
 
 #include "llimageworker.h"
 #include "llimagedxt.h"
+#include "llmath.h"
+#include "llstl.h"
+#include "lltimer.h"
 
 //----------------------------------------------------------------------------
 
 // MAIN THREAD
-LLImageDecodeThread::LLImageDecodeThread(bool threaded)
-	: LLQueuedThread("imagedecode", threaded)
+LLImageDecodeThread::LLImageDecodeThread(bool threaded, S32 num_workers)
+	: LLQueuedThread("imagedecode", threaded),
+	  mDecodedCount(0),
+	  mAverageLatency(0.f),
+	  mAverageDecodeTime(0.f)
 {
+	if (threaded)
+	{
+		for (S32 i = 1; i < num_workers; ++i)
+		{
+			PoolWorker* worker = new PoolWorker(this, i);
+			mPoolWorkers.push_back(worker);
+			worker->start();
+		}
+	}
 }
 
 //virtual 
 LLImageDecodeThread::~LLImageDecodeThread()
 {
+	stopPoolWorkers();
+}
+
+// MAIN THREAD
+//virtual
+void LLImageDecodeThread::shutdown()
+{
+	// The helpers must be gone before LLQueuedThread::shutdown() deletes the requests.
+	stopPoolWorkers();
+	LLQueuedThread::shutdown();
+}
+
+void LLImageDecodeThread::stopPoolWorkers()
+{
+	for (std::vector<PoolWorker*>::iterator iter = mPoolWorkers.begin(); iter != mPoolWorkers.end(); ++iter)
+	{
+		(*iter)->setQuitting();
+	}
+	for (std::vector<PoolWorker*>::iterator iter = mPoolWorkers.begin(); iter != mPoolWorkers.end(); ++iter)
+	{
+		S32 timeout = 100;
+		while (!(*iter)->isStopped() && timeout-- > 0)
+		{
+			ms_sleep(10);
+		}
+		if (!(*iter)->isStopped())
+		{
+			llwarns << "Image decode worker didn't stop, leaking it." << llendl;
+			*iter = NULL;
+		}
+	}
+	for_each(mPoolWorkers.begin(), mPoolWorkers.end(), DeletePointer());
+	mPoolWorkers.clear();
 }
 
 // MAIN THREAD
@@ -53,7 +101,7 @@ S32 LLImageDecodeThread::update(F32 max_time_ms)
 		creation_info& info = *iter;
 		ImageRequest* req = new ImageRequest(info.handle, info.image,
 						     info.priority, info.discard, info.needs_aux,
-						     info.responder);
+						     info.responder, this, info.queued_time);
 
 		bool res = addRequest(req);
 		if (!res)
@@ -61,8 +109,16 @@ S32 LLImageDecodeThread::update(F32 max_time_ms)
 			llerrs << "request added after LLLFSThread::cleanupClass()" << llendl;
 		}
 	}
+	bool added = !mCreationList.empty();
 	mCreationList.clear();
 	S32 res = LLQueuedThread::update(max_time_ms);
+	if (added)
+	{
+		for (std::vector<PoolWorker*>::iterator iter = mPoolWorkers.begin(); iter != mPoolWorkers.end(); ++iter)
+		{
+			(*iter)->wake();
+		}
+	}
 	return res;
 }
 
@@ -71,10 +127,60 @@ LLImageDecodeThread::handle_t LLImageDecodeThread::decodeImage(LLImageFormatted*
 {
 	LLMutexLock lock(&mCreationMutex);
 	handle_t handle = generateHandle();
-	mCreationList.push_back(creation_info(handle, image, priority, discard, needs_aux, responder));
+	mCreationList.push_back(creation_info(handle, image, priority, discard, needs_aux, responder, LLTimer::getTotalSeconds()));
 	return handle;
 }
 
+void LLImageDecodeThread::abortDecode(handle_t handle)
+{
+	{
+		LLMutexLock lock(&mCreationMutex);
+		for (creation_list_t::iterator iter = mCreationList.begin(); iter != mCreationList.end(); ++iter)
+		{
+			if (iter->handle == handle)
+			{
+				// Never got queued, so nobody will call the responder.
+				mCreationList.erase(iter);
+				return;
+			}
+		}
+	}
+	abortRequest(handle, false);
+}
+
+LLImageDecodeThread::Stats LLImageDecodeThread::getStats()
+{
+	Stats stats;
+	{
+		LLMutexLock lock(&mCreationMutex);
+		stats.mQueued = mCreationList.size();
+	}
+	stats.mQueued += getPending();
+	stats.mWorkers = mThreaded ? mPoolWorkers.size() + 1 : 0;
+	LLMutexLock lock(&mStatsMutex);
+	stats.mDecoded = mDecodedCount;
+	stats.mLatency = mAverageLatency;
+	stats.mDecodeTime = mAverageDecodeTime;
+	return stats;
+}
+
+// Any decode thread.
+void LLImageDecodeThread::recordDecode(F32 latency, F32 decode_time)
+{
+	LLMutexLock lock(&mStatsMutex);
+	if (mDecodedCount++ == 0)
+	{
+		mAverageLatency = latency;
+		mAverageDecodeTime = decode_time;
+	}
+	else
+	{
+		// Roughly the last 100 images.
+		mAverageLatency = lerp(mAverageLatency, latency, 0.01f);
+		mAverageDecodeTime = lerp(mAverageDecodeTime, decode_time, 0.01f);
+	}
+}
+
 // Used by unit test only
 // Returns the size of the mutex guarded list as an indication of sanity
 S32 LLImageDecodeThread::tut_size()
@@ -90,16 +196,52 @@ LLImageDecodeThread::Responder::~Responder()
 
 //----------------------------------------------------------------------------
 
+LLImageDecodeThread::PoolWorker::PoolWorker(LLImageDecodeThread* owner, S32 index)
+	: LLThread(llformat("imagedecode %d", index)),
+	  mOwner(owner)
+{
+}
+
+//virtual
+bool LLImageDecodeThread::PoolWorker::runCondition()
+{
+	return mOwner->getPending() > 0;
+}
+
+//virtual
+void LLImageDecodeThread::PoolWorker::run()
+{
+	while (1)
+	{
+		// Sleeps until update() wakes us with new requests.
+		checkPause();
+		if (isQuitting())
+		{
+			break;
+		}
+		if (mOwner->processNextRequest() == 0)
+		{
+			ms_sleep(1);
+		}
+	}
+}
+
+//----------------------------------------------------------------------------
+
 LLImageDecodeThread::ImageRequest::ImageRequest(handle_t handle, LLImageFormatted* image, 
 												U32 priority, S32 discard, BOOL needs_aux,
-												LLImageDecodeThread::Responder* responder)
+												LLImageDecodeThread::Responder* responder,
+												LLImageDecodeThread* owner, F64 queued_time)
 	: LLQueuedThread::QueuedRequest(handle, priority, FLAG_AUTO_COMPLETE),
 	  mFormattedImage(image),
 	  mDiscardLevel(discard),
 	  mNeedsAux(needs_aux),
 	  mDecodedRaw(FALSE),
 	  mDecodedAux(FALSE),
-	  mResponder(responder)
+	  mResponder(responder),
+	  mOwner(owner),
+	  mQueuedTime(queued_time),
+	  mDecodeTime(0.f)
 {
 }
 
@@ -115,6 +257,14 @@ LLImageDecodeThread::ImageRequest::~ImageRequest()
 
 // Returns true when done, whether or not decode was successful.
 bool LLImageDecodeThread::ImageRequest::processRequest()
+{
+	LLTimer timer;
+	bool done = decodeSlice();
+	mDecodeTime += timer.getElapsedTimeF32();
+	return done;
+}
+
+bool LLImageDecodeThread::ImageRequest::decodeSlice()
 {
 	const F32 decode_time_slice = .1f;
 	bool done = true;
@@ -161,6 +311,10 @@ bool LLImageDecodeThread::ImageRequest::processRequest()
 
 void LLImageDecodeThread::ImageRequest::finishRequest(bool completed)
 {
+	if (completed && mOwner)
+	{
+		mOwner->recordDecode((F32)(LLTimer::getTotalSeconds() - mQueuedTime), mDecodeTime);
+	}
 	if (mResponder.notNull())
 	{
 		bool success = completed && mDecodedRaw && mDecodedImageRaw->getDataSize() && (!mNeedsAux || mDecodedAux);
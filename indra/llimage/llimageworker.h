@@ -50,7 +50,8 @@ public:
 	public:
 		ImageRequest(handle_t handle, LLImageFormatted* image,
 					 U32 priority, S32 discard, BOOL needs_aux,
-					 LLImageDecodeThread::Responder* responder);
+					 LLImageDecodeThread::Responder* responder,
+					 LLImageDecodeThread* owner = NULL, F64 queued_time = 0.0);
 
 		/*virtual*/ bool processRequest();
 		/*virtual*/ void finishRequest(bool completed);
@@ -59,6 +60,8 @@ public:
 		bool tut_isOK();
 		
 	private:
+		bool decodeSlice();				// processRequest() minus the timing
+
 		// input
 		LLPointer<LLImageFormatted> mFormattedImage;
 		S32 mDiscardLevel;
@@ -69,17 +72,39 @@ public:
 		BOOL mDecodedRaw;
 		BOOL mDecodedAux;
 		LLPointer<LLImageDecodeThread::Responder> mResponder;
+		// statistics
+		LLImageDecodeThread* mOwner;
+		F64 mQueuedTime;		// when decodeImage() was called
+		F32 mDecodeTime;		// spent in processRequest()
+	};
+
+	// For the texture console.
+	struct Stats
+	{
+		S32 mQueued;			// waiting or being decoded
+		S32 mWorkers;
+		U32 mDecoded;			// since start
+		F32 mLatency;			// seconds from decodeImage() to completion, moving average
+		F32 mDecodeTime;		// seconds of actual decoding per image, moving average
 	};
 	
 public:
-	LLImageDecodeThread(bool threaded = true);
+	// num_workers threads (this one included) take requests from the same
+	// priority queue. A request that yields after a time slice can be
+	// resumed by any of them, but is never worked on by two at once.
+	LLImageDecodeThread(bool threaded = true, S32 num_workers = 1);
 	virtual ~LLImageDecodeThread();
+	/*virtual*/ void shutdown();
 
 	handle_t decodeImage(LLImageFormatted* image,
 						 U32 priority, S32 discard, BOOL needs_aux,
 						 Responder* responder);
+	// Unlike abortRequest(), also works before the next update() queued the request.
+	void abortDecode(handle_t handle);
 	S32 update(F32 max_time_ms);
 
+	Stats getStats();
+
 	// Used by unit tests to check the consistency of the thread instance
 	S32 tut_size();
 	
@@ -92,13 +117,34 @@ private:
 		S32 discard;
 		BOOL needs_aux;
 		LLPointer<Responder> responder;
-		creation_info(handle_t h, LLImageFormatted* i, U32 p, S32 d, BOOL aux, Responder* r)
-			: handle(h), image(i), priority(p), discard(d), needs_aux(aux), responder(r)
+		F64 queued_time;
+		creation_info(handle_t h, LLImageFormatted* i, U32 p, S32 d, BOOL aux, Responder* r, F64 t)
+			: handle(h), image(i), priority(p), discard(d), needs_aux(aux), responder(r), queued_time(t)
 		{}
 	};
 	typedef std::list<creation_info> creation_list_t;
 	creation_list_t mCreationList;
 	LLMutex mCreationMutex;
+
+	// Extra threads sharing our request queue.
+	class PoolWorker : public LLThread
+	{
+	public:
+		PoolWorker(LLImageDecodeThread* owner, S32 index);
+	protected:
+		/*virtual*/ bool runCondition();
+		/*virtual*/ void run();
+	private:
+		LLImageDecodeThread* mOwner;
+	};
+	std::vector<PoolWorker*> mPoolWorkers;
+	void stopPoolWorkers();
+
+	void recordDecode(F32 latency, F32 decode_time);
+	LLMutex mStatsMutex;
+	U32 mDecodedCount;
+	F32 mAverageLatency;
+	F32 mAverageDecodeTime;
 };
 
 #endif
@@ -0,0 +1,226 @@
+/**
+ * @file llimagekernels_test.cpp
+ * @brief Checks the image row kernels against the per-pixel LLImageRaw loops.
+ *
+ * $LicenseInfo:firstyear=2001&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "../llcommon/linden_common.h"
+#include <vector>
+// Class to test
+#include "../llimagekernels.h"
+// Dependencies
+#include "llmath.h"
+#include "lltimer.h"
+// Tut header
+#include "../test/lltut.h"
+
+namespace
+{
+	// The loops LLImageRaw::scale() used before the kernels, as reference.
+	void copy_line_scaled(const U8* in, U8* out, S32 in_pixel_len, S32 out_pixel_len, S32 in_pixel_step, S32 out_pixel_step, S32 components)
+	{
+		const F32 ratio = F32(in_pixel_len) / out_pixel_len;
+		const F32 norm_factor = 1.f / ratio;
+		for (S32 x = 0; x < out_pixel_len; x++)
+		{
+			const F32 sample0 = x * ratio;
+			const F32 sample1 = (x + 1) * ratio;
+			const S32 index0 = llfloor(sample0);
+			const S32 index1 = llfloor(sample1);
+			const F32 fract0 = 1.f - (sample0 - F32(index0));
+			const F32 fract1 = sample1 - F32(index1);
+			for (S32 c = 0; c < components; ++c)
+			{
+				U8* outp = out + x * out_pixel_step * components + c;
+				if (index0 == index1)
+				{
+					*outp = in[index0 * in_pixel_step * components + c];
+					continue;
+				}
+				F32 v = in[index0 * in_pixel_step * components + c] * fract0;
+				for (S32 u = index0 + 1; u < index1; u++)
+				{
+					v += in[u * in_pixel_step * components + c];
+				}
+				if (fract1 && index1 < in_pixel_len)
+				{
+					v += in[index1 * in_pixel_step * components + c] * fract1;
+				}
+				v *= norm_factor;
+				*outp = U8(llmath::llround(v));
+			}
+		}
+	}
+
+	void reference_scale(const std::vector<U8>& in, S32 width, S32 height, std::vector<U8>& out, S32 new_width, S32 new_height, S32 components)
+	{
+		std::vector<U8> temp(width * new_height * components);
+		for (S32 col = 0; col < width; ++col)
+		{
+			copy_line_scaled(&in[0] + components * col, &temp[0] + components * col, height, new_height, width, width, components);
+		}
+		out.resize(new_width * new_height * components);
+		for (S32 row = 0; row < new_height; ++row)
+		{
+			copy_line_scaled(&temp[0] + width * components * row, &out[0] + new_width * components * row, width, new_width, 1, 1, components);
+		}
+	}
+
+	void kernel_scale(const std::vector<U8>& in, S32 width, S32 height, std::vector<U8>& out, S32 new_width, S32 new_height, S32 components)
+	{
+		std::vector<U8> temp(width * new_height * components);
+		LLImageKernels::scaleColumns(&in[0], &temp[0], width * components, height, new_height);
+		out.resize(new_width * new_height * components);
+		LLImageKernels::scaleRows(&temp[0], &out[0], width, new_width, components, new_height);
+	}
+
+	U8 fast_fractional_mult(U8 a, U8 b)
+	{
+		U32 i = a * b + 128;
+		return U8((i + (i >> 8)) >> 8);
+	}
+
+	void reference_composite(const std::vector<U8>& src, std::vector<U8>& dst)
+	{
+		for (size_t i = 0; i < dst.size() / 3; ++i)
+		{
+			const U8* s = &src[i * 4];
+			U8* d = &dst[i * 3];
+			if (s[3] == 255)
+			{
+				d[0] = s[0]; d[1] = s[1]; d[2] = s[2];
+			}
+			else if (s[3])
+			{
+				U8 transparency = 255 - s[3];
+				for (S32 c = 0; c < 3; ++c)
+				{
+					d[c] = fast_fractional_mult(d[c], transparency) + fast_fractional_mult(s[c], s[3]);
+				}
+			}
+		}
+	}
+
+	void fill_random(std::vector<U8>& buffer, S32 size)
+	{
+		buffer.resize(size);
+		for (S32 i = 0; i < size; ++i)
+		{
+			buffer[i] = (U8)(rand() >> 4);
+		}
+	}
+}
+
+// -------------------------------------------------------------------------------------------
+// TUT
+// -------------------------------------------------------------------------------------------
+
+namespace tut
+{
+	// Test wrapper declarations
+	struct imagekernels_test
+	{
+		~imagekernels_test()
+		{
+			LLImageKernels::setUseSIMD(true);
+		}
+	};
+
+	// Tut templating thingamagic: test group, object and test instance
+	typedef test_group<imagekernels_test> imagekernels_t;
+	typedef imagekernels_t::object imagekernels_object_t;
+	tut::imagekernels_t tut_imagekernels("LLImageKernels");
+
+	template<> template<>
+	void imagekernels_object_t::test<1>()
+	{
+		// Scaling matches the per-pixel loops exactly, with and without SIMD.
+		const S32 sizes[][4] = {
+			{ 512, 512, 256, 256 }, { 300, 200, 71, 33 }, { 64, 64, 512, 512 },
+			{ 100, 37, 37, 100 }, { 17, 5, 3, 9 }, { 256, 256, 256, 128 }, { 1, 1, 7, 3 } };
+		const S32 components[] = { 1, 2, 3, 4 };
+		std::vector<U8> in, expected, actual;
+		for (S32 simd = 0; simd < 2; ++simd)
+		{
+			LLImageKernels::setUseSIMD(simd != 0);
+			for (S32 c = 0; c < 4; ++c)
+			{
+				for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+				{
+					const S32* size = sizes[s];
+					fill_random(in, size[0] * size[1] * components[c]);
+					reference_scale(in, size[0], size[1], expected, size[2], size[3], components[c]);
+					kernel_scale(in, size[0], size[1], actual, size[2], size[3], components[c]);
+					std::string what = llformat("%dx%dx%d to %dx%d, simd %d", size[0], size[1], components[c], size[2], size[3], simd);
+					ensure(what, expected == actual);
+				}
+			}
+		}
+	}
+
+	template<> template<>
+	void imagekernels_object_t::test<2>()
+	{
+		// Compositing matches, including the opaque and transparent shortcuts and odd tails.
+		const S32 counts[] = { 1, 3, 4, 5, 7, 64 * 64 + 3 };
+		std::vector<U8> src, dst, expected;
+		for (S32 simd = 0; simd < 2; ++simd)
+		{
+			LLImageKernels::setUseSIMD(simd != 0);
+			for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); ++i)
+			{
+				fill_random(src, counts[i] * 4);
+				fill_random(dst, counts[i] * 3);
+				for (S32 p = 0; p < counts[i]; p += 3)
+				{
+					src[p * 4 + 3] = (p & 1) ? 0 : 255;
+				}
+				expected = dst;
+				reference_composite(src, expected);
+				LLImageKernels::composite4onto3(&src[0], &dst[0], counts[i]);
+				ensure(llformat("%d pixels, simd %d", counts[i], simd), expected == dst);
+			}
+		}
+	}
+
+	template<> template<>
+	void imagekernels_object_t::test<3>()
+	{
+		// Timing of a 1024x1024 RGBA downscale, for the log.
+		std::vector<U8> in, out;
+		fill_random(in, 1024 * 1024 * 4);
+		LLTimer timer;
+		reference_scale(in, 1024, 1024, out, 1000, 1000, 4);
+		F32 reference_time = timer.getElapsedTimeF32();
+		LLImageKernels::setUseSIMD(false);
+		timer.reset();
+		kernel_scale(in, 1024, 1024, out, 1000, 1000, 4);
+		F32 scalar_time = timer.getElapsedTimeF32();
+		LLImageKernels::setUseSIMD(true);
+		timer.reset();
+		kernel_scale(in, 1024, 1024, out, 1000, 1000, 4);
+		F32 simd_time = timer.getElapsedTimeF32();
+		llinfos << "1024x1024 RGBA scale: per-pixel " << reference_time * 1000.f << "ms, row scalar "
+				<< scalar_time * 1000.f << "ms, row SIMD " << simd_time * 1000.f << "ms" << llendl;
+	}
+}
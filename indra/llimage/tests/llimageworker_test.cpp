@@ -239,6 +239,53 @@ namespace tut
 		ensure("LLImageDecodeThread: threaded work unit not processed", done == true);
 	}
 
+	template<> template<>
+	void imagedecodethread_object_t::test<3>()
+	{
+		// Test a *threaded* instance with a pool of workers sharing the queue
+		const S32 NUM_WORKERS = 4;
+		const S32 NUM_REQUESTS = 32;
+		mThread = new LLImageDecodeThread(true, NUM_WORKERS);
+		ensure_equals("LLImageDecodeThread: pool size incorrect", mThread->getStats().mWorkers, NUM_WORKERS);
+		bool done[NUM_REQUESTS];
+		for (S32 i = 0; i < NUM_REQUESTS; ++i)
+		{
+			mThread->decodeImage(NULL, LLQueuedThread::PRIORITY_NORMAL + i, 0, FALSE, new responder_test(&done[i]));
+		}
+		ensure_equals("LLImageDecodeThread: pool queue depth incorrect", mThread->getStats().mQueued, NUM_REQUESTS);
+		mThread->update(1);
+		// Every work order must be handled exactly once, whichever worker picked it up
+		const U32 INCREMENT_TIME = 100;				// 100 milliseconds
+		const U32 MAX_TIME = 100 * INCREMENT_TIME;	// wait 10 seconds but no more
+		U32 total_time = 0;
+		while (mThread->getStats().mDecoded < (U32)NUM_REQUESTS && total_time < MAX_TIME)
+		{
+			ms_sleep(INCREMENT_TIME);
+			total_time += INCREMENT_TIME;
+		}
+		ensure_equals("LLImageDecodeThread: pool work units not all processed", mThread->getStats().mDecoded, (U32)NUM_REQUESTS);
+		for (S32 i = 0; i < NUM_REQUESTS; ++i)
+		{
+			ensure("LLImageDecodeThread: pool responder not called", done[i]);
+		}
+		// Shut down with the pool still around: must not hang or crash
+		mThread->shutdown();
+	}
+
+	template<> template<>
+	void imagedecodethread_object_t::test<4>()
+	{
+		// Aborting a decode before update() queued it must drop it without calling the responder
+		mThread = new LLImageDecodeThread(false);
+		bool done = false;
+		LLImageDecodeThread::handle_t decodeHandle = mThread->decodeImage(NULL, LLQueuedThread::PRIORITY_NORMAL, 0, FALSE, new responder_test(&done));
+		ensure("LLImageDecodeThread: abortDecode() setup failed", mThread->tut_size() == 1);
+		mThread->abortDecode(decodeHandle);
+		ensure("LLImageDecodeThread: abortDecode() didn't empty the list", mThread->tut_size() == 0);
+		mThread->update(0);
+		ensure("LLImageDecodeThread: aborted work unit was processed", done == false);
+	}
+
 	// ---------------------------------------------------------------------------------------
 	// Test the LLImageDecodeThread::ImageRequest interface
 	// ---------------------------------------------------------------------------------------
@@ -31,8 +31,16 @@
 #include "openjpeg.h"
 
 #include "lltimer.h"
+#include "llatomic.h"
 //#include "llmemory.h"
 
+// Decoded code-blocks kept per image between discard levels, and for all images.
+// Lower resolutions come first, so a full per-image cache still holds the
+// code-blocks most likely to be reused.
+const S32 MAX_T1_CACHE_BYTES = 1024 * 1024;
+const S32 MAX_TOTAL_T1_CACHE_BYTES = 64 * 1024 * 1024;
+static LLAtomicS32 sTotalT1CacheBytes(0);
+
 const char* fallbackEngineInfoLLImageJ2CImpl()
 {
 	static std::string version_string = std::string("OpenJPEG: ") + opj_version();
@@ -96,13 +104,39 @@ int ceildivpow2(int a, int b)
 
 
 LLImageJ2COJ::LLImageJ2COJ()
-	: LLImageJ2CImpl()
+	: LLImageJ2CImpl(),
+	  mT1Cache(NULL),
+	  mT1CacheBytes(0)
 {
 }
 
 
 LLImageJ2COJ::~LLImageJ2COJ()
 {
+	releaseT1Cache();
+}
+
+void LLImageJ2COJ::updateT1CacheBytes()
+{
+#ifdef OPJ_HAS_T1_CACHE
+	int hits, misses, bytes;
+	opj_get_t1_cache_stats(mT1Cache, &hits, &misses, &bytes);
+	sTotalT1CacheBytes += bytes - mT1CacheBytes;
+	mT1CacheBytes = bytes;
+#endif
+}
+
+void LLImageJ2COJ::releaseT1Cache()
+{
+#ifdef OPJ_HAS_T1_CACHE
+	if (mT1Cache)
+	{
+		opj_destroy_t1_cache(mT1Cache);
+		mT1Cache = NULL;
+		sTotalT1CacheBytes -= mT1CacheBytes;
+		mT1CacheBytes = 0;
+	}
+#endif
 }
 
 
@@ -194,6 +228,16 @@ BOOL LLImageJ2COJ::decodeImpl(LLImageJ2C &base, LLImageRaw &raw_image, F32 decod
 
 	/* JPEG-2000 codestream */
 
+#ifdef OPJ_HAS_T1_CACHE
+	// While a texture streams in it gets decoded at decreasing discard levels;
+	// let the next decode reuse the code-blocks whose data didn't change.
+	if (!mT1Cache && parameters.cp_reduce > 0 && sTotalT1CacheBytes < MAX_TOTAL_T1_CACHE_BYTES)
+	{
+		mT1Cache = opj_create_t1_cache(MAX_T1_CACHE_BYTES);
+	}
+	parameters.cp_t1_cache = mT1Cache;
+#endif
+
 	/* get a decoder handle */
 	dinfo = opj_create_decompress(CODEC_J2K);
 
@@ -230,6 +274,16 @@ BOOL LLImageJ2COJ::decodeImpl(LLImageJ2C &base, LLImageRaw &raw_image, F32 decod
 		opj_destroy_decompress(dinfo);
 	}
 
+	if (parameters.cp_reduce == 0)
+	{
+		// Full resolution, nothing left to refine.
+		releaseT1Cache();
+	}
+	else if (mT1Cache)
+	{
+		updateT1CacheBytes();
+	}
+
 	// The image decode failed if the return was NULL or the component
 	// count was zero.  The latter is just a sanity check before we
 	// dereference the array.
@@ -52,6 +52,13 @@ protected:
 		return (a + (1 << b) - 1) >> b;
 	}
 
+private:
+	void updateT1CacheBytes();
+	void releaseT1Cache();
+
+	// Code-blocks decoded for a previous, higher discard level of this image.
+	struct opj_t1_cache* mT1Cache;
+	S32 mT1CacheBytes;
 };
 
 #endif
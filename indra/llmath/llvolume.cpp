@@ -2672,6 +2672,190 @@ bool LLVolume::unpackVolumeFaces(std::istream& is, S32 size)
 	return true;
 }
 
+const U32 LLVolume::DECODED_FACES_VERSION = 1;
+
+namespace
+{
+	const char DECODED_FACES_MAGIC[4] = { 'L', 'L', 'V', 'F' };
+	const U32 DECODED_FACE_HAS_WEIGHTS = 1;
+
+	// magic, version, sculpt flags, face count
+	const S32 DECODED_HEADER_SIZE = 16;
+	// vertex count, index count, flags, padding, mExtents (with mCenter), mTexCoordExtents
+	const S32 DECODED_FACE_HEADER_SIZE = 16 + 3 * sizeof(LLVector4a) + 2 * sizeof(LLVector2);
+
+	// Sizes of the buffers, as allocated by resizeVertices and resizeIndices.
+	S32 decoded_vertex_bytes(S32 num_verts)
+	{
+		return num_verts * 2 * sizeof(LLVector4a) + (((num_verts * sizeof(LLVector2)) + 0xF) & ~0xF);
+	}
+
+	S32 decoded_index_bytes(S32 num_indices)
+	{
+		return ((num_indices * sizeof(U16)) + 0xF) & ~0xF;
+	}
+
+	U32 decoded_sculpt_flags(const LLVolumeParams& params)
+	{
+		return params.getSculptType() & (LL_SCULPT_FLAG_MIRROR | LL_SCULPT_FLAG_INVERT);
+	}
+}
+
+void LLVolume::packDecodedFaces(std::string& data) const
+{
+	S32 size = DECODED_HEADER_SIZE;
+	for (face_list_t::const_iterator iter = mVolumeFaces.begin(); iter != mVolumeFaces.end(); ++iter)
+	{
+		size += DECODED_FACE_HEADER_SIZE;
+		if (iter->mNumVertices)
+		{
+			size += decoded_vertex_bytes(iter->mNumVertices);
+			if (iter->mWeights)
+			{
+				size += iter->mNumVertices * sizeof(LLVector4a);
+			}
+		}
+		if (iter->mNumIndices)
+		{
+			size += decoded_index_bytes(iter->mNumIndices);
+		}
+	}
+
+	data.resize(size);
+	char* out = &data[0];
+
+	U32 header[3] = { DECODED_FACES_VERSION, decoded_sculpt_flags(mParams), (U32)mVolumeFaces.size() };
+	memcpy(out, DECODED_FACES_MAGIC, 4);		/* Flawfinder: ignore */
+	memcpy(out + 4, header, 12);				/* Flawfinder: ignore */
+	out += DECODED_HEADER_SIZE;
+
+	for (face_list_t::const_iterator iter = mVolumeFaces.begin(); iter != mVolumeFaces.end(); ++iter)
+	{
+		const LLVolumeFace& face = *iter;
+		S32 counts[4] = { face.mNumVertices, face.mNumIndices, 0, 0 };
+		if (face.mNumVertices && face.mWeights)
+		{
+			counts[2] = DECODED_FACE_HAS_WEIGHTS;
+		}
+		memcpy(out, counts, 16);											/* Flawfinder: ignore */
+		memcpy(out + 16, face.mExtents, 3 * sizeof(LLVector4a));			/* Flawfinder: ignore */
+		memcpy(out + 64, face.mTexCoordExtents, 2 * sizeof(LLVector2));	/* Flawfinder: ignore */
+		out += DECODED_FACE_HEADER_SIZE;
+
+		if (face.mNumVertices)
+		{
+			// Positions, normals and texture coordinates are one buffer.
+			S32 bytes = decoded_vertex_bytes(face.mNumVertices);
+			memcpy(out, face.mPositions, bytes);							/* Flawfinder: ignore */
+			out += bytes;
+		}
+		if (face.mNumIndices)
+		{
+			S32 bytes = decoded_index_bytes(face.mNumIndices);
+			memcpy(out, face.mIndices, bytes);								/* Flawfinder: ignore */
+			out += bytes;
+		}
+		if (counts[2] & DECODED_FACE_HAS_WEIGHTS)
+		{
+			S32 bytes = face.mNumVertices * sizeof(LLVector4a);
+			memcpy(out, face.mWeights, bytes);								/* Flawfinder: ignore */
+			out += bytes;
+		}
+	}
+
+	llassert(out == &data[0] + size);
+}
+
+bool LLVolume::unpackDecodedFaces(const U8* data, S32 size)
+{
+	U32 header[3];
+	if (size < DECODED_HEADER_SIZE || memcmp(data, DECODED_FACES_MAGIC, 4))
+	{
+		return false;
+	}
+	memcpy(header, data + 4, 12);				/* Flawfinder: ignore */
+	if (header[0] != DECODED_FACES_VERSION || header[1] != decoded_sculpt_flags(mParams) ||
+		header[2] == 0 || header[2] > (U32)LL_SCULPT_MESH_MAX_FACES)
+	{
+		return false;
+	}
+
+	const U8* in = data + DECODED_HEADER_SIZE;
+	const U8* end = data + size;
+
+	mVolumeFaces.clear();
+	mVolumeFaces.resize(header[2]);
+
+	for (U32 i = 0; i < header[2]; ++i)
+	{
+		LLVolumeFace& face = mVolumeFaces[i];
+
+		S32 counts[4];
+		if (end - in < DECODED_FACE_HEADER_SIZE)
+		{
+			mVolumeFaces.clear();
+			return false;
+		}
+		memcpy(counts, in, 16);												/* Flawfinder: ignore */
+		S32 num_verts = counts[0];
+		S32 num_indices = counts[1];
+		bool has_weights = num_verts && (counts[2] & DECODED_FACE_HAS_WEIGHTS);
+		if (num_verts < 0 || num_verts > 65536 || num_indices < 0 || num_indices > 3 * 65536 ||
+			end - in < DECODED_FACE_HEADER_SIZE + (num_verts ? decoded_vertex_bytes(num_verts) : 0) +
+					   (num_indices ? decoded_index_bytes(num_indices) : 0) +
+					   (has_weights ? num_verts * (S32)sizeof(LLVector4a) : 0))
+		{
+			mVolumeFaces.clear();
+			return false;
+		}
+		memcpy(face.mExtents, in + 16, 3 * sizeof(LLVector4a));			/* Flawfinder: ignore */
+		memcpy(face.mTexCoordExtents, in + 64, 2 * sizeof(LLVector2));		/* Flawfinder: ignore */
+		in += DECODED_FACE_HEADER_SIZE;
+
+		face.resizeVertices(num_verts);
+		if (num_verts)
+		{
+			S32 bytes = decoded_vertex_bytes(num_verts);
+			memcpy(face.mPositions, in, bytes);								/* Flawfinder: ignore */
+			in += bytes;
+		}
+
+		face.resizeIndices(num_indices);
+		if (num_indices)
+		{
+			S32 bytes = decoded_index_bytes(num_indices);
+			memcpy(face.mIndices, in, bytes);								/* Flawfinder: ignore */
+			in += bytes;
+
+			// A damaged cache entry must not make the renderer read past the vertices.
+			// Faces without vertices are left as unpackVolumeFaces leaves them.
+			for (S32 j = 0; num_verts && j < num_indices; ++j)
+			{
+				if (face.mIndices[j] >= num_verts)
+				{
+					mVolumeFaces.clear();
+					return false;
+				}
+			}
+		}
+
+		if (has_weights)
+		{
+			face.allocateWeights(num_verts);
+			S32 bytes = num_verts * sizeof(LLVector4a);
+			memcpy(face.mWeights, in, bytes);								/* Flawfinder: ignore */
+			in += bytes;
+		}
+
+		// The faces were cache optimized before they were packed.
+		face.mOptimized = TRUE;
+	}
+
+	mSculptLevel = 0;
+
+	return true;
+}
+
 
 BOOL LLVolume::isMeshAssetLoaded()
 {
@@ -2809,9 +2993,10 @@ inline LLVector4a sculpt_rgb_to_vector(U8 r, U8 g, U8 b)
 	return value;
 }
 
-inline U32 sculpt_xy_to_index(U32 x, U32 y, U16 sculpt_width, U16 sculpt_height, S8 sculpt_components)
+// sculpt_row_stride is the bytes from one row to the next: width * components unless the map is a sub-rectangle.
+inline U32 sculpt_xy_to_index(U32 x, U32 y, S32 sculpt_row_stride, S8 sculpt_components)
 {
-	U32 index = (x + y * sculpt_width) * sculpt_components;
+	U32 index = x * sculpt_components + y * sculpt_row_stride;
 	return index;
 }
 
@@ -2821,7 +3006,7 @@ inline U32 sculpt_st_to_index(S32 s, S32 t, S32 size_s, S32 size_t, U16 sculpt_w
 	U32 x = (U32) ((F32)s/(size_s) * (F32) sculpt_width);
 	U32 y = (U32) ((F32)t/(size_t) * (F32) sculpt_height);
 
-	return sculpt_xy_to_index(x, y, sculpt_width, sculpt_height, sculpt_components);
+	return sculpt_xy_to_index(x, y, sculpt_width * sculpt_components, sculpt_components);
 }
 
 
@@ -2839,9 +3024,9 @@ inline LLVector4a sculpt_st_to_vector(S32 s, S32 t, S32 size_s, S32 size_t, U16
 	return sculpt_index_to_vector(index, sculpt_data);
 }
 
-inline LLVector4a sculpt_xy_to_vector(U32 x, U32 y, U16 sculpt_width, U16 sculpt_height, S8 sculpt_components, const U8* sculpt_data)
+inline LLVector4a sculpt_xy_to_vector(U32 x, U32 y, S32 sculpt_row_stride, S8 sculpt_components, const U8* sculpt_data)
 {
-	U32 index = sculpt_xy_to_index(x, y, sculpt_width, sculpt_height, sculpt_components);
+	U32 index = sculpt_xy_to_index(x, y, sculpt_row_stride, sculpt_components);
 
 	return sculpt_index_to_vector(index, sculpt_data);
 }
@@ -2923,7 +3108,7 @@ void LLVolume::sculptGeneratePlaceholder()
 }
 
 // create the vertices from the map
-void LLVolume::sculptGenerateMapVertices(U16 sculpt_width, U16 sculpt_height, S8 sculpt_components, const U8* sculpt_data, U8 sculpt_type)
+void LLVolume::sculptGenerateMapVertices(U16 sculpt_width, U16 sculpt_height, S8 sculpt_components, const U8* sculpt_data, U8 sculpt_type, S32 sculpt_row_stride)
 {
 	U8 sculpt_stitching = sculpt_type & LL_SCULPT_TYPE_MASK;
 	BOOL sculpt_invert = sculpt_type & LL_SCULPT_FLAG_INVERT;
@@ -2997,7 +3182,7 @@ void LLVolume::sculptGenerateMapVertices(U16 sculpt_width, U16 sculpt_height, S8
 				}
 			}
 
-			pt = sculpt_xy_to_vector(x, y, sculpt_width, sculpt_height, sculpt_components, sculpt_data);
+			pt = sculpt_xy_to_vector(x, y, sculpt_row_stride, sculpt_components, sculpt_data);
 
 			if (sculpt_mirror)
 			{
@@ -3104,10 +3289,15 @@ bool sculpt_calc_mesh_resolution(U16 width, U16 height, U8 type, F32 detail, S32
 }
 
 // sculpt replaces generate() for sculpted surfaces
-void LLVolume::sculpt(U16 sculpt_width, U16 sculpt_height, S8 sculpt_components, const U8* sculpt_data, S32 sculpt_level)
+void LLVolume::sculpt(U16 sculpt_width, U16 sculpt_height, S8 sculpt_components, const U8* sculpt_data, S32 sculpt_level, S32 sculpt_row_stride)
 {
     U8 sculpt_type = mParams.getSculptType();
 
+	if (sculpt_row_stride <= 0)
+	{
+		sculpt_row_stride = sculpt_width * sculpt_components;
+	}
+
 	BOOL data_is_empty = FALSE;
 
 	if (sculpt_width == 0 || sculpt_height == 0 || sculpt_components < 3 || sculpt_data == NULL)
@@ -3154,7 +3344,7 @@ void LLVolume::sculpt(U16 sculpt_width, U16 sculpt_height, S8 sculpt_components,
 	//generate vertex positions
 	if (!data_is_empty)
 	{
-		sculptGenerateMapVertices(sculpt_width, sculpt_height, sculpt_components, sculpt_data, sculpt_type);
+		sculptGenerateMapVertices(sculpt_width, sculpt_height, sculpt_components, sculpt_data, sculpt_type, sculpt_row_stride);
 
 		// don't test lowest LOD to support legacy content DEV-33670
 		if (mDetail > SCULPT_MIN_AREA_DETAIL)
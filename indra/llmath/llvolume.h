@@ -1048,12 +1048,14 @@ public:
 	U32					mFaceMask;			// bit array of which faces exist in this volume
 	LLVector3			mLODScaleBias;		// vector for biasing LOD based on scale
 	
-	void sculpt(U16 sculpt_width, U16 sculpt_height, S8 sculpt_components, const U8* sculpt_data, S32 sculpt_level);
+	// sculpt_row_stride is the bytes between map rows, for a map that is a window onto a larger
+	// image (an LLImageRawView's getRowStride()); 0 means tightly packed.
+	void sculpt(U16 sculpt_width, U16 sculpt_height, S8 sculpt_components, const U8* sculpt_data, S32 sculpt_level, S32 sculpt_row_stride = 0);
 	void copyVolumeFaces(const LLVolume* volume);
 	void cacheOptimize();
 
 private:
-	void sculptGenerateMapVertices(U16 sculpt_width, U16 sculpt_height, S8 sculpt_components, const U8* sculpt_data, U8 sculpt_type);
+	void sculptGenerateMapVertices(U16 sculpt_width, U16 sculpt_height, S8 sculpt_components, const U8* sculpt_data, U8 sculpt_type, S32 sculpt_row_stride);
 	F32 sculptGetSurfaceArea();
 	void sculptGeneratePlaceholder();
 	void sculptCalcMeshResolution(U16 width, U16 height, U8 type, S32& s, S32& t);
@@ -1065,6 +1067,17 @@ protected:
 public:
 	virtual bool unpackVolumeFaces(std::istream& is, S32 size);
 
+	// Faces as left by unpackVolumeFaces (dequantized, mirrored or inverted
+	// according to the sculpt type, cache optimized) in a binary format for
+	// the local mesh cache. Every block has the size and padding of its
+	// LLVolumeFace buffer, so unpacking is one copy per buffer. Host byte
+	// order: the data never leaves the machine that wrote it. Bump
+	// DECODED_FACES_VERSION whenever the decoding above changes its output.
+	void packDecodedFaces(std::string& data) const;
+	bool unpackDecodedFaces(const U8* data, S32 size);
+
+	static const U32 DECODED_FACES_VERSION;
+
 	virtual void setMeshAssetLoaded(BOOL loaded);
 	virtual BOOL isMeshAssetLoaded();
 
@@ -0,0 +1,266 @@
+/**
+ * @file llvolume_test.cpp
+ * @brief Tests the decoded mesh face format of LLVolume.
+ *
+ * $LicenseInfo:firstyear=2001&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "../llcommon/linden_common.h"
+#include <sstream>
+#include <vector>
+// Class to test
+#include "../llvolume.h"
+// Dependencies
+#include "llsdserialize.h"
+#include "v2math.h"
+#include "v3math.h"
+// Tut header
+#include "../test/lltut.h"
+
+namespace
+{
+	// A mesh asset face as LLVolume::unpackVolumeFaces expects it.
+	LLSD make_face(S32 num_verts, bool weights)
+	{
+		std::vector<U8> pos(num_verts * 6), norm(num_verts * 6), tc(num_verts * 4), idx;
+		for (size_t i = 0; i < pos.size(); ++i)
+		{
+			pos[i] = U8(i * 37 + 11);
+			norm[i] = U8(i * 53 + 7);
+		}
+		for (size_t i = 0; i < tc.size(); ++i)
+		{
+			tc[i] = U8(i * 29 + 3);
+		}
+		for (S32 t = 0; t < num_verts - 2; ++t)
+		{
+			U16 tri[3] = { U16(t), U16(t + 1), U16(t + 2) };
+			for (S32 k = 0; k < 3; ++k)
+			{
+				idx.push_back(tri[k] & 0xff);
+				idx.push_back(tri[k] >> 8);
+			}
+		}
+
+		LLSD face;
+		face["Position"] = pos;
+		face["Normal"] = norm;
+		face["TexCoord0"] = tc;
+		face["TriangleList"] = idx;
+		face["PositionDomain"]["Min"] = LLVector3(-1.f, -2.f, -3.f).getValue();
+		face["PositionDomain"]["Max"] = LLVector3(1.f, 2.f, 3.f).getValue();
+		face["TexCoord0Domain"]["Min"] = LLVector2(0.f, 0.f).getValue();
+		face["TexCoord0Domain"]["Max"] = LLVector2(1.f, 1.f).getValue();
+		if (weights)
+		{
+			// One joint per vertex at full weight, each list terminated with 0xFF.
+			std::vector<U8> w;
+			for (S32 v = 0; v < num_verts; ++v)
+			{
+				w.push_back(U8(v % 4));
+				w.push_back(0xff);
+				w.push_back(0xff);
+				w.push_back(0xff);
+			}
+			face["Weights"] = w;
+		}
+		return face;
+	}
+
+	LLVolumeParams make_params(U8 flags)
+	{
+		LLVolumeParams params;
+		params.setType(LL_PCODE_PROFILE_SQUARE, LL_PCODE_PATH_LINE);
+		params.setSculptID(LLUUID("0f2dd3f1-2a6b-4b5e-9c1d-6c4b0c3a8e21"), LL_SCULPT_TYPE_MESH | flags);
+		return params;
+	}
+
+	// A face with weights, one without, and an empty one, decoded from a zipped asset.
+	LLPointer<LLVolume> make_volume(U8 flags)
+	{
+		LLSD mdl = LLSD::emptyArray();
+		mdl.append(make_face(24, false));
+		mdl.append(make_face(10, true));
+		LLSD empty;
+		empty["NoGeometry"] = true;
+		mdl.append(empty);
+
+		std::string zipped = zip_llsd(mdl);
+		std::istringstream istr(zipped);
+		LLPointer<LLVolume> volume = new LLVolume(make_params(flags), 1.f);
+		volume->unpackVolumeFaces(istr, zipped.size());
+		return volume;
+	}
+
+	bool same_faces(const LLVolume* a, const LLVolume* b)
+	{
+		if (a->getNumVolumeFaces() != b->getNumVolumeFaces())
+		{
+			return false;
+		}
+		for (S32 i = 0; i < a->getNumVolumeFaces(); ++i)
+		{
+			const LLVolumeFace& x = a->getVolumeFace(i);
+			const LLVolumeFace& y = b->getVolumeFace(i);
+			S32 nv = x.mNumVertices;
+			if (nv != y.mNumVertices || x.mNumIndices != y.mNumIndices ||
+				(x.mWeights == NULL) != (y.mWeights == NULL) ||
+				memcmp(x.mExtents, y.mExtents, 3 * sizeof(LLVector4a)) ||
+				memcmp(x.mTexCoordExtents, y.mTexCoordExtents, 2 * sizeof(LLVector2)))
+			{
+				return false;
+			}
+			if (nv && (memcmp(x.mPositions, y.mPositions, nv * sizeof(LLVector4a)) ||
+					   memcmp(x.mNormals, y.mNormals, nv * sizeof(LLVector4a)) ||
+					   memcmp(x.mTexCoords, y.mTexCoords, nv * sizeof(LLVector2)) ||
+					   memcmp(x.mIndices, y.mIndices, x.mNumIndices * sizeof(U16)) ||
+					   (x.mWeights && memcmp(x.mWeights, y.mWeights, nv * sizeof(LLVector4a)))))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// A sphere sculpt map, w x h RGB pixels, written at (x0, y0) into an image row_stride bytes wide.
+	void fill_sphere_map(std::vector<U8>& data, S32 w, S32 h, S32 x0, S32 y0, S32 row_stride)
+	{
+		for (S32 y = 0; y < h; ++y)
+		{
+			F32 theta = F_PI * y / (h - 1);
+			for (S32 x = 0; x < w; ++x)
+			{
+				F32 phi = F_TWO_PI * x / w;
+				U8* pix = &data[(y0 + y) * row_stride + (x0 + x) * 3];
+				pix[0] = U8(127.5f + 127.f * sinf(theta) * cosf(phi));
+				pix[1] = U8(127.5f + 127.f * sinf(theta) * sinf(phi));
+				pix[2] = U8(127.5f + 127.f * cosf(theta));
+			}
+		}
+	}
+
+	bool unpack(const std::string& packed, U8 flags, S32 size = -1)
+	{
+		LLPointer<LLVolume> volume = new LLVolume(make_params(flags), 1.f);
+		return volume->unpackDecodedFaces((const U8*)packed.data(), size < 0 ? (S32)packed.size() : size);
+	}
+}
+
+namespace tut
+{
+	struct volume_test
+	{
+	};
+
+	typedef test_group<volume_test> volume_t;
+	typedef volume_t::object volume_object_t;
+	tut::volume_t tut_volume("LLVolume");
+
+	template<> template<>
+	void volume_object_t::test<1>()
+	{
+		// Decoded faces come back exactly as packed, for every mirror/invert combination.
+		const U8 flags[] = { 0, LL_SCULPT_FLAG_MIRROR, LL_SCULPT_FLAG_INVERT, LL_SCULPT_FLAG_MIRROR | LL_SCULPT_FLAG_INVERT };
+		for (S32 i = 0; i < 4; ++i)
+		{
+			LLPointer<LLVolume> volume = make_volume(flags[i]);
+			ensure_equals("faces", volume->getNumVolumeFaces(), 3);
+			ensure("weights", volume->getVolumeFace(0).mWeights == NULL && volume->getVolumeFace(1).mWeights != NULL);
+			// unpackVolumeFaces stands in a single degenerate triangle for a face without geometry.
+			ensure_equals("empty face", volume->getVolumeFace(2).mNumVertices, 1);
+
+			std::string packed;
+			volume->packDecodedFaces(packed);
+
+			LLPointer<LLVolume> copy = new LLVolume(make_params(flags[i]), 1.f);
+			ensure(llformat("unpack, flags %d", flags[i]), copy->unpackDecodedFaces((const U8*)packed.data(), packed.size()));
+			ensure(llformat("same faces, flags %d", flags[i]), same_faces(volume, copy));
+			ensure("optimized", copy->getVolumeFace(0).mOptimized);
+		}
+	}
+
+	template<> template<>
+	void volume_object_t::test<2>()
+	{
+		// Damaged or mismatched entries are rejected.
+		LLPointer<LLVolume> volume = make_volume(LL_SCULPT_FLAG_MIRROR);
+		std::string packed;
+		volume->packDecodedFaces(packed);
+		ensure("intact", unpack(packed, LL_SCULPT_FLAG_MIRROR));
+
+		ensure("truncated body", !unpack(packed, LL_SCULPT_FLAG_MIRROR, packed.size() - 16));
+		ensure("truncated face header", !unpack(packed, LL_SCULPT_FLAG_MIRROR, 16 + 40));
+		ensure("truncated header", !unpack(packed, LL_SCULPT_FLAG_MIRROR, 10));
+
+		std::string bad = packed;
+		U32 version = LLVolume::DECODED_FACES_VERSION + 1;
+		memcpy(&bad[4], &version, 4);				/* Flawfinder: ignore */
+		ensure("wrong version", !unpack(bad, LL_SCULPT_FLAG_MIRROR));
+
+		bad = packed;
+		bad[0] = 'X';
+		ensure("wrong magic", !unpack(bad, LL_SCULPT_FLAG_MIRROR));
+
+		ensure("wrong sculpt flags", !unpack(packed, 0));
+		ensure("wrong sculpt flags", !unpack(packed, LL_SCULPT_FLAG_MIRROR | LL_SCULPT_FLAG_INVERT));
+
+		// The first index of the first face: file header, face header, then the vertex buffer.
+		const LLVolumeFace& face = volume->getVolumeFace(0);
+		S32 nv = face.mNumVertices;
+		S32 offset = 16 + 16 + 3 * sizeof(LLVector4a) + 2 * sizeof(LLVector2) +
+					 nv * 2 * sizeof(LLVector4a) + ((nv * sizeof(LLVector2) + 0xF) & ~0xF);
+		bad = packed;
+		U16 index;
+		memcpy(&index, &bad[offset], 2);			/* Flawfinder: ignore */
+		ensure_equals("first index", index, face.mIndices[0]);
+		index = nv;
+		memcpy(&bad[offset], &index, 2);			/* Flawfinder: ignore */
+		ensure("out of range index", !unpack(bad, LL_SCULPT_FLAG_MIRROR));
+	}
+
+	template<> template<>
+	void volume_object_t::test<3>()
+	{
+		// A sculpt map read through a row stride, as from a view onto part of a
+		// larger image, builds the same volume as the packed map.
+		const S32 w = 32, h = 32;
+		std::vector<U8> packed(w * h * 3, 0);
+		fill_sphere_map(packed, w, h, 0, 0, w * 3);
+
+		const S32 parent_w = 48, parent_h = 40, x0 = 5, y0 = 3;
+		std::vector<U8> parent(parent_w * parent_h * 3, 0xff);
+		fill_sphere_map(parent, w, h, x0, y0, parent_w * 3);
+
+		LLVolumeParams params;
+		params.setType(LL_PCODE_PROFILE_CIRCLE, LL_PCODE_PATH_CIRCLE);
+		params.setSculptID(LLUUID("0f2dd3f1-2a6b-4b5e-9c1d-6c4b0c3a8e21"), LL_SCULPT_TYPE_SPHERE);
+
+		LLPointer<LLVolume> a = new LLVolume(params, 2.f);
+		a->sculpt(w, h, 3, &packed[0], 0);
+		LLPointer<LLVolume> b = new LLVolume(params, 2.f);
+		b->sculpt(w, h, 3, &parent[(y0 * parent_w + x0) * 3], 0, parent_w * 3);
+
+		ensure_equals("sculpt level", b->getSculptLevel(), 0);
+		ensure("has faces", b->getNumVolumeFaces() > 0);
+		ensure("same faces", same_faces(a, b));
+	}
+}
@@ -77,6 +77,11 @@ AIPerService::AIPerService(void) :
 		mTotalAdded(0),
 		mEventPolls(0),
 		mEstablishedConnections(0),
+		mLatency(25),
+		mBaseLatency(0.f),
+		mLastBandwidth(0),
+		mLastAdjustment(0),
+		mConnectionLimited(false),
 		mUsedCT(0),
 		mCTInUse(0)
 {
@@ -98,7 +103,7 @@ AIPerService::CapabilityType::~CapabilityType()
 }
 
 // Fake copy constructor.
-AIPerService::AIPerService(AIPerService const&) : mHTTPBandwidth(0)
+AIPerService::AIPerService(AIPerService const&) : mHTTPBandwidth(0), mLatency(0)
 {
 }
 
@@ -417,6 +422,10 @@ bool AIPerService::queue(AICurlEasyRequest const& easy_request, AICapabilityType
   if (needs_queuing)
   {
 	queued_requests.push_back(easy_request.get_ptr());
+	if (mTotalAdded >= mConcurrentConnections)
+	{
+	  mConnectionLimited = true;
+	}
 	if (is_approved(capability_type))
 	{
 	  TotalQueued_wat(sTotalQueued)->approved++;
@@ -488,6 +497,10 @@ void AIPerService::add_queued_to(curlthread::MultiHandle* multi_handle, bool onl
 	if (mTotalAdded >= mConcurrentConnections)
 	{
 	  // We hit the maximum number of connections for this service. Abort any attempt to add anything to this service.
+	  if (!ct.mQueuedRequests.empty())
+	  {
+		mConnectionLimited = true;
+	  }
 	  break;
 	}
 	if (ct.mAdded >= ct.mConcurrentConnections)
@@ -624,18 +637,75 @@ void AIPerService::adjust_concurrent_connections(int increment)
   for (AIPerService::iterator iter = instance_map_w->begin(); iter != instance_map_w->end(); ++iter)
   {
 	PerService_wat per_service_w(*iter->second);
-	U16 old_concurrent_connections = per_service_w->mConcurrentConnections;
-	int new_concurrent_connections = llclamp(old_concurrent_connections + increment, 1, (int)CurlConcurrentConnectionsPerService);
-	per_service_w->mConcurrentConnections = (U16)new_concurrent_connections;
-	increment = per_service_w->mConcurrentConnections - old_concurrent_connections;
-	for (int i = 0; i < number_of_capability_types; ++i)
-	{
-	  per_service_w->mCapabilityType[i].mMaxPipelinedRequests = llmax(per_service_w->mCapabilityType[i].mMaxPipelinedRequests + increment, 0);
-	  int new_concurrent_connections_per_capability_type =
-		  llclamp((new_concurrent_connections * per_service_w->mCapabilityType[i].mConcurrentConnections + old_concurrent_connections / 2) / old_concurrent_connections, 1, new_concurrent_connections);
-	  per_service_w->mCapabilityType[i].mConcurrentConnections = (U16)new_concurrent_connections_per_capability_type;
-	}
+	per_service_w->set_concurrent_connections(llclamp(per_service_w->mConcurrentConnections + increment, 1, (int)CurlConcurrentConnectionsPerService));
+  }
+}
+
+void AIPerService::set_concurrent_connections(int new_concurrent_connections)
+{
+  U16 old_concurrent_connections = mConcurrentConnections;
+  mConcurrentConnections = (U16)new_concurrent_connections;
+  int increment = new_concurrent_connections - old_concurrent_connections;
+  for (int i = 0; i < number_of_capability_types; ++i)
+  {
+	mCapabilityType[i].mMaxPipelinedRequests = llmax(mCapabilityType[i].mMaxPipelinedRequests + increment, 0);
+	int new_concurrent_connections_per_capability_type =
+		llclamp((new_concurrent_connections * mCapabilityType[i].mConcurrentConnections + old_concurrent_connections / 2) / old_concurrent_connections, 1, new_concurrent_connections);
+	mCapabilityType[i].mConcurrentConnections = (U16)new_concurrent_connections_per_capability_type;
+  }
+}
+
+// Adaptive concurrency, in the spirit of TCP Vegas with an AIMD step.
+//
+// The time to first byte of a request is the round trip time plus the time the request
+// spent waiting at the server. The lowest one second average seen is taken as the
+// latency of an idle service; when the current average rises well above that, requests
+// are queuing up at the server (or in a throttled link in between) and more connections
+// only make things worse, so back off multiplicatively. Otherwise, if we had requests
+// waiting for a connection and the bandwidth didn't drop since the last step, try one
+// connection more. At most one step per second, so that every step is measured over
+// requests that were made with the previous limit.
+void AIPerService::request_finished(U32 latency_ms, U64 sTime_40ms)
+{
+  mLatency.addData(latency_ms, sTime_40ms);
+  if (!sAdaptiveConcurrency || sTime_40ms - mLastAdjustment < 25)		// 25 = 1000 ms / 40 ms.
+  {
+	return;
+  }
+  F32 const latency = (F32)mLatency.getAverage(0);
+  if (latency <= 0.f)
+  {
+	return;
+  }
+  // Let the base latency slowly follow the current latency upwards, so that a route change doesn't stall us forever.
+  if (mBaseLatency == 0.f || latency < mBaseLatency)
+  {
+	mBaseLatency = latency;
+  }
+  else
+  {
+	mBaseLatency += (latency - mBaseLatency) / 32;
+  }
+  size_t const bandwidth = mHTTPBandwidth.truncateData(sTime_40ms);
+  int new_concurrent_connections = mConcurrentConnections;
+  if (latency > 2 * mBaseLatency)
+  {
+	new_concurrent_connections = mConcurrentConnections * 3 / 4;
+  }
+  else if (mConnectionLimited && bandwidth >= mLastBandwidth)
+  {
+	new_concurrent_connections = mConcurrentConnections + 1;
+  }
+  new_concurrent_connections = llclamp(new_concurrent_connections, (int)llmin(sMinConcurrentConnections, CurlConcurrentConnectionsPerService), (int)CurlConcurrentConnectionsPerService);
+  if (new_concurrent_connections != mConcurrentConnections)
+  {
+	Dout(dc::curl, "Adaptive concurrency: latency " << latency << " ms (base " << mBaseLatency << " ms), bandwidth " << bandwidth <<
+		" bytes/s: " << mConcurrentConnections << " --> " << new_concurrent_connections << " connections.");
+	set_concurrent_connections(new_concurrent_connections);
   }
+  mLastBandwidth = bandwidth;
+  mLastAdjustment = sTime_40ms;
+  mConnectionLimited = false;
 }
 
 void AIPerService::ResetUsed::operator()(AIPerService::instance_map_type::value_type const& service) const
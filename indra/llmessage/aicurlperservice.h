@@ -173,6 +173,13 @@ class AIPerService {
 	int mEventPolls;							// Number of active event poll handles with this service.
 	int mEstablishedConnections;				// Number of connected sockets to this service.
 
+	// Adaptive concurrency (see request_finished).
+	AIAverage mLatency;							// Keeps track of the time to first byte (in ms) of requests that finished in the past second.
+	F32 mBaseLatency;							// The lowest one second average of mLatency seen (slowly forgotten), or 0 when unknown.
+	size_t mLastBandwidth;						// mHTTPBandwidth at the last adjustment of mConcurrentConnections.
+	U64 mLastAdjustment;						// Time of the last adjustment of mConcurrentConnections, in 40 ms units.
+	bool mConnectionLimited;					// Set when a request had to wait for a connection since the last adjustment.
+
 	U32 mUsedCT;								// Bit mask with one bit per capability type. A '1' means the capability was in use since the last resetUsedCT().
 	U32 mCTInUse;								// Bit mask with one bit per capability type. A '1' means the capability is in use right now.
 
@@ -180,6 +187,7 @@ class AIPerService {
 	struct ResetUsed { void operator()(instance_map_type::value_type const& service) const; };
 
 	void redivide_connections(void);
+	void set_concurrent_connections(int new_concurrent_connections);
 	void mark_inuse(AICapabilityType capability_type)
 	{
 	  U32 bit = CT2mask(capability_type);
@@ -266,6 +274,8 @@ class AIPerService {
 
 	static LLAtomicU32 sHTTPThrottleBandwidth125;			// HTTPThrottleBandwidth times 125 (in bytes/s).
 	static bool sNoHTTPBandwidthThrottling;					// Global override to disable bandwidth throttling.
+	static bool sAdaptiveConcurrency;						// Let request_finished tune mConcurrentConnections.
+	static U16 sMinConcurrentConnections;					// Lower bound for that; the upper bound is CurlConcurrentConnectionsPerService.
 
   public:
 	void added_to_command_queue(AICapabilityType capability_type) { ++mCapabilityType[capability_type].mQueuedCommands; mark_inuse(capability_type); }
@@ -275,6 +285,7 @@ class AIPerService {
 								   bool downloaded_something, bool success);			// Called when an easy handle for this service is removed again from the multi handle.
 	void download_started(AICapabilityType capability_type) { ++mCapabilityType[capability_type].mDownloading; }
 	bool throttled(AICapabilityType capability_type) const;		// Returns true if the maximum number of allowed requests for this service/capability type have been added to the multi handle.
+	void request_finished(U32 latency_ms, U64 sTime_40ms);		// Called when a (non event poll) request finished successfully, with its time to first byte.
 	bool nothing_added(AICapabilityType capability_type) const { return mCapabilityType[capability_type].mAdded == 0; }
 
 	bool queue(AICurlEasyRequest const& easy_request, AICapabilityType capability_type, bool force_queuing = true);	// Add easy_request to the queue if queue is empty or force_queuing.
@@ -288,8 +299,11 @@ class AIPerService {
 
 	AIAverage& bandwidth(void) { return mHTTPBandwidth; }
 	AIAverage const& bandwidth(void) const { return mHTTPBandwidth; }
+	AIAverage& latency(void) { return mLatency; }
+	AIAverage const& latency(void) const { return mLatency; }
 
 	static void setNoHTTPBandwidthThrottling(bool nb) { sNoHTTPBandwidthThrottling = nb; }
+	static void setAdaptiveConcurrency(bool adaptive, U16 min_connections) { sAdaptiveConcurrency = adaptive; sMinConcurrentConnections = llmax(min_connections, (U16)1); }
 	static void setHTTPThrottleBandwidth(F32 max_kbps) { sHTTPThrottleBandwidth125 = 125.f * max_kbps; }
 	static size_t getHTTPThrottleBandwidth125(void) { return sHTTPThrottleBandwidth125; }
 	static F32 throttleFraction(void) { return ThrottleFraction_wat(sThrottleFraction)->fraction / 1024.f; }
@@ -203,6 +203,13 @@ int ioctlsocket(int fd, int, unsigned long* nonblocking_enable)
 
 #define WINDOWS_CODE (LL_WINDOWS || DEBUG_WINDOWS_CODE_ON_LINUX)
 
+// On linux the curl thread can wait with epoll instead of select (see CurlUseEpoll).
+#define EPOLL_CODE (LL_LINUX && !DEBUG_WINDOWS_CODE_ON_LINUX)
+
+#if EPOLL_CODE
+#include <sys/epoll.h>
+#endif
+
 #undef AICurlPrivate
 
 namespace AICurlPrivate {
@@ -804,8 +811,18 @@ void CurlSocketInfo::set_action(int action)
 
   Dout(dc::curl, "CurlSocketInfo::set_action(" << action_str(mAction) << " --> " << action_str(action) << ") [" << (void*)mEasyRequest.get_ptr().get() << "]");
   int toggle_action = mAction ^ action; 
+#if EPOLL_CODE
+  // With epoll the kernel keeps the interest set; the poll sets stay empty.
+  bool const use_poll_sets = mMultiHandle.mEpollFd == -1;
+  if (!use_poll_sets && toggle_action)
+  {
+	mMultiHandle.epoll_update(mSocketFd, mAction, action);
+  }
+#else
+  bool const use_poll_sets = true;
+#endif
   mAction = action;
-  if ((toggle_action & CURL_POLL_IN))
+  if ((toggle_action & CURL_POLL_IN) && use_poll_sets)
   {
 	if ((action & CURL_POLL_IN))
 	  mMultiHandle.mReadPollSet->add(this);
@@ -816,7 +833,8 @@ void CurlSocketInfo::set_action(int action)
   {
 	if ((action & CURL_POLL_OUT))
 	{
-	  mMultiHandle.mWritePollSet->add(this);
+	  if (use_poll_sets)
+		mMultiHandle.mWritePollSet->add(this);
 	  if (mTimeout)
 	  {
 		  // Note that this detection normally doesn't work because mTimeout will be zero.
@@ -826,7 +844,8 @@ void CurlSocketInfo::set_action(int action)
 	}
 	else
 	{
-	  mMultiHandle.mWritePollSet->remove(this);
+	  if (use_poll_sets)
+		mMultiHandle.mWritePollSet->remove(this);
 
 	  // The following is a bit of a hack, needed because of the lack of proper timeout callbacks in libcurl.
 	  // The removal of CURL_POLL_OUT could be part of the SSL handshake, therefore check if we're already connected:
@@ -1388,6 +1407,20 @@ void AICurlThread::run(void)
 
   {
 	AICurlMultiHandle_wat multi_handle_w(AICurlMultiHandle::getInstance());
+#if EPOLL_CODE
+	bool const use_epoll = multi_handle_w->mEpollFd != -1;
+	static int const max_epoll_events = 256;
+	struct epoll_event epoll_events[max_epoll_events];
+	if (use_epoll)
+	{
+	  struct epoll_event ev;
+	  ev.events = EPOLLIN;
+	  ev.data.fd = mWakeUpFd;
+	  llassert_always(epoll_ctl(multi_handle_w->mEpollFd, EPOLL_CTL_ADD, mWakeUpFd, &ev) == 0);
+	}
+#else
+	bool const use_epoll = false;
+#endif
 	while(mRunning)
 	{
 	  // If mRunning is true then we can only get here if mWakeUpFd != CURL_SOCKET_BAD.
@@ -1415,26 +1448,32 @@ void AICurlThread::run(void)
 	  // We're now entering select(), during which the main thread will write to the pipe/socket
 	  // to wake us up, because it can't get the lock.
 
-	  // Copy the next batch of file descriptors from the PollSets mFileDescriptors into their mFdSet.
-	  multi_handle_w->mReadPollSet->refresh();
-	  refresh_t wres = multi_handle_w->mWritePollSet->refresh();
-	  // Add wake up fd if any, and pass NULL to select() if a set is empty.
-	  fd_set* read_fd_set = multi_handle_w->mReadPollSet->access();
-	  FD_SET(mWakeUpFd, read_fd_set);
-	  fd_set* write_fd_set = ((wres & empty)) ? NULL : multi_handle_w->mWritePollSet->access();
-	  // Calculate nfds (ignored on windows).
+	  fd_set* read_fd_set = NULL;
+	  fd_set* write_fd_set = NULL;
+	  int nfds = 0;
+	  if (!use_epoll)
+	  {
+		// Copy the next batch of file descriptors from the PollSets mFileDescriptors into their mFdSet.
+		multi_handle_w->mReadPollSet->refresh();
+		refresh_t wres = multi_handle_w->mWritePollSet->refresh();
+		// Add wake up fd if any, and pass NULL to select() if a set is empty.
+		read_fd_set = multi_handle_w->mReadPollSet->access();
+		FD_SET(mWakeUpFd, read_fd_set);
+		write_fd_set = ((wres & empty)) ? NULL : multi_handle_w->mWritePollSet->access();
+		// Calculate nfds (ignored on windows).
 #if !WINDOWS_CODE
-	  curl_socket_t const max_rfd = llmax(multi_handle_w->mReadPollSet->get_max_fd(), mWakeUpFd);
-	  curl_socket_t const max_wfd = multi_handle_w->mWritePollSet->get_max_fd();
-	  int nfds = llmax(max_rfd, max_wfd) + 1;
-	  llassert(1 <= nfds && nfds <= FD_SETSIZE);
-	  llassert((max_rfd == -1) == (read_fd_set == NULL) &&
-			   (max_wfd == -1) == (write_fd_set == NULL));	// Needed on Windows.
-	  llassert((max_rfd == -1 || multi_handle_w->mReadPollSet->is_set(max_rfd)) &&
-			   (max_wfd == -1 || multi_handle_w->mWritePollSet->is_set(max_wfd)));
+		curl_socket_t const max_rfd = llmax(multi_handle_w->mReadPollSet->get_max_fd(), mWakeUpFd);
+		curl_socket_t const max_wfd = multi_handle_w->mWritePollSet->get_max_fd();
+		nfds = llmax(max_rfd, max_wfd) + 1;
+		llassert(1 <= nfds && nfds <= FD_SETSIZE);
+		llassert((max_rfd == -1) == (read_fd_set == NULL) &&
+				 (max_wfd == -1) == (write_fd_set == NULL));	// Needed on Windows.
+		llassert((max_rfd == -1 || multi_handle_w->mReadPollSet->is_set(max_rfd)) &&
+				 (max_wfd == -1 || multi_handle_w->mWritePollSet->is_set(max_wfd)));
 #else
-	  int nfds = 64;
+		nfds = 64;
 #endif
+	  }
 	  int ready = 0;
 	  struct timeval timeout;
 	  // Update AICurlTimer::sTime_1ms.
@@ -1495,6 +1534,11 @@ void AICurlThread::run(void)
 		++same_count;
 	  }
 #endif
+#endif
+#if EPOLL_CODE
+	  if (use_epoll)
+		ready = epoll_wait(multi_handle_w->mEpollFd, epoll_events, max_epoll_events, timeout_ms);
+	  else
 #endif
 	  ready = select(nfds, read_fd_set, write_fd_set, NULL, &timeout);
 	  mWakeUpFlagMutex.unlock();
@@ -1524,8 +1568,9 @@ void AICurlThread::run(void)
 	  // or -1 when an error occurred. A value of 0 means that a timeout occurred.
 	  if (ready == -1)
 	  {
-		llwarns << "select() failed: " << errno << ", " << strerror(errno) << llendl;
-		if (errno == EBADF)
+		llwarns << (use_epoll ? "epoll_wait" : "select") << "() failed: " << errno << ", " << strerror(errno) << llendl;
+		// epoll drops closed filedescriptors by itself, so EBADF only needs recovery for select().
+		if (errno == EBADF && !use_epoll)
 		{
 		  // Somewhere (fmodex?) one of our file descriptors was closed. Try to recover by finding out which.
 		  llassert_always(!is_bad(mWakeUpFd, false));		// We can't recover from this.
@@ -1596,6 +1641,37 @@ void AICurlThread::run(void)
 		// Handle stalling transactions.
 		multi_handle_w->handle_stalls();
 	  }
+#if EPOLL_CODE
+	  else if (use_epoll)
+	  {
+		// First process commands from main-thread, like below.
+		for (int i = 0; i < ready; ++i)
+		{
+		  if (epoll_events[i].data.fd == mWakeUpFd)
+		  {
+			wakeup(multi_handle_w);
+			break;
+		  }
+		}
+		// Events carry the filedescriptor, not the CurlSocketInfo, because libcurl
+		// can remove sockets (deleting their CurlSocketInfo) while we run over the list.
+		for (int i = 0; i < ready; ++i)
+		{
+		  curl_socket_t fd = epoll_events[i].data.fd;
+		  if (fd == mWakeUpFd)
+			continue;
+		  U32 events = epoll_events[i].events;
+		  int ev_bitmask = 0;
+		  if ((events & (EPOLLIN | EPOLLHUP)))
+			ev_bitmask |= CURL_CSELECT_IN;
+		  if ((events & EPOLLOUT))
+			ev_bitmask |= CURL_CSELECT_OUT;
+		  if ((events & EPOLLERR))
+			ev_bitmask |= CURL_CSELECT_ERR;
+		  multi_handle_w->socket_action(fd, ev_bitmask);
+		}
+	  }
+#endif
 	  else
 	  {
 		if (multi_handle_w->mReadPollSet->is_set(mWakeUpFd))
@@ -1632,10 +1708,24 @@ void AICurlThread::run(void)
 
 LLAtomicU32 MultiHandle::sTotalAdded;
 
-MultiHandle::MultiHandle(void) : mTimeout(-1), mReadPollSet(NULL), mWritePollSet(NULL)
+MultiHandle::MultiHandle(void) : mTimeout(-1), mReadPollSet(NULL), mWritePollSet(NULL), mEpollFd(-1)
 {
   mReadPollSet = new PollSet;
   mWritePollSet = new PollSet;
+#if EPOLL_CODE
+  if (curl_use_epoll)
+  {
+	mEpollFd = epoll_create(64);		// The size is only a hint.
+	if (mEpollFd == -1)
+	{
+	  llwarns << "epoll_create() failed: " << errno << ", " << strerror(errno) << "; using select()." << llendl;
+	}
+	else
+	{
+	  fcntl(mEpollFd, F_SETFD, FD_CLOEXEC);
+	}
+  }
+#endif
   check_multi_code(curl_multi_setopt(mMultiHandle, CURLMOPT_SOCKETFUNCTION, &MultiHandle::socket_callback));
   check_multi_code(curl_multi_setopt(mMultiHandle, CURLMOPT_SOCKETDATA, this));
   check_multi_code(curl_multi_setopt(mMultiHandle, CURLMOPT_TIMERFUNCTION, &MultiHandle::timer_callback));
@@ -1653,10 +1743,37 @@ MultiHandle::~MultiHandle()
 	finish_easy_request(*iter, CURLE_GOT_NOTHING);	// Error code is not used anyway.
 	remove_easy_request(*iter);
   }
+#if EPOLL_CODE
+  if (mEpollFd != -1)
+  {
+	close(mEpollFd);
+  }
+#endif
   delete mWritePollSet;
   delete mReadPollSet;
 }
 
+#if EPOLL_CODE
+void MultiHandle::epoll_update(curl_socket_t sockfd, int old_action, int action)
+{
+  // Level triggered: libcurl does not promise to read or write until EAGAIN
+  // in one socket_action() call, so with EPOLLET a socket could go quiet
+  // with data still pending.
+  struct epoll_event ev;
+  ev.events = ((action & CURL_POLL_IN) ? EPOLLIN : 0) | ((action & CURL_POLL_OUT) ? EPOLLOUT : 0);
+  ev.data.fd = sockfd;
+  int op = (old_action == CURL_POLL_NONE) ? EPOLL_CTL_ADD : ((action == CURL_POLL_NONE) ? EPOLL_CTL_DEL : EPOLL_CTL_MOD);
+  if (epoll_ctl(mEpollFd, op, sockfd, &ev) == -1)
+  {
+	// A socket that was closed already was dropped from the epoll set by the kernel.
+	if (op != EPOLL_CTL_DEL || (errno != EBADF && errno != ENOENT))
+	{
+	  llwarns << "epoll_ctl(" << op << ", " << sockfd << ") failed: " << errno << ", " << strerror(errno) << llendl;
+	}
+  }
+}
+#endif
+
 void MultiHandle::handle_stalls(void)
 {
   for(addedEasyRequests_type::iterator iter = mAddedEasyRequests.begin(); iter != mAddedEasyRequests.end();)
@@ -1745,6 +1862,7 @@ CURLMsg const* MultiHandle::info_read(int* msgs_in_queue) const
 }
 
 U32 curl_max_total_concurrent_connections = 32;						// Initialized on start up by startCurlThread().
+bool curl_use_epoll = true;											// Initialized on start up by startCurlThread().
 
 bool MultiHandle::add_easy_request(AICurlEasyRequest const& easy_request, bool from_queue)
 {
@@ -1856,7 +1974,17 @@ CURLMcode MultiHandle::remove_easy_request(addedEasyRequests_type::iterator cons
 	capability_type = curl_easy_request_w->capability_type();
 	event_poll = curl_easy_request_w->is_event_poll();
 	per_service = curl_easy_request_w->getPerServicePtr();
-	PerService_wat(*per_service)->removed_from_multi_handle(capability_type, event_poll, downloaded_something, success);		// (About to be) removed from mAddedEasyRequests.
+	PerService_wat per_service_w(*per_service);
+	per_service_w->removed_from_multi_handle(capability_type, event_poll, downloaded_something, success);		// (About to be) removed from mAddedEasyRequests.
+	if (success && !event_poll)
+	{
+	  // Feed the time to first byte to the adaptive concurrency of this service.
+	  double pretransfer_time = 0, starttransfer_time = 0;
+	  curl_easy_request_w->getinfo(CURLINFO_PRETRANSFER_TIME, &pretransfer_time);
+	  curl_easy_request_w->getinfo(CURLINFO_STARTTRANSFER_TIME, &starttransfer_time);
+	  U32 latency_ms = (starttransfer_time > pretransfer_time) ? (U32)((starttransfer_time - pretransfer_time) * 1000) : 0;
+	  per_service_w->request_finished(latency_ms, get_clock_count() * HTTPTimeout::sClockWidth_40ms);
+	}
 #ifdef SHOW_ASSERT
 	curl_easy_request_w->mRemovedPerCommand = as_per_command;
 #endif
@@ -2670,10 +2798,12 @@ void startCurlThread(LLControlGroup* control_group)
   // Cache Debug Settings.
   sConfigGroup = control_group;
   curl_max_total_concurrent_connections = sConfigGroup->getU32("CurlMaxTotalConcurrentConnections");
+  curl_use_epoll = sConfigGroup->getBOOL("CurlUseEpoll");
   CurlConcurrentConnectionsPerService = (U16)sConfigGroup->getU32("CurlConcurrentConnectionsPerService");
   gNoVerifySSLCert = sConfigGroup->getBOOL("NoVerifySSLCert");
   AIPerService::setMaxPipelinedRequests(curl_max_total_concurrent_connections);
   AIPerService::setHTTPThrottleBandwidth(sConfigGroup->getF32("HTTPThrottleBandwidth"));
+  AIPerService::setAdaptiveConcurrency(sConfigGroup->getBOOL("CurlAdaptiveConcurrency"), (U16)llmin(sConfigGroup->getU32("CurlMinConcurrentConnectionsPerService"), (U32)32));
 
   AICurlThread::sInstance = new AICurlThread;
   AICurlThread::sInstance->start();
@@ -2711,6 +2841,15 @@ bool handleCurlConcurrentConnectionsPerService(LLSD const& newvalue)
   return true;
 }
 
+bool handleCurlAdaptiveConcurrency(LLSD const& newvalue)
+{
+  using namespace AICurlPrivate;
+
+  // Used for both CurlAdaptiveConcurrency and CurlMinConcurrentConnectionsPerService.
+  AIPerService::setAdaptiveConcurrency(sConfigGroup->getBOOL("CurlAdaptiveConcurrency"), (U16)llmin(sConfigGroup->getU32("CurlMinConcurrentConnectionsPerService"), (U32)32));
+  return true;
+}
+
 bool handleNoVerifySSLCert(LLSD const& newvalue)
 {
   gNoVerifySSLCert = newvalue.asBoolean();
@@ -2755,6 +2894,8 @@ AIThreadSafeSimpleDC<AIPerService::MaxPipelinedRequests> AIPerService::sMaxPipel
 AIThreadSafeSimpleDC<AIPerService::ThrottleFraction> AIPerService::sThrottleFraction;
 LLAtomicU32 AIPerService::sHTTPThrottleBandwidth125(250000);
 bool AIPerService::sNoHTTPBandwidthThrottling;
+bool AIPerService::sAdaptiveConcurrency;
+U16 AIPerService::sMinConcurrentConnections = 1;
 
 // Return Approvement if we want at least one more HTTP request for this service.
 //
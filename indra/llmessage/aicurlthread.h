@@ -40,6 +40,7 @@ namespace AICurlPrivate {
 namespace curlthread {
 
 extern U32 curl_max_total_concurrent_connections;
+extern bool curl_use_epoll;
 
 class PollSet;
 
@@ -114,6 +115,12 @@ class MultiHandle : public CurlMultiHandle
 
 	PollSet* mReadPollSet;
 	PollSet* mWritePollSet;
+
+	// The epoll instance that replaces the poll sets and select() on linux, or -1 when select() is used.
+	int mEpollFd;
+
+	// Change the events epoll waits for on sockfd from the CURL_POLL_* old_action to action.
+	void epoll_update(curl_socket_t sockfd, int old_action, int action);
 };
 
 } // namespace curlthread
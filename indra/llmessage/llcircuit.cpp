@@ -65,11 +65,26 @@ const F32 TARGET_PERIOD_LENGTH = 5.f;	// seconds
 const F32 LL_DUPLICATE_SUPPRESSION_TIMEOUT = 60.f; //seconds - this can be long, as time-based cleanup is
 													// only done when wrapping packetids, now...
 
+const U32 INITIAL_RELIABLE_RING_SIZE = 256;	// Must be a power of two.
+const U32 MAX_FREE_RELIABLE_PACKETS = 256;		// Acked packets kept for reuse, per circuit.
+
+// Number of packet ids from 'from' up to 'to', taking the wrap at LL_MAX_OUT_PACKET_ID into account.
+static inline U32 packet_id_distance(TPACKETID from, TPACKETID to)
+{
+	return (to - from) & (LL_MAX_OUT_PACKET_ID - 1);
+}
+
+static inline TPACKETID next_packet_id(TPACKETID id)
+{
+	return (id + 1) & (LL_MAX_OUT_PACKET_ID - 1);
+}
+
 LLCircuitData::LLCircuitData(const LLHost &host, TPACKETID in_id, 
 							 const F32 circuit_heartbeat_interval, const F32 circuit_timeout)
 :	mHost (host),
 	mWrapID(0),
 	mPacketsOutID(0), 
+	mPacketOutIDs(new LLPacketOutIDs),
 	mPacketsInID(in_id),
 	mHighestPacketID(in_id),
 	mTimeoutCallback(NULL),
@@ -86,6 +101,9 @@ LLCircuitData::LLCircuitData(const LLHost &host, TPACKETID in_id,
 	mLastPingID(0),
 	mPingDelay(INITIAL_PING_VALUE_MSEC), 
 	mPingDelayAveraged((F32)INITIAL_PING_VALUE_MSEC), 
+	mReliableRing(INITIAL_RELIABLE_RING_SIZE, (LLReliablePacket*)NULL),
+	mOldestReliableID(0),
+	mEndReliableID(0),
 	mUnackedPacketCount(0),
 	mUnackedPacketBytes(0),
 	mLastPacketInTime(0.0),
@@ -133,33 +151,14 @@ LLCircuitData::~LLCircuitData()
 
 	// remove all pending reliable messages on this circuit
 	std::vector<TPACKETID> doomed;
-	reliable_iter iter;
-	reliable_iter end = mUnackedPackets.end();
-	for(iter = mUnackedPackets.begin(); iter != end; ++iter)
+	TPACKETID end_id = mEndReliableID;
+	for (TPACKETID id = mOldestReliableID; mUnackedPacketCount && id != end_id; id = next_packet_id(id))
 	{
-		packetp = iter->second;
-		gMessageSystem->mFailedResendPackets++;
-		if(gMessageSystem->mVerboseLog)
-		{
-			doomed.push_back(packetp->mPacketID);
-		}
-		if (packetp->mCallback)
+		packetp = findReliablePacket(id);
+		if (!packetp)
 		{
-			packetp->mCallback(packetp->mCallbackData,LL_ERR_CIRCUIT_GONE);
+			continue;
 		}
-
-		// Update stats
-		mUnackedPacketCount--;
-		mUnackedPacketBytes -= packetp->mBufferLength;
-
-		delete packetp;
-	}
-
-	// remove all pending final retry reliable messages on this circuit
-	end = mFinalRetryPackets.end();
-	for(iter = mFinalRetryPackets.begin(); iter != end; ++iter)
-	{
-		packetp = iter->second;
 		gMessageSystem->mFailedResendPackets++;
 		if(gMessageSystem->mVerboseLog)
 		{
@@ -171,11 +170,10 @@ LLCircuitData::~LLCircuitData()
 		}
 
 		// Update stats
-		mUnackedPacketCount--;
-		mUnackedPacketBytes -= packetp->mBufferLength;
-
-		delete packetp;
+		removeReliablePacket(packetp);
 	}
+	for_each(mFreeReliablePackets.begin(), mFreeReliablePackets.end(), DeletePointer());
+	mFreeReliablePackets.clear();
 
 	// log aborted reliable packets for this circuit.
 	if(gMessageSystem->mVerboseLog && !doomed.empty())
@@ -191,80 +189,99 @@ LLCircuitData::~LLCircuitData()
 
 void LLCircuitData::ackReliablePacket(TPACKETID packet_num)
 {
-	reliable_iter iter;
-	LLReliablePacket *packetp;
-
-	iter = mUnackedPackets.find(packet_num);
-	if (iter != mUnackedPackets.end())
+	LLReliablePacket *packetp = findReliablePacket(packet_num);
+	if (!packetp)
 	{
-		packetp = iter->second;
+		// Couldn't find this packet on the unacked ring.
+		// maybe it's a duplicate ack?
+		return;
+	}
 
-		if(gMessageSystem->mVerboseLog)
+	if(gMessageSystem->mVerboseLog)
+	{
+		std::ostringstream str;
+		str << "MSG: <- " << packetp->mHost << "\tRELIABLE ACKED:\t"
+			<< packetp->mPacketID;
+		llinfos << str.str() << llendl;
+	}
+	if (packetp->mCallback)
+	{
+		if (packetp->mTimeout < 0.f)   // negative timeout will always return timeout even for successful ack, for debugging
 		{
-			std::ostringstream str;
-			str << "MSG: <- " << packetp->mHost << "\tRELIABLE ACKED:\t"
-				<< packetp->mPacketID;
-			llinfos << str.str() << llendl;
+			packetp->mCallback(packetp->mCallbackData,LL_ERR_TCP_TIMEOUT);					
 		}
-		if (packetp->mCallback)
+		else
 		{
-			if (packetp->mTimeout < 0.f)   // negative timeout will always return timeout even for successful ack, for debugging
-			{
-				packetp->mCallback(packetp->mCallbackData,LL_ERR_TCP_TIMEOUT);					
-			}
-			else
-			{
-				packetp->mCallback(packetp->mCallbackData,LL_ERR_NOERR);
-			}
+			packetp->mCallback(packetp->mCallbackData,LL_ERR_NOERR);
 		}
+	}
 
-		// Update stats
-		mUnackedPacketCount--;
-		mUnackedPacketBytes -= packetp->mBufferLength;
+	// Update stats and cleanup
+	removeReliablePacket(packetp);
+}
 
-		// Cleanup
-		delete packetp;
-		mUnackedPackets.erase(iter);
-		return;
+
+LLReliablePacket* LLCircuitData::findReliablePacket(TPACKETID packet_num) const
+{
+	if (!mUnackedPacketCount ||
+		packet_id_distance(mOldestReliableID, packet_num) >= packet_id_distance(mOldestReliableID, mEndReliableID))
+	{
+		return NULL;
 	}
+	LLReliablePacket *packetp = mReliableRing[packet_num & (mReliableRing.size() - 1)];
+	return (packetp && packetp->mPacketID == packet_num) ? packetp : NULL;
+}
+
+
+void LLCircuitData::removeReliablePacket(LLReliablePacket *packetp)
+{
+	mReliableRing[packetp->mPacketID & (mReliableRing.size() - 1)] = NULL;
+	mUnackedPacketCount--;
+	mUnackedPacketBytes -= packetp->mBufferLength;
 
-	iter = mFinalRetryPackets.find(packet_num);
-	if (iter != mFinalRetryPackets.end())
+	if (!mUnackedPacketCount)
 	{
-		packetp = iter->second;
-		// llinfos << "Packet " << packet_num << " removed from the pending list" << llendl;
-		if(gMessageSystem->mVerboseLog)
-		{
-			std::ostringstream str;
-			str << "MSG: <- " << packetp->mHost << "\tRELIABLE ACKED:\t"
-				<< packetp->mPacketID;
-			llinfos << str.str() << llendl;
-		}
-		if (packetp->mCallback)
+		mOldestReliableID = mEndReliableID;
+	}
+	else if (packetp->mPacketID == mOldestReliableID)
+	{
+		// Skip to the next packet that is still unacked, there is one before mEndReliableID.
+		do
 		{
-			if (packetp->mTimeout < 0.f)   // negative timeout will always return timeout even for successful ack, for debugging
-			{
-				packetp->mCallback(packetp->mCallbackData,LL_ERR_TCP_TIMEOUT);					
-			}
-			else
-			{
-				packetp->mCallback(packetp->mCallbackData,LL_ERR_NOERR);
-			}
+			mOldestReliableID = next_packet_id(mOldestReliableID);
 		}
+		while (!mReliableRing[mOldestReliableID & (mReliableRing.size() - 1)]);
+	}
 
-		// Update stats
-		mUnackedPacketCount--;
-		mUnackedPacketBytes -= packetp->mBufferLength;
-
-		// Cleanup
-		delete packetp;
-		mFinalRetryPackets.erase(iter);
+	if (mFreeReliablePackets.size() < MAX_FREE_RELIABLE_PACKETS)
+	{
+		packetp->mCallback = NULL;
+		mFreeReliablePackets.push_back(packetp);
 	}
 	else
 	{
-		// Couldn't find this packet on either of the unacked lists.
-		// maybe it's a duplicate ack?
+		delete packetp;
+	}
+}
+
+
+void LLCircuitData::growReliableRing(U32 window)
+{
+	U32 size = mReliableRing.size();
+	while (size < window)
+	{
+		size <<= 1;
+	}
+	std::vector<LLReliablePacket *> ring(size, (LLReliablePacket*)NULL);
+	if (mUnackedPacketCount)
+	{
+		U32 old_mask = mReliableRing.size() - 1;
+		for (TPACKETID id = mOldestReliableID; id != mEndReliableID; id = next_packet_id(id))
+		{
+			ring[id & (size - 1)] = mReliableRing[id & old_mask];
+		}
 	}
+	mReliableRing.swap(ring);
 }
 
 
@@ -276,119 +293,102 @@ S32 LLCircuitData::resendUnackedPackets(const F64 now)
 
 
 	//
-	// Theoretically we should search through the list for the packet with the oldest
-	// packet ID, as otherwise when we WRAP we will resend reliable packets out of order.
-	// Since resends are ALREADY out of order, and wrapping is highly rare (16+million packets),
-	// I'm not going to worry about this for now - djs
+	// Walk the ring from the oldest packet id to the newest, so that resends
+	// go out in order (also when the packet ids wrapped). Packets that still
+	// have retries left are resent when they expired, "final retry" packets
+	// (mRetries == 0) fail when they expired.
 	//
 
-	reliable_iter iter;
 	BOOL have_resend_overflow = FALSE;
-	for (iter = mUnackedPackets.begin(); iter != mUnackedPackets.end();)
+	BOOL stop_resending = FALSE;
+	TPACKETID end_id = mEndReliableID;
+	for (TPACKETID id = mOldestReliableID; mUnackedPacketCount && id != end_id; id = next_packet_id(id))
 	{
-		packetp = iter->second;
-
-		// Only check overflow if we haven't had one yet.
-		if (!have_resend_overflow)
+		packetp = findReliablePacket(id);
+		if (!packetp)
 		{
-			have_resend_overflow = mThrottles.checkOverflow(TC_RESEND, 0);
+			continue;
 		}
 
-		if (have_resend_overflow)
+		if (packetp->mRetries && !stop_resending)
 		{
-			// We've exceeded our bandwidth for resends.
-			// Time to stop trying to send them.
+			// Only check overflow if we haven't had one yet.
+			if (!have_resend_overflow)
+			{
+				have_resend_overflow = mThrottles.checkOverflow(TC_RESEND, 0);
+			}
 
-			// If we have too many unacked packets, we need to start dropping expired ones.
-			if (mUnackedPacketBytes > 512000)
+			if (have_resend_overflow)
 			{
-				if (now > packetp->mExpirationTime)
+				// We've exceeded our bandwidth for resends.
+				// Time to stop trying to send them.
+
+				// If we have too many unacked packets, we need to start dropping expired ones.
+				if (mUnackedPacketBytes > 512000)
 				{
-					// This circuit has overflowed.  Do not retry.  Do not pass go.
-					packetp->mRetries = 0;
-					// Remove it from this list and add it to the final list.
-					mUnackedPackets.erase(iter++);
-					mFinalRetryPackets[packetp->mPacketID] = packetp;
+					if (now > packetp->mExpirationTime)
+					{
+						// This circuit has overflowed.  Do not retry.  Do not pass go.
+						// That makes it a final retry packet, which fails below.
+						packetp->mRetries = 0;
+					}
 				}
 				else
 				{
-					++iter;
+					if (mUnackedPacketBytes > 256000 && !(getPacketsOut() % 1024))
+					{
+						// Warn if we've got a lot of resends waiting.
+						llwarns << mHost << " has " << mUnackedPacketBytes 
+								<< " bytes of reliable messages waiting" << llendl;
+					}
+					// Stop resending.  There are less than 512000 unacked packets.
+					// Final retry packets still need to be checked for failure.
+					stop_resending = TRUE;
 				}
-				// Move on to the next unacked packet.
-				continue;
 			}
-			
-			if (mUnackedPacketBytes > 256000 && !(getPacketsOut() % 1024))
+			else if (now > packetp->mExpirationTime)
 			{
-				// Warn if we've got a lot of resends waiting.
-				llwarns << mHost << " has " << mUnackedPacketBytes 
-						<< " bytes of reliable messages waiting" << llendl;
-			}
-			// Stop resending.  There are less than 512000 unacked packets.
-			break;
-		}
-
-		if (now > packetp->mExpirationTime)
-		{
-			packetp->mRetries--;
-			
-			// retry		
-			mCurrentResendCount++;
+				packetp->mRetries--;
+				
+				// retry		
+				mCurrentResendCount++;
 
-			gMessageSystem->mResentPackets++;
+				gMessageSystem->mResentPackets++;
 
-			if(gMessageSystem->mVerboseLog)
-			{
-				std::ostringstream str;
-				str << "MSG: -> " << packetp->mHost
-					<< "\tRESENDING RELIABLE:\t" << packetp->mPacketID;
-				llinfos << str.str() << llendl;
-			}
+				if(gMessageSystem->mVerboseLog)
+				{
+					std::ostringstream str;
+					str << "MSG: -> " << packetp->mHost
+						<< "\tRESENDING RELIABLE:\t" << packetp->mPacketID;
+					llinfos << str.str() << llendl;
+				}
 
-			packetp->mBuffer[0] |= LL_RESENT_FLAG;  // tag packet id as being a resend	
+				packetp->mBuffer[0] |= LL_RESENT_FLAG;  // tag packet id as being a resend	
 
-			gMessageSystem->mPacketRing->sendPacket(packetp->mSocket, 
-											   (char *)packetp->mBuffer, packetp->mBufferLength, 
-											   packetp->mHost);
+				gMessageSystem->mPacketRing->sendPacket(packetp->mSocket, 
+												   (char *)packetp->mBuffer, packetp->mBufferLength, 
+												   packetp->mHost);
 
-			mThrottles.throttleOverflow(TC_RESEND, packetp->mBufferLength * 8.f);
+				mThrottles.throttleOverflow(TC_RESEND, packetp->mBufferLength * 8.f);
 
-			// The new method, retry time based on ping
-			if (packetp->mPingBasedRetry)
-			{
-				packetp->mExpirationTime = now + llmax(LL_MINIMUM_RELIABLE_TIMEOUT_SECONDS, (LL_RELIABLE_TIMEOUT_FACTOR * getPingDelayAveraged()));
-			}
-			else
-			{
-				// custom, constant retry time
-				packetp->mExpirationTime = now + packetp->mTimeout;
-			}
+				// The new method, retry time based on ping
+				if (packetp->mPingBasedRetry)
+				{
+					packetp->mExpirationTime = now + llmax(LL_MINIMUM_RELIABLE_TIMEOUT_SECONDS, (LL_RELIABLE_TIMEOUT_FACTOR * getPingDelayAveraged()));
+				}
+				else
+				{
+					// custom, constant retry time
+					packetp->mExpirationTime = now + packetp->mTimeout;
+				}
 
-			if (!packetp->mRetries)
-			{
-				// Last resend, remove it from this list and add it to the final list.
-				mUnackedPackets.erase(iter++);
-				mFinalRetryPackets[packetp->mPacketID] = packetp;
-			}
-			else
-			{
-				// Don't remove it yet, it still gets to try to resend at least once.
-				++iter;
+				// When this was the last resend, the packet is a final retry packet now.
+				resent_packets++;
+				continue;
 			}
-			resent_packets++;
-		}
-		else
-		{
-			// Don't need to do anything with this packet, keep iterating.
-			++iter;
 		}
-	}
 
-
-	for (iter = mFinalRetryPackets.begin(); iter != mFinalRetryPackets.end();)
-	{
-		packetp = iter->second;
-		if (now > packetp->mExpirationTime)
+		if (!packetp->mRetries && now > packetp->mExpirationTime)
 		{
 			// fail (too many retries)
 			//llinfos << "Packet " << packetp->mPacketID << " removed from the pending list: exceeded retry limit" << llendl;
@@ -412,15 +412,7 @@ S32 LLCircuitData::resendUnackedPackets(const F64 now)
 			}
 
 			// Update stats
-			mUnackedPacketCount--;
-			mUnackedPacketBytes -= packetp->mBufferLength;
-
-			mFinalRetryPackets.erase(iter++);
-			delete packetp;
-		}
-		else
-		{
-			++iter;
+			removeReliablePacket(packetp);
 		}
 	}
 
@@ -450,6 +442,10 @@ LLCircuitData *LLCircuit::addCircuitData(const LLHost &host, TPACKETID in_id)
 	LLCircuitData *tempp = new LLCircuitData(host, in_id, mHeartbeatInterval, mHeartbeatTimeout);
 	mCircuitData.insert(circuit_data_map::value_type(host, tempp));
 	mPingSet.insert(tempp);
+	if (gMessageSystem && gMessageSystem->mPacketRing)
+	{
+		gMessageSystem->mPacketRing->addAckHost(host, tempp->mPacketOutIDs);
+	}
 
 	mLastCircuit = tempp;
 	return tempp;
@@ -478,6 +474,10 @@ void LLCircuit::removeCircuitData(const LLHost &host)
 		// Clean up from optimization maps
 		mUnackedCircuitMap.erase(host);
 		mSendAckMap.erase(host);
+		if (gMessageSystem && gMessageSystem->mPacketRing)
+		{
+			gMessageSystem->mPacketRing->removeAckHost(host);
+		}
 		delete cdp;
 	}
 
@@ -494,6 +494,7 @@ void LLCircuitData::setAlive(BOOL b_alive)
 	if (mbAlive != b_alive)
 	{
 		mPacketsOutID = 0;
+		mPacketOutIDs->reset();
 		mPacketsInID = 0;
 		mbAlive = b_alive;
 	}
@@ -567,19 +568,56 @@ void LLCircuitData::addReliablePacket(S32 mSocket, U8 *buf_ptr, S32 buf_len, LLR
 {
 	LLReliablePacket *packet_info;
 
-	packet_info = new LLReliablePacket(mSocket, buf_ptr, buf_len, params);
+	if (mFreeReliablePackets.empty())
+	{
+		packet_info = new LLReliablePacket(mSocket, buf_ptr, buf_len, params);
+	}
+	else
+	{
+		packet_info = mFreeReliablePackets.back();
+		mFreeReliablePackets.pop_back();
+		packet_info->init(mSocket, buf_ptr, buf_len, params);
+	}
 
-	mUnackedPacketCount++;
-	mUnackedPacketBytes += packet_info->mBufferLength;
+	TPACKETID id = packet_info->mPacketID;
+	LLReliablePacket *old_packetp = findReliablePacket(id);
+	if (old_packetp)
+	{
+		// Only possible if the packet ids wrapped around while this one was still unacked.
+		llwarns << mHost << " still had unacked packet " << id << ", dropping it." << llendl;
+		removeReliablePacket(old_packetp);
+	}
 
-	if (params && params->mRetries)
+	if (!mUnackedPacketCount)
 	{
-		mUnackedPackets[packet_info->mPacketID] = packet_info;
+		mOldestReliableID = id;
+		mEndReliableID = next_packet_id(id);
 	}
-	else
+	else if (packet_id_distance(mOldestReliableID, id) >= packet_id_distance(mOldestReliableID, mEndReliableID))
 	{
-		mFinalRetryPackets[packet_info->mPacketID] = packet_info;
+		// Outside of the current window, normally just the next packet id.
+		TPACKETID oldest_id = mOldestReliableID;
+		TPACKETID end_id = mEndReliableID;
+		if (packet_id_distance(mEndReliableID, id) < LL_MAX_OUT_PACKET_ID / 2)
+		{
+			end_id = next_packet_id(id);
+		}
+		else
+		{
+			oldest_id = id;
+		}
+		U32 window = packet_id_distance(oldest_id, end_id);
+		if (window > mReliableRing.size())
+		{
+			growReliableRing(window);
+		}
+		mOldestReliableID = oldest_id;
+		mEndReliableID = end_id;
 	}
+
+	mReliableRing[id & (mReliableRing.size() - 1)] = packet_info;
+	mUnackedPacketCount++;
+	mUnackedPacketBytes += packet_info->mBufferLength;
 }
 
 
@@ -863,93 +901,11 @@ BOOL LLCircuitData::updateWatchDogTimers(LLMessageSystem *msgsys)
 	// for the packet that it was out of order with was received BEFORE
 	// the ping was sent.
 
-	// Find the current oldest reliable packetID
-	// This is to handle the case if we actually manage to wrap our
-	// packet IDs - the oldest will actually have a higher packet ID
-	// than the current.
-	BOOL wrapped = FALSE;
-	reliable_iter iter;
-	iter = mUnackedPackets.upper_bound(getPacketOutID());
-	if (iter == mUnackedPackets.end())
-	{
-		// Nothing AFTER this one, so we want the lowest packet ID
-		// then.
-		iter = mUnackedPackets.begin();
-		wrapped = TRUE;
-	}
-
-	TPACKETID packet_id = 0;
-
-	// Check against the "final" packets
-	BOOL wrapped_final = FALSE;
-	reliable_iter iter_final;
-	iter_final = mFinalRetryPackets.upper_bound(getPacketOutID());
-	if (iter_final == mFinalRetryPackets.end())
-	{
-		iter_final = mFinalRetryPackets.begin();
-		wrapped_final = TRUE;
-	}
-
-	//llinfos << mHost << " - unacked count " << mUnackedPackets.size() << llendl;
-	//llinfos << mHost << " - final count " << mFinalRetryPackets.size() << llendl;
-	if (wrapped != wrapped_final)
-	{
-		// One of the "unacked" or "final" lists hasn't wrapped.  Whichever one
-		// hasn't has the oldest packet.
-		if (!wrapped)
-		{
-			// Hasn't wrapped, so the one on the
-			// unacked packet list is older
-			packet_id = iter->first;
-			//llinfos << mHost << ": nowrapped unacked" << llendl;
-		}
-		else
-		{
-			packet_id = iter_final->first;
-			//llinfos << mHost << ": nowrapped final" << llendl;
-		}
-	}
-	else
-	{
-		// They both wrapped, we can just use the minimum of the two.
-		if ((iter == mUnackedPackets.end()) && (iter_final == mFinalRetryPackets.end()))
-		{
-			// Wow!  No unacked packets at all!
-			// Send the ID of the last packet we sent out.
-			// This will flush all of the destination's
-			// unacked packets, theoretically.
-			//llinfos << mHost << ": No unacked!" << llendl;
-			packet_id = getPacketOutID();
-		}
-		else
-		{
-			BOOL had_unacked = FALSE;
-			if (iter != mUnackedPackets.end())
-			{
-				// Unacked list has the lowest so far
-				packet_id = iter->first;
-				had_unacked = TRUE;
-				//llinfos << mHost << ": Unacked" << llendl;
-			}
-
-			if (iter_final != mFinalRetryPackets.end())
-			{
-				// Use the lowest of the unacked list and the final list
-				if (had_unacked)
-				{
-					// Both had a packet, use the lowest.
-					packet_id = llmin(packet_id, iter_final->first);
-					//llinfos << mHost << ": Min of unacked/final" << llendl;
-				}
-				else
-				{
-					// Only the final had a packet, use it.
-					packet_id = iter_final->first;
-					//llinfos << mHost << ": Final!" << llendl;
-				}
-			}
-		}
-	}
+	// Find the current oldest reliable packetID.
+	// If there are no unacked packets at all, send the ID of the last
+	// packet we sent out. This will flush all of the destination's
+	// unacked packets, theoretically.
+	TPACKETID packet_id = mUnackedPacketCount ? mOldestReliableID : getPacketOutID();
 
 	// Send off the another ping.
 	pingTimerStart();
@@ -1242,9 +1198,8 @@ TPACKETID LLCircuitData::nextPacketOutID()
 {
 	mPacketsOut++;
 	
-	TPACKETID id; 
-
-	id = (mPacketsOutID + 1) % LL_MAX_OUT_PACKET_ID;
+	// The receive thread takes ids from the same counter for its acks.
+	TPACKETID id = mPacketOutIDs->next();
 			
 	if (id < mPacketsOutID)
 	{
@@ -1337,7 +1292,7 @@ U32 LLCircuitData::getPacketsOut() const
 
 TPACKETID LLCircuitData::getPacketOutID() const
 {
-	return mPacketsOutID;
+	return mPacketOutIDs->get();
 }
 
 
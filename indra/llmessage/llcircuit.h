@@ -33,6 +33,9 @@
 
 #include "llerror.h"
 
+#include "llatomic.h"
+#include "llpointer.h"
+#include "llthread.h"
 #include "lltimer.h"
 #include "timing.h"
 #include "net.h"
@@ -71,6 +74,22 @@ class LLSD;
 // Classes
 //
 
+// The ids of a circuit's outgoing packets. Shared with the packet receive
+// thread, which sends acks on the circuit without waiting for the main thread.
+class LLPacketOutIDs : public LLThreadSafeRefCount
+{
+public:
+	LLPacketOutIDs() : mCount(0) { }
+
+	// Thread safe.
+	TPACKETID next()			{ return (mCount++ + 1) & (LL_MAX_OUT_PACKET_ID - 1); }
+	TPACKETID get() const		{ return mCount & (LL_MAX_OUT_PACKET_ID - 1); }
+	void reset()				{ mCount = 0; }
+
+private:
+	LLAtomicU32 mCount;
+};
+
 
 class LLCircuitData
 {
@@ -174,6 +193,9 @@ protected:
 	BOOL			updateWatchDogTimers(LLMessageSystem *msgsys);	// Return FALSE if the circuit is dead and should be cleaned up
 
 	void			addReliablePacket(S32 mSocket, U8 *buf_ptr, S32 buf_len, LLReliablePacketParams *params);
+	LLReliablePacket* findReliablePacket(TPACKETID packet_num) const;
+	void			removeReliablePacket(LLReliablePacket *packetp);
+	void			growReliableRing(U32 window);
 	BOOL			isDuplicateResend(TPACKETID packetnum);
 	// Call this method when a reliable message comes in - this will
 	// correctly place the packet in the correct list to be acked
@@ -200,7 +222,8 @@ protected:
 
 	// Current packet IDs of incoming/outgoing packets
 	// Used for packet sequencing/packet loss detection.
-	TPACKETID		mPacketsOutID;
+	TPACKETID		mPacketsOutID;				// Last id this circuit sent from the main thread
+	LLPointer<LLPacketOutIDs>	mPacketOutIDs;	// Also handed out to the packet receive thread
 	TPACKETID		mPacketsInID;
 	TPACKETID		mHighestPacketID;
 
@@ -237,11 +260,16 @@ protected:
 	packet_time_map							mRecentlyReceivedReliablePackets;
 	std::vector<TPACKETID> mAcks;
 
-	typedef std::map<TPACKETID, LLReliablePacket *> reliable_map;
-	typedef reliable_map::iterator					reliable_iter;
-
-	reliable_map							mUnackedPackets;
-	reliable_map							mFinalRetryPackets;
+	// Unacked reliable packets, indexed by packet id modulo the (power of two)
+	// size of the ring. The ring grows so that all ids from the oldest unacked
+	// one to the newest fit, so a slot never holds two packets. Packets with
+	// mRetries left are resent when they expire, packets without (the "final
+	// retry" ones) fail when they expire.
+	std::vector<LLReliablePacket *>			mReliableRing;
+	TPACKETID								mOldestReliableID;	// Oldest unacked packet id, if there are any.
+	TPACKETID								mEndReliableID;		// One past the newest.
+	// Acked packets, kept for reuse together with their buffers.
+	std::vector<LLReliablePacket *>			mFreeReliablePackets;
 
 	S32										mUnackedPacketCount;
 	S32										mUnackedPacketBytes;
@@ -323,6 +323,21 @@ public:
 		{
 			mTotalSize = -1;
 		}
+
+		DecodeBlock decode_block;
+		decode_block.mType = blockp->mType;
+		decode_block.mNumber = blockp->mNumber;
+		decode_block.mFirstVariable = (S32)mDecodeVariables.size();
+		decode_block.mNumVariables = (S32)blockp->mMemberVariables.size();
+		mDecodeBlocks.push_back(decode_block);
+		for (LLMessageBlock::message_variable_map_t::const_iterator iter = blockp->mMemberVariables.begin();
+			 iter != blockp->mMemberVariables.end(); ++iter)
+		{
+			DecodeVariable decode_variable;
+			decode_variable.mType = (*iter)->getType();
+			decode_variable.mSize = (*iter)->getSize();
+			mDecodeVariables.push_back(decode_variable);
+		}
 	}
 
 	LLMessageBlock *getBlock(char *name)
@@ -428,8 +443,25 @@ public:
 	}
 
 public:
+	// The layout of the message as a flat table, in the same order as mMemberBlocks
+	// and their mMemberVariables; built by addBlock for LLTemplateMessageReader::decodeData.
+	struct DecodeVariable
+	{
+		EMsgVariableType	mType;
+		S32					mSize;				// Fixed size, or for MVT_VARIABLE the size of the length in front of the data.
+	};
+	struct DecodeBlock
+	{
+		EMsgBlockType		mType;
+		S32					mNumber;			// Number of repeats of an MBT_MULTIPLE block.
+		S32					mFirstVariable;		// Index into mDecodeVariables.
+		S32					mNumVariables;
+	};
+
 	typedef LLDynamicArrayIndexed<LLMessageBlock*, char*, 8> message_block_map_t;
 	message_block_map_t						mMemberBlocks;
+	std::vector<DecodeBlock>				mDecodeBlocks;
+	std::vector<DecodeVariable>				mDecodeVariables;
 	char									*mName;
 	EMsgFrequency							mFrequency;
 	EMsgTrust								mTrust;
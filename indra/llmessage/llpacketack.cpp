@@ -43,7 +43,17 @@ LLReliablePacket::LLReliablePacket(
 	S32 buf_len,
 	LLReliablePacketParams* params) :
 	mBuffer(NULL),
-	mBufferLength(0)
+	mBufferLength(0),
+	mBufferSize(0)
+{
+	init(socket, buf_ptr, buf_len, params);
+}
+
+void LLReliablePacket::init(
+	S32 socket,
+	U8* buf_ptr,
+	S32 buf_len,
+	LLReliablePacketParams* params)
 {
 	if (params)
 	{
@@ -57,6 +67,7 @@ LLReliablePacket::LLReliablePacket(
 	}
 	else
 	{
+		mHost.invalidate();
 		mRetries = 0;
 		mPingBasedRetry = TRUE;
 		mTimeout = 0.f;
@@ -69,14 +80,17 @@ LLReliablePacket::LLReliablePacket(
 	mPacketID = ntohl(*((U32*)(&buf_ptr[PHL_PACKET_ID])));
 
 	mSocket = socket;
+	mBufferLength = 0;
 	if (mRetries)
 	{
-		mBuffer = new U8[buf_len];
-		if (mBuffer != NULL)
+		// Recycled packets keep their buffer when it is large enough.
+		if (buf_len > mBufferSize)
 		{
-			memcpy(mBuffer,buf_ptr,buf_len);	/*Flawfinder: ignore*/
-			mBufferLength = buf_len;
+			delete [] mBuffer;
+			mBuffer = new U8[buf_len];
+			mBufferSize = buf_len;
 		}
-			
+		memcpy(mBuffer,buf_ptr,buf_len);	/*Flawfinder: ignore*/
+		mBufferLength = buf_len;
 	}
 }
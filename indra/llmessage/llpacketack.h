@@ -92,6 +92,13 @@ public:
 		mBuffer = NULL;
 	};
 
+	// (Re)initialize a packet, reusing its buffer if possible.
+	void init(
+		S32 socket,
+		U8* buf_ptr,
+		S32 buf_len,
+		LLReliablePacketParams* params);
+
 	friend class LLCircuitData;
 protected:
 	S32 mSocket;
@@ -105,6 +112,7 @@ protected:
 
 	U8* mBuffer;
 	S32 mBufferLength;
+	S32 mBufferSize;		// Allocated size of mBuffer.
 
 	TPACKETID mPacketID;
 
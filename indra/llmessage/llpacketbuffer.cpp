@@ -59,6 +59,10 @@ LLPacketBuffer::LLPacketBuffer (S32 hSocket)
 	init(hSocket);
 }
 
+LLPacketBuffer::LLPacketBuffer() : mSize(0)
+{
+}
+
 ///////////////////////////////////////////////////////////
 
 LLPacketBuffer::~LLPacketBuffer ()
@@ -36,6 +36,7 @@ class LLPacketBuffer
 public:
 	LLPacketBuffer(const LLHost &host, const char *datap, const S32 size);
 	LLPacketBuffer(S32 hSocket);           // receive a packet
+	LLPacketBuffer();                      // empty, filled in later with getBuffer() and set()
 	~LLPacketBuffer();
 
 	S32			getSize() const					{ return mSize; }
@@ -44,6 +45,11 @@ public:
 	LLHost		getReceivingInterface() const	{ return mReceivingIF; }
 	void init(S32 hSocket);
 
+	// For the batched receive and send in LLPacketRing: the NET_BUFFER_SIZE bytes to
+	// receive into or to copy into, and what ended up there.
+	char		*getBuffer()					{ return mData; }
+	void		set(S32 size, const LLHost &host, const LLHost &receiving_if) { mSize = size; mHost = host; mReceivingIF = receiving_if; }
+
 protected:
 	char	mData[NET_BUFFER_SIZE];        // packet data		/* Flawfinder : ignore */
 	S32		mSize;          // size of buffer in bytes
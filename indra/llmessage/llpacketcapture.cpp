@@ -0,0 +1,313 @@
+/**
+ * @file llpacketcapture.cpp
+ * @brief Capture of received UDP packets and their replay through LLMessageSystem.
+ *
+ * $LicenseInfo:firstyear=2001&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llpacketcapture.h"
+
+#include "lltimer.h"
+#include "message.h"
+
+// type, trusted, size, ip, port, time
+static const S32 RECORD_HEADER_SIZE = 1 + 1 + 2 + 4 + 4 + 8;
+
+const char LLPacketCapture::CAPTURE_MAGIC[8] = { 'L', 'L', 'P', 'C', 'A', 'P', '0', '1' };
+LLFILE* LLPacketCapture::sFile = NULL;
+U64 LLPacketCapture::sStartTime = 0;
+LLPacketReplay* LLPacketReplay::sActive = NULL;
+
+//static
+bool LLPacketCapture::start(const std::string& filename)
+{
+	stop();
+	sFile = LLFile::fopen(filename, "wb");
+	if (!sFile)
+	{
+		llwarns << "Unable to open packet capture file " << filename << llendl;
+		return false;
+	}
+	if (fwrite(CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC), 1, sFile) != 1)
+	{
+		llwarns << "Unable to write packet capture file " << filename << llendl;
+		stop();
+		return false;
+	}
+	sStartTime = totalTime();
+	llinfos << "Capturing received packets to " << filename << llendl;
+	return true;
+}
+
+//static
+void LLPacketCapture::stop()
+{
+	if (sFile)
+	{
+		LLFile::close(sFile);
+		sFile = NULL;
+	}
+}
+
+//static
+void LLPacketCapture::recordCircuit(const LLHost& host, BOOL trusted)
+{
+	if (sFile)
+	{
+		write(LLPacketCaptureRecord::RECORD_CIRCUIT, trusted, host, NULL, 0);
+	}
+}
+
+//static
+void LLPacketCapture::recordPacket(const LLHost& sender, const U8* data, S32 size)
+{
+	if (sFile && size > 0)
+	{
+		write(LLPacketCaptureRecord::RECORD_PACKET, false, sender, data, size);
+	}
+}
+
+//static
+void LLPacketCapture::write(U8 type, bool trusted, const LLHost& host, const U8* data, S32 size)
+{
+	U8 header[RECORD_HEADER_SIZE];
+	U16 size16 = (U16)size;
+	U32 ip = host.getAddress();
+	U32 port = host.getPort();
+	U64 time = totalTime() - sStartTime;
+	header[0] = type;
+	header[1] = trusted ? 1 : 0;
+	memcpy(&header[2], &size16, 2);		/* Flawfinder: ignore */
+	memcpy(&header[4], &ip, 4);			/* Flawfinder: ignore */
+	memcpy(&header[8], &port, 4);		/* Flawfinder: ignore */
+	memcpy(&header[12], &time, 8);		/* Flawfinder: ignore */
+	if (fwrite(header, RECORD_HEADER_SIZE, 1, sFile) != 1 ||
+		(size && fwrite(data, size, 1, sFile) != 1))
+	{
+		llwarns << "Error writing packet capture, capture stopped." << llendl;
+		stop();
+	}
+}
+
+//---------------------------------------------------------------------------
+// LLPacketCaptureReader
+//---------------------------------------------------------------------------
+
+LLPacketCaptureReader::LLPacketCaptureReader() : mFile(NULL)
+{
+}
+
+LLPacketCaptureReader::~LLPacketCaptureReader()
+{
+	close();
+}
+
+bool LLPacketCaptureReader::open(const std::string& filename)
+{
+	close();
+	mFile = LLFile::fopen(filename, "rb");
+	if (!mFile)
+	{
+		llwarns << "Unable to open packet capture file " << filename << llendl;
+		return false;
+	}
+	char magic[sizeof(LLPacketCapture::CAPTURE_MAGIC)];
+	if (fread(magic, sizeof(magic), 1, mFile) != 1 ||
+		memcmp(magic, LLPacketCapture::CAPTURE_MAGIC, sizeof(magic)))
+	{
+		llwarns << filename << " is not a packet capture file" << llendl;
+		close();
+		return false;
+	}
+	return true;
+}
+
+void LLPacketCaptureReader::close()
+{
+	if (mFile)
+	{
+		LLFile::close(mFile);
+		mFile = NULL;
+	}
+}
+
+bool LLPacketCaptureReader::next(LLPacketCaptureRecord& record)
+{
+	U8 header[RECORD_HEADER_SIZE];
+	if (!mFile || fread(header, RECORD_HEADER_SIZE, 1, mFile) != 1)
+	{
+		return false;
+	}
+	U16 size;
+	U32 ip;
+	U32 port;
+	record.mType = header[0];
+	record.mTrusted = header[1] != 0;
+	memcpy(&size, &header[2], 2);				/* Flawfinder: ignore */
+	memcpy(&ip, &header[4], 4);					/* Flawfinder: ignore */
+	memcpy(&port, &header[8], 4);				/* Flawfinder: ignore */
+	memcpy(&record.mTime, &header[12], 8);		/* Flawfinder: ignore */
+	record.mHost.set(ip, port);
+	record.mData.resize(size);
+	return !size || fread(&record.mData[0], size, 1, mFile) == 1;
+}
+
+//---------------------------------------------------------------------------
+// LLPacketReplay
+//---------------------------------------------------------------------------
+
+LLPacketReplay::LLPacketReplay(LLMessageSystem* msg)
+:	mMessageSystem(msg),
+	mHavePacket(false),
+	mSpeed(0.f),
+	mStartTime(0),
+	mFirstTime(0),
+	mEndTime(0),
+	mPacketsReplayed(0),
+	mMessagesHandled(0)
+{
+}
+
+bool LLPacketReplay::open(const std::string& filename)
+{
+	return mReader.open(filename);
+}
+
+bool LLPacketReplay::pump()
+{
+	if (mEndTime)
+	{
+		return false;
+	}
+	if (!mStartTime)
+	{
+		mStartTime = totalTime();
+	}
+	while (true)
+	{
+		if (!mHavePacket)
+		{
+			if (!mReader.next(mRecord))
+			{
+				mReader.close();
+				mEndTime = totalTime();
+				return false;
+			}
+			if (mRecord.mType == LLPacketCaptureRecord::RECORD_CIRCUIT)
+			{
+				if (!mHost.isOk())
+				{
+					mMessageSystem->enableCircuit(mRecord.mHost, mRecord.mTrusted);
+				}
+				continue;
+			}
+			if (mRecord.mType != LLPacketCaptureRecord::RECORD_PACKET)
+			{
+				continue;
+			}
+			if (!mPacketsReplayed)
+			{
+				mFirstTime = mRecord.mTime;
+			}
+			mHavePacket = true;
+		}
+		if (mSpeed > 0.f &&
+			(F64)(mRecord.mTime - mFirstTime) / mSpeed > (F64)(totalTime() - mStartTime))
+		{
+			// Not due yet.
+			return true;
+		}
+		replayPacket();
+		mHavePacket = false;
+	}
+}
+
+void LLPacketReplay::replayPacket()
+{
+	static U8 buffer[MAX_BUFFER_SIZE];
+	++mPacketsReplayed;
+	S32 size = llmin((S32)mRecord.mData.size(), MAX_BUFFER_SIZE);
+	if (size < LL_MINIMUM_VALID_PACKET_SIZE)
+	{
+		return;
+	}
+	memcpy(buffer, &mRecord.mData[0], size);		/* Flawfinder: ignore */
+	if (buffer[0] & LL_ACK_FLAG)
+	{
+		// checkMessages leaves the appended acks of a faked message alone. They
+		// acked packets of the recorded session anyway, so just drop them.
+		size -= 1 + buffer[size - 1] * sizeof(TPACKETID);
+		if (size < LL_MINIMUM_VALID_PACKET_SIZE)
+		{
+			return;
+		}
+		buffer[0] &= ~LL_ACK_FLAG;
+	}
+	// The recorded packet ids belong to the recorded session. Don't let a reliable
+	// one look like it needs acking, or a resent one like a duplicate to drop.
+	buffer[0] &= ~(LL_RELIABLE_FLAG | LL_RESENT_FLAG);
+	if (mMessageSystem->checkMessages(0, true, buffer, mHost.isOk() ? mHost : mRecord.mHost, size))
+	{
+		++mMessagesHandled;
+	}
+}
+
+F64 LLPacketReplay::getElapsedSeconds() const
+{
+	if (!mStartTime)
+	{
+		return 0.0;
+	}
+	return (F64)((mEndTime ? mEndTime : totalTime()) - mStartTime) * SEC_PER_USEC;
+}
+
+//static
+void LLPacketReplay::start(LLMessageSystem* msg, const std::string& filename, F32 speed, const LLHost& host)
+{
+	delete sActive;
+	sActive = new LLPacketReplay(msg);
+	if (!sActive->open(filename))
+	{
+		delete sActive;
+		sActive = NULL;
+		return;
+	}
+	sActive->setSpeed(speed);
+	sActive->setHost(host);
+	llinfos << "Replaying packet capture " << filename << llendl;
+}
+
+//static
+void LLPacketReplay::pumpActive()
+{
+	if (sActive && !sActive->pump())
+	{
+		F64 seconds = sActive->getElapsedSeconds();
+		llinfos << "Packet capture replayed: " << sActive->getPacketsReplayed() << " packets, "
+				<< sActive->getMessagesHandled() << " messages handled in " << seconds << " seconds ("
+				<< (seconds > 0.0 ? sActive->getMessagesHandled() / seconds : 0.0) << " messages/s)" << llendl;
+		delete sActive;
+		sActive = NULL;
+	}
+}
@@ -0,0 +1,152 @@
+/**
+ * @file llpacketcapture.h
+ * @brief Capture of received UDP packets and their replay through LLMessageSystem.
+ *
+ * $LicenseInfo:firstyear=2001&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLPACKETCAPTURE_H
+#define LL_LLPACKETCAPTURE_H
+
+#include <string>
+#include <vector>
+
+#include "llfile.h"
+#include "llhost.h"
+
+class LLMessageSystem;
+
+// A capture file starts with CAPTURE_MAGIC, followed by records:
+//
+//   U8  type       RECORD_CIRCUIT or RECORD_PACKET
+//   U8  trusted    circuit records: the circuit is trusted
+//   U16 size       packet records: number of data bytes following the record
+//   U32 ip         circuit host, or the sender of the packet
+//   U32 port
+//   U64 time       microseconds since the capture was started
+//
+// All fields are in host byte order; a capture is meant to be replayed on the
+// same kind of machine it was recorded on. Packets are stored as checkMessages
+// gets them, with appended acks: before zero code expansion, or already expanded
+// when the packet receive thread runs.
+struct LLPacketCaptureRecord
+{
+	enum EType
+	{
+		RECORD_CIRCUIT = 1,
+		RECORD_PACKET = 2
+	};
+
+	U8 mType;
+	bool mTrusted;
+	LLHost mHost;
+	U64 mTime;
+	std::vector<U8> mData;
+};
+
+class LLPacketCapture
+{
+public:
+	// Starts writing to filename, truncating it. Circuits that already exist
+	// are not known here, see LLMessageSystem::startPacketCapture.
+	static bool start(const std::string& filename);
+	static void stop();
+	static bool isCapturing() { return sFile != NULL; }
+
+	static void recordCircuit(const LLHost& host, BOOL trusted);
+	static void recordPacket(const LLHost& sender, const U8* data, S32 size);
+
+	static const char CAPTURE_MAGIC[8];
+
+private:
+	static void write(U8 type, bool trusted, const LLHost& host, const U8* data, S32 size);
+
+	static LLFILE* sFile;
+	static U64 sStartTime;
+};
+
+class LLPacketCaptureReader
+{
+public:
+	LLPacketCaptureReader();
+	~LLPacketCaptureReader();
+
+	bool open(const std::string& filename);
+	void close();
+
+	// Reads the next record. Returns false at the end of the file, or on a truncated record.
+	bool next(LLPacketCaptureRecord& record);
+
+private:
+	LLFILE* mFile;
+};
+
+// Pushes a capture through LLMessageSystem::checkMessages, and with that
+// through the registered message handlers, without using the network: appended
+// acks are stripped and the reliable and resent flags cleared, so nothing is
+// acked and the circuits' packet tracking is left alone.
+class LLPacketReplay
+{
+public:
+	LLPacketReplay(LLMessageSystem* msg);
+
+	bool open(const std::string& filename);
+
+	// 1 replays at the recorded speed, 2 twice as fast, etc. 0 (the default)
+	// replays as fast as the message system can handle it.
+	void setSpeed(F32 speed) { mSpeed = speed; }
+
+	// Attribute every packet to host instead of the recorded sender, and
+	// ignore the recorded circuits. Used to replay into a logged in viewer,
+	// where the handlers look up the region by host.
+	void setHost(const LLHost& host) { mHost = host; }
+
+	// Feeds all packets that are due. Returns false when the capture is done.
+	bool pump();
+
+	S32 getPacketsReplayed() const { return mPacketsReplayed; }
+	S32 getMessagesHandled() const { return mMessagesHandled; }
+	F64 getElapsedSeconds() const;
+
+	// Viewer side: one replay at a time, pumped once per frame from the network idle.
+	static void start(LLMessageSystem* msg, const std::string& filename, F32 speed, const LLHost& host);
+	static void pumpActive();
+
+private:
+	void replayPacket();
+
+	LLMessageSystem* mMessageSystem;
+	LLPacketCaptureReader mReader;
+	LLPacketCaptureRecord mRecord;
+	bool mHavePacket;
+	F32 mSpeed;
+	LLHost mHost;
+	U64 mStartTime;			// Zero until the first pump().
+	U64 mFirstTime;			// Capture time of the first packet.
+	U64 mEndTime;
+	S32 mPacketsReplayed;
+	S32 mMessagesHandled;
+
+	static LLPacketReplay* sActive;
+};
+
+#endif // LL_LLPACKETCAPTURE_H
@@ -0,0 +1,360 @@
+/** 
+ * @file llpacketreceivethread.cpp
+ * @brief Thread that receives UDP packets for LLPacketRing.
+ *
+ * $LicenseInfo:firstyear=2001&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llpacketreceivethread.h"
+
+#if LL_WINDOWS
+	#include <winsock2.h>
+#else
+	#include <sys/select.h>
+	#include <sys/socket.h>
+	#include <netinet/in.h>
+#endif
+
+#include "llcircuit.h"
+#include "llproxy.h"
+#include "lltimer.h"	// ms_sleep()
+#include "message.h"
+#include "net.h"
+
+namespace
+{
+	const S32 MAX_ACKS_PER_PACKET = 250;	// Same as LLCircuit::sendAcks.
+
+	// The zero coding of LLMessageSystem::zeroCodeExpand: a run of zero bytes is
+	// sent as 0 followed by its length, with 0 0 meaning 256 of them. The packet
+	// header is never zero coded. Returns the expanded size, or 0 when it doesn't
+	// fit in out_size bytes.
+	S32 zero_code_expand(const U8* in, S32 in_size, U8* out, S32 out_size)
+	{
+		if (in_size < LL_PACKET_ID_SIZE || out_size < LL_PACKET_ID_SIZE)
+		{
+			return 0;
+		}
+		memcpy(out, in, LL_PACKET_ID_SIZE);	/*Flawfinder: ignore*/
+		const U8* inptr = in + LL_PACKET_ID_SIZE;
+		const U8* const inend = in + in_size;
+		U8* outptr = out + LL_PACKET_ID_SIZE;
+		U8* const outend = out + out_size;
+		while (inptr < inend)
+		{
+			U8 c = *inptr++;
+			if (c)
+			{
+				if (outptr == outend)
+				{
+					return 0;
+				}
+				*outptr++ = c;
+				continue;
+			}
+			// A run of zeroes: 0 0 ... 0 [count].
+			S32 zeroes = 1;
+			while (inptr < inend && !*inptr)
+			{
+				++inptr;
+				zeroes += 256;
+			}
+			if (inptr < inend)
+			{
+				zeroes += *inptr++ - 1;
+			}
+			if (outend - outptr < zeroes)
+			{
+				return 0;
+			}
+			memset(outptr, 0, zeroes);
+			outptr += zeroes;
+		}
+		return (S32)(outptr - out);
+	}
+}
+
+LLPacketReceiveThread::LLPacketReceiveThread(S32 socket) :
+	LLThread("Packet receive"),
+	mSocket(socket),
+	mRing(RING_SIZE),
+	mRingFull(0)
+{
+}
+
+LLPacketReceiveThread::~LLPacketReceiveThread()
+{
+	// Stop run() before the ring goes away.
+	shutdown();
+}
+
+S32 LLPacketReceiveThread::receivePacket(char *datap, LLHost &sender, LLHost &receiving_if, S32 &compressed_size, bool &acked)
+{
+	if (mRing.empty())
+	{
+		return 0;
+	}
+	const LLPacketBufferRing::Slot &slot = mRing.front();
+	S32 size = slot.mPacket.getSize();
+	memcpy(datap, slot.mPacket.getData(), size);	/*Flawfinder: ignore*/
+	sender = slot.mPacket.getHost();
+	receiving_if = slot.mPacket.getReceivingInterface();
+	compressed_size = slot.mCompressedSize;
+	acked = slot.mAcked;
+	// Hand the buffer back to the receive thread.
+	mRing.pop();
+	return size;
+}
+
+U32 LLPacketReceiveThread::getAndResetRingFull()
+{
+	U32 full = mRingFull;
+	mRingFull -= full;
+	return full;
+}
+
+void LLPacketReceiveThread::addAckHost(const LLHost &host, LLPacketOutIDs *out_ids)
+{
+	LLMutexLock lock(&mAckMutex);
+	AckHost &ack_host = mAckHosts[host];
+	ack_host.mOutIDs = out_ids;
+	ack_host.mAcks.clear();
+}
+
+void LLPacketReceiveThread::removeAckHost(const LLHost &host)
+{
+	LLMutexLock lock(&mAckMutex);
+	mAckHosts.erase(host);
+}
+
+void LLPacketReceiveThread::setUDPProxy(const LLHost &proxy)
+{
+	LLMutexLock lock(&mAckMutex);
+	mUDPProxy = proxy;
+}
+
+// Returns true when the socket has something to read. Times out every
+// 100 ms so that we notice when we have to quit.
+bool LLPacketReceiveThread::waitForPacket()
+{
+	fd_set read_fds;
+	FD_ZERO(&read_fds);
+	FD_SET(mSocket, &read_fds);
+	struct timeval timeout;
+	timeout.tv_sec = 0;
+	timeout.tv_usec = 100000;
+	return select(mSocket + 1, &read_fds, NULL, NULL, &timeout) > 0;
+}
+
+void LLPacketReceiveThread::collectAcks(U32 count)
+{
+	for (U32 i = 0; i < count; ++i)
+	{
+		LLPacketBufferRing::Slot &slot = mRing.getWriteSlot(i);
+		const U8* data = (const U8*)slot.mPacket.getData();
+		// Leave what we couldn't expand to the main thread, it's probably malformed.
+		if (slot.mPacket.getSize() < LL_MINIMUM_VALID_PACKET_SIZE ||
+			(data[0] & (LL_RELIABLE_FLAG | LL_ZERO_CODE_FLAG)) != LL_RELIABLE_FLAG)
+		{
+			continue;
+		}
+		ack_hosts_t::iterator it = mAckHosts.find(slot.mPacket.getHost());
+		if (it != mAckHosts.end())
+		{
+			TPACKETID id;
+			memcpy(&id, &data[PHL_PACKET_ID], sizeof(TPACKETID));	/*Flawfinder: ignore*/
+			it->second.mAcks.push_back(ntohl(id));
+			slot.mAcked = true;
+		}
+	}
+}
+
+// Sends the collected acks as PacketAck messages, like LLCircuit::sendAcks.
+void LLPacketReceiveThread::sendAcks(const LLHost &proxy)
+{
+	char buffer[SOCKS_HEADER_SIZE + NET_BUFFER_SIZE];
+	char* packet = buffer + SOCKS_HEADER_SIZE;
+	for (ack_hosts_t::iterator it = mAckHosts.begin(); it != mAckHosts.end(); ++it)
+	{
+		AckHost &ack_host = it->second;
+		const LLHost &host = it->first;
+		size_t sent = 0;
+		while (sent < ack_host.mAcks.size())
+		{
+			S32 count = llmin((S32)(ack_host.mAcks.size() - sent), MAX_ACKS_PER_PACKET);
+			// Header: no flags, the packet id and no extra header.
+			packet[0] = 0;
+			U32 id = htonl(ack_host.mOutIDs->next());
+			memcpy(&packet[PHL_PACKET_ID], &id, sizeof(U32));	/*Flawfinder: ignore*/
+			packet[PHL_OFFSET] = 0;
+			// PacketAck is the fixed message 0xFFFFFFFB: a count and that many U32 IDs.
+			S32 size = PHL_NAME;
+			packet[size++] = (char)0xFF;
+			packet[size++] = (char)0xFF;
+			packet[size++] = (char)0xFF;
+			packet[size++] = (char)0xFB;
+			packet[size++] = (char)count;
+			for (S32 i = 0; i < count; ++i)
+			{
+				htonmemcpy(&packet[size], &ack_host.mAcks[sent++], MVT_U32, sizeof(U32));
+				size += sizeof(U32);
+			}
+
+			if (proxy.isOk())
+			{
+				proxywrap_t* header = static_cast<proxywrap_t*>(static_cast<void*>(buffer));
+				header->rsv = 0;
+				header->addr = host.getAddress();
+				header->port = htons(host.getPort());
+				header->atype = ADDRESS_IPV4;
+				header->frag = 0;
+				send_packet(mSocket, buffer, size + SOCKS_HEADER_SIZE, proxy.getAddress(), proxy.getPort());
+			}
+			else
+			{
+				send_packet(mSocket, packet, size, host.getAddress(), host.getPort());
+			}
+		}
+		ack_host.mAcks.clear();
+	}
+}
+
+void LLPacketReceiveThread::run()
+{
+	char* buffers[NET_BATCH_SIZE];
+	S32 sizes[NET_BATCH_SIZE];
+	LLHost senders[NET_BATCH_SIZE];
+	LLHost receiving_ifs[NET_BATCH_SIZE];
+
+	while (!isQuitting())
+	{
+		U32 free = mRing.getFree();
+		if (!free)
+		{
+			// The main thread is behind; leave the rest in the socket buffer for now.
+			mRingFull++;
+			ms_sleep(1);
+			continue;
+		}
+		if (!waitForPacket())
+		{
+			continue;
+		}
+
+		LLHost proxy;
+		{
+			LLMutexLock lock(&mAckMutex);
+			proxy = mUDPProxy;
+		}
+
+		S32 count = llmin(free, (U32)NET_BATCH_SIZE);
+		for (S32 i = 0; i < count; ++i)
+		{
+			buffers[i] = mRing.getWriteSlot(i).mPacket.getBuffer();
+		}
+		count = receive_packets(mSocket, buffers, sizes, senders, receiving_ifs, count);
+
+		U32 written = 0;
+		for (S32 i = 0; i < count; ++i)
+		{
+			char* data = buffers[i];
+			S32 size = sizes[i];
+			if (proxy.isOk())
+			{
+				if (size <= SOCKS_HEADER_SIZE)
+				{
+					continue;
+				}
+				// *FIX We are assuming ATYP is 0x01 (IPv4), not 0x03 (hostname) or 0x04 (IPv6)
+				proxywrap_t* header = static_cast<proxywrap_t*>(static_cast<void*>(data));
+				senders[i].setAddress(header->addr);
+				senders[i].setPort(ntohs(header->port));
+				size -= SOCKS_HEADER_SIZE;
+				memmove(data, data + SOCKS_HEADER_SIZE, size);
+			}
+			if (size <= 0)
+			{
+				// A size of 0 means 'no more packets' to the main thread.
+				continue;
+			}
+
+			LLPacketBufferRing::Slot& slot = mRing.getWriteSlot(written);
+			char* buffer = slot.mPacket.getBuffer();
+			slot.mCompressedSize = 0;
+			slot.mAcked = false;
+			if (size >= LL_MINIMUM_VALID_PACKET_SIZE && (data[0] & LL_ZERO_CODE_FLAG))
+			{
+				// Only the message is zero coded, not the acks appended to it.
+				S32 acks_size = 0;
+				if (data[0] & LL_ACK_FLAG)
+				{
+					acks_size = (U8)data[size - 1] * sizeof(TPACKETID) + 1;
+					if (size < acks_size + LL_MINIMUM_VALID_PACKET_SIZE)
+					{
+						// Malformed, let the main thread complain about it.
+						acks_size = -1;
+					}
+				}
+				S32 expanded = 0;
+				if (acks_size >= 0)
+				{
+					expanded = zero_code_expand((const U8*)data, size - acks_size, mExpandBuffer, NET_BUFFER_SIZE - acks_size);
+				}
+				if (expanded)
+				{
+					memmove(buffer + expanded, data + size - acks_size, acks_size);
+					memcpy(buffer, mExpandBuffer, expanded);	/*Flawfinder: ignore*/
+					buffer[0] &= ~LL_ZERO_CODE_FLAG;
+					slot.mCompressedSize = size - acks_size;
+					size = expanded + acks_size;
+					data = buffer;
+				}
+				else if (acks_size >= 0)
+				{
+					LL_DEBUGS("Messaging") << "Dropping zero coded packet that doesn't expand into a buffer" << LL_ENDL;
+					continue;
+				}
+			}
+			if (buffer != data)
+			{
+				// Close the gap left by a packet that we skipped.
+				memcpy(buffer, data, size);	/*Flawfinder: ignore*/
+			}
+			slot.mPacket.set(size, senders[i], receiving_ifs[i]);
+			++written;
+		}
+
+		{
+			LLMutexLock lock(&mAckMutex);
+			collectAcks(written);
+		}
+		// Publish.
+		mRing.publish(written);
+
+		// Ack after publishing, so that an ack never goes out for a packet that
+		// the main thread didn't get.
+		LLMutexLock lock(&mAckMutex);
+		sendAcks(proxy);
+	}
+}
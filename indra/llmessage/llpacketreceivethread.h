@@ -0,0 +1,145 @@
+/** 
+ * @file llpacketreceivethread.h
+ * @brief Thread that receives UDP packets for LLPacketRing.
+ *
+ * $LicenseInfo:firstyear=2001&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLPACKETRECEIVETHREAD_H
+#define LL_LLPACKETRECEIVETHREAD_H
+
+#include <map>
+#include <vector>
+
+#include "llthread.h"
+#include "llatomic.h"
+#include "llhost.h"
+#include "llpacketbuffer.h"
+#include "llpointer.h"
+
+class LLPacketOutIDs;
+
+// Single producer, single consumer ring of preallocated LLPacketBuffers, without
+// locking: only the producer advances mWrite and only the consumer advances mRead.
+class LLPacketBufferRing
+{
+public:
+	struct Slot
+	{
+		Slot() : mCompressedSize(0), mAcked(false) { }
+
+		LLPacketBuffer mPacket;
+		S32 mCompressedSize;		// Size before zero code expansion, 0 if the packet wasn't zero coded.
+		bool mAcked;				// The receive thread already acked this reliable packet.
+	};
+
+	// size must be a power of two.
+	LLPacketBufferRing(U32 size) : mSize(size), mSlots(new Slot[size]), mWrite(0), mRead(0)
+	{
+		llassert(size && !(size & (size - 1)));
+	}
+	~LLPacketBufferRing() { delete [] mSlots; }
+
+	// Producer. The slots that can be written before the next publish() are
+	// getWriteSlot(0) up to getWriteSlot(getFree() - 1).
+	U32 getFree() const				{ return mSize - (mWrite - mRead); }
+	Slot& getWriteSlot(U32 i)		{ return mSlots[(mWrite + i) & (mSize - 1)]; }
+	// Hands the next count written slots to the consumer.
+	void publish(U32 count)			{ mWrite = mWrite + count; }
+
+	// Consumer.
+	bool empty() const				{ return mRead == mWrite; }
+	const Slot& front() const		{ return mSlots[mRead & (mSize - 1)]; }
+	// Hands the front slot back to the producer.
+	void pop()						{ mRead = mRead + 1; }
+
+private:
+	U32 const mSize;
+	Slot* const mSlots;
+	LLAtomicU32 mWrite;				// Number of slots published.
+	LLAtomicU32 mRead;				// Number of slots popped.
+};
+
+// Keeps the socket drained while the main thread is busy, so that a slow frame
+// doesn't overflow the socket buffer (and cause packet loss and resends).
+//
+// Packets go to the main thread through an LLPacketBufferRing, with their SOCKS5
+// UDP headers stripped and zero coding expanded. Reliable packets from the hosts
+// registered with addAckHost are acked from here, so that their acks don't wait
+// for the next frame either. Message decoding, and acks for everything else, stay
+// on the main thread in LLMessageSystem::checkMessages.
+class LLPacketReceiveThread : public LLThread
+{
+public:
+	LLPacketReceiveThread(S32 socket);
+	~LLPacketReceiveThread();
+
+	// Main thread. Copies the oldest received packet to datap (NET_BUFFER_SIZE bytes)
+	// and returns its size, or returns 0 when there is none. compressed_size is set
+	// to the size of the packet on the wire if it was zero coded, and to 0 otherwise;
+	// acked is set when this thread already acked it.
+	S32 receivePacket(char *datap, LLHost &sender, LLHost &receiving_if, S32 &compressed_size, bool &acked);
+
+	// Main thread. Number of milliseconds the receive thread waited for a full ring since the last call.
+	U32 getAndResetRingFull();
+
+	// Main thread. Ack the reliable packets of host from now on, using out_ids for the acks.
+	void addAckHost(const LLHost &host, LLPacketOutIDs *out_ids);
+	void removeAckHost(const LLHost &host);
+
+	// Main thread. The SOCKS5 UDP proxy to receive from and send the acks through;
+	// an invalid host when there is none.
+	void setUDPProxy(const LLHost &proxy);
+
+protected:
+	/*virtual*/ void run(void);
+
+private:
+	bool waitForPacket();
+	// Moves the ids of the reliable packets of this batch to mPendingAcks
+	// (with the lock held) and marks their slots.
+	void collectAcks(U32 count);
+	void sendAcks(const LLHost &proxy);
+
+private:
+	enum { RING_SIZE = 512 };		// Must be a power of two.
+
+	struct AckHost
+	{
+		LLPointer<LLPacketOutIDs> mOutIDs;
+		std::vector<TPACKETID> mAcks;
+	};
+	typedef std::map<LLHost, AckHost> ack_hosts_t;
+
+	S32 mSocket;
+	LLPacketBufferRing mRing;
+	LLAtomicU32 mRingFull;
+
+	LLMutex mAckMutex;				// Protects mAckHosts and mUDPProxy.
+	ack_hosts_t mAckHosts;
+	LLHost mUDPProxy;
+
+	// Receive thread only.
+	U8 mExpandBuffer[NET_BUFFER_SIZE];
+};
+
+#endif // LL_LLPACKETRECEIVETHREAD_H
@@ -27,6 +27,7 @@
 #include "linden_common.h"
 
 #include "llpacketring.h"
+#include "llpacketreceivethread.h"
 
 #if LL_WINDOWS
 	#include <winsock2.h>
@@ -60,13 +61,23 @@ LLPacketRing::LLPacketRing () :
 	mInBufferLength(0),
 	mOutBufferLength(0),
 	mDropPercentage(0.0f),
-	mPacketsToDrop(0x0)
+	mPacketsToDrop(0x0),
+	mReceiveBatchCount(0),
+	mReceiveBatchNext(0),
+	mReceiveThread(NULL),
+	mReceiveThreadSOCKS(false),
+	mLastCompressedSize(0),
+	mLastPacketAcked(false),
+	mSendBatchCount(0),
+	mSendBatchSocket(-1),
+	mBatchSends(false)
 {
 }
 
 ///////////////////////////////////////////////////////////
 LLPacketRing::~LLPacketRing ()
 {
+	stopReceiveThread();
 	cleanup();
 }
 	
@@ -88,6 +99,9 @@ void LLPacketRing::cleanup ()
 		delete packetp;
 		mSendQueue.pop();
 	}
+
+	mReceiveBatchCount = mReceiveBatchNext = 0;
+	mSendBatchCount = 0;
 }
 
 ///////////////////////////////////////////////////////////
@@ -121,6 +135,42 @@ void LLPacketRing::setOutBandwidth(const F32 bps)
 {
 	mOutThrottle.setRate(bps);
 }
+
+void LLPacketRing::startReceiveThread(S32 socket)
+{
+	if (!mReceiveThread)
+	{
+		llinfos << "Starting packet receive thread" << llendl;
+		mReceiveThread = new LLPacketReceiveThread(socket);
+		mReceiveThreadSOCKS = false;
+		mReceiveThread->start();
+	}
+}
+
+void LLPacketRing::addAckHost(const LLHost &host, LLPacketOutIDs *out_ids)
+{
+	if (mReceiveThread)
+	{
+		mReceiveThread->addAckHost(host, out_ids);
+	}
+}
+
+void LLPacketRing::removeAckHost(const LLHost &host)
+{
+	if (mReceiveThread)
+	{
+		mReceiveThread->removeAckHost(host);
+	}
+}
+
+void LLPacketRing::stopReceiveThread()
+{
+	if (mReceiveThread)
+	{
+		delete mReceiveThread;		// Calls shutdown().
+		mReceiveThread = NULL;
+	}
+}
 ///////////////////////////////////////////////////////////
 S32 LLPacketRing::receiveFromRing (S32 socket, char *datap)
 {
@@ -158,13 +208,79 @@ S32 LLPacketRing::receiveFromRing (S32 socket, char *datap)
 	return packet_size;
 }
 
+///////////////////////////////////////////////////////////
+S32 LLPacketRing::receiveFromBatch(S32 socket, char *datap)
+{
+	if (mReceiveBatchNext == mReceiveBatchCount)
+	{
+		// Batch used up, fetch whatever is waiting with a single system call.
+		char* buffers[NET_BATCH_SIZE];
+		S32 sizes[NET_BATCH_SIZE];
+		LLHost senders[NET_BATCH_SIZE];
+		LLHost receiving_ifs[NET_BATCH_SIZE];
+		for (S32 i = 0; i < NET_BATCH_SIZE; ++i)
+		{
+			buffers[i] = mReceiveBatch[i].getBuffer();
+		}
+		mReceiveBatchCount = receive_packets(socket, buffers, sizes, senders, receiving_ifs, NET_BATCH_SIZE);
+		mReceiveBatchNext = 0;
+		for (S32 i = 0; i < mReceiveBatchCount; ++i)
+		{
+			mReceiveBatch[i].set(sizes[i], senders[i], receiving_ifs[i]);
+		}
+		if (!mReceiveBatchCount)
+		{
+			return 0;
+		}
+	}
+
+	LLPacketBuffer& packet = mReceiveBatch[mReceiveBatchNext++];
+	memcpy(datap, packet.getData(), packet.getSize());	/*Flawfinder: ignore*/
+	mLastSender = packet.getHost();
+	mLastReceivingIF = packet.getReceivingInterface();
+	return packet.getSize();
+}
+
 ///////////////////////////////////////////////////////////
 S32 LLPacketRing::receivePacket (S32 socket, char *datap)
 {
 	S32 packet_size = 0;
+	mLastCompressedSize = 0;
+	mLastPacketAcked = false;
+
+	if (mReceiveThread)
+	{
+		if (LLProxy::isSOCKSProxyEnabled() != mReceiveThreadSOCKS)
+		{
+			mReceiveThreadSOCKS = !mReceiveThreadSOCKS;
+			mReceiveThread->setUDPProxy(mReceiveThreadSOCKS ? LLProxy::getInstance()->getUDPProxy() : LLHost());
+		}
+		packet_size = mReceiveThread->receivePacket(datap, mLastSender, mLastReceivingIF, mLastCompressedSize, mLastPacketAcked);
+		if (!packet_size)
+		{
+			U32 ring_full = mReceiveThread->getAndResetRingFull();
+			if (ring_full)
+			{
+				LL_DEBUGS("Messaging") << "Packet receive thread waited " << ring_full << " ms for a full ring" << LL_ENDL;
+			}
+		}
+		// Fake packet loss, except for packets that were already acked: the sender won't resend those.
+		else if (!mLastPacketAcked)
+		{
+			if (mDropPercentage && (ll_frand(100.f) < mDropPercentage))
+			{
+				mPacketsToDrop++;
+			}
 
+			if (mPacketsToDrop)
+			{
+				packet_size = 0;
+				mPacketsToDrop--;
+			}
+		}
+	}
 	// If using the throttle, simulate a limited size input buffer.
-	if (mUseInThrottle)
+	else if (mUseInThrottle)
 	{
 		BOOL done = FALSE;
 
@@ -248,15 +364,13 @@ S32 LLPacketRing::receivePacket (S32 socket, char *datap)
 			{
 				packet_size = 0;
 			}
+			mLastReceivingIF = ::get_receiving_interface();
 		}
 		else
 		{
-			packet_size = receive_packet(socket, datap);
-			mLastSender = ::get_sender();
+			packet_size = receiveFromBatch(socket, datap);
 		}
 
-		mLastReceivingIF = ::get_receiving_interface();
-
 		if (packet_size)  // did we actually get a packet?
 		{
 			if (mDropPercentage && (ll_frand(100.f) < mDropPercentage))
@@ -353,11 +467,57 @@ BOOL LLPacketRing::sendPacket(int h_socket, char * send_buffer, S32 buf_size, LL
 	return status;
 }
 
+void LLPacketRing::beginSendBatch()
+{
+	mBatchSends = true;
+}
+
+void LLPacketRing::endSendBatch()
+{
+	flushSendBatch();
+	mBatchSends = false;
+}
+
+void LLPacketRing::flushSendBatch()
+{
+	if (mSendBatchCount)
+	{
+		const char* buffers[NET_BATCH_SIZE];
+		S32 sizes[NET_BATCH_SIZE];
+		LLHost recipients[NET_BATCH_SIZE];
+		for (S32 i = 0; i < mSendBatchCount; ++i)
+		{
+			buffers[i] = mSendBatch[i].getData();
+			sizes[i] = mSendBatch[i].getSize();
+			recipients[i] = mSendBatch[i].getHost();
+		}
+		send_packets(mSendBatchSocket, buffers, sizes, recipients, mSendBatchCount);
+		mSendBatchCount = 0;
+	}
+}
+
 BOOL LLPacketRing::sendPacketImpl(int h_socket, const char * send_buffer, S32 buf_size, LLHost host)
 {
 	
 	if (!LLProxy::isSOCKSProxyEnabled())
 	{
+		if (mBatchSends && buf_size <= NET_BUFFER_SIZE)
+		{
+			if (mSendBatchCount && h_socket != mSendBatchSocket)
+			{
+				flushSendBatch();
+			}
+			LLPacketBuffer& packet = mSendBatch[mSendBatchCount++];
+			memcpy(packet.getBuffer(), send_buffer, buf_size);	/*Flawfinder: ignore*/
+			packet.set(buf_size, host, LLHost());
+			mSendBatchSocket = h_socket;
+			if (mSendBatchCount == NET_BATCH_SIZE)
+			{
+				flushSendBatch();
+			}
+			// Like with the out throttle queue, a failure of a deferred send is not reported.
+			return TRUE;
+		}
 		return send_packet(h_socket, send_buffer, buf_size, host.getAddress(), host.getPort());
 	}
 
@@ -36,6 +36,9 @@
 #include "llthrottle.h"
 #include "net.h"
 
+class LLPacketOutIDs;
+class LLPacketReceiveThread;
+
 class LLPacketRing
 {
 public:
@@ -51,10 +54,28 @@ public:
 	void setInBandwidth(const F32 bps);
 	void setOutBandwidth(const F32 bps);
 	S32  receivePacket (S32 socket, char *datap);
+
+	// Let a separate thread receive the packets for socket (see LLPacketReceiveThread).
+	// The in throttle (InBandwidth) is not simulated while it runs.
+	void startReceiveThread(S32 socket);
+	void stopReceiveThread();
+	// While the receive thread runs, it acks the reliable packets from these hosts itself.
+	void addAckHost(const LLHost &host, LLPacketOutIDs *out_ids);
+	void removeAckHost(const LLHost &host);
+	// About the last packet from receivePacket: its size on the wire if it was zero
+	// coded by the sender but already expanded by the receive thread (0 otherwise),
+	// and whether the receive thread already acked it.
+	S32  getLastCompressedSize() const			{ return mLastCompressedSize; }
+	bool wasLastPacketAcked() const				{ return mLastPacketAcked; }
 	S32  receiveFromRing (S32 socket, char *datap);
 
 	BOOL sendPacket(int h_socket, char * send_buffer, S32 buf_size, LLHost host);
 
+	// Between these, sent packets are collected and go out with as few system calls
+	// as possible (sendmmsg), at the latest from endSendBatch().
+	void beginSendBatch();
+	void endSendBatch();
+
 	inline LLHost getLastSender();
 	inline LLHost getLastReceivingInterface();
 
@@ -80,11 +101,29 @@ protected:
 	std::queue<LLPacketBuffer *> mReceiveQueue;
 	std::queue<LLPacketBuffer *> mSendQueue;
 
+	// Received with one receive_packets call, handed out by receivePacket one by one.
+	LLPacketBuffer mReceiveBatch[NET_BATCH_SIZE];
+	S32 mReceiveBatchCount;
+	S32 mReceiveBatchNext;
+
+	LLPacketReceiveThread* mReceiveThread;
+	bool mReceiveThreadSOCKS;		// Whether mReceiveThread was told to use the SOCKS proxy.
+	S32 mLastCompressedSize;
+	bool mLastPacketAcked;
+
+	// Collected between beginSendBatch and endSendBatch, for one send_packets call.
+	LLPacketBuffer mSendBatch[NET_BATCH_SIZE];
+	S32 mSendBatchCount;
+	int mSendBatchSocket;
+	bool mBatchSends;
+
 	LLHost mLastSender;
 	LLHost mLastReceivingIF;
 
 private:
 	BOOL sendPacketImpl(int h_socket, const char * send_buffer, S32 buf_size, LLHost host);
+	S32 receiveFromBatch(S32 socket, char *datap);
+	void flushSendBatch();
 };
 
 
@@ -42,7 +42,7 @@ LLTemplateMessageReader::LLTemplateMessageReader(message_template_number_map_t&
 												 number_template_map) :
 	mReceiveSize(0),
 	mCurrentRMessageTemplate(NULL),
-	mCurrentRMessageData(NULL),
+	mReceiveBuffer(NULL),
 	mMessageNumbers(number_template_map)
 {
 }
@@ -50,8 +50,6 @@ LLTemplateMessageReader::LLTemplateMessageReader(message_template_number_map_t&
 //virtual 
 LLTemplateMessageReader::~LLTemplateMessageReader()
 {
-	delete mCurrentRMessageData;
-	mCurrentRMessageData = NULL;
 }
 
 //virtual
@@ -59,8 +57,29 @@ void LLTemplateMessageReader::clearMessage()
 {
 	mReceiveSize = -1;
 	mCurrentRMessageTemplate = NULL;
-	delete mCurrentRMessageData;
-	mCurrentRMessageData = NULL;
+	mReceiveBuffer = NULL;
+}
+
+// Returns the index of blockname in the current template, or -1.
+S32 LLTemplateMessageReader::findBlock(const char *blockname) const
+{
+	const LLMessageTemplate::message_block_map_t& blocks = mCurrentRMessageTemplate->mMemberBlocks;
+	LLMessageTemplate::message_block_map_t::const_iterator iter = blocks.find((char *)blockname);
+	return (iter == blocks.end()) ? -1 : (S32)(iter - blocks.begin());
+}
+
+// Returns the index of varname in the given block of the current template, or -1.
+S32 LLTemplateMessageReader::findVariable(S32 block, const char *varname) const
+{
+	const LLMessageBlock::message_variable_map_t& variables = (*(mCurrentRMessageTemplate->mMemberBlocks.begin() + block))->mMemberVariables;
+	LLMessageBlock::message_variable_map_t::const_iterator iter = variables.find(varname);
+	return (iter == variables.end()) ? -1 : (S32)(iter - variables.begin());
+}
+
+const LLTemplateMessageReader::VarRef& LLTemplateMessageReader::getVarRef(S32 block, S32 blocknum, S32 var) const
+{
+	S32 num_variables = mCurrentRMessageTemplate->mDecodeBlocks[block].mNumVariables;
+	return mVarRefs[mBlockRefs[block].mFirstVar + blocknum * num_variables + var];
 }
 
 void LLTemplateMessageReader::getData(const char *blockname, const char *varname, void *datap, S32 size, S32 blocknum, S32 max_size)
@@ -72,79 +91,69 @@ void LLTemplateMessageReader::getData(const char *blockname, const char *varname
 		return;
 	}
 
-	if (!mCurrentRMessageData)
+	if (!mReceiveBuffer)
 	{
-		llerrs << "Invalid mCurrentMessageData in getData!" << llendl;
+		llerrs << "No decoded message in getData!" << llendl;
 		return;
 	}
 
-	char *bnamep = (char *)blockname + blocknum; // this works because it's just a hash.  The bnamep is never derefference
-	char *vnamep = (char *)varname; 
-
-	LLMsgData::msg_blk_data_map_t::const_iterator iter = mCurrentRMessageData->mMemberBlocks.find(bnamep);
-
-	if (iter == mCurrentRMessageData->mMemberBlocks.end())
+	S32 block = findBlock(blockname);
+	if (block < 0 || blocknum >= mBlockRefs[block].mCount)
 	{
 		llerrs << "Block " << blockname << " #" << blocknum
-			<< " not in message " << mCurrentRMessageData->mName << llendl;
+			<< " not in message " << mCurrentRMessageTemplate->mName << llendl;
 		return;
 	}
 
-	LLMsgBlkData *msg_block_data = iter->second;
-	LLMsgBlkData::msg_var_data_map_t &var_data_map = msg_block_data->mMemberVarData;
-
-	if (var_data_map.find(vnamep) == var_data_map.end())
+	S32 var = findVariable(block, varname);
+	if (var < 0)
 	{
-		llerrs << "Variable "<< vnamep << " not in message "
-			<< mCurrentRMessageData->mName<< " block " << bnamep << llendl;
+		llerrs << "Variable "<< varname << " not in message "
+			<< mCurrentRMessageTemplate->mName << " block " << blockname << llendl;
 		return;
 	}
 
-	LLMsgVarData& vardata = msg_block_data->mMemberVarData[vnamep];
+	const VarRef& var_ref = getVarRef(block, blocknum, var);
+	const S32 vardata_size = var_ref.mSize;
 
-	if (size && size != vardata.getSize())
+	if (size && size != vardata_size)
 	{
-		llerrs << "Msg " << mCurrentRMessageData->mName 
-			<< " variable " << vnamep
-			<< " is size " << vardata.getSize()
+		llerrs << "Msg " << mCurrentRMessageTemplate->mName 
+			<< " variable " << varname
+			<< " is size " << vardata_size
 			<< " but copying into buffer of size " << size
 			<< llendl;
 		return;
 	}
 
-
-	const S32 vardata_size = vardata.getSize();
 	if( max_size >= vardata_size )
-	{   
-		switch( vardata_size )
-		{ 
-		case 1:
-			*((U8*)datap) = *((U8*)vardata.getData());
-			break;
-		case 2:
-			*((U16*)datap) = *((U16*)vardata.getData());
-			break;
-		case 4:
-			*((U32*)datap) = *((U32*)vardata.getData());
-			break;
-		case 8:
-			((U32*)datap)[0] = ((U32*)vardata.getData())[0];
-			((U32*)datap)[1] = ((U32*)vardata.getData())[1];
-			break;
-		default:
-			memcpy(datap, vardata.getData(), vardata_size);
-			break;
+	{
+		if (var_ref.mOffset < 0)
+		{
+			memset(datap, 0, vardata_size);
+		}
+		else
+		{
+			EMsgVariableType type = mCurrentRMessageTemplate->mDecodeVariables[mCurrentRMessageTemplate->mDecodeBlocks[block].mFirstVariable + var].mType;
+			htonmemcpy(datap, mReceiveBuffer + var_ref.mOffset, type, vardata_size);
 		}
 	}
 	else
 	{
-		llwarns << "Msg " << mCurrentRMessageData->mName 
-			<< " variable " << vnamep
-			<< " is size " << vardata.getSize()
+		llwarns << "Msg " << mCurrentRMessageTemplate->mName 
+			<< " variable " << varname
+			<< " is size " << vardata_size
 			<< " but truncated to max size of " << max_size
 			<< llendl;
 
-		memcpy(datap, vardata.getData(), max_size);
+		if (var_ref.mOffset < 0)
+		{
+			memset(datap, 0, max_size);
+		}
+		else
+		{
+			memcpy(datap, mReceiveBuffer + var_ref.mOffset, max_size);	/* Flawfinder: ignore */
+		}
 	}
 }
 
@@ -157,22 +166,19 @@ S32 LLTemplateMessageReader::getNumberOfBlocks(const char *blockname)
 		return -1;
 	}
 
-	if (!mCurrentRMessageData)
+	if (!mReceiveBuffer)
 	{
-		llerrs << "Invalid mCurrentRMessageData in getData!" << llendl;
+		llerrs << "No decoded message in getNumberOfBlocks!" << llendl;
 		return -1;
 	}
 
-	char *bnamep = (char *)blockname; 
-
-	LLMsgData::msg_blk_data_map_t::const_iterator iter = mCurrentRMessageData->mMemberBlocks.find(bnamep);
-	
-	if (iter == mCurrentRMessageData->mMemberBlocks.end())
+	S32 block = findBlock(blockname);
+	if (block < 0)
 	{
 		return 0;
 	}
 
-	return (iter->second)->mBlockNumber;
+	return mBlockRefs[block].mCount;
 }
 
 S32 LLTemplateMessageReader::getSize(const char *blockname, const char *varname)
@@ -184,43 +190,36 @@ S32 LLTemplateMessageReader::getSize(const char *blockname, const char *varname)
 		return LL_MESSAGE_ERROR;
 	}
 
-	if (!mCurrentRMessageData)
+	if (!mReceiveBuffer)
 	{	// This is a serious error - crash
-		llerrs << "Invalid mCurrentRMessageData in getData!" << llendl;
+		llerrs << "No decoded message in getSize!" << llendl;
 		return LL_MESSAGE_ERROR;
 	}
 
-	char *bnamep = (char *)blockname; 
-
-	LLMsgData::msg_blk_data_map_t::const_iterator iter = mCurrentRMessageData->mMemberBlocks.find(bnamep);
-	
-	if (iter == mCurrentRMessageData->mMemberBlocks.end())
+	S32 block = findBlock(blockname);
+	if (block < 0 || !mBlockRefs[block].mCount)
 	{	// don't crash
-		llinfos << "Block " << bnamep << " not in message "
-			<< mCurrentRMessageData->mName << llendl;
+		llinfos << "Block " << blockname << " not in message "
+			<< mCurrentRMessageTemplate->mName << llendl;
 		return LL_BLOCK_NOT_IN_MESSAGE;
 	}
 
-	char *vnamep = (char *)varname; 
-
-	LLMsgBlkData* msg_data = iter->second;
-	LLMsgVarData& vardata = msg_data->mMemberVarData[vnamep];
-	
-	if (!vardata.getName())
+	S32 var = findVariable(block, varname);
+	if (var < 0)
 	{	// don't crash
 		llinfos << "Variable " << varname << " not in message "
-			<< mCurrentRMessageData->mName << " block " << bnamep << llendl;
+			<< mCurrentRMessageTemplate->mName << " block " << blockname << llendl;
 		return LL_VARIABLE_NOT_IN_BLOCK;
 	}
 
-	if (mCurrentRMessageTemplate->mMemberBlocks[bnamep]->mType != MBT_SINGLE)
+	if (mCurrentRMessageTemplate->mDecodeBlocks[block].mType != MBT_SINGLE)
 	{	// This is a serious error - crash
-		llerrs << "Block " << bnamep << " isn't type MBT_SINGLE,"
+		llerrs << "Block " << blockname << " isn't type MBT_SINGLE,"
 			" use getSize with blocknum argument!" << llendl;
 		return LL_MESSAGE_ERROR;
 	}
 
-	return vardata.getSize();
+	return getVarRef(block, 0, var).mSize;
 }
 
 S32 LLTemplateMessageReader::getSize(const char *blockname, S32 blocknum, const char *varname)
@@ -232,35 +231,29 @@ S32 LLTemplateMessageReader::getSize(const char *blockname, S32 blocknum, const
 		return LL_MESSAGE_ERROR;
 	}
 
-	if (!mCurrentRMessageData)
+	if (!mReceiveBuffer)
 	{	// This is a serious error - crash
-		llerrs << "Invalid mCurrentRMessageData in getData!" << llendl;
+		llerrs << "No decoded message in getSize!" << llendl;
 		return LL_MESSAGE_ERROR;
 	}
 
-	char *bnamep = (char *)blockname + blocknum; 
-	char *vnamep = (char *)varname; 
-
-	LLMsgData::msg_blk_data_map_t::const_iterator iter = mCurrentRMessageData->mMemberBlocks.find(bnamep);
-	
-	if (iter == mCurrentRMessageData->mMemberBlocks.end())
+	S32 block = findBlock(blockname);
+	if (block < 0 || blocknum >= mBlockRefs[block].mCount)
 	{	// don't crash
-		llinfos << "Block " << bnamep << " not in message " 
-			<< mCurrentRMessageData->mName << llendl;
+		llinfos << "Block " << blockname << " #" << blocknum << " not in message " 
+			<< mCurrentRMessageTemplate->mName << llendl;
 		return LL_BLOCK_NOT_IN_MESSAGE;
 	}
 
-	LLMsgBlkData* msg_data = iter->second;
-	LLMsgVarData& vardata = msg_data->mMemberVarData[vnamep];
-	
-	if (!vardata.getName())
+	S32 var = findVariable(block, varname);
+	if (var < 0)
 	{	// don't crash
-		llinfos << "Variable " << vnamep << " not in message "
-			<<  mCurrentRMessageData->mName << " block " << bnamep << llendl;
+		llinfos << "Variable " << varname << " not in message "
+			<<  mCurrentRMessageTemplate->mName << " block " << blockname << llendl;
 		return LL_VARIABLE_NOT_IN_BLOCK;
 	}
 
-	return vardata.getSize();
+	return getVarRef(block, blocknum, var).mSize;
 }
 
 void LLTemplateMessageReader::getBinaryData(const char *blockname, 
@@ -537,40 +530,40 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender,
 {
 	llassert( mReceiveSize >= 0 );
 	llassert( mCurrentRMessageTemplate);
-	llassert( !mCurrentRMessageData );
-	delete mCurrentRMessageData; // just to make sure
 
 	// The offset tells us how may bytes to skip after the end of the
 	// message name.
 	U8 offset = buffer[PHL_OFFSET];
 	S32 decode_pos = LL_PACKET_ID_SIZE + (S32)(mCurrentRMessageTemplate->mFrequency) + offset;
 
-	// create base working data set
-	mCurrentRMessageData = new LLMsgData(mCurrentRMessageTemplate->mName);
-	
-	// loop through the template building the data structure as we go
-	LLMessageTemplate::message_block_map_t::const_iterator iter;
-	for(iter = mCurrentRMessageTemplate->mMemberBlocks.begin();
-		iter != mCurrentRMessageTemplate->mMemberBlocks.end();
-		++iter)
+	// Nothing is copied: we only note where every variable is in the packet.
+	// The tables keep their capacity from message to message, so this doesn't
+	// allocate anything once the biggest message has been seen.
+	mReceiveBuffer = buffer;
+	mBlockRefs.clear();
+	mVarRefs.clear();
+	S32 total_blocks = 0;
+
+	const std::vector<LLMessageTemplate::DecodeVariable>& variables = mCurrentRMessageTemplate->mDecodeVariables;
+	const std::vector<LLMessageTemplate::DecodeBlock>& blocks = mCurrentRMessageTemplate->mDecodeBlocks;
+	for (std::vector<LLMessageTemplate::DecodeBlock>::const_iterator iter = blocks.begin(); iter != blocks.end(); ++iter)
 	{
-		LLMessageBlock* mbci = *iter;
+		const LLMessageTemplate::DecodeBlock& block = *iter;
 		U8	repeat_number;
-		S32	i;
 
 		// how many of this block?
 
-		if (mbci->mType == MBT_SINGLE)
+		if (block.mType == MBT_SINGLE)
 		{
 			// just one
 			repeat_number = 1;
 		}
-		else if (mbci->mType == MBT_MULTIPLE)
+		else if (block.mType == MBT_MULTIPLE)
 		{
 			// a known number
-			repeat_number = mbci->mNumber;
+			repeat_number = block.mNumber;
 		}
-		else if (mbci->mType == MBT_VARIABLE)
+		else if (block.mType == MBT_VARIABLE)
 		{
 			// need to read the number from the message
 			// repeat number is a single byte
@@ -596,42 +589,25 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender,
 			return FALSE;
 		}
 
-		LLMsgBlkData* cur_data_block = NULL;
+		BlockRef block_ref;
+		block_ref.mFirstVar = (S32)mVarRefs.size();
+		block_ref.mCount = repeat_number;
+		mBlockRefs.push_back(block_ref);
+		total_blocks += repeat_number;
 
 		// now loop through the block
-		for (i = 0; i < repeat_number; i++)
+		for (S32 i = 0; i < repeat_number; i++)
 		{
-			if (i)
+			for (S32 v = block.mFirstVariable; v < block.mFirstVariable + block.mNumVariables; ++v)
 			{
-				// build new name to prevent collisions
-				// TODO: This should really change to a vector
-				cur_data_block = new LLMsgBlkData(mbci->mName, repeat_number);
-				cur_data_block->mName = mbci->mName + i;
-			}
-			else
-			{
-				cur_data_block = new LLMsgBlkData(mbci->mName, repeat_number);
-			}
-
-			// add the block to the message
-			mCurrentRMessageData->addBlock(cur_data_block);
-
-			// now read the variables
-			for (LLMessageBlock::message_variable_map_t::const_iterator iter = 
-					 mbci->mMemberVariables.begin();
-				 iter != mbci->mMemberVariables.end(); iter++)
-			{
-				const LLMessageVariable& mvci = **iter;
-
-				// ok, build out the variables
-				// add variable block
-				cur_data_block->addVariable(mvci.getName(), mvci.getType());
+				const LLMessageTemplate::DecodeVariable& variable = variables[v];
+				VarRef var_ref;
 
 				// what type of variable?
-				if (mvci.getType() == MVT_VARIABLE)
+				if (variable.mType == MVT_VARIABLE)
 				{
 					// variable, get the number of bytes to read from the template
-					S32 data_size = mvci.getSize();
+					S32 data_size = variable.mSize;
 					U8 tsizeb = 0;
 					U16 tsizeh = 0;
 					U32 tsize = 0;
@@ -666,39 +642,40 @@ BOOL LLTemplateMessageReader::decodeData(const U8* buffer, const LLHost& sender,
 					}
 					decode_pos += data_size;
 
-					cur_data_block->addData(mvci.getName(), &buffer[decode_pos], tsize, mvci.getType());
+					var_ref.mOffset = decode_pos;
+					var_ref.mSize = tsize;
+					if ((S64)decode_pos + tsize > mReceiveSize)
+					{
+						if (!custom)
+							logRanOffEndOfPacket(sender, decode_pos, tsize);
+
+						// Don't read past the end of the packet.
+						var_ref.mOffset = -1;
+						var_ref.mSize = 0;
+					}
 					decode_pos += tsize;
 				}
 				else
 				{
 					// fixed!
-					// so, copy data pointer and set data size to fixed size
-					if ((decode_pos + mvci.getSize()) > mReceiveSize)
+					var_ref.mOffset = decode_pos;
+					var_ref.mSize = variable.mSize;
+					if ((decode_pos + variable.mSize) > mReceiveSize)
 					{
 						if(!custom)
-							logRanOffEndOfPacket(sender, decode_pos, mvci.getSize());
+							logRanOffEndOfPacket(sender, decode_pos, variable.mSize);
 
 						// default to 0s.
-						U32 size = mvci.getSize();
-						std::vector<U8> data(size, 0);
-						cur_data_block->addData(mvci.getName(), &(data[0]), 
-												size, mvci.getType());
-					}
-					else
-					{
-						cur_data_block->addData(mvci.getName(), 
-												&buffer[decode_pos], 
-												mvci.getSize(), 
-												mvci.getType());
+						var_ref.mOffset = -1;
 					}
-					decode_pos += mvci.getSize();
+					decode_pos += variable.mSize;
 				}
+				mVarRefs.push_back(var_ref);
 			}
 		}
 	}
 
-	if (mCurrentRMessageData->mMemberBlocks.empty()
-		&& !mCurrentRMessageTemplate->mMemberBlocks.empty())
+	if (!total_blocks && !blocks.empty())
 	{
 		lldebugs << "Empty message '" << mCurrentRMessageTemplate->mName << "' (no blocks)" << llendl;
 		return FALSE;
@@ -829,9 +806,44 @@ bool LLTemplateMessageReader::isUdpBanned() const
 //virtual 
 void LLTemplateMessageReader::copyToBuilder(LLMessageBuilder& builder) const
 {
-	if(NULL == mCurrentRMessageTemplate)
+	if(NULL == mCurrentRMessageTemplate || NULL == mReceiveBuffer)
     {
         return;
     }
-	builder.copyFromMessageData(*mCurrentRMessageData);
+
+	// Only used to forward messages, so the builder still gets the data as an LLMsgData.
+	LLMsgData message_data(mCurrentRMessageTemplate->mName);
+	S32 block = 0;
+	for (LLMessageTemplate::message_block_map_t::const_iterator iter = mCurrentRMessageTemplate->mMemberBlocks.begin();
+		 iter != mCurrentRMessageTemplate->mMemberBlocks.end(); ++iter, ++block)
+	{
+		const LLMessageBlock* mbci = *iter;
+		S32 repeat_number = mBlockRefs[block].mCount;
+		for (S32 i = 0; i < repeat_number; ++i)
+		{
+			LLMsgBlkData* cur_data_block = new LLMsgBlkData(mbci->mName, repeat_number);
+			// build new name to prevent collisions
+			cur_data_block->mName = mbci->mName + i;
+			message_data.addBlock(cur_data_block);
+
+			S32 var = 0;
+			for (LLMessageBlock::message_variable_map_t::const_iterator var_iter = mbci->mMemberVariables.begin();
+				 var_iter != mbci->mMemberVariables.end(); ++var_iter, ++var)
+			{
+				const LLMessageVariable& mvci = **var_iter;
+				const VarRef& var_ref = getVarRef(block, i, var);
+				cur_data_block->addVariable(mvci.getName(), mvci.getType());
+				if (var_ref.mOffset < 0)
+				{
+					std::vector<U8> data(var_ref.mSize + 1, 0);
+					cur_data_block->addData(mvci.getName(), &data[0], var_ref.mSize, mvci.getType());
+				}
+				else
+				{
+					cur_data_block->addData(mvci.getName(), mReceiveBuffer + var_ref.mOffset, var_ref.mSize, mvci.getType());
+				}
+			}
+		}
+	}
+	builder.copyFromMessageData(message_data);
 }
@@ -30,9 +30,9 @@
 #include "llmessagereader.h"
 
 #include <map>
+#include <vector>
 
 class LLMessageTemplate;
-class LLMsgData;
 
 class LLTemplateMessageReader : public LLMessageReader
 {
@@ -100,6 +100,7 @@ public:
 
 	BOOL validateMessage(const U8* buffer, S32 buffer_size, 
 						 const LLHost& sender, bool trusted = false, bool custom = false);
+	// The get* methods read straight from buffer, so it has to stay valid until clearMessage().
 	BOOL readMessage(const U8* buffer, const LLHost& sender);
 
 	bool isTrusted() const;
@@ -119,9 +120,27 @@ private:
 
 	BOOL decodeData(const U8* buffer, const LLHost& sender, bool custom);
 
+	// Where the variables of the current message are in mReceiveBuffer.
+	struct VarRef
+	{
+		S32 mOffset;		// -1 if the packet ended before this variable; it reads as zeroes then.
+		S32 mSize;
+	};
+	struct BlockRef
+	{
+		S32 mFirstVar;		// Index into mVarRefs of the first variable of the first instance.
+		S32 mCount;			// Number of instances of this block in the message.
+	};
+
+	S32 findBlock(const char *blockname) const;
+	S32 findVariable(S32 block, const char *varname) const;
+	const VarRef& getVarRef(S32 block, S32 blocknum, S32 var) const;
+
 	S32	mReceiveSize;
 	LLMessageTemplate* mCurrentRMessageTemplate;
-	LLMsgData* mCurrentRMessageData;
+	const U8* mReceiveBuffer;				// NULL while there is no decoded message.
+	std::vector<BlockRef> mBlockRefs;		// One per block of mCurrentRMessageTemplate.
+	std::vector<VarRef> mVarRefs;			// Every variable of every block instance, in packet order.
 	message_template_number_map_t& mMessageNumbers;
 	friend class LLFloaterMessageLogItem;
 };
@@ -79,6 +79,7 @@
 #include "v3math.h"
 #include "v4math.h"
 #include "lltransfertargetvfile.h"
+#include "llpacketcapture.h"
 #include "llpacketring.h"
 // <os>
 #include "llrand.h"// <os> - Message Log / Builder
@@ -372,8 +373,11 @@ LLMessageSystem::~LLMessageSystem()
 	
 	if (!mbError)
 	{
+		// Don't let the receive thread wait on a closed socket.
+		mPacketRing->stopReceiveThread();
 		end_net(mSocket);
 	}
+	LLPacketCapture::stop();
 	mSocket = 0;
 	
 	delete mTemplateMessageReader;
@@ -561,6 +565,9 @@ BOOL LLMessageSystem::checkMessages( S64 frame_count, bool faked_message, U8 fak
 		BOOL recv_resent = FALSE;
 		S32 acks = 0;
 		S32 true_rcv_size = 0;
+		// What the packet receive thread already did with this packet, if it runs.
+		S32 expanded_from_size = 0;
+		bool acked_by_thread = false;
 
 		U8* buffer = mTrueReceiveBuffer;
 
@@ -575,6 +582,8 @@ BOOL LLMessageSystem::checkMessages( S64 frame_count, bool faked_message, U8 fak
 		receive_size = mTrueReceiveSize;
 		mLastSender = mPacketRing->getLastSender();
 		mLastReceivingIF = mPacketRing->getLastReceivingInterface();
+		expanded_from_size = mPacketRing->getLastCompressedSize();
+		acked_by_thread = mPacketRing->wasLastPacketAcked();
 // <os> - Message Log / Builder
 		} else {
 			buffer = fake_buffer;
@@ -587,6 +596,7 @@ BOOL LLMessageSystem::checkMessages( S64 frame_count, bool faked_message, U8 fak
  		if(mTrueReceiveSize && receive_size > (S32) LL_MINIMUM_VALID_PACKET_SIZE && !faked_message)
  		{
 			LLMessageLog::log(mLastSender, LLHost(16777343, mPort), buffer, mTrueReceiveSize);
+			LLPacketCapture::recordPacket(mLastSender, buffer, mTrueReceiveSize);
  		}
  		// < /os>
 		
@@ -633,6 +643,16 @@ BOOL LLMessageSystem::checkMessages( S64 frame_count, bool faked_message, U8 fak
 
 			// process the message as normal
 			mIncomingCompressedSize = zeroCodeExpand(&buffer, &receive_size);
+			if (expanded_from_size)
+			{
+				// The receive thread expanded it already; count it as it came in on the wire.
+				mIncomingCompressedSize = expanded_from_size;
+				mCompressedPacketsIn++;
+				mCompressedBytesIn += expanded_from_size;
+				mUncompressedBytesIn += receive_size;
+				mTotalBytesIn += expanded_from_size - receive_size;
+				mTrueReceiveSize -= receive_size - expanded_from_size;
+			}
 			mCurrentRecvPacketID = ntohl(*((U32*)(&buffer[1])));
 			host = getSender();
 
@@ -673,12 +693,13 @@ BOOL LLMessageSystem::checkMessages( S64 frame_count, bool faked_message, U8 fak
 			if (buffer[0] & LL_RESENT_FLAG)
 			{
 				recv_resent = TRUE;
-				if (cdp && cdp->isDuplicateResend(mCurrentRecvPacketID))
+				// A faked message didn't arrive on the circuit, so it is not one of its resends.
+				if (cdp && !faked_message && cdp->isDuplicateResend(mCurrentRecvPacketID))
 				{
 					// We need to ACK here to suppress
 					// further resends of packets we've
 					// already seen.
-					if (recv_reliable)
+					if (recv_reliable && !acked_by_thread)
 					{
 						//mAckList.addData(new LLPacketAck(host, mCurrentRecvPacketID));
 						// ***************************************
@@ -757,7 +778,8 @@ BOOL LLMessageSystem::checkMessages( S64 frame_count, bool faked_message, U8 fak
 
 			if( valid_packet )
 			{
-				logValidMsg(cdp, host, recv_reliable, recv_resent, (BOOL)(acks>0) );
+				// Keep faked messages out of the circuit's packet id and byte tracking.
+				logValidMsg(faked_message ? NULL : cdp, host, recv_reliable, recv_resent, (BOOL)(acks>0) );
 				valid_packet = mTemplateMessageReader->readMessage(buffer, host);
 			}
 
@@ -771,14 +793,17 @@ BOOL LLMessageSystem::checkMessages( S64 frame_count, bool faked_message, U8 fak
 				mBytesIn += mTrueReceiveSize;
 				
 				// ACK here for	valid packets that we've seen
-				// for the first time.
-				if (cdp && recv_reliable)
+				// for the first time. Faked messages were never sent by the other end.
+				if (cdp && recv_reliable && !faked_message)
 				{
 					// Add to the recently received list for duplicate suppression
 					cdp->mRecentlyReceivedReliablePackets[mCurrentRecvPacketID] = getMessageTimeUsecs();
 
 					// Put it onto the list of packets to be acked
-					cdp->collectRAck(mCurrentRecvPacketID);
+					if (!acked_by_thread)
+					{
+						cdp->collectRAck(mCurrentRecvPacketID);
+					}
 					mReliablePacketsIn++;
 				}
 			}
@@ -795,7 +820,7 @@ BOOL LLMessageSystem::checkMessages( S64 frame_count, bool faked_message, U8 fak
 				}
 			}
 		}
-	} while (!valid_packet && receive_size > 0);
+	} while (!valid_packet && receive_size > 0 && !faked_message);	// A faked message would be retried forever.
 
 	F64 mt_sec = getMessageTimeSeconds();
 	// Check to see if we need to print debug info
@@ -848,12 +873,17 @@ void LLMessageSystem::processAcks()
 		// Check the status of circuits
 		mCircuitInfo.updateWatchDogTimers(this);
 
+		// Resends and acks go out in batches.
+		mPacketRing->beginSendBatch();
+
 		//resend any necessary packets
 		mCircuitInfo.resendUnackedPackets(mUnackedListDepth, mUnackedListSize);
 
 		//cycle through ack list for each host we need to send acks to
 		mCircuitInfo.sendAcks();
 
+		mPacketRing->endSendBatch();
+
 		if (!mDenyTrustedCircuitSet.empty())
 		{
 			LL_INFOS("Messaging") << "Sending queued DenyTrustedCircuit messages." << llendl;
@@ -1273,10 +1303,12 @@ S32 LLMessageSystem::sendMessage(const LLHost &host)
 	memset(mSendBuffer, 0, LL_PACKET_ID_SIZE - 1); 
 
 	// add the send id to the front of the message
-	cdp->nextPacketOutID();
+	// (read it back from the return value, the receive thread may take the
+	// next id for an ack before we get to use this one)
+	TPACKETID packet_out_id = cdp->nextPacketOutID();
 
 	// Packet ID size is always 4
-	*((S32*)&mSendBuffer[PHL_PACKET_ID]) = htonl(cdp->getPacketOutID());
+	*((S32*)&mSendBuffer[PHL_PACKET_ID]) = htonl(packet_out_id);
 
 	// Compress the message, which will usually reduce its size.
 	U8 * buf_ptr = (U8 *)mSendBuffer;
@@ -1384,7 +1416,7 @@ S32 LLMessageSystem::sendMessage(const LLHost &host)
 		std::ostringstream str;
 		str << "MSG: -> " << host;
 		std::string buffer;
-		buffer = llformat( "\t%6d\t%6d\t%6d ", mSendSize, buffer_length, cdp->getPacketOutID());
+		buffer = llformat( "\t%6d\t%6d\t%6d ", mSendSize, buffer_length, packet_out_id);
 		str << buffer
 			<< mMessageBuilder->getMessageName()
 			<< (mSendReliable ? " reliable " : "");
@@ -1621,6 +1653,22 @@ void LLMessageSystem::enableCircuit(const LLHost &host, BOOL trusted)
 		cdp->setAlive(TRUE);
 	}
 	cdp->setTrusted(trusted);
+	LLPacketCapture::recordCircuit(host, trusted);
+}
+
+bool LLMessageSystem::startPacketCapture(const std::string& filename)
+{
+	if (!LLPacketCapture::start(filename))
+	{
+		return false;
+	}
+	// Circuits that are already up, so that a replay accepts their packets.
+	std::vector<LLCircuitData*> circuits = mCircuitInfo.getCircuitDataList();
+	for (std::vector<LLCircuitData*>::iterator iter = circuits.begin(); iter != circuits.end(); ++iter)
+	{
+		LLPacketCapture::recordCircuit((*iter)->getHost(), (*iter)->getTrusted());
+	}
+	return true;
 }
 
 void LLMessageSystem::disableCircuit(const LLHost &host)
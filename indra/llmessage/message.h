@@ -615,6 +615,10 @@ public:
 	
 	void	enableCircuit(const LLHost &host, BOOL trusted);
 	void	disableCircuit(const LLHost &host);
+
+	// Records all received packets, and the circuits they can arrive on, to
+	// filename for LLPacketReplay. Stopped with LLPacketCapture::stop().
+	bool	startPacketCapture(const std::string& filename);
 	
 	// Use this to establish trust on startup and in response to
 	// DenyTrustedCircuit.
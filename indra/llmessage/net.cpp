@@ -349,11 +349,15 @@ BOOL send_packet(int hSocket, const char *sendBuffer, int size, U32 recipient, i
 	int nRet = 0;
 	U32 last_error = 0;
 
-	stDstAddr.sin_addr.s_addr = recipient;
-	stDstAddr.sin_port = htons(nPort);
+	// A local address, so that the packet receive thread can send its acks at the same time.
+	SOCKADDR_IN dst_addr;
+	memset(&dst_addr, 0, sizeof(dst_addr));
+	dst_addr.sin_family = AF_INET;
+	dst_addr.sin_addr.s_addr = recipient;
+	dst_addr.sin_port = htons(nPort);
 	do
 	{
-		nRet = sendto(hSocket, sendBuffer, size, 0, (struct sockaddr*)&stDstAddr, sizeof(stDstAddr));					
+		nRet = sendto(hSocket, sendBuffer, size, 0, (struct sockaddr*)&dst_addr, sizeof(dst_addr));					
 
 		if (nRet == SOCKET_ERROR ) 
 		{
@@ -526,12 +530,31 @@ void end_net(S32& socket_out)
 }
 
 #if LL_LINUX
+// Extracts the address a datagram was sent to from the IP_PKTINFO control message, if any.
+static void get_destip(struct msghdr *msg, U32 *dstip)
+{
+	struct cmsghdr *cmsgptr;
+	for (cmsgptr = CMSG_FIRSTHDR(msg); cmsgptr != NULL; cmsgptr = CMSG_NXTHDR(msg, cmsgptr))
+	{
+		if( cmsgptr->cmsg_level == SOL_IP && cmsgptr->cmsg_type == IP_PKTINFO )
+		{
+			in_pktinfo *pktinfo = (in_pktinfo *)CMSG_DATA(cmsgptr);
+			if( pktinfo )
+			{
+				// Two choices. routed and specified. ipi_addr is routed, ipi_spec_dst is
+				// routed. We should stay with specified until we go to multiple
+				// interfaces
+				*dstip = pktinfo->ipi_spec_dst.s_addr;
+			}
+		}
+	}
+}
+
 static int recvfrom_destip( int socket, void *buf, int len, struct sockaddr *from, socklen_t *fromlen, U32 *dstip )
 {
 	int size;
 	struct iovec iov[1];
 	char cmsg[CMSG_SPACE(sizeof(struct in_pktinfo))];
-	struct cmsghdr *cmsgptr;
 	struct msghdr msg = {0};
 
 	iov[0].iov_base = buf;
@@ -552,20 +575,7 @@ static int recvfrom_destip( int socket, void *buf, int len, struct sockaddr *fro
 		return -1;
 	}
 
-	for (cmsgptr = CMSG_FIRSTHDR(&msg); cmsgptr != NULL; cmsgptr = CMSG_NXTHDR( &msg, cmsgptr))
-	{
-		if( cmsgptr->cmsg_level == SOL_IP && cmsgptr->cmsg_type == IP_PKTINFO )
-		{
-			in_pktinfo *pktinfo = (in_pktinfo *)CMSG_DATA(cmsgptr);
-			if( pktinfo )
-			{
-				// Two choices. routed and specified. ipi_addr is routed, ipi_spec_dst is
-				// routed. We should stay with specified until we go to multiple
-				// interfaces
-				*dstip = pktinfo->ipi_spec_dst.s_addr;
-			}
-		}
-	}
+	get_destip(&msg, dstip);
 
 	return size;
 }
@@ -608,12 +618,16 @@ BOOL send_packet(int hSocket, const char * sendBuffer, int size, U32 recipient,
 	BOOL	resend;
 	S32		send_attempts = 0;
 
-	stDstAddr.sin_addr.s_addr = recipient;
-	stDstAddr.sin_port = htons(nPort);
+	// A local address, so that the packet receive thread can send its acks at the same time.
+	struct sockaddr_in dst_addr;
+	memset(&dst_addr, 0, sizeof(dst_addr));
+	dst_addr.sin_family = AF_INET;
+	dst_addr.sin_addr.s_addr = recipient;
+	dst_addr.sin_port = htons(nPort);
 
 	do
 	{
-		ret = sendto(hSocket, sendBuffer, size, 0,	(struct sockaddr*)&stDstAddr, sizeof(stDstAddr));
+		ret = sendto(hSocket, sendBuffer, size, 0,	(struct sockaddr*)&dst_addr, sizeof(dst_addr));
 		send_attempts++;
 
 		if (ret >= 0)
@@ -631,21 +645,21 @@ BOOL send_packet(int hSocket, const char * sendBuffer, int size, U32 recipient,
 			{
 				// say nothing, just repeat send
 				llinfos << "sendto() reported buffer full, resending (attempt " << send_attempts << ")" << llendl;
-				llinfos << inet_ntoa(stDstAddr.sin_addr) << ":" << nPort << llendl;
+				llinfos << inet_ntoa(dst_addr.sin_addr) << ":" << nPort << llendl;
 				resend = TRUE;
 			}
 			else if (errno == ECONNREFUSED)
 			{
 				// response to ICMP connection refused message on earlier send
 				llinfos << "sendto() reported connection refused, resending (attempt " << send_attempts << ")" << llendl;
-				llinfos << inet_ntoa(stDstAddr.sin_addr) << ":" << nPort << llendl;
+				llinfos << inet_ntoa(dst_addr.sin_addr) << ":" << nPort << llendl;
 				resend = TRUE;
 			}
 			else
 			{
 				// some other error
 				llinfos << "sendto() failed: " << errno << ", " << strerror(errno) << llendl;
-				llinfos << inet_ntoa(stDstAddr.sin_addr) << ":" << nPort << llendl;
+				llinfos << inet_ntoa(dst_addr.sin_addr) << ":" << nPort << llendl;
 				resend = FALSE;
 			}
 		}
@@ -661,6 +675,142 @@ BOOL send_packet(int hSocket, const char * sendBuffer, int size, U32 recipient,
 	return success;
 }
 
+#if LL_LINUX
+S32 receive_packets(int hSocket, char** receiveBuffers, S32* sizes, LLHost* senders, LLHost* receiving_ifs, S32 count)
+{
+	struct mmsghdr msgs[NET_BATCH_SIZE];
+	struct iovec iovs[NET_BATCH_SIZE];
+	struct sockaddr_in from[NET_BATCH_SIZE];
+	char cmsgs[NET_BATCH_SIZE][CMSG_SPACE(sizeof(struct in_pktinfo))];
+
+	count = llmin(count, (S32)NET_BATCH_SIZE);
+	memset(msgs, 0, count * sizeof(struct mmsghdr));
+	for (S32 i = 0; i < count; ++i)
+	{
+		iovs[i].iov_base = receiveBuffers[i];
+		iovs[i].iov_len = NET_BUFFER_SIZE;
+		msgs[i].msg_hdr.msg_name = &from[i];
+		msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+		msgs[i].msg_hdr.msg_iov = &iovs[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+		msgs[i].msg_hdr.msg_control = cmsgs[i];
+		msgs[i].msg_hdr.msg_controllen = sizeof(cmsgs[i]);
+	}
+
+	int received = recvmmsg(hSocket, msgs, count, MSG_DONTWAIT, NULL);
+	if (received <= 0)
+	{
+		// Nothing waiting (EAGAIN), or an error; like receive_packet, report neither.
+		return 0;
+	}
+
+	for (S32 i = 0; i < received; ++i)
+	{
+		U32 dstip = INVALID_HOST_IP_ADDRESS;
+		get_destip(&msgs[i].msg_hdr, &dstip);
+		sizes[i] = msgs[i].msg_len;
+		senders[i] = LLHost(from[i].sin_addr.s_addr, ntohs(from[i].sin_port));
+		receiving_ifs[i] = LLHost(dstip, INVALID_PORT);
+	}
+	return received;
+}
+
+S32 send_packets(int hSocket, const char* const* sendBuffers, const S32* sizes, const LLHost* recipients, S32 count)
+{
+	struct mmsghdr msgs[NET_BATCH_SIZE];
+	struct iovec iovs[NET_BATCH_SIZE];
+	struct sockaddr_in to[NET_BATCH_SIZE];
+
+	S32 sent = 0;
+	S32 done = 0;
+	while (done < count)
+	{
+		S32 batch = llmin(count - done, (S32)NET_BATCH_SIZE);
+		memset(msgs, 0, batch * sizeof(struct mmsghdr));
+		memset(to, 0, batch * sizeof(struct sockaddr_in));
+		for (S32 i = 0; i < batch; ++i)
+		{
+			to[i].sin_family = AF_INET;
+			to[i].sin_addr.s_addr = recipients[done + i].getAddress();
+			to[i].sin_port = htons(recipients[done + i].getPort());
+			iovs[i].iov_base = const_cast<char*>(sendBuffers[done + i]);
+			iovs[i].iov_len = sizes[done + i];
+			msgs[i].msg_hdr.msg_name = &to[i];
+			msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+			msgs[i].msg_hdr.msg_iov = &iovs[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+		}
+
+		int ret = sendmmsg(hSocket, msgs, batch, 0);
+		if (ret > 0)
+		{
+			sent += ret;
+			done += ret;
+		}
+		else
+		{
+			// The first datagram failed. Leave it to send_packet, which retries on a full buffer and reports anything else.
+			if (send_packet(hSocket, sendBuffers[done], sizes[done], recipients[done].getAddress(), recipients[done].getPort()))
+			{
+				++sent;
+			}
+			++done;
+		}
+	}
+	return sent;
+}
+#endif
+
+#endif
+
+#if !LL_LINUX
+// No batched system calls here, fall back to one datagram per call.
+
+// Unlike receive_packet this doesn't touch the globals behind get_sender(),
+// so that the packet receive thread can use it.
+S32 receive_packets(int hSocket, char** receiveBuffers, S32* sizes, LLHost* senders, LLHost* receiving_ifs, S32 count)
+{
+	if (count < 1)
+	{
+		return 0;
+	}
+	struct sockaddr_in from;
+#if LL_WINDOWS
+	int addr_size = sizeof(from);
+#else
+	socklen_t addr_size = sizeof(from);
+#endif
+	int ret = recvfrom(hSocket, receiveBuffers[0], NET_BUFFER_SIZE, 0, (struct sockaddr*)&from, &addr_size);
+	if (ret <= 0)
+	{
+#if LL_WINDOWS
+		int error = WSAGetLastError();
+		if (ret < 0 && error != WSAEWOULDBLOCK && error != WSAECONNRESET)
+		{
+			llinfos << "receive_packets() failed, Error: " << error << llendl;
+		}
+#endif
+		return 0;
+	}
+	sizes[0] = ret;
+	senders[0] = LLHost(from.sin_addr.s_addr, ntohs(from.sin_port));
+	// Only known with recvfrom_destip, which is Linux only.
+	receiving_ifs[0] = LLHost(INVALID_HOST_IP_ADDRESS, INVALID_PORT);
+	return 1;
+}
+
+S32 send_packets(int hSocket, const char* const* sendBuffers, const S32* sizes, const LLHost* recipients, S32 count)
+{
+	S32 sent = 0;
+	for (S32 i = 0; i < count; ++i)
+	{
+		if (send_packet(hSocket, sendBuffers[i], sizes[i], recipients[i].getAddress(), recipients[i].getPort()))
+		{
+			++sent;
+		}
+	}
+	return sent;
+}
 #endif
 
 //EOF
@@ -32,6 +32,9 @@ class LLHost;
 
 #define NET_BUFFER_SIZE (0x2000)
 
+// Maximum number of datagrams handled by one receive_packets/send_packets system call
+#define NET_BATCH_SIZE (32)
+
 // Request a free local port from the operating system
 #define NET_USE_OS_ASSIGNED_PORT 0
 
@@ -41,10 +44,21 @@ S32		start_net(S32& socket_out, int& nPort);
 void	end_net(S32& socket_out);
 
 // returns size of packet or -1 in case of error
+// Sets the globals behind get_sender() and get_receiving_interface(): main thread only.
 S32		receive_packet(int hSocket, char * receiveBuffer);
 
+// Thread safe, the packet receive thread sends its acks with this.
 BOOL	send_packet(int hSocket, const char *sendBuffer, int size, U32 recipient, int nPort);	// Returns TRUE on success.
 
+// Batched versions of the above, using recvmmsg/sendmmsg where available (linux) and
+// one datagram at a time elsewhere. Every receive buffer must be NET_BUFFER_SIZE bytes.
+// receive_packets returns the number of datagrams received (0 when none are waiting)
+// and fills in their sizes, senders and receiving interfaces; at most NET_BATCH_SIZE.
+S32		receive_packets(int hSocket, char** receiveBuffers, S32* sizes, LLHost* senders, LLHost* receiving_ifs, S32 count);
+// Both are thread safe.
+// send_packets tries to send all count datagrams and returns the number that were sent.
+S32		send_packets(int hSocket, const char* const* sendBuffers, const S32* sizes, const LLHost* recipients, S32 count);
+
 //void	get_sender(char * tmp);
 LLHost	get_sender();
 U32		get_sender_port();
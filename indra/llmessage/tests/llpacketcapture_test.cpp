@@ -0,0 +1,199 @@
+/**
+ * @file llpacketcapture_test.cpp
+ * @brief LLPacketCapture, LLPacketCaptureReader and LLPacketReplay test cases.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llpacketcapture.h"
+
+#include "lluuid.h"
+#include "../message.h"
+#include "../message_prehash.h"
+#include "../llmessagetemplate.h"
+#include "../lltemplatemessagebuilder.h"
+
+#include "../test/lltut.h"
+
+namespace
+{
+	S32 sHandled = 0;
+	U32 sLastValue = 0;
+
+	void process_test_message(LLMessageSystem* msg, void**)
+	{
+		++sHandled;
+		msg->getU32Fast(_PREHASH_Test0, _PREHASH_Test0, sLastValue);
+	}
+
+	// A TestMessage as a sim sends it: reliable, resent, with one appended ack.
+	S32 build_packet(const LLTemplateMessageBuilder::message_template_name_map_t& templates, TPACKETID packet_id, U32 value, U8* packet)
+	{
+		LLTemplateMessageBuilder builder(templates);
+		builder.newMessage(_PREHASH_TestMessage);
+		builder.nextBlock(_PREHASH_Test0);
+		builder.addU32(_PREHASH_Test0, value);
+		memset(packet, 0, LL_PACKET_ID_SIZE);
+		S32 size = builder.buildMessage(packet, MAX_BUFFER_SIZE, 0);
+
+		packet[0] = LL_RELIABLE_FLAG | LL_RESENT_FLAG | LL_ACK_FLAG;
+		U32 id = htonl(packet_id);
+		memcpy(&packet[1], &id, sizeof(id));			/* Flawfinder: ignore */
+		U32 ack = htonl(1000 + packet_id);
+		memcpy(&packet[size], &ack, sizeof(ack));		/* Flawfinder: ignore */
+		size += sizeof(ack);
+		packet[size++] = 1;
+		return size;
+	}
+}
+
+namespace tut
+{
+	struct packetcapture_data
+	{
+		packetcapture_data()
+		{
+			LLUUID random;
+			random.generate();
+#if LL_WINDOWS
+			mFilename = "C:\\packet-capture-test-" + random.asString();
+#else
+			mFilename = "/tmp/packet-capture-test-" + random.asString();
+#endif
+		}
+		~packetcapture_data()
+		{
+			LLPacketCapture::stop();
+			LLFile::remove(mFilename);
+			// not end_messaging_system()
+			delete gMessageSystem;
+			gMessageSystem = NULL;
+		}
+
+		std::string mFilename;
+	};
+	typedef test_group<packetcapture_data> packetcapture_test;
+	typedef packetcapture_test::object packetcapture_object;
+	tut::packetcapture_test packetcapture_testcase("LLPacketCapture");
+
+	template<> template<>
+	void packetcapture_object::test<1>()
+	{
+		// Records come back in order with their hosts and data.
+		LLHost sim(ip_string_to_u32("10.1.2.3"), 13005);
+		U8 data[200];
+		for (S32 i = 0; i < (S32)sizeof(data); ++i)
+		{
+			data[i] = (U8)i;
+		}
+		ensure("start", LLPacketCapture::start(mFilename));
+		ensure("capturing", LLPacketCapture::isCapturing());
+		LLPacketCapture::recordCircuit(sim, TRUE);
+		LLPacketCapture::recordPacket(sim, data, sizeof(data));
+		LLPacketCapture::recordPacket(sim, data, 10);
+		LLPacketCapture::stop();
+		ensure("stopped", !LLPacketCapture::isCapturing());
+
+		LLPacketCaptureReader reader;
+		LLPacketCaptureRecord record;
+		ensure("open", reader.open(mFilename));
+		ensure("circuit", reader.next(record));
+		ensure_equals("circuit type", (S32)record.mType, (S32)LLPacketCaptureRecord::RECORD_CIRCUIT);
+		ensure("circuit trusted", record.mTrusted);
+		ensure("circuit host", record.mHost == sim);
+		ensure("packet", reader.next(record));
+		ensure_equals("packet type", (S32)record.mType, (S32)LLPacketCaptureRecord::RECORD_PACKET);
+		ensure("packet host", record.mHost == sim);
+		ensure_equals("packet size", (S32)record.mData.size(), (S32)sizeof(data));
+		ensure("packet data", !memcmp(&record.mData[0], data, sizeof(data)));
+		U64 first_time = record.mTime;
+		ensure("second packet", reader.next(record));
+		ensure_equals("second packet size", (S32)record.mData.size(), 10);
+		ensure("time order", record.mTime >= first_time);
+		ensure("end", !reader.next(record));
+	}
+
+	template<> template<>
+	void packetcapture_object::test<2>()
+	{
+		// Something that isn't a capture is refused.
+		LLFILE* file = LLFile::fopen(mFilename, "wb");
+		ensure("create", file != NULL);
+		fputs("not a capture", file);
+		LLFile::close(file);
+		LLPacketCaptureReader reader;
+		ensure("refused", !reader.open(mFilename));
+	}
+
+	template<> template<>
+	void packetcapture_object::test<3>()
+	{
+		// A replay reaches the handlers, but doesn't ack, count or suppress
+		// the recorded packets on the live circuit.
+		start_messaging_system("notafile", 13035, 1, 0, 0, FALSE, "notasharedsecret", NULL, false, 5.f, 100.f);
+		ensure("message system", gMessageSystem != NULL);
+
+		LLMessageTemplate* test_template = new LLMessageTemplate(_PREHASH_TestMessage, 1, MFT_HIGH);
+		LLMessageBlock* block = new LLMessageBlock(_PREHASH_Test0, MBT_SINGLE);
+		block->addVariable(const_cast<char*>(_PREHASH_Test0), MVT_U32, 4);
+		test_template->addBlock(block);
+		gMessageSystem->mMessageTemplates[_PREHASH_TestMessage] = test_template;
+		gMessageSystem->mMessageNumbers[1] = test_template;		// deleted with the message system
+		gMessageSystem->setHandlerFuncFast(_PREHASH_TestMessage, process_test_message);
+
+		LLHost sim(ip_string_to_u32("10.1.2.3"), 13005);
+		gMessageSystem->enableCircuit(sim, TRUE);
+
+		LLTemplateMessageBuilder::message_template_name_map_t templates;
+		templates[_PREHASH_TestMessage] = test_template;
+		U8 packet[MAX_BUFFER_SIZE];
+		ensure("start", LLPacketCapture::start(mFilename));
+		LLPacketCapture::recordCircuit(sim, TRUE);
+		LLPacketCapture::recordPacket(sim, packet, build_packet(templates, 5, 42, packet));
+		// The same packet id again, as a second replay of a capture would deliver it.
+		LLPacketCapture::recordPacket(sim, packet, build_packet(templates, 5, 43, packet));
+		LLPacketCapture::recordPacket(sim, packet, build_packet(templates, 6, 44, packet));
+		LLPacketCapture::stop();
+
+		sHandled = 0;
+		LLPacketReplay replay(gMessageSystem);
+		ensure("open", replay.open(mFilename));
+		replay.setHost(sim);
+		while (replay.pump())
+		{
+		}
+
+		ensure_equals("packets", replay.getPacketsReplayed(), 3);
+		ensure_equals("handled", replay.getMessagesHandled(), 3);
+		ensure_equals("handler calls", sHandled, 3);
+		ensure_equals("last value", sLastValue, (U32)44);
+
+		LLCircuitData* cdp = gMessageSystem->mCircuitInfo.findCircuit(sim);
+		ensure("circuit", cdp != NULL);
+		ensure("nothing to ack", gMessageSystem->mCircuitInfo.mSendAckMap.empty());
+		ensure_equals("packets in", cdp->getPacketsIn(), (U32)0);
+		ensure_equals("bytes in", cdp->getBytesIn(), 0);
+		ensure_equals("lost", cdp->getPacketsLost(), (U32)0);
+	}
+}
@@ -0,0 +1,208 @@
+/**
+ * @file llpacketreceivethread_test.cpp
+ * @brief LLPacketBufferRing test cases.
+ *
+ * $LicenseInfo:firstyear=2010&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+
+#include "linden_common.h"
+
+#include "../llpacketreceivethread.h"
+
+#include "lltimer.h"
+
+#include "../test/lltut.h"
+
+namespace
+{
+	// Packet number index: its size varies and it starts with the number.
+	S32 packet_size(U32 index)
+	{
+		return 8 + (index * 97) % 1200;
+	}
+
+	void write_packet(LLPacketBufferRing& ring, U32 slot, U32 index)
+	{
+		LLPacketBuffer& packet = ring.getWriteSlot(slot).mPacket;
+		memset(packet.getBuffer(), index & 0xff, packet_size(index));
+		memcpy(packet.getBuffer(), &index, sizeof(index));	/* Flawfinder: ignore */
+		packet.set(packet_size(index), LLHost(index, 13000), LLHost());
+	}
+
+	bool is_packet(const LLPacketBufferRing& ring, U32 index)
+	{
+		const LLPacketBuffer& packet = ring.front().mPacket;
+		U32 number;
+		memcpy(&number, packet.getData(), sizeof(number));	/* Flawfinder: ignore */
+		return number == index &&
+			   packet.getSize() == packet_size(index) &&
+			   (U8)packet.getData()[packet.getSize() - 1] == (index & 0xff) &&
+			   packet.getHost() == LLHost(index, 13000);
+	}
+
+	const U32 THREADED_PACKETS = 20000;
+
+	class Producer : public LLThread
+	{
+	public:
+		Producer(LLPacketBufferRing& ring) : LLThread("Ring producer"), mRing(ring) { }
+
+		/*virtual*/ void run()
+		{
+			U32 index = 0;
+			while (index < THREADED_PACKETS)
+			{
+				// Publish in batches of up to 7, like the receive thread does with whatever one receive call got.
+				U32 count = llmin(llmin(mRing.getFree(), (U32)7), THREADED_PACKETS - index);
+				if (!count)
+				{
+					ms_sleep(1);
+					continue;
+				}
+				for (U32 i = 0; i < count; ++i)
+				{
+					write_packet(mRing, i, index + i);
+				}
+				mRing.publish(count);
+				index += count;
+			}
+		}
+
+		LLPacketBufferRing& mRing;
+	};
+
+	class Consumer : public LLThread
+	{
+	public:
+		Consumer(LLPacketBufferRing& ring) : LLThread("Ring consumer"), mRing(ring), mReceived(0), mErrors(0) { }
+
+		/*virtual*/ void run()
+		{
+			while (mReceived < THREADED_PACKETS)
+			{
+				if (mRing.empty())
+				{
+					ms_sleep(1);
+					continue;
+				}
+				if (!is_packet(mRing, mReceived))
+				{
+					++mErrors;
+				}
+				mRing.pop();
+				++mReceived;
+			}
+		}
+
+		LLPacketBufferRing& mRing;
+		U32 mReceived;
+		U32 mErrors;
+	};
+}
+
+namespace tut
+{
+	struct ring_data
+	{
+	};
+
+	typedef test_group<ring_data> ring_test;
+	typedef ring_test::object ring_object;
+	tut::ring_test tut_ring("LLPacketBufferRing");
+
+	template<> template<>
+	void ring_object::test<1>()
+	{
+		// The indices wrap around the slots many times over.
+		LLPacketBufferRing ring(4);
+		ensure("starts empty", ring.empty());
+		ensure_equals("all free", ring.getFree(), 4U);
+		U32 written = 0, read = 0;
+		for (S32 round = 0; round < 20; ++round)
+		{
+			U32 count = 1 + round % 3;
+			for (U32 i = 0; i < count; ++i)
+			{
+				write_packet(ring, i, written + i);
+			}
+			ensure("not published yet", ring.empty() == (written == read));
+			ring.publish(count);
+			written += count;
+			ensure_equals("free", ring.getFree(), 4 - (written - read));
+			while (written - read > 1)
+			{
+				ensure(llformat("packet %d", read), is_packet(ring, read));
+				ring.pop();
+				++read;
+			}
+		}
+		ring.pop();
+		ensure("empty again", ring.empty());
+	}
+
+	template<> template<>
+	void ring_object::test<2>()
+	{
+		// A full ring takes nothing until the consumer frees a slot, and never overwrites unread packets.
+		LLPacketBufferRing ring(4);
+		for (U32 i = 0; i < 4; ++i)
+		{
+			write_packet(ring, i, i);
+		}
+		ring.publish(4);
+		ensure_equals("full", ring.getFree(), 0U);
+		ensure("oldest first", is_packet(ring, 0));
+
+		ring.pop();
+		ensure_equals("one free", ring.getFree(), 1U);
+		write_packet(ring, 0, 4);
+		ring.publish(1);
+		ensure_equals("full again", ring.getFree(), 0U);
+		for (U32 i = 1; i <= 4; ++i)
+		{
+			ensure(llformat("packet %d", i), is_packet(ring, i));
+			ring.pop();
+		}
+		ensure("empty", ring.empty());
+	}
+
+	template<> template<>
+	void ring_object::test<3>()
+	{
+		// A producer and a consumer thread; the ring is far smaller than what goes through it.
+		LLPacketBufferRing ring(16);
+		Producer producer(ring);
+		Consumer consumer(ring);
+		consumer.start();
+		producer.start();
+		for (S32 waited = 0; waited < 60000 && !(producer.isStopped() && consumer.isStopped()); ++waited)
+		{
+			ms_sleep(1);
+		}
+		ensure("producer done", producer.isStopped());
+		ensure("consumer done", consumer.isStopped());
+		ensure_equals("received", consumer.mReceived, THREADED_PACKETS);
+		ensure_equals("errors", consumer.mErrors, 0U);
+		ensure("empty", ring.empty());
+	}
+}
@@ -0,0 +1,174 @@
+/**
+ * @file net_test.cpp
+ * @brief Batched UDP send and receive over loopback
+ *
+ * $LicenseInfo:firstyear=2007&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include <vector>
+
+#include "linden_common.h"
+
+#include "../net.h"
+#include "../llhost.h"
+
+#include "lltimer.h"
+
+#include "../test/lltut.h"
+
+namespace tut
+{
+	// A burst of datagrams of the sizes seen during an object update flood,
+	// each one tagged with its index, sent over loopback.
+	struct net_data
+	{
+		net_data() : mSender(-1), mReceiver(-1), mSenderPort(NET_USE_OS_ASSIGNED_PORT), mReceiverPort(NET_USE_OS_ASSIGNED_PORT)
+		{
+			start_net(mSender, mSenderPort);
+			start_net(mReceiver, mReceiverPort);
+			mLoopback = LLHost(ip_string_to_u32(LOOPBACK_ADDRESS_STRING), mReceiverPort);
+		}
+		~net_data()
+		{
+			end_net(mSender);
+			end_net(mReceiver);
+		}
+
+		static S32 packetSize(S32 index)
+		{
+			return 40 + (index * 97) % (MTUBYTES - 40);
+		}
+
+		void fill(char* buffer, S32 index)
+		{
+			memset(buffer, index & 0xff, packetSize(index));
+			memcpy(buffer, &index, sizeof(index));
+		}
+
+		// Receives until count datagrams arrived or a second passed, checking each one.
+		S32 drain(S32 first, S32 count, bool batched)
+		{
+			static char data[NET_BATCH_SIZE][NET_BUFFER_SIZE];
+			char* buffers[NET_BATCH_SIZE];
+			S32 sizes[NET_BATCH_SIZE];
+			LLHost senders[NET_BATCH_SIZE];
+			LLHost receiving_ifs[NET_BATCH_SIZE];
+			for (S32 i = 0; i < NET_BATCH_SIZE; ++i)
+			{
+				buffers[i] = data[i];
+			}
+
+			S32 received = 0;
+			LLTimer timeout;
+			while (received < count && timeout.getElapsedTimeF32() < 1.f)
+			{
+				S32 n;
+				if (batched)
+				{
+					n = receive_packets(mReceiver, buffers, sizes, senders, receiving_ifs, NET_BATCH_SIZE);
+				}
+				else
+				{
+					sizes[0] = receive_packet(mReceiver, buffers[0]);
+					senders[0] = get_sender();
+					n = sizes[0] > 0 ? 1 : 0;
+				}
+				for (S32 i = 0; i < n; ++i, ++received)
+				{
+					S32 index;
+					memcpy(&index, buffers[i], sizeof(index));
+					ensure_equals("datagram order", index, first + received);
+					ensure_equals("datagram size", sizes[i], packetSize(index));
+					ensure_equals("sender port", (S32)senders[i].getPort(), (S32)mSenderPort);
+				}
+			}
+			return received;
+		}
+
+		// Sends total datagrams in bursts of burst and returns how many came back, in order.
+		S32 replay(S32 total, S32 burst, bool batched)
+		{
+			std::vector<std::vector<char> > data(burst, std::vector<char>(NET_BUFFER_SIZE));
+			std::vector<const char*> buffers(burst);
+			std::vector<S32> sizes(burst);
+			std::vector<LLHost> recipients(burst, mLoopback);
+
+			S32 received = 0;
+			for (S32 first = 0; first < total; first += burst)
+			{
+				S32 count = llmin(burst, total - first);
+				for (S32 i = 0; i < count; ++i)
+				{
+					fill(&data[i][0], first + i);
+					buffers[i] = &data[i][0];
+					sizes[i] = packetSize(first + i);
+				}
+				if (batched)
+				{
+					ensure_equals("all sent", send_packets(mSender, &buffers[0], &sizes[0], &recipients[0], count), count);
+				}
+				else
+				{
+					for (S32 i = 0; i < count; ++i)
+					{
+						ensure("sent", send_packet(mSender, buffers[i], sizes[i], mLoopback.getAddress(), mLoopback.getPort()));
+					}
+				}
+				received += drain(first, count, batched);
+			}
+			return received;
+		}
+
+		S32 mSender;
+		S32 mReceiver;
+		int mSenderPort;
+		int mReceiverPort;
+		LLHost mLoopback;
+	};
+	typedef test_group<net_data> net_test;
+	typedef net_test::object net_object;
+	tut::net_test net_testcase("net");
+
+	template<> template<>
+	void net_object::test<1>()
+	{
+		ensure("sockets", mSender >= 0 && mReceiver >= 0);
+		// More than one batch in a single call.
+		ensure_equals("batched round trip", replay(3 * NET_BATCH_SIZE + 5, 3 * NET_BATCH_SIZE + 5, true), 3 * NET_BATCH_SIZE + 5);
+	}
+
+	template<> template<>
+	void net_object::test<2>()
+	{
+		// Replay the same stream both ways and report the rates; bursts stay well below the socket buffers.
+		S32 const total = 20000;
+		S32 const burst = 64;
+		LLTimer timer;
+		ensure_equals("single round trip", replay(total, burst, false), total);
+		F32 single = timer.getElapsedTimeF32();
+		timer.reset();
+		ensure_equals("batched round trip", replay(total, burst, true), total);
+		F32 batched = timer.getElapsedTimeF32();
+		llinfos << total << " datagrams over loopback: " << total / llmax(single, 0.001f) << " per second one at a time, "
+				<< total / llmax(batched, 0.001f) << " per second batched." << llendl;
+	}
+}
@@ -358,15 +358,24 @@ void* LLPluginMessage::getValuePointer(const std::string &key) const
 /**
  *	Flatten the message into a string.
  *
+ * @param[in] binary Generate binary LLSD instead of XML.
+ *
  * @return Message as a string.
  */
-std::string LLPluginMessage::generate(void) const
+std::string LLPluginMessage::generate(bool binary) const
 {
 	std::ostringstream result;
 	
-	// Pretty XML may be slightly easier to deal with while debugging...
-//	LLSDSerialize::toXML(mMessage, result);
-	LLSDSerialize::toPrettyXML(mMessage, result);
+	if(binary)
+	{
+		LLSDSerialize::toBinary(mMessage, result);
+	}
+	else
+	{
+		// Pretty XML may be slightly easier to deal with while debugging...
+//		LLSDSerialize::toXML(mMessage, result);
+		LLSDSerialize::toPrettyXML(mMessage, result);
+	}
 	
 	return result.str();
 }
@@ -383,7 +392,16 @@ int LLPluginMessage::parse(const std::string &message)
 
 	std::istringstream input(message);
 	
-	S32 parse_result = LLSDSerialize::fromXML(mMessage, input);
+	S32 parse_result;
+	if(!message.empty() && message[0] == '{')
+	{
+		// A binary LLSD map; XML always starts with '<'.
+		parse_result = LLSDSerialize::fromBinary(mMessage, input, (S32)message.size());
+	}
+	else
+	{
+		parse_result = LLSDSerialize::fromXML(mMessage, input);
+	}
 	
 	return (int)parse_result;
 }
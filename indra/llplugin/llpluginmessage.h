@@ -85,11 +85,14 @@ public:
 	// get the value of a key as a pointer.
 	void* getValuePointer(const std::string &key) const;
 
-	// Flatten the message into a string
-	std::string generate(void) const;
+	// Flatten the message into a string, as XML or as binary LLSD.
+	// Binary messages contain nul characters: they can only be sent over a pipe that uses binary framing,
+	// and not to a plugin DSO (which receives C strings).
+	std::string generate(bool binary = false) const;
 
 	// Parse an incoming message into component parts
 	// (this clears out all existing state before starting the parse)
+	// Both formats that generate() produces are accepted.
 	// Returns -1 on failure, otherwise returns the number of key/value pairs in the message.
 	int parse(const std::string &message);
 
@@ -34,6 +34,7 @@
 #include "llapr.h"
 
 static const char MESSAGE_DELIMITER = '\0';
+static const size_t FRAME_HEADER_SIZE = 4;			// Big endian size of the message, when using binary framing.
 
 LLPluginMessagePipeOwner::LLPluginMessagePipeOwner() :
 	mMessagePipe(NULL),
@@ -102,6 +103,7 @@ void LLPluginMessagePipeOwner::killMessagePipe(void)
 }
 
 LLPluginMessagePipe::LLPluginMessagePipe(LLPluginMessagePipeOwner *owner, LLSocket::ptr_t socket):
+	mBinaryFraming(false),
 	mOwner(owner),
 	mSocket(socket)
 {
@@ -122,12 +124,29 @@ bool LLPluginMessagePipe::addMessage(const std::string &message)
 	// queue the message for later output
 	//LLMutexLock lock(&mOutputMutex);
 	mOutputMutex.lock();
-	mOutput += message;
-	mOutput += MESSAGE_DELIMITER;	// message separator
+	if(mBinaryFraming)
+	{
+		U32 size = (U32)message.size();
+		char header[FRAME_HEADER_SIZE] = { (char)(size >> 24), (char)(size >> 16), (char)(size >> 8), (char)size };
+		mOutput.append(header, FRAME_HEADER_SIZE);
+		mOutput += message;
+	}
+	else
+	{
+		mOutput += message;
+		mOutput += MESSAGE_DELIMITER;	// message separator
+	}
 	mOutputMutex.unlock();
 	return true;
 }
 
+void LLPluginMessagePipe::setBinaryFraming(bool binary_framing)
+{
+	LLMutexLock input_lock(&mInputMutex);
+	LLMutexLock output_lock(&mOutputMutex);
+	mBinaryFraming = binary_framing;
+}
+
 void LLPluginMessagePipe::clearOwner(void)
 {
 	// The owner is done with this pipe.  The next call to process_impl should send any remaining data and exit.
@@ -385,19 +404,18 @@ bool LLPluginMessagePipe::pumpInput(F64 timeout)
 
 void LLPluginMessagePipe::processInput(void)
 {
-	// Look for input delimiter(s) in the input buffer.
-	int delim;
+	// Look for complete message(s) in the input buffer.
+	std::string message;
 	mInputMutex.lock();
-	while((delim = mInput.find(MESSAGE_DELIMITER)) != std::string::npos)
+	while(extractMessage(message))
 	{	
 		// Let the owner process this message
 		if (mOwner)
 		{
-			// Pull the message out of the input buffer before calling receiveMessageRaw.
+			// The message is pulled out of the input buffer before calling receiveMessageRaw.
 			// It's now possible for this function to get called recursively (in the case where the plugin makes a blocking request)
 			// and this guarantees that the messages will get dequeued correctly.
-			std::string message(mInput, 0, delim);
-			mInput.erase(0, delim + 1);
+			// It also means that receiveMessageRaw may switch the framing for the messages that follow.
 			mInputMutex.unlock();
 			mOwner->receiveMessageRaw(message);
 			mInputMutex.lock();
@@ -410,3 +428,32 @@ void LLPluginMessagePipe::processInput(void)
 	mInputMutex.unlock();
 }
 
+bool LLPluginMessagePipe::extractMessage(std::string &message)
+{
+	if(mBinaryFraming)
+	{
+		if(mInput.size() < FRAME_HEADER_SIZE)
+		{
+			return false;
+		}
+		const U8 *header = (const U8 *)mInput.data();
+		size_t size = ((size_t)header[0] << 24) | ((size_t)header[1] << 16) | ((size_t)header[2] << 8) | (size_t)header[3];
+		if(mInput.size() < FRAME_HEADER_SIZE + size)
+		{
+			return false;
+		}
+		message.assign(mInput, FRAME_HEADER_SIZE, size);
+		mInput.erase(0, FRAME_HEADER_SIZE + size);
+	}
+	else
+	{
+		std::string::size_type delim = mInput.find(MESSAGE_DELIMITER);
+		if(delim == std::string::npos)
+		{
+			return false;
+		}
+		message.assign(mInput, 0, delim);
+		mInput.erase(0, delim + 1);
+	}
+	return true;
+}
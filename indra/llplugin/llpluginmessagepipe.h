@@ -79,9 +79,16 @@ public:
 	bool pumpInput(F64 timeout = 0.0f);
 
 	bool flushMessages(void) { return pumpOutput(true); }
+
+	// Switch between nul-delimited messages (the default, which only works for XML)
+	// and messages that are preceded by their size (needed for binary LLSD).
+	// Both sides have to switch at the same point in the message stream.
+	void setBinaryFraming(bool binary_framing);
 		
 protected:	
 	void processInput(void);
+	// Removes the first complete message from mInput. Call with mInputMutex locked.
+	bool extractMessage(std::string &message);
 
 	// used internally by pump()
 	void setSocketTimeout(apr_interval_time_t timeout_usec);
@@ -90,6 +97,7 @@ protected:
 	std::string mInput;
 	LLMutex mOutputMutex;
 	std::string mOutput;
+	bool mBinaryFraming;
 
 	LLPluginMessagePipeOwner *mOwner;
 	LLSocket::ptr_t mSocket;
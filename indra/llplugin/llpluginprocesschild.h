@@ -113,6 +113,7 @@ private:
 	F64		mCPUElapsed;
 	bool	mBlockingRequest;
 	bool	mBlockingResponseReceived;
+	bool	mBinaryMessages;		// The parent asked for binary messages in load_plugin.
 	std::queue<std::string> mMessageQueue;
 	
 	void deliverQueuedMessages();
@@ -45,6 +45,7 @@ LLPluginProcessParentOwner::~LLPluginProcessParentOwner()
 }
 
 bool LLPluginProcessParent::sUseReadThread = false;
+bool LLPluginProcessParent::sUseBinaryMessages = true;
 apr_pollset_t *LLPluginProcessParent::sPollSet = NULL;
 LLAPRPool LLPluginProcessParent::sPollSetPool;
 bool LLPluginProcessParent::sPollsetNeedsRebuild = false;
@@ -99,6 +100,8 @@ LLPluginProcessParent::LLPluginProcessParent(LLPluginProcessParentOwner *owner)
 	mBlocked = false;
 	mPolledInput = false;
 	mReceivedShutdown = false;
+	mPluginOffersBinaryMessages = false;
+	mBinaryMessages = false;
 	mPollFD.client_data = NULL;
 	mPollFDPool.create();
 
@@ -492,10 +495,23 @@ void LLPluginProcessParent::idle(void)
 				
 				// Send the message to load the plugin
 				{
+					bool binary_messages = mPluginOffersBinaryMessages && sUseBinaryMessages;
 					LLPluginMessage message(LLPLUGIN_MESSAGE_CLASS_INTERNAL, "load_plugin");
 					message.setValue("file", mPluginFile);
 					message.setValue("dir", mPluginDir);
+					if(binary_messages)
+					{
+						message.setValueBoolean("binary_messages", true);
+					}
 					sendMessage(message);
+
+					if(binary_messages && mMessagePipe)
+					{
+						// Everything after load_plugin is binary LLSD, in both directions.
+						// The plugin doesn't send anything between hello and load_plugin, so nothing is in flight.
+						mBinaryMessages = true;
+						mMessagePipe->setBinaryFraming(true);
+					}
 				}
 
 				setState(STATE_LOADING);
@@ -629,15 +645,15 @@ void LLPluginProcessParent::sendMessage(const LLPluginMessage &message)
 		mBlocked = true;
 	}
 	
-	std::string buffer = message.generate();
+	std::string buffer = message.generate(mBinaryMessages);
 #if LL_DEBUG
 	if (message.getName() == "mouse_event")
 	{
-		LL_DEBUGS("PluginMouseEvent") << "Sending: " << buffer << LL_ENDL;
+		LL_DEBUGS("PluginMouseEvent") << "Sending: " << message << LL_ENDL;
 	}
 	else
 	{
-		LL_DEBUGS("Plugin") << "Sending: " << buffer << LL_ENDL;
+		LL_DEBUGS("Plugin") << "Sending: " << message << LL_ENDL;
 	}
 #endif
 	writeMessageRaw(buffer);
@@ -917,11 +933,11 @@ void LLPluginProcessParent::servicePoll()
 // It parses the message and passes it on to LLPluginProcessParent::receiveMessage.
 void LLPluginProcessParent::receiveMessageRaw(const std::string &message)
 {
-	LL_DEBUGS("PluginRaw") << "Received: " << message << LL_ENDL;
-	
 	LLPluginMessage parsed;
 	if(parsed.parse(message) != -1)
 	{
+		LL_DEBUGS("PluginRaw") << "Received: " << parsed << LL_ENDL;
+
 		if(parsed.hasValue("blocking_request"))
 		{
 			mBlocked = true;
@@ -993,6 +1009,7 @@ void LLPluginProcessParent::receiveMessage(const LLPluginMessage &message)
 			if(mState == STATE_CONNECTED)
 			{
 				// Plugin host has launched.  Tell it which plugin to load.
+				mPluginOffersBinaryMessages = message.getValueBoolean("binary_messages");
 				setState(STATE_HELLO);
 			}
 			else
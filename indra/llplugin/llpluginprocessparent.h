@@ -125,6 +125,9 @@ public:
 	static bool canPollThreadRun() { return (sPollSet || sPollsetNeedsRebuild || sUseReadThread); };
 	static void setUseReadThread(bool use_read_thread);
 	static bool getUseReadThread() { return sUseReadThread; };
+	// Use binary LLSD messages with plugins that offer them, starting with the next launched plugin.
+	static void setUseBinaryMessages(bool use_binary_messages) { sUseBinaryMessages = use_binary_messages; };
+	static bool getUseBinaryMessages() { return sUseBinaryMessages; };
 private:
 
 	enum EState
@@ -179,6 +182,8 @@ private:
 	bool mBlocked;
 	bool mPolledInput;
 	bool mReceivedShutdown;
+	bool mPluginOffersBinaryMessages;	// The hello message said the plugin can switch to binary messages.
+	bool mBinaryMessages;				// Binary messages were negotiated in load_plugin.
 
 	LLProcessLauncher mDebugger;
 	
@@ -186,6 +191,7 @@ private:
 	F32 mPluginLockupTimeout;		// If we don't receive a heartbeat in this many seconds, we declare the plugin locked up.
 
 	static bool sUseReadThread;
+	static bool sUseBinaryMessages;
 	apr_pollfd_t mPollFD;
 	LLAPRPool mPollFDPool;
 	static apr_pollset_t *sPollSet;
@@ -424,6 +424,7 @@ LLGLManager::LLGLManager() :
 	mHasVertexBufferObject(FALSE),
 	mHasVertexArrayObject(FALSE),
 	mHasMapBufferRange(FALSE),
+	mHasPixelBufferObject(FALSE),
 	mHasFlushBufferRange(FALSE),
 	mHasPBuffer(FALSE),
 	mHasShaderObjects(FALSE),
@@ -938,6 +939,7 @@ void LLGLManager::initExtensions()
 	mHasVertexArrayObject = ExtensionExists("GL_ARB_vertex_array_object", gGLHExts.mSysExts);
 	mHasSync = ExtensionExists("GL_ARB_sync", gGLHExts.mSysExts);
 	mHasMapBufferRange = ExtensionExists("GL_ARB_map_buffer_range", gGLHExts.mSysExts);
+	mHasPixelBufferObject = ExtensionExists("GL_ARB_pixel_buffer_object", gGLHExts.mSysExts);
 	mHasFlushBufferRange = ExtensionExists("GL_APPLE_flush_buffer_range", gGLHExts.mSysExts);
 	mHasDepthClamp = ExtensionExists("GL_ARB_depth_clamp", gGLHExts.mSysExts) || ExtensionExists("GL_NV_depth_clamp", gGLHExts.mSysExts);
 	// mask out FBO support when packed_depth_stencil isn't there 'cause we need it for LLRenderTarget -Brad
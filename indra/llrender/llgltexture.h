@@ -32,6 +32,7 @@
 #include "llgl.h"
 
 class LLImageRaw;
+class LLImageRawView;
 
 //
 //this the parent for the class LLViewerTexture
@@ -105,7 +106,7 @@ public:
 
 	virtual const LLUUID& getID() const = 0;
 
-	void setBoostLevel(S32 level);
+	virtual void setBoostLevel(S32 level);
 	S32  getBoostLevel() { return mBoostLevel; }
 
 	S32 getFullWidth() const { return mFullWidth; }
@@ -124,6 +125,7 @@ public:
 	LLGLuint   getTexName() const ;		
 	BOOL       createGLTexture() ;
 	BOOL       createGLTexture(S32 discard_level, const LLImageRaw* imageraw, S32 usename = 0, BOOL to_create = TRUE, S32 category = LLGLTexture::OTHER);
+	BOOL       createGLTexture(S32 discard_level, const LLImageRawView* view, S32 usename = 0, BOOL to_create = TRUE, S32 category = LLGLTexture::OTHER);
 
 	void       setFilteringOption(LLTexUnit::eTextureFilterOptions option);
 	void       setExplicitFormat(LLGLint internal_format, LLGLenum primary_format, LLGLenum type_format = 0, BOOL swap_bytes = FALSE);
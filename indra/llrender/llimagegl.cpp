@@ -37,6 +37,7 @@
 #include "llmath.h"
 #include "llgl.h"
 #include "llglslshader.h"
+#include "llpixelbufferring.h"
 #include "llrender.h"
 
 //----------------------------------------------------------------------------
@@ -188,6 +189,7 @@ void LLImageGL::initClass(S32 num_catagories)
 //static 
 void LLImageGL::cleanupClass() 
 {	
+	LLPixelBufferRing::cleanupClass();
 	sTextureMemByCategory.clear() ;
 	sTextureMemByCategoryBound.clear() ;
 	sTextureCurMemByCategoryBound.clear() ;
@@ -294,6 +296,7 @@ void LLImageGL::updateStats(F32 current_time)
 	sLastFrameTime = current_time;
 	sBoundTextureMemoryInBytes = sCurBoundTextureMemory;
 	sCurBoundTextureMemory = 0;
+	LLPixelBufferRing::endFrame();
 
 	if(gAuditTexture)
 	{
@@ -328,6 +331,7 @@ S32 LLImageGL::updateBoundTexMem(const S32 mem, const S32 ncomponents, S32 categ
 //static 
 void LLImageGL::destroyGL(BOOL save_state)
 {
+	LLPixelBufferRing::cleanupClass();
 	for (S32 stage = 0; stage < gGLManager.mNumTextureUnits; stage++)
 	{
 		gGL.getTexUnit(stage)->unbind(LLTexUnit::TT_TEXTURE);
@@ -554,6 +558,39 @@ static bool check_power_of_two(S32 dim)
 	return !(dim & (dim - 1)) ;
 }
 
+//bytes GL reads for pixel_count tightly packed pixels (GL_UNPACK_ALIGNMENT is 1),
+//or 0 for formats we don't stage through the upload ring.
+static U32 staged_upload_bytes(U32 pixformat, U32 pixtype, S32 pixel_count)
+{
+	switch (pixtype)
+	{
+	case GL_UNSIGNED_BYTE:
+		break;
+	case GL_UNSIGNED_INT_8_8_8_8:
+	case GL_UNSIGNED_INT_8_8_8_8_REV:
+		return pixel_count * 4;
+	default:
+		return 0;
+	}
+	switch (pixformat)
+	{
+	case GL_ALPHA:
+	case GL_LUMINANCE:
+	case GL_RED:
+		return pixel_count;
+	case GL_LUMINANCE_ALPHA:
+	case GL_RG:
+		return pixel_count * 2;
+	case GL_RGB:
+		return pixel_count * 3;
+	case GL_RGBA:
+	case GL_BGRA:
+		return pixel_count * 4;
+	default:
+		return 0;
+	}
+}
+
 //static
 bool LLImageGL::checkSize(S32 width, S32 height)
 {
@@ -693,8 +730,16 @@ void LLImageGL::setImage(const LLImageRaw* imageraw)
 	setImage(rawdata, FALSE);
 }
 
+void LLImageGL::setImage(const LLImageRawView* view)
+{
+	llassert((view->getWidth() == getWidth(mCurrentDiscardLevel)) &&
+			 (view->getHeight() == getHeight(mCurrentDiscardLevel)) &&
+			 (view->getComponents() == getComponents()));
+	setImage(view->getData(), FALSE, view->isContiguous() ? 0 : view->getParent()->getWidth());
+}
+
 static LLFastTimer::DeclareTimer FTM_SET_IMAGE("setImage");
-void LLImageGL::setImage(const U8* data_in, BOOL data_hasmips)
+void LLImageGL::setImage(const U8* data_in, BOOL data_hasmips, S32 row_length)
 {
 	LLFastTimer t(FTM_SET_IMAGE);
 	bool is_compressed = false;
@@ -702,6 +747,12 @@ void LLImageGL::setImage(const U8* data_in, BOOL data_hasmips)
 	{
 		is_compressed = true;
 	}
+	if (row_length == getWidth(mCurrentDiscardLevel))
+	{
+		row_length = 0;
+	}
+	// Only a single uncompressed level can come from a sub-rectangle.
+	llassert(!row_length || (!data_hasmips && !is_compressed));
 	
 	
 	
@@ -804,11 +855,11 @@ void LLImageGL::setImage(const U8* data_in, BOOL data_hasmips)
 					LLImageGL::setManualImage(mTarget, 0, mFormatInternal,
 								 w, h, 
 								 mFormatPrimary, mFormatType,
-								 data_in, mAllowCompression);
-					analyzeAlpha(data_in, w, h);
+								 data_in, mAllowCompression, row_length);
+					analyzeAlpha(data_in, w, h, row_length);
 					stop_glerror();
 
-					updatePickMask(w, h, data_in);
+					updatePickMask(w, h, data_in, row_length);
 
 					if(mFormatSwapBytes)
 					{
@@ -837,6 +888,19 @@ void LLImageGL::setImage(const U8* data_in, BOOL data_hasmips)
 				S32 cur_mip_size = 0;
 #endif
 				
+				// generateMip() reads packed rows, so pack a sub-rectangle once up front.
+				U8* packed_data = NULL;
+				if (row_length)
+				{
+					S32 row_bytes = width * mComponents;
+					packed_data = new U8[row_bytes * height];
+					for (S32 y = 0; y < height; ++y)
+					{
+						memcpy(packed_data + y * row_bytes, data_in + y * row_length * mComponents, row_bytes);	/* Flawfinder: ignore */
+					}
+					data_in = packed_data;
+				}
+
 				mMipLevels = nummips;
 
 				for (int m=0; m<nummips; m++)
@@ -902,6 +966,7 @@ void LLImageGL::setImage(const U8* data_in, BOOL data_hasmips)
 					delete[] prev_mip_data;
 					prev_mip_data = NULL;
 				}
+				delete[] packed_data;
 			}
 		}
 		else
@@ -929,10 +994,10 @@ void LLImageGL::setImage(const U8* data_in, BOOL data_hasmips)
 			}
 
 			LLImageGL::setManualImage(mTarget, 0, mFormatInternal, w, h,
-						 mFormatPrimary, mFormatType, (GLvoid *)data_in, mAllowCompression);
-			analyzeAlpha(data_in, w, h);
+						 mFormatPrimary, mFormatType, (GLvoid *)data_in, mAllowCompression, row_length);
+			analyzeAlpha(data_in, w, h, row_length);
 			
-			updatePickMask(w, h, data_in);
+			updatePickMask(w, h, data_in, row_length);
 
 			stop_glerror();
 
@@ -1026,8 +1091,15 @@ BOOL LLImageGL::setSubImage(const U8* datap, S32 data_width, S32 data_height, S3
 		if (!res) llerrs << "LLImageGL::setSubImage(): bindTexture failed" << llendl;
 		stop_glerror();
 
+		const void* pixels = datap;
+		U32 bytes = staged_upload_bytes(mFormatPrimary, mFormatType, (height - 1) * data_width + width);
+		if (bytes)
+		{
+			LLPixelBufferRing::stage(pixels, bytes);
+		}
 		glTexSubImage2D(mTarget, 0, x_pos, y_pos, 
-						width, height, mFormatPrimary, mFormatType, datap);
+						width, height, mFormatPrimary, mFormatType, pixels);
+		LLPixelBufferRing::unbind();
 		gGL.getTexUnit(0)->disable();
 		stop_glerror();
 
@@ -1085,10 +1157,15 @@ void LLImageGL::deleteTextures(S32 numTextures, U32 *textures)
 
 // static
 static LLFastTimer::DeclareTimer FTM_SET_MANUAL_IMAGE("setManualImage");
-void LLImageGL::setManualImage(U32 target, S32 miplevel, S32 intformat, S32 width, S32 height, U32 pixformat, U32 pixtype, const void *pixels, bool allow_compression)
+void LLImageGL::setManualImage(U32 target, S32 miplevel, S32 intformat, S32 width, S32 height, U32 pixformat, U32 pixtype, const void *pixels, bool allow_compression, S32 row_length)
 {
 	LLFastTimer t(FTM_SET_MANUAL_IMAGE);
 	std::vector<U32> scratch;
+	const U8* src = (const U8*) pixels;
+	if (row_length == width)
+	{
+		row_length = 0;
+	}
 	if (LLRender::sGLCoreProfile)
 	{
 #ifdef GL_ARB_texture_swizzle
@@ -1129,9 +1206,10 @@ void LLImageGL::setManualImage(U32 target, S32 miplevel, S32 intformat, S32 widt
 				U32 pixel_count = (U32) (width*height);
 				for (U32 i = 0; i < pixel_count; i++)
 				{
+					U32 j = row_length ? (i / width) * row_length + i % width : i;
 					U8* pix = (U8*) &scratch[i];
 					pix[0] = pix[1] = pix[2] = 0;
-					pix[3] = ((U8*) pixels)[i];
+					pix[3] = src[j];
 				}
 
 				pixformat = GL_RGBA;
@@ -1146,8 +1224,9 @@ void LLImageGL::setManualImage(U32 target, S32 miplevel, S32 intformat, S32 widt
 				U32 pixel_count = (U32) (width*height);
 				for (U32 i = 0; i < pixel_count; i++)
 				{
-					U8 lum = ((U8*) pixels)[i*2+0];
-					U8 alpha = ((U8*) pixels)[i*2+1];
+					U32 j = row_length ? (i / width) * row_length + i % width : i;
+					U8 lum = src[j*2+0];
+					U8 alpha = src[j*2+1];
 
 					U8* pix = (U8*) &scratch[i];
 					pix[0] = pix[1] = pix[2] = lum;
@@ -1166,7 +1245,8 @@ void LLImageGL::setManualImage(U32 target, S32 miplevel, S32 intformat, S32 widt
 				U32 pixel_count = (U32) (width*height);
 				for (U32 i = 0; i < pixel_count; i++)
 				{
-					U8 lum = ((U8*) pixels)[i];
+					U32 j = row_length ? (i / width) * row_length + i % width : i;
+					U8 lum = src[j];
 
 					U8* pix = (U8*) &scratch[i];
 					pix[0] = pix[1] = pix[2] = lum;
@@ -1217,7 +1297,26 @@ void LLImageGL::setManualImage(U32 target, S32 miplevel, S32 intformat, S32 widt
 	}
 
 	stop_glerror();
+	if (pixels != src)
+	{
+		// Converted into packed scratch above.
+		row_length = 0;
+	}
+	if (row_length)
+	{
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, row_length);
+	}
+	U32 bytes = pixels ? staged_upload_bytes(pixformat, pixtype, row_length ? (height - 1) * row_length + width : width * height) : 0;
+	if (bytes)
+	{
+		LLPixelBufferRing::stage(pixels, bytes);
+	}
 	glTexImage2D(target, miplevel, intformat, width, height, 0, pixformat, pixtype, pixels);
+	LLPixelBufferRing::unbind();
+	if (row_length)
+	{
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	}
 	stop_glerror();
 }
 
@@ -1258,6 +1357,20 @@ static LLFastTimer::DeclareTimer FTM_CREATE_GL_TEXTURE2("createGLTexture(raw)");
 BOOL LLImageGL::createGLTexture(S32 discard_level, const LLImageRaw* imageraw, S32 usename/*=0*/, BOOL to_create, S32 category)
 {
 	LLFastTimer t(FTM_CREATE_GL_TEXTURE2);
+	return createGLTextureFromRaw(discard_level, imageraw->getWidth(), imageraw->getHeight(), imageraw->getComponents(),
+								  imageraw->getData(), 0, usename, to_create, category);
+}
+
+BOOL LLImageGL::createGLTexture(S32 discard_level, const LLImageRawView* view, S32 usename/*=0*/, BOOL to_create, S32 category)
+{
+	LLFastTimer t(FTM_CREATE_GL_TEXTURE2);
+	return createGLTextureFromRaw(discard_level, view->getWidth(), view->getHeight(), view->getComponents(),
+								  view->getData(), view->isContiguous() ? 0 : view->getParent()->getWidth(), usename, to_create, category);
+}
+
+BOOL LLImageGL::createGLTextureFromRaw(S32 discard_level, S32 raw_w, S32 raw_h, S32 components, const U8* rawdata, S32 row_length,
+									   S32 usename, BOOL to_create, S32 category)
+{
 	if (gGLManager.mIsDisabled)
 	{
 		llwarns << "Trying to create a texture while GL is disabled!" << llendl;
@@ -1275,13 +1388,11 @@ BOOL LLImageGL::createGLTexture(S32 discard_level, const LLImageRaw* imageraw, S
 	}
 	
 	// Actual image width/height = raw image width/height * 2^discard_level
-	S32 raw_w = imageraw->getWidth() ;
-	S32 raw_h = imageraw->getHeight() ;
 	S32 w = raw_w << discard_level;
 	S32 h = raw_h << discard_level;
 
 	// setSize may call destroyGLTexture if the size does not match
-	setSize(w, h, imageraw->getComponents(), discard_level);
+	setSize(w, h, components, discard_level);
 
 	if( !mHasExplicitFormat )
 	{
@@ -1327,12 +1438,11 @@ BOOL LLImageGL::createGLTexture(S32 discard_level, const LLImageRaw* imageraw, S
 	}
 
 	setCategory(category);
- 	const U8* rawdata = imageraw->getData();
-	return createGLTexture(discard_level, rawdata, FALSE, usename);
+	return createGLTexture(discard_level, rawdata, FALSE, usename, row_length);
 }
 
 static LLFastTimer::DeclareTimer FTM_CREATE_GL_TEXTURE3("createGLTexture3(data)");
-BOOL LLImageGL::createGLTexture(S32 discard_level, const U8* data_in, BOOL data_hasmips, S32 usename)
+BOOL LLImageGL::createGLTexture(S32 discard_level, const U8* data_in, BOOL data_hasmips, S32 usename, S32 row_length)
 {
 	LLFastTimer t(FTM_CREATE_GL_TEXTURE3);
 	llassert(data_in);
@@ -1348,7 +1458,7 @@ BOOL LLImageGL::createGLTexture(S32 discard_level, const U8* data_in, BOOL data_
 	if (mTexName != 0 && discard_level == mCurrentDiscardLevel)
 	{
 		// This will only be true if the size has not changed
-		setImage(data_in, data_hasmips);
+		setImage(data_in, data_hasmips, row_length);
 		return TRUE;
 	}
 	
@@ -1391,7 +1501,7 @@ BOOL LLImageGL::createGLTexture(S32 discard_level, const U8* data_in, BOOL data_
 
 	mCurrentDiscardLevel = discard_level;	
 
-	setImage(data_in, data_hasmips);
+	setImage(data_in, data_hasmips, row_length);
 
 	// Set texture options to our defaults.
 	gGL.getTexUnit(0)->setHasMipMaps(mHasMipMaps);
@@ -1795,7 +1905,7 @@ void LLImageGL::calcAlphaChannelOffsetAndStride()
 }
 
 //std::map<LLGLuint, std::list<std::pair<std::string,std::string> > > sTextureMaskMap;
-void LLImageGL::analyzeAlpha(const void* data_in, U32 w, U32 h)
+void LLImageGL::analyzeAlpha(const void* data_in, U32 w, U32 h, U32 row_length)
 {
 	if(!mNeedsAlphaAndPickMask)
 	{
@@ -1806,6 +1916,7 @@ void LLImageGL::analyzeAlpha(const void* data_in, U32 w, U32 h)
 
 	U32 length = w * h;
 	U32 alphatotal = 0;
+	U32 row = row_length ? row_length : w;
 	
 	U32 sample[16];
 	memset(sample, 0, sizeof(U32)*16);
@@ -1827,12 +1938,12 @@ void LLImageGL::analyzeAlpha(const void* data_in, U32 w, U32 h)
 			{
 				const U32 s1 = current[0];
 				alphatotal += s1;
-				const U32 s2 = current[w * mAlphaStride];
+				const U32 s2 = current[row * mAlphaStride];
 				alphatotal += s2;
 				current += mAlphaStride;
 				const U32 s3 = current[0];
 				alphatotal += s3;
-				const U32 s4 = current[w * mAlphaStride];
+				const U32 s4 = current[row * mAlphaStride];
 				alphatotal += s4;
 				current += mAlphaStride;
 
@@ -1854,20 +1965,22 @@ void LLImageGL::analyzeAlpha(const void* data_in, U32 w, U32 h)
 			}
 			
 			
-			rowstart += 2 * w * mAlphaStride;
+			rowstart += 2 * row * mAlphaStride;
 		}
 
 		length *= 2; // we sampled everything twice, essentially
 	}
 	else
 	{
+		// a single row or a single column; a column steps a whole source row per pixel.
+		const U32 step = (w == 1 ? row : 1) * mAlphaStride;
 		const GLubyte* current = ((const GLubyte*) data_in) + mAlphaOffset;
 		for (U32 i = 0; i < length; i++)
 		{
 			const U32 s1 = *current;
 			alphatotal += s1;
 			++sample[s1/16];
-			current += mAlphaStride;
+			current += step;
 
 			if(i%2==0)
 			{
@@ -1931,7 +2044,7 @@ void LLImageGL::analyzeAlpha(const void* data_in, U32 w, U32 h)
 }
 
 //----------------------------------------------------------------------------
-void LLImageGL::updatePickMask(S32 width, S32 height, const U8* data_in)
+void LLImageGL::updatePickMask(S32 width, S32 height, const U8* data_in, S32 row_length)
 {
 	if(!mNeedsAlphaAndPickMask)
 	{
@@ -1961,12 +2074,13 @@ void LLImageGL::updatePickMask(S32 width, S32 height, const U8* data_in)
 	memset(mPickMask, 0, sizeof(U8) * size);
 
 	U32 pick_bit = 0;
+	S32 row = row_length ? row_length : width;
 	
 	for (S32 y = 0; y < height; y += 2)
 	{
 		for (S32 x = 0; x < width; x += 2)
 		{
-			U8 alpha = data_in[(y*width+x)*4+3];
+			U8 alpha = data_in[(y*row+x)*4+3];
 
 			if (alpha > 32)
 			{
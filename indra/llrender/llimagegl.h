@@ -87,7 +87,8 @@ public:
 protected:
 	virtual ~LLImageGL();
 
-	void analyzeAlpha(const void* data_in, U32 w, U32 h);
+	// row_length is the source row in pixels when it is longer than w (a sub-rectangle); 0 means w.
+	void analyzeAlpha(const void* data_in, U32 w, U32 h, U32 row_length = 0);
 	void calcAlphaChannelOffsetAndStride();
 
 public:
@@ -97,14 +98,19 @@ public:
 	void setComponents(S32 ncomponents) { mComponents = (S8)ncomponents ;}
 	void setAllowCompression(bool allow) { mAllowCompression = allow; }
 
-	static void setManualImage(U32 target, S32 miplevel, S32 intformat, S32 width, S32 height, U32 pixformat, U32 pixtype, const void *pixels, bool allow_compression = true);
+	// row_length as for GL_UNPACK_ROW_LENGTH: pixels from one source row to the next, 0 for tightly packed.
+	static void setManualImage(U32 target, S32 miplevel, S32 intformat, S32 width, S32 height, U32 pixformat, U32 pixtype, const void *pixels, bool allow_compression = true, S32 row_length = 0);
 
 	BOOL createGLTexture() ;
 	BOOL createGLTexture(S32 discard_level, const LLImageRaw* imageraw, S32 usename = 0, BOOL to_create = TRUE,
 		S32 category = sMaxCategories-1);
-	BOOL createGLTexture(S32 discard_level, const U8* data, BOOL data_hasmips = FALSE, S32 usename = 0);
+	// Uploads straight from the view's parent, without packing a sub-rectangle first.
+	BOOL createGLTexture(S32 discard_level, const LLImageRawView* view, S32 usename = 0, BOOL to_create = TRUE,
+		S32 category = sMaxCategories-1);
+	BOOL createGLTexture(S32 discard_level, const U8* data, BOOL data_hasmips = FALSE, S32 usename = 0, S32 row_length = 0);
 	void setImage(const LLImageRaw* imageraw);
-	void setImage(const U8* data_in, BOOL data_hasmips = FALSE);
+	void setImage(const LLImageRawView* view);
+	void setImage(const U8* data_in, BOOL data_hasmips = FALSE, S32 row_length = 0);
 	BOOL setSubImage(const LLImageRaw* imageraw, S32 x_pos, S32 y_pos, S32 width, S32 height, BOOL force_fast_update = FALSE);
 	BOOL setSubImage(const U8* datap, S32 data_width, S32 data_height, S32 x_pos, S32 y_pos, S32 width, S32 height, BOOL force_fast_update = FALSE);
 	BOOL setSubImageFromFrameBuffer(S32 fb_x, S32 fb_y, S32 x_pos, S32 y_pos, S32 width, S32 height);
@@ -148,7 +154,7 @@ public:
 	BOOL getUseMipMaps() const { return mUseMipMaps; }
 	void setUseMipMaps(BOOL usemips) { mUseMipMaps = usemips; }	
 
-	void updatePickMask(S32 width, S32 height, const U8* data_in);
+	void updatePickMask(S32 width, S32 height, const U8* data_in, S32 row_length = 0);
 	BOOL getMask(const LLVector2 &tc);
 
 	void checkTexSize(bool forced = false) const ;
@@ -174,8 +180,13 @@ public:
 	// Various GL/Rendering options
 	S32 mTextureMemory;
 	mutable F32  mLastBindTime;	// last time this was bound, by discard level
-	
+
 private:
+	// Shared by the raw image and view overloads of createGLTexture.
+	BOOL createGLTextureFromRaw(S32 discard_level, S32 raw_w, S32 raw_h, S32 components, const U8* rawdata, S32 row_length,
+		S32 usename, BOOL to_create, S32 category);
+
+
 	LLPointer<LLImageRaw> mSaveData; // used for destroyGL/restoreGL
 	S32	mSaveDiscardLevel;
 	U8* mPickMask;  //downsampled bitmap approximation of alpha channel.  NULL if no alpha channel
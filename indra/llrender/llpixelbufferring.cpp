@@ -0,0 +1,204 @@
+/**
+ * @file llpixelbufferring.cpp
+ * @brief Pixel buffer object ring for asynchronous texture uploads
+ *
+ * $LicenseInfo:firstyear=2003&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llpixelbufferring.h"
+#include "llglheaders.h"
+
+LLPixelBufferRing* LLPixelBufferRing::sInstance = NULL;
+U32 LLPixelBufferRing::sSize = 0;
+bool LLPixelBufferRing::sBound = false;
+LLPixelBufferRing::Stats LLPixelBufferRing::sFrameStats;
+LLPixelBufferRing::Stats LLPixelBufferRing::sLastFrameStats;
+
+// Keep every staged upload 16 byte aligned, some drivers take a slow path otherwise.
+static const U32 STAGE_ALIGNMENT = 16;
+
+LLPixelBufferRing::LLPixelBufferRing(U32 size)
+:	mBuffer(0),
+	mSize(size),
+	mSegmentSize(size / NUM_SEGMENTS & ~(STAGE_ALIGNMENT - 1)),
+	mSegment(0),
+	mOffset(0)
+{
+#if defined(GL_ARB_pixel_buffer_object) && defined(GL_ARB_map_buffer_range)
+	glGenBuffersARB(1, &mBuffer);
+	glBindBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, mBuffer);
+	glBufferDataARB(GL_PIXEL_UNPACK_BUFFER_ARB, mSize, NULL, GL_STREAM_DRAW_ARB);
+	glBindBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, 0);
+	stop_glerror();
+#endif
+}
+
+LLPixelBufferRing::~LLPixelBufferRing()
+{
+#if defined(GL_ARB_pixel_buffer_object)
+	if (mBuffer)
+	{
+		glDeleteBuffersARB(1, &mBuffer);
+	}
+#endif
+}
+
+//static
+void LLPixelBufferRing::setSize(U32 bytes)
+{
+	if (bytes != sSize)
+	{
+		cleanupClass();
+		sSize = bytes;
+		if (sSize)
+		{
+			llinfos << "Texture upload ring: " << sSize / (1024 * 1024) << " MB" << llendl;
+		}
+	}
+}
+
+//static
+void LLPixelBufferRing::cleanupClass()
+{
+	// The ring is created again on the next upload, e.g. after the GL context was recreated.
+	delete sInstance;
+	sInstance = NULL;
+	sBound = false;
+}
+
+//static
+bool LLPixelBufferRing::stage(const void*& pixels, U32 bytes)
+{
+	if (!sSize || !pixels)
+	{
+		return false;
+	}
+	if (!sInstance)
+	{
+		if (!gGLManager.mHasPixelBufferObject || !gGLManager.mHasMapBufferRange || !gGLManager.mHasSync)
+		{
+			llinfos << "Texture upload ring needs pixel buffer objects, map buffer range and sync, disabled." << llendl;
+			sSize = 0;
+			return false;
+		}
+		sInstance = new LLPixelBufferRing(sSize);
+	}
+	bool staged = sInstance->copyIn(pixels, bytes);
+	if (staged)
+	{
+		++sFrameStats.mUploads;
+		sFrameStats.mUploadBytes += bytes;
+	}
+	else
+	{
+		++sFrameStats.mDirect;
+	}
+	return staged;
+}
+
+//static
+void LLPixelBufferRing::unbind()
+{
+	if (sBound)
+	{
+#if defined(GL_ARB_pixel_buffer_object)
+		glBindBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, 0);
+#endif
+		sBound = false;
+	}
+}
+
+//static
+void LLPixelBufferRing::endFrame()
+{
+	if (sInstance && sInstance->mOffset)
+	{
+		// Fence this frame's uploads now, so their segment can be reused as soon as the GPU is done with it.
+		sInstance->advance();
+	}
+	sLastFrameStats = sFrameStats;
+	sFrameStats = Stats();
+}
+
+//static
+LLPixelBufferRing::Stats LLPixelBufferRing::getStats()
+{
+	Stats stats = sLastFrameStats;
+	stats.mSize = sInstance ? sSize : 0;
+	return stats;
+}
+
+bool LLPixelBufferRing::copyIn(const void*& pixels, U32 bytes)
+{
+#if defined(GL_ARB_pixel_buffer_object) && defined(GL_ARB_map_buffer_range)
+	if (bytes > mSegmentSize)
+	{
+		return false;
+	}
+	if (mOffset + bytes > mSegmentSize && !advance())
+	{
+		return false;
+	}
+
+	U32 start = mSegment * mSegmentSize + mOffset;
+	glBindBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, mBuffer);
+	sBound = true;
+	// Unsynchronized: the fences already guarantee the GPU is done with this segment.
+	void* dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER_ARB, start, bytes,
+								 GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	if (!dst)
+	{
+		unbind();
+		return false;
+	}
+	memcpy(dst, pixels, bytes);		/* Flawfinder: ignore */
+	if (!glUnmapBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB))
+	{
+		// Buffer contents got lost (e.g. a mode switch), do this one from client memory.
+		unbind();
+		return false;
+	}
+	stop_glerror();
+
+	mOffset += (bytes + STAGE_ALIGNMENT - 1) & ~(STAGE_ALIGNMENT - 1);
+	pixels = (const U8*) (size_t) start;
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool LLPixelBufferRing::advance()
+{
+	S32 next = (mSegment + 1) % NUM_SEGMENTS;
+	if (!mFences[next].isCompleted())
+	{
+		// The GPU is still reading the next segment. Don't wait for it, that is the stall we are avoiding.
+		return false;
+	}
+	mFences[mSegment].placeFence();
+	mSegment = next;
+	mOffset = 0;
+	return true;
+}
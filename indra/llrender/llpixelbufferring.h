@@ -0,0 +1,91 @@
+/**
+ * @file llpixelbufferring.h
+ * @brief Pixel buffer object ring for asynchronous texture uploads
+ *
+ * $LicenseInfo:firstyear=2003&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLPIXELBUFFERRING_H
+#define LL_LLPIXELBUFFERRING_H
+
+#include "llgl.h"
+
+// One GL_PIXEL_UNPACK_BUFFER split into segments that are used round robin.
+// Texture uploads copy their pixels into the current segment and hand GL an
+// offset instead of a client pointer, so glTexImage2D returns without waiting
+// for the driver to copy the pixels. A segment gets a fence when it is left
+// and is only reused once the GPU is past that fence; while the next segment
+// is still busy, uploads go straight from client memory as before.
+//
+// Main (GL) thread only.
+class LLPixelBufferRing
+{
+public:
+	enum { NUM_SEGMENTS = 4 };
+
+	// Creates the ring on first use; 0 bytes disables it. Needs GL_ARB_pixel_buffer_object,
+	// GL_ARB_map_buffer_range and GL_ARB_sync.
+	static void setSize(U32 bytes);
+	static void cleanupClass();
+
+	// Copies bytes from pixels into the ring and leaves the ring bound as the unpack buffer.
+	// Sets pixels to what to hand to glTexImage2D/glTexSubImage2D instead (an offset into
+	// the ring) and returns true, or returns false and leaves pixels alone when the caller
+	// should upload from client memory. Call unbind() after the GL upload call either way.
+	static bool stage(const void*& pixels, U32 bytes);
+	static void unbind();
+
+	// Fences this frame's uploads and rolls the per frame stats.
+	static void endFrame();
+
+	struct Stats
+	{
+		U32 mSize;					// bytes, 0 when off
+		U32 mUploads;				// last frame, through the ring
+		U32 mUploadBytes;
+		U32 mDirect;				// last frame, from client memory because the ring was busy or too small
+	};
+	static Stats getStats();
+
+private:
+	LLPixelBufferRing(U32 size);
+	~LLPixelBufferRing();
+
+	bool copyIn(const void*& pixels, U32 bytes);
+	bool advance();
+
+private:
+	U32 mBuffer;
+	U32 mSize;
+	U32 mSegmentSize;
+	S32 mSegment;
+	U32 mOffset;
+	LLGLSyncFence mFences[NUM_SEGMENTS];
+
+	static LLPixelBufferRing* sInstance;
+	static U32 sSize;
+	static bool sBound;
+	static Stats sFrameStats;
+	static Stats sLastFrameStats;
+};
+
+#endif // LL_LLPIXELBUFFERRING_H
@@ -27,6 +27,7 @@
 #include "linden_common.h"
 
 #include "llvfs.h"
+#include "llvfsmappedfile.h"
 
 #include <sys/stat.h>
 #include <set>
@@ -50,6 +51,9 @@ const S32 BLOCK_LENGTH_INVALID = -1;	// mLength for invalid LLVFSFileBlocks
 
 LLVFS *gVFS = NULL;
 
+// static
+bool LLVFS::sUseMappedData = false;
+
 // internal class definitions
 
 LLVFSBlock::LLVFSBlock()
@@ -70,6 +74,15 @@ bool LLVFSBlock::locationSortPredicate(
 {
 	return lhs->mLocation < rhs->mLocation;
 }
+
+bool LLVFSBlock::lengthSortPredicate(
+	const LLVFSBlock* lhs,
+	const LLVFSBlock* rhs)
+{
+	return (lhs->mLength == rhs->mLength)
+		? lhs->mLocation < rhs->mLocation
+		: lhs->mLength < rhs->mLength;
+}
     
 LLVFSFileSpecifier::LLVFSFileSpecifier()
 :	mFileID(),
@@ -214,7 +227,10 @@ const S32 LLVFSFileBlock::SERIAL_SIZE = 34;
 LLVFS::LLVFS(const std::string& index_filename, const std::string& data_filename, const BOOL read_only, const U32 presize, const BOOL remove_after_crash)
 :	mRemoveAfterCrash(remove_after_crash),
 	mDataFP(NULL),
-	mIndexFP(NULL)
+	mIndexFP(NULL),
+	mMappedData(NULL),
+	mFreeSizeClasses(0),
+	mFreeBlockCount(0)
 {
 	mDataMutex = new LLMutex;
 
@@ -534,6 +550,21 @@ LLVFS::LLVFS(const std::string& index_filename, const std::string& data_filename
 		}
 	}
 
+	if (sUseMappedData)
+	{
+		mMappedData = new LLVFSMappedFile;
+		if (mMappedData->map(mDataFP, mReadOnly))
+		{
+			LL_INFOS("VFS") << "Memory mapped VFS data file (" << mMappedData->getSize() << " bytes)" << LL_ENDL;
+		}
+		else
+		{
+			LL_WARNS("VFS") << "Couldn't memory map VFS data file, using stdio" << LL_ENDL;
+			delete mMappedData;
+			mMappedData = NULL;
+		}
+	}
+
 	LL_INFOS("VFS") << "Using VFS index file " << mIndexFilename << LL_ENDL;
 	LL_INFOS("VFS") << "Using VFS data file " << mDataFilename << LL_ENDL;
 
@@ -557,10 +588,19 @@ LLVFS::~LLVFS()
 	}
 	mFileBlocks.clear();
 	
-	mFreeBlocksByLength.clear();
+	for (S32 i = 0; i < NUM_SIZE_CLASSES; i++)
+	{
+		mFreeBlocksBySize[i].clear();
+	}
+	mFreeSizeClasses = 0;
+	mFreeBlockCount = 0;
 
 	for_each(mFreeBlocksByLocation.begin(), mFreeBlocksByLocation.end(), DeletePairedPointer());
     
+	// Unmap before the file (and its lock) goes away.
+	delete mMappedData;
+	mMappedData = NULL;
+
 	unlockAndClose(mDataFP);
 	mDataFP = NULL;
     
@@ -725,8 +765,7 @@ BOOL LLVFS::checkAvailable(S32 max_size)
 {
 	lockData();
 	
-	blocks_length_map_t::iterator iter = mFreeBlocksByLength.lower_bound(max_size); // first entry >= size
-	const BOOL res(iter == mFreeBlocksByLength.end() ? FALSE : TRUE);
+	const BOOL res(findBestFit(max_size) ? TRUE : FALSE);
 
 	unlockData();
 	
@@ -853,18 +892,7 @@ BOOL LLVFS::setMaxSize(const LLUUID &file_id, const LLAssetType::EType file_type
 					if (block->mSize > 0)
 					{
 						// move the file into the new block
-						std::vector<U8> buffer(block->mSize);
-						fseek(mDataFP, block->mLocation, SEEK_SET);
-						if (fread(&buffer[0], block->mSize, 1, mDataFP) == 1)
-						{
-							fseek(mDataFP, new_data_location, SEEK_SET);
-							if (fwrite(&buffer[0], block->mSize, 1, mDataFP) != 1)
-							{
-								llwarns << "Short write" << llendl;
-							}
-						} else {
-							llwarns << "Short read" << llendl;
-						}
+						moveData(block->mLocation, new_data_location, block->mSize);
 					}
 				}
     
@@ -1086,6 +1114,17 @@ S32 LLVFS::getData(const LLUUID &file_id, const LLAssetType::EType file_type, U8
 		}
 	}
 
+	if (do_read && mMappedData)
+	{
+		// Pin the stripes before letting go of mDataMutex so nobody can
+		// move or overwrite the block while we copy it out.
+		mMappedData->rdlockRange(location, length);
+		unlockData();
+		bytesread = mMappedData->read(location, buffer, length);
+		mMappedData->rdunlockRange(location, length);
+		return bytesread;
+	}
+
 	if (do_read)
 	{
 		fseek(mDataFP, location, SEEK_SET);
@@ -1157,6 +1196,34 @@ S32 LLVFS::storeData(const LLUUID &file_id, const LLAssetType::EType file_type,
 				length = block->mLength - location;
 			}
 			U32 file_location = location + block->mLocation;
+
+			if (mMappedData)
+			{
+				if (!mMappedData->reserve(file_location + length))
+				{
+					llwarns << llformat("VFS Write Error: can't map %d bytes at %u", length, file_location) << llendl;
+					unlockData();
+					return 0;
+				}
+
+				// Update the index while we still own mDataMutex; readers of
+				// the new size wait on the stripes until the data is there.
+				mMappedData->wrlockRange(file_location, length);
+				if (location + length > block->mSize)
+				{
+					block->mSize = location + length;
+					sync(block);
+				}
+				unlockData();
+
+				S32 write_len = mMappedData->write(file_location, buffer, length);
+				mMappedData->wrunlockRange(file_location, length);
+				if (write_len != length)
+				{
+					llwarns << llformat("VFS Write Error: %d != %d",write_len,length) << llendl;
+				}
+				return write_len;
+			}
 			
 			fseek(mDataFP, file_location, SEEK_SET);
 			S32 write_len = (S32)fwrite(buffer, 1, length, mDataFP);
@@ -1256,31 +1323,68 @@ BOOL LLVFS::isLocked(const LLUUID &file_id, const LLAssetType::EType file_type,
 // protected
 //============================================================================
 
-void LLVFS::eraseBlockLength(LLVFSBlock *block)
+// static
+S32 LLVFS::getSizeClass(S32 length)
 {
-	// find the corresponding map entry in the length map and erase it
-	S32 length = block->mLength;
-	blocks_length_map_t::iterator iter = mFreeBlocksByLength.lower_bound(length);
-	blocks_length_map_t::iterator end = mFreeBlocksByLength.end();
-	bool found_block = false;
-	while(iter != end)
-	{
-		LLVFSBlock *tblock = iter->second;
-		llassert(tblock->mLength == length); // there had -better- be an entry with our length!
-		if (tblock == block)
-		{
-			mFreeBlocksByLength.erase(iter);
-			found_block = true;
-			break;
-		}
-		++iter;
+	S32 size_class = 0;
+	while (length > 1)
+	{
+		length >>= 1;
+		size_class++;
 	}
-	if(!found_block)
+	return size_class;
+}
+
+void LLVFS::insertBlockLength(LLVFSBlock *block)
+{
+	S32 size_class = getSizeClass(block->mLength);
+	mFreeBlocksBySize[size_class].insert(block);
+	mFreeSizeClasses |= 1U << size_class;
+	mFreeBlockCount++;
+}
+
+// Must be called before the block's length or location change, both are part of the key.
+void LLVFS::eraseBlockLength(LLVFSBlock *block)
+{
+	S32 size_class = getSizeClass(block->mLength);
+	blocks_length_set_t& bin = mFreeBlocksBySize[size_class];
+	if (bin.erase(block) != 1)
 	{
 		llerrs << "eraseBlock could not find block" << llendl;
 	}
+	if (bin.empty())
+	{
+		mFreeSizeClasses &= ~(1U << size_class);
+	}
+	mFreeBlockCount--;
 }
 
+LLVFSBlock *LLVFS::findBestFit(S32 size)
+{
+	S32 size_class = getSizeClass(size);
+
+	// Anything in our own class that is long enough?
+	LLVFSBlock probe(0, size);
+	blocks_length_set_t& bin = mFreeBlocksBySize[size_class];
+	blocks_length_set_t::iterator iter = bin.lower_bound(&probe);
+	if (iter != bin.end())
+	{
+		return *iter;
+	}
+
+	// Otherwise the smallest block of the next non-empty class fits.
+	U32 larger = (size_class + 1 < NUM_SIZE_CLASSES) ? (mFreeSizeClasses & (~0U << (size_class + 1))) : 0;
+	if (!larger)
+	{
+		return NULL;
+	}
+	size_class++;
+	while (!(larger & (1U << size_class)))
+	{
+		size_class++;
+	}
+	return *mFreeBlocksBySize[size_class].begin();
+}
 
 // Remove block from both free lists (by location and by length).
 void LLVFS::eraseBlock(LLVFSBlock *block)
@@ -1335,7 +1439,7 @@ void LLVFS::addFreeBlock(LLVFSBlock *block)
 		eraseBlockLength(prev_block);
 		eraseBlock(next_block);
 		prev_block->mLength += block->mLength + next_block->mLength;
-		mFreeBlocksByLength.insert(blocks_length_map_t::value_type(prev_block->mLength, prev_block));
+		insertBlockLength(prev_block);
 		delete block;
 		block = NULL;
 		delete next_block;
@@ -1348,7 +1452,7 @@ void LLVFS::addFreeBlock(LLVFSBlock *block)
 		// therefore only need to update the length map. JC
 		eraseBlockLength(prev_block);
 		prev_block->mLength += block->mLength;
-		mFreeBlocksByLength.insert(blocks_length_map_t::value_type(prev_block->mLength, prev_block)); // multimap insert
+		insertBlockLength(prev_block);
 		delete block;
 		block = NULL;
 	}
@@ -1362,7 +1466,7 @@ void LLVFS::addFreeBlock(LLVFSBlock *block)
 		next_block->mLength += block->mLength;
 		// Don't hint here, next_free_it iterator may be invalid.
 		mFreeBlocksByLocation.insert(blocks_location_map_t::value_type(next_block->mLocation, next_block)); // multimap insert
-		mFreeBlocksByLength.insert(blocks_length_map_t::value_type(next_block->mLength, next_block)); // multimap insert			
+		insertBlockLength(next_block);
 		delete block;
 		block = NULL;
 	}
@@ -1371,7 +1475,7 @@ void LLVFS::addFreeBlock(LLVFSBlock *block)
 		// Can't merge with other free blocks.
 		// Hint that insert should go near next_free_it.
  		mFreeBlocksByLocation.insert(next_free_it, blocks_location_map_t::value_type(block->mLocation, block)); // multimap insert
- 		mFreeBlocksByLength.insert(blocks_length_map_t::value_type(block->mLength, block)); // multimap insert
+ 		insertBlockLength(block);
 	}
 }
 
@@ -1433,6 +1537,43 @@ void LLVFS::useFreeSpace(LLVFSBlock *free_block, S32 length)
 	}
 }
 
+// mDataMutex must be LOCKED before calling this
+bool LLVFS::moveData(U32 from, U32 to, S32 size)
+{
+	if (mMappedData)
+	{
+		if (!mMappedData->reserve(llmax(from, to) + size))
+		{
+			llwarns << "Short write" << llendl;
+			return false;
+		}
+		// Source and destination may share stripes.
+		mMappedData->wrlockAll();
+		bool success = (mMappedData->move(from, to, size) == size);
+		mMappedData->wrunlockAll();
+		if (!success)
+		{
+			llwarns << "Short move" << llendl;
+		}
+		return success;
+	}
+
+	std::vector<U8> buffer(size);
+	fseek(mDataFP, from, SEEK_SET);
+	if (fread(&buffer[0], size, 1, mDataFP) != 1)
+	{
+		llwarns << "Short read" << llendl;
+		return false;
+	}
+	fseek(mDataFP, to, SEEK_SET);
+	if (fwrite(&buffer[0], size, 1, mDataFP) != 1)
+	{
+		llwarns << "Short write" << llendl;
+		return false;
+	}
+	return true;
+}
+
 // NOTE! mDataMutex must be LOCKED before calling this
 // sync this index entry out to the index file
 // we need to do this constantly to avoid corruption on viewer crash
@@ -1536,9 +1677,7 @@ LLVFSBlock *LLVFS::findFreeBlock(S32 size, LLVFSFileBlock *immune)
 	while (! block)
 	{
 		// look for a suitable free block
-		blocks_length_map_t::iterator iter = mFreeBlocksByLength.lower_bound(size); // first entry >= size
-		if (iter != mFreeBlocksByLength.end())
-			block = iter->second;
+		block = findBestFit(size);
     	
 		// no large enough free blocks, time to clean out some junk
 		if (! block)
@@ -1625,6 +1764,87 @@ LLVFSBlock *LLVFS::findFreeBlock(S32 size, LLVFSFileBlock *immune)
 // public
 //============================================================================
 
+S32 LLVFS::defragment(F32 max_time)
+{
+	if (!isValid() || mReadOnly)
+	{
+		return 0;
+	}
+
+	LLTimer timer;
+	LLMutexLock lock_data(mDataMutex);
+
+	// A single free block is just the unused tail of the data file.
+	if (mFreeBlocksByLocation.size() <= 1)
+	{
+		return 0;
+	}
+
+	std::vector<LLVFSBlock*> files_by_loc;
+	files_by_loc.reserve(mFileBlocks.size());
+	for (fileblock_map::iterator it = mFileBlocks.begin(); it != mFileBlocks.end(); ++it)
+	{
+		if (it->second->mLength > 0)
+		{
+			files_by_loc.push_back(it->second);
+		}
+	}
+	std::sort(files_by_loc.begin(), files_by_loc.end(), LLVFSBlock::locationSortPredicate);
+
+	S32 bytes_moved = 0;
+	blocks_location_map_t::iterator free_it = mFreeBlocksByLocation.begin();
+	while (free_it != mFreeBlocksByLocation.end() && timer.getElapsedTimeF32() < max_time)
+	{
+		LLVFSBlock *free_block = free_it->second;
+
+		// Free blocks are always coalesced, so whatever follows one is a file (or the end).
+		LLVFSBlock key(free_block->mLocation + free_block->mLength, 0);
+		std::vector<LLVFSBlock*>::iterator file_it =
+			std::lower_bound(files_by_loc.begin(), files_by_loc.end(), &key, LLVFSBlock::locationSortPredicate);
+		if (file_it == files_by_loc.end() || (*file_it)->mLocation != key.mLocation)
+		{
+			++free_it;
+			continue;
+		}
+
+		// Only slide when the old and new data don't overlap, so a crash
+		// before the index is synced leaves the old copy intact.
+		LLVFSFileBlock *file_block = (LLVFSFileBlock*)*file_it;
+		if (file_block->mSize > free_block->mLength)
+		{
+			++free_it;
+			continue;
+		}
+
+		U32 new_location = free_block->mLocation;
+		if (file_block->mSize > 0 &&
+			!moveData(file_block->mLocation, new_location, file_block->mSize))
+		{
+			break;
+		}
+
+		// The file's order in files_by_loc is unchanged, nothing lived in the gap.
+		eraseBlock(free_block);
+		file_block->mLocation = new_location;
+		sync(file_block);
+
+		// Re-add the gap behind the file; this may merge it with the next free block.
+		U32 gap_location = new_location + file_block->mLength;
+		free_block->mLocation = gap_location;
+		addFreeBlock(free_block);
+		free_block = NULL;
+
+		bytes_moved += file_block->mSize;
+		free_it = mFreeBlocksByLocation.lower_bound(gap_location);
+	}
+
+	if (bytes_moved)
+	{
+		LL_DEBUGS("VFS") << "Defragmented " << bytes_moved << " bytes in " << timer.getElapsedTimeF32() << " seconds" << LL_ENDL;
+	}
+	return bytes_moved;
+}
+
 void LLVFS::pokeFiles()
 {
 	if (!isValid())
@@ -1635,8 +1855,9 @@ void LLVFS::pokeFiles()
 	
 	// only write data if we actually read 4 bytes
 	// otherwise we're writing garbage and screwing up the file
+	// (a mapped data file is already paged in on demand)
 	fseek(mDataFP, 0, SEEK_SET);
-	if (fread(&word, sizeof(word), 1, mDataFP) == 1)
+	if (!mMappedData && fread(&word, sizeof(word), 1, mDataFP) == 1)
 	{
 		fseek(mDataFP, 0, SEEK_SET);
 		if (fwrite(&word, sizeof(word), 1, mDataFP) != 1)
@@ -1737,6 +1958,8 @@ void LLVFS::audit()
 				// try to keep data from being lost
 				unlockAndClose(mIndexFP);
 				mIndexFP = NULL;
+				delete mMappedData;
+				mMappedData = NULL;
 				unlockAndClose(mDataFP);
 				mDataFP = NULL;
 				llwarns << "VFS: Original block index " << block->mIndexLocation
@@ -1949,7 +2172,7 @@ void LLVFS::dumpStatistics()
 	llinfos << "Invalid blocks: " << invalid_file_count << llendl;
 	llinfos << "File blocks:    " << mFileBlocks.size() << llendl;
 
-	S32 length_list_count = (S32)mFreeBlocksByLength.size();
+	S32 length_list_count = mFreeBlockCount;
 	S32 location_list_count = (S32)mFreeBlocksByLocation.size();
 	if (length_list_count == location_list_count)
 	{
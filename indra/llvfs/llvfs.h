@@ -28,11 +28,14 @@
 #define LL_LLVFS_H
 
 #include <deque>
+#include <set>
 #include "lluuid.h"
 #include "linked_lists.h"
 #include "llassettype.h"
 #include "llthread.h"
 
+class LLVFSMappedFile;
+
 enum EVFSValid 
 {
 	VFSVALID_UNKNOWN = 0, 
@@ -66,6 +69,11 @@ public:
 		const LLVFSBlock* lhs,
 		const LLVFSBlock* rhs);
 
+	// Orders by length, then location (free block locations are unique).
+	static bool lengthSortPredicate(
+		const LLVFSBlock* lhs,
+		const LLVFSBlock* rhs);
+
 public:
 	U32 mLocation;
 	S32	mLength;		// allocated block size
@@ -133,6 +141,7 @@ public:
 
 	BOOL isValid() const			{ return (VFSVALID_OK == mValid); }
 	EVFSValid getValidState() const	{ return mValid; }
+	bool isMapped() const			{ return mMappedData != NULL; }
 
 	// ---------- The following fucntions lock/unlock mDataMutex ----------
 	BOOL getExists(const LLUUID &file_id, const LLAssetType::EType file_type);
@@ -155,6 +164,17 @@ public:
 	BOOL isLocked(const LLUUID &file_id, const LLAssetType::EType file_type, EVFSLock lock);
 	// ----------------------------------------------------------------
 
+	// When set before createLLVFS(), the data file is memory mapped and
+	// getData()/storeData() copy through it under per-stripe locks instead
+	// of holding mDataMutex around fseek/fread. Falls back to stdio if the
+	// mapping can't be created.
+	static bool sUseMappedData;
+
+	// Slide file blocks down into the free space in front of them, for at
+	// most max_time seconds. Call from idle time; holds mDataMutex while it
+	// runs. Returns the number of bytes moved.
+	S32 defragment(F32 max_time);
+
 	// Used to trigger evil WinXP behavior of "preloading" entire file into memory.
 	void pokeFiles();
 
@@ -173,9 +193,15 @@ public:
 protected:
 	void removeFileBlock(LLVFSFileBlock *fileblock);
 	
+	static S32 getSizeClass(S32 length);
+	void insertBlockLength(LLVFSBlock *block);
 	void eraseBlockLength(LLVFSBlock *block);
 	void eraseBlock(LLVFSBlock *block);
 	void addFreeBlock(LLVFSBlock *block);
+	// Smallest free block of at least size bytes, or NULL.
+	LLVFSBlock *findBestFit(S32 size);
+	// Copy size bytes of file data; the caller owns both regions.
+	bool moveData(U32 from, U32 to, S32 size);
 	//void mergeFreeBlocks();
 	void useFreeSpace(LLVFSBlock *free_block, S32 length);
 	void sync(LLVFSFileBlock *block, BOOL remove = FALSE);
@@ -203,13 +229,27 @@ public:
 protected:
 	fileblock_map mFileBlocks;
 
-	typedef std::multimap<S32, LLVFSBlock*>	blocks_length_map_t;
-	blocks_length_map_t 	mFreeBlocksByLength;
+	// Free blocks are binned by size class (floor(log2(length))). Each bin
+	// is ordered by length, so a best fit is one scan of mFreeSizeClasses
+	// plus one lower_bound, and removing a block is a direct lookup.
+	struct length_less
+	{
+		bool operator()(const LLVFSBlock* lhs, const LLVFSBlock* rhs) const
+		{
+			return LLVFSBlock::lengthSortPredicate(lhs, rhs);
+		}
+	};
+	typedef std::set<LLVFSBlock*, length_less> blocks_length_set_t;
+	enum { NUM_SIZE_CLASSES = 32 };
+	blocks_length_set_t		mFreeBlocksBySize[NUM_SIZE_CLASSES];
+	U32						mFreeSizeClasses;	// bit n set if mFreeBlocksBySize[n] is not empty
+	S32						mFreeBlockCount;
 	typedef std::multimap<U32, LLVFSBlock*>	blocks_location_map_t;
 	blocks_location_map_t 	mFreeBlocksByLocation;
 
 	LLFILE *mDataFP;
 	LLFILE *mIndexFP;
+	LLVFSMappedFile *mMappedData;	// NULL unless sUseMappedData and the mapping succeeded
 
 	std::deque<S32> mIndexHoles;
 
@@ -0,0 +1,303 @@
+/**
+ * @file llvfsmappedfile.cpp
+ * @brief Memory mapped, lock striped access to the VFS data file
+ *
+ * $LicenseInfo:firstyear=2002&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llvfsmappedfile.h"
+
+#if LL_WINDOWS
+#include <io.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+LLVFSMappedFile::LLVFSMappedFile()
+:	mFP(NULL),
+	mMappedAddress(NULL),
+	mSize(0),
+	mReadOnly(true)
+#if LL_WINDOWS
+	, mMapping(NULL)
+#endif
+{
+}
+
+LLVFSMappedFile::~LLVFSMappedFile()
+{
+	unmap();
+}
+
+bool LLVFSMappedFile::map(LLFILE* fp, bool read_only)
+{
+	llassert(!mMappedAddress);
+	if (!fp)
+	{
+		return false;
+	}
+
+	mFP = fp;
+	mReadOnly = read_only;
+
+	// Anything still sitting in the stdio buffer must hit the file
+	// before we start looking at it through the mapping.
+	fflush(mFP);
+	fseek(mFP, 0, SEEK_END);
+	long size = ftell(mFP);
+	if (size <= 0)
+	{
+		// Nothing to map yet; reserve() will map once the file has data.
+		return !mReadOnly;
+	}
+
+	return mapSize((U32)size);
+}
+
+void LLVFSMappedFile::unmap()
+{
+	if (mMappedAddress)
+	{
+#if LL_WINDOWS
+		if (!mReadOnly)
+		{
+			FlushViewOfFile(mMappedAddress, 0);
+		}
+		UnmapViewOfFile(mMappedAddress);
+		CloseHandle((HANDLE)mMapping);
+		mMapping = NULL;
+#else
+		if (!mReadOnly)
+		{
+			msync(mMappedAddress, mSize, MS_ASYNC);
+		}
+		if (munmap(mMappedAddress, mSize) == -1)
+		{
+			llwarns << "VFS: munmap failed, errno " << errno << llendl;
+		}
+#endif
+		mMappedAddress = NULL;
+	}
+	mSize = 0;
+}
+
+// Called with all stripes held (or before anyone else can see us).
+bool LLVFSMappedFile::mapSize(U32 size)
+{
+	unmap();
+
+#if LL_WINDOWS
+	HANDLE file = (HANDLE)_get_osfhandle(_fileno(mFP));
+	// CreateFileMapping extends the file when size exceeds it.
+	mMapping = CreateFileMapping(file, NULL, mReadOnly ? PAGE_READONLY : PAGE_READWRITE, 0, size, NULL);
+	if (!mMapping)
+	{
+		llwarns << "VFS: CreateFileMapping failed: " << GetLastError() << llendl;
+		return false;
+	}
+	void* address = MapViewOfFile((HANDLE)mMapping, mReadOnly ? FILE_MAP_READ : FILE_MAP_WRITE, 0, 0, size);
+	if (!address)
+	{
+		llwarns << "VFS: MapViewOfFile failed: " << GetLastError() << llendl;
+		CloseHandle((HANDLE)mMapping);
+		mMapping = NULL;
+		return false;
+	}
+#else
+	int fd = fileno(mFP);
+	if (!mReadOnly)
+	{
+		struct stat st;
+		if (fstat(fd, &st) == 0 && (U32)st.st_size < size && ftruncate(fd, size) == -1)
+		{
+			llwarns << "VFS: Couldn't grow data file to " << size << " bytes, errno " << errno << llendl;
+			return false;
+		}
+	}
+	void* address = ::mmap(NULL, size, mReadOnly ? PROT_READ : (PROT_READ | PROT_WRITE), MAP_SHARED, fd, 0);
+	if (address == MAP_FAILED)
+	{
+		llwarns << "VFS: mmap of " << size << " bytes failed, errno " << errno << llendl;
+		return false;
+	}
+#endif
+
+	mMappedAddress = (U8*)address;
+	mSize = size;
+	return true;
+}
+
+bool LLVFSMappedFile::reserve(U32 size)
+{
+	if (size <= mSize)
+	{
+		return true;
+	}
+	if (mReadOnly)
+	{
+		return false;
+	}
+
+	// Grow in 16 MB steps so appending files don't remap on every write.
+	const U32 GROW_STEP = 0x01000000;
+	U32 new_size = (size + GROW_STEP - 1) & ~(GROW_STEP - 1);
+	if (new_size < size)
+	{
+		new_size = size;	// wrapped around near 4 GB
+	}
+
+	wrlockAll();
+	bool success = (size <= mSize) || mapSize(new_size);
+	wrunlockAll();
+	return success;
+}
+
+U64 LLVFSMappedFile::stripeMask(U32 location, S32 length) const
+{
+	if (length <= 0)
+	{
+		length = 1;
+	}
+	U32 first = location >> STRIPE_SHIFT;
+	U32 last = (location + (U32)length - 1) >> STRIPE_SHIFT;
+	if (last - first + 1 >= NUM_STRIPES)
+	{
+		return ~(U64)0;
+	}
+	U64 mask = 0;
+	for (U32 i = first; i <= last; ++i)
+	{
+		mask |= (U64)1 << (i % NUM_STRIPES);
+	}
+	return mask;
+}
+
+// Stripes are always taken in ascending index order, whatever the range.
+
+void LLVFSMappedFile::rdlockRange(U32 location, S32 length)
+{
+	U64 mask = stripeMask(location, length);
+	for (S32 i = 0; i < NUM_STRIPES; ++i)
+	{
+		if (mask & ((U64)1 << i))
+		{
+			mStripes[i].rdlock();
+		}
+	}
+}
+
+void LLVFSMappedFile::rdunlockRange(U32 location, S32 length)
+{
+	U64 mask = stripeMask(location, length);
+	for (S32 i = NUM_STRIPES - 1; i >= 0; --i)
+	{
+		if (mask & ((U64)1 << i))
+		{
+			mStripes[i].rdunlock();
+		}
+	}
+}
+
+void LLVFSMappedFile::wrlockRange(U32 location, S32 length)
+{
+	U64 mask = stripeMask(location, length);
+	for (S32 i = 0; i < NUM_STRIPES; ++i)
+	{
+		if (mask & ((U64)1 << i))
+		{
+			mStripes[i].wrlock();
+		}
+	}
+}
+
+void LLVFSMappedFile::wrunlockRange(U32 location, S32 length)
+{
+	U64 mask = stripeMask(location, length);
+	for (S32 i = NUM_STRIPES - 1; i >= 0; --i)
+	{
+		if (mask & ((U64)1 << i))
+		{
+			mStripes[i].wrunlock();
+		}
+	}
+}
+
+void LLVFSMappedFile::wrlockAll()
+{
+	for (S32 i = 0; i < NUM_STRIPES; ++i)
+	{
+		mStripes[i].wrlock();
+	}
+}
+
+void LLVFSMappedFile::wrunlockAll()
+{
+	for (S32 i = NUM_STRIPES - 1; i >= 0; --i)
+	{
+		mStripes[i].wrunlock();
+	}
+}
+
+S32 LLVFSMappedFile::read(U32 location, U8* buffer, S32 length) const
+{
+	if (!mMappedAddress || location >= mSize || length <= 0)
+	{
+		return 0;
+	}
+	if ((U32)length > mSize - location)
+	{
+		length = (S32)(mSize - location);
+	}
+	memcpy(buffer, mMappedAddress + location, length);		/* Flawfinder: ignore */
+	return length;
+}
+
+S32 LLVFSMappedFile::write(U32 location, const U8* buffer, S32 length)
+{
+	if (mReadOnly || !mMappedAddress || location >= mSize || length <= 0)
+	{
+		return 0;
+	}
+	if ((U32)length > mSize - location)
+	{
+		length = (S32)(mSize - location);
+	}
+	memcpy(mMappedAddress + location, buffer, length);		/* Flawfinder: ignore */
+	return length;
+}
+
+S32 LLVFSMappedFile::move(U32 from, U32 to, S32 length)
+{
+	if (mReadOnly || !mMappedAddress || length <= 0 ||
+		from >= mSize || to >= mSize ||
+		(U32)length > mSize - from || (U32)length > mSize - to)
+	{
+		return 0;
+	}
+	memmove(mMappedAddress + to, mMappedAddress + from, length);
+	return length;
+}
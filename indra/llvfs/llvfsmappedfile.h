@@ -0,0 +1,96 @@
+/**
+ * @file llvfsmappedfile.h
+ * @brief Memory mapped, lock striped access to the VFS data file
+ *
+ * $LicenseInfo:firstyear=2002&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLVFSMAPPEDFILE_H
+#define LL_LLVFSMAPPEDFILE_H
+
+#include "llthread.h"
+
+// Maps the whole VFS data file into memory so that readers can copy out of
+// it in parallel instead of serializing on one fseek/fread pair.
+//
+// The file is split into stripes of STRIPE_SIZE bytes; each stripe index
+// (modulo NUM_STRIPES) has its own reader/writer lock. Readers of disjoint
+// or identical ranges never block each other, a writer only blocks the
+// stripes it touches. Remapping (growing the file) takes every stripe.
+//
+// Lock order: LLVFS::mDataMutex, then stripes in ascending index order.
+class LLVFSMappedFile
+{
+public:
+	enum
+	{
+		STRIPE_SHIFT = 16,			// 64 kB stripes
+		NUM_STRIPES = 64			// must fit in the U64 mask used by lockRange()
+	};
+
+	LLVFSMappedFile();
+	~LLVFSMappedFile();
+
+	// Map the file behind fp. Any buffered stdio data is flushed first.
+	// Returns false if the platform refused the mapping (for example address
+	// space exhaustion on 32-bit builds); the caller should fall back to stdio.
+	bool map(LLFILE* fp, bool read_only);
+	void unmap();
+	bool isMapped() const				{ return mMappedAddress != NULL; }
+	U32 getSize() const					{ return mSize; }
+
+	// Make sure [0, size) is backed by the file and the mapping, growing both
+	// if needed. Takes all stripes, so it must not be called while holding any.
+	bool reserve(U32 size);
+
+	// Shared (read) or exclusive (write) access to the stripes covering a range.
+	void rdlockRange(U32 location, S32 length);
+	void rdunlockRange(U32 location, S32 length);
+	void wrlockRange(U32 location, S32 length);
+	void wrunlockRange(U32 location, S32 length);
+	void wrlockAll();
+	void wrunlockAll();
+
+	// The caller must hold the stripes covering the range(s).
+	// Return the number of bytes copied; ranges are clamped to the mapping.
+	S32 read(U32 location, U8* buffer, S32 length) const;
+	S32 write(U32 location, const U8* buffer, S32 length);
+	// Both ranges must be covered; use wrlockAll() since they may share stripes.
+	S32 move(U32 from, U32 to, S32 length);
+
+private:
+	bool mapSize(U32 size);
+	U64 stripeMask(U32 location, S32 length) const;
+
+private:
+	AIRWLock mStripes[NUM_STRIPES];
+
+	LLFILE* mFP;
+	U8* mMappedAddress;
+	U32 mSize;
+	bool mReadOnly;
+#if LL_WINDOWS
+	void* mMapping;						// HANDLE
+#endif
+};
+
+#endif // LL_LLVFSMAPPEDFILE_H
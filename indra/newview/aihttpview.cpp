@@ -83,6 +83,7 @@ void AIServiceBar::draw()
   int event_polls;
   int established_connections;
   int concurrent_connections;
+  double latency;
   size_t bandwidth;
   {
 	PerService_rat per_service_r(*mPerService);
@@ -92,6 +93,8 @@ void AIServiceBar::draw()
 	event_polls = per_service_r->mEventPolls;
 	established_connections = per_service_r->mEstablishedConnections;
 	concurrent_connections = per_service_r->mConcurrentConnections;
+	per_service_r->latency().truncateData(AIHTTPView::getTime_40ms());
+	latency = per_service_r->latency().getAverage(0);
 	bandwidth = per_service_r->bandwidth().truncateData(AIHTTPView::getTime_40ms());
 	cts = per_service_r->mCapabilityType;	// Not thread-safe, but we're only reading from it and only using the results to show in a debug console.
   }
@@ -150,9 +153,9 @@ void AIServiceBar::draw()
   }
   start = mHTTPView->updateColumn(mc_col, start);
 #ifdef CWDEBUG
-  text = llformat(" | %d,%d,%d/%d", total_added, event_polls, established_connections, concurrent_connections);
+  text = llformat(" | %d,%d,%d/%d %.0fms", total_added, event_polls, established_connections, concurrent_connections, latency);
 #else
-  text = llformat(" | %d/%d", total_added, concurrent_connections);
+  text = llformat(" | %d/%d %.0fms", total_added, concurrent_connections, latency);
 #endif
   LLFontGL::getFontMonospace()->renderUTF8(text, 0, start, height, text_color, LLFontGL::LEFT, LLFontGL::TOP);
   start += LLFontGL::getFontMonospace()->getWidth(text);
@@ -216,7 +219,7 @@ void AIGLHTTPHeaderBar::draw(void)
   F32 height = v_offset + sLineHeight * number_of_header_lines;
   text = "HTTP console -- [approved]-commandQ-curlQ,{added/max,downloading}[/max][ completed]";
   LLFontGL::getFontMonospace()->renderUTF8(text, 0, h_offset, height, text_color, LLFontGL::LEFT, LLFontGL::TOP);
-  text = " | Added/Max";
+  text = " | Added/Max TTFB";
   U32 start = mHTTPView->updateColumn(mc_col, 100);
   LLFontGL::getFontMonospace()->renderUTF8(text, 0, start, height, LLColor4::green, LLFontGL::LEFT, LLFontGL::TOP);
   start += LLFontGL::getFontMonospace()->getWidth(text);
@@ -49,11 +49,13 @@
 #include "llagentwearables.h"
 #include "llwindow.h"
 #include "llviewerstats.h"
+#include "lllogchat.h"
 #include "llmarketplacefunctions.h"
 #include "llmarketplacenotifications.h"
 #include "llmd5.h"
 #include "llmeshrepository.h"
 #include "llmodaldialog.h"
+#include "llpacketcapture.h"
 #include "llpumpio.h"
 #include "llmimetypes.h"
 #include "llslurl.h"
@@ -102,6 +104,7 @@
 #include "llnotifications.h"
 #include "llnotificationsutil.h"
 #include <boost/bind.hpp>
+#include <boost/thread.hpp>
 
 #if LL_WINDOWS
 	#include "llwindebug.h"
@@ -120,6 +123,7 @@
 #include "lltexturecache.h"
 #include "lltexturefetch.h"
 #include "llimageworker.h"
+#include "llpixelbufferring.h"
 
 // <edit>
 #include "aicurleasyrequeststatemachine.h"
@@ -501,6 +505,7 @@ static void settings_to_globals()
 
 	LLImageGL::sGlobalUseAnisotropic	= gSavedSettings.getBOOL("RenderAnisotropic");
 	LLImageGL::sCompressTextures		= gSavedSettings.getBOOL("RenderCompressTextures");
+	LLPixelBufferRing::setSize(gSavedSettings.getU32("TextureUploadRingSize") * 1024 * 1024);
 	LLVOVolume::sLODFactor				= gSavedSettings.getF32("RenderVolumeLODFactor");
 	LLVOVolume::sDistanceFactor			= 1.f-LLVOVolume::sLODFactor * 0.1f;
 	LLVolumeImplFlexible::sUpdateFactor = gSavedSettings.getF32("RenderFlexTimeFactor");
@@ -1399,6 +1404,19 @@ bool LLAppViewer::mainLoop()
 						ms_sleep(llmin(io_pending/100,100)); // give the vfs some time to catch up
 					}
 
+					if (!work_pending && !io_pending && gVFS)
+					{
+						// The cache threads have nothing queued, compact the VFS a little.
+						static LLCachedControl<F32> defrag_time(gSavedSettings, "VFSDefragmentTime");
+						static LLFrameTimer defrag_timer;
+						if (defrag_time > 0.f && defrag_timer.getElapsedTimeF32() > 1.f)
+						{
+							LLFastTimer ftm(FTM_VFS);
+							gVFS->defragment(defrag_time);
+							defrag_timer.reset();
+						}
+					}
+
 					F64 idle_time = idleTimer.getElapsedTimeF64();
 					if (!work_pending || idle_time >= max_idle_time)
 					{
@@ -1521,6 +1539,9 @@ bool LLAppViewer::cleanup()
 
 	llinfos << "Viewer disconnected" << llendflush;
 
+	// Write out the chat and IM lines that are still queued.
+	LLLogChat::cleanupClass();
+
 	display_cleanup(); 
 
 	release_start_screen(); // just in case
@@ -1938,7 +1959,13 @@ bool LLAppViewer::initThreads()
 	LLLFSThread::initClass(enable_threads && false);
 
 	// Image decoding
-	LLAppViewer::sImageDecodeThread = new LLImageDecodeThread(enable_threads && true);
+	S32 decode_threads = gSavedSettings.getU32("ImageDecodeThreads");
+	if (decode_threads <= 0)
+	{
+		// Leave a core for the main thread.
+		decode_threads = llclamp((S32)boost::thread::hardware_concurrency() - 1, 1, 8);
+	}
+	LLAppViewer::sImageDecodeThread = new LLImageDecodeThread(enable_threads && true, decode_threads);
 	LLAppViewer::sTextureCache = new LLTextureCache(enable_threads && true);
 	LLAppViewer::sTextureFetch = new LLTextureFetch(LLAppViewer::getTextureCache(),
 													sImageDecodeThread,
@@ -3482,6 +3509,8 @@ bool LLAppViewer::initCache()
 	// Startup the VFS...
 	gSavedSettings.setU32("VFSSalt", new_salt);
 
+	LLVFS::sUseMappedData = gSavedSettings.getBOOL("VFSUseMappedData");
+
 	// Don't remove VFS after viewer crashes.  If user has corrupt data, they can reinstall. JC
 	gVFS = LLVFS::createLLVFS(new_vfs_index_file, new_vfs_data_file, false, vfs_size_u32, false);
 	if (!gVFS)
@@ -4427,6 +4456,9 @@ void LLAppViewer::idleNetwork()
 #endif
 		}
 
+		// Feed a packet capture that is being replayed, if any.
+		LLPacketReplay::pumpActive();
+
 		// Handle per-frame message system processing.
 		gMessageSystem->processAcks();
 
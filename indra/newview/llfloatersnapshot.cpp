@@ -1172,10 +1172,13 @@ LLSnapshotLivePreview::EAspectSizeProblem LLSnapshotLivePreview::generateFormatt
 	// Served, so no need to call this again.
 	mFormattedDelayTimer.stop();
 
-	// A cropped copy of raw snapshot is put in 'scaled', which then is
-	// scaled to the target size (or a close power of two in the case
-	// of textures) and then encoded to 'formatted' of the same size.
-	LLPointer<LLImageRaw> scaled = new LLImageRaw(mRawSnapshot, w, h, crop_offset, crop_vertically);
+	// The cropped part of the raw snapshot is scaled into 'scaled', to the
+	// target size (or a close power of two in the case of textures), and
+	// then encoded to 'formatted' of the same size.
+	LLPointer<LLImageRawView> cropped = crop_vertically ?
+		new LLImageRawView(mRawSnapshot, 0, crop_offset, w, h) :
+		new LLImageRawView(mRawSnapshot, crop_offset, 0, w, h);
+	LLPointer<LLImageRaw> scaled;
 
 	// Subsequently, 'formatted' is decoded into 'decoded' again,
 	// to serve the full screen preview.
@@ -1185,12 +1188,13 @@ LLSnapshotLivePreview::EAspectSizeProblem LLSnapshotLivePreview::generateFormatt
 	if (mSnapshotType == SNAPSHOT_TEXTURE)
 	{
 		// 'scaled' must be a power of two.
+		scaled = new LLImageRaw(cropped);
 		scaled->biasedScaleToPowerOfTwo(mWidth, mHeight, 1024);
 	}
 	else
 	{
 		// 'scaled' is just the target size.
-		scaled->scale(mWidth, mHeight);
+		scaled = new LLImageRaw(cropped.get(), mWidth, mHeight);
 	}
 
 	bool lossless = false;
@@ -33,9 +33,216 @@
 #include "llviewerprecompiledheaders.h"
 
 #include <ctime>
+#include <deque>
+#if LL_WINDOWS
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 #include "lllogchat.h"
 #include "llappviewer.h"
 #include "llfloaterchat.h"
+#include "llthread.h"
+#include "lltimer.h"
+
+// Appends the lines of saveHistory to the log files on a thread of its own, so
+// that the main thread doesn't wait for the disk. A file stays open while lines
+// are written to it, is synced to disk every few seconds and closed when it
+// has been idle for a minute.
+class LLLogChatWriter : public LLThread
+{
+public:
+	LLLogChatWriter();
+	~LLLogChatWriter();
+
+	// Main thread. Queues a line for the log file with path filename. Waits when the queue is full.
+	void append(std::string const& filename, std::string const& line);
+
+	// Main thread. Returns when everything that was queued before is in the files.
+	void flush();
+
+protected:
+	/*virtual*/ void run(void);
+
+private:
+	struct Line
+	{
+		std::string mFilename;
+		std::string mText;
+	};
+
+	struct File
+	{
+		LLFILE* mFile;
+		F64 mLastWrite;
+		bool mNeedsSync;
+	};
+
+	// Returns false when there was nothing to write.
+	bool writeQueued();
+	void syncFiles(bool close_all);
+
+	enum { MAX_QUEUED_LINES = 1024 };
+	static F64 const SYNC_INTERVAL;
+	static F64 const CLOSE_AFTER;
+
+	LLMutex mQueueMutex;
+	std::deque<Line> mQueue;
+	bool mWriting;				// Lines were taken from mQueue that are not in the files yet.
+
+	// Writer thread only.
+	typedef std::map<std::string, File> file_map_t;
+	file_map_t mFiles;
+	LLTimer mTimer;
+	F64 mLastSync;
+};
+
+F64 const LLLogChatWriter::SYNC_INTERVAL = 5.0;
+F64 const LLLogChatWriter::CLOSE_AFTER = 60.0;
+
+static LLLogChatWriter* sLogChatWriter = NULL;
+
+LLLogChatWriter::LLLogChatWriter() :
+	LLThread("Chat log writer"),
+	mWriting(false),
+	mLastSync(0.0)
+{
+}
+
+LLLogChatWriter::~LLLogChatWriter()
+{
+	// Stop run() first; it writes what is left in the queue.
+	shutdown();
+}
+
+void LLLogChatWriter::append(std::string const& filename, std::string const& line)
+{
+	Line entry;
+	entry.mFilename = filename;
+	entry.mText = line;
+	while (1)
+	{
+		{
+			LLMutexLock lock(&mQueueMutex);
+			if (mQueue.size() < MAX_QUEUED_LINES)
+			{
+				mQueue.push_back(entry);
+				return;
+			}
+		}
+		// The disk can't keep up; rather wait than lose lines.
+		ms_sleep(1);
+	}
+}
+
+void LLLogChatWriter::flush()
+{
+	while (1)
+	{
+		{
+			LLMutexLock lock(&mQueueMutex);
+			if (mQueue.empty() && !mWriting)
+			{
+				return;
+			}
+		}
+		ms_sleep(1);
+	}
+}
+
+bool LLLogChatWriter::writeQueued()
+{
+	std::deque<Line> lines;
+	mQueueMutex.lock();
+	lines.swap(mQueue);
+	mWriting = !lines.empty();
+	mQueueMutex.unlock();
+	if (lines.empty())
+	{
+		return false;
+	}
+
+	F64 now = mTimer.getElapsedTimeF64();
+	for (std::deque<Line>::iterator line = lines.begin(); line != lines.end(); ++line)
+	{
+		file_map_t::iterator iter = mFiles.find(line->mFilename);
+		if (iter == mFiles.end())
+		{
+			LLFILE* fp = LLFile::fopen(line->mFilename, "a");		/*Flawfinder: ignore*/
+			if (!fp)
+			{
+				llinfos << "Couldn't open chat history log!" << llendl;
+				continue;
+			}
+			File file = { fp, now, false };
+			iter = mFiles.insert(file_map_t::value_type(line->mFilename, file)).first;
+		}
+		fprintf(iter->second.mFile, "%s\n", line->mText.c_str());
+		iter->second.mLastWrite = now;
+		iter->second.mNeedsSync = true;
+	}
+
+	// Make the lines visible to loadHistory and to other programs.
+	for (file_map_t::iterator iter = mFiles.begin(); iter != mFiles.end(); ++iter)
+	{
+		if (iter->second.mLastWrite == now)
+		{
+			fflush(iter->second.mFile);
+		}
+	}
+
+	mQueueMutex.lock();
+	mWriting = false;
+	mQueueMutex.unlock();
+	return true;
+}
+
+void LLLogChatWriter::syncFiles(bool close_all)
+{
+	F64 now = mTimer.getElapsedTimeF64();
+	bool sync = close_all || now - mLastSync >= SYNC_INTERVAL;
+	if (sync)
+	{
+		mLastSync = now;
+	}
+	for (file_map_t::iterator iter = mFiles.begin(); iter != mFiles.end();)
+	{
+		File& file = iter->second;
+		if (sync && file.mNeedsSync)
+		{
+			fflush(file.mFile);
+#if LL_WINDOWS
+			_commit(_fileno(file.mFile));
+#else
+			fsync(fileno(file.mFile));
+#endif
+			file.mNeedsSync = false;
+		}
+		if (close_all || now - file.mLastWrite >= CLOSE_AFTER)
+		{
+			fclose(file.mFile);
+			mFiles.erase(iter++);
+		}
+		else
+		{
+			++iter;
+		}
+	}
+}
+
+void LLLogChatWriter::run()
+{
+	while (!isQuitting())
+	{
+		if (!writeQueued())
+		{
+			syncFiles(false);
+			ms_sleep(100);
+		}
+	}
+	writeQueued();
+	syncFiles(true);
+}
 
 
 //static
@@ -114,17 +321,19 @@ void LLLogChat::saveHistory(std::string const& filename, std::string line)
 		return;
 	}
 
-	LLFILE* fp = LLFile::fopen(LLLogChat::makeLogFileName(filename), "a"); 		/*Flawfinder: ignore*/
-	if (!fp)
-	{
-		llinfos << "Couldn't open chat history log!" << llendl;
-	}
-	else
+	if (!sLogChatWriter)
 	{
-		fprintf(fp, "%s\n", line.c_str());
-		
-		fclose (fp);
+		sLogChatWriter = new LLLogChatWriter;
+		sLogChatWriter->start();
 	}
+	sLogChatWriter->append(LLLogChat::makeLogFileName(filename), line);
+}
+
+//static
+void LLLogChat::cleanupClass()
+{
+	delete sLogChatWriter;
+	sLogChatWriter = NULL;
 }
 
 static long const LOG_RECALL_BUFSIZ = 2048;
@@ -142,13 +351,20 @@ void LLLogChat::loadHistory(std::string const& filename , void (*callback)(ELogL
 		static const LLCachedControl<U32> lines("LogShowHistoryLines", 32);
 		if (lines == 0) break;
 
+		// Lines that saveHistory queued have to be in the file first.
+		if (sLogChatWriter)
+		{
+			sLogChatWriter->flush();
+		}
+
 		// Open the log file.
 		LLFILE* fptr = LLFile::fopen(makeLogFileName(filename), "rb");
 		if (!fptr) break;
 
 		// Set pos to point to the last character of the file, if any.
 		if (fseek(fptr, 0, SEEK_END)) break;
-		long pos = ftell(fptr) - 1;
+		long end = ftell(fptr);
+		long pos = end - 1;
 		if (pos < 0) break;
 
 		char buffer[LOG_RECALL_BUFSIZ];
@@ -182,23 +398,30 @@ void LLLogChat::loadHistory(std::string const& filename , void (*callback)(ELogL
 			break;
 		}
 
-		// Set the file pointer at the first line to return.
+		// Read everything from the first line to return till the end of the file at once.
+		std::string tail(end - pos, '\0');
 		fseek(fptr, pos, SEEK_SET);
+		tail.resize(fread(&tail[0], 1, tail.size(), fptr));
+		fclose(fptr);
 
-		// Read lines from the file one by one until we reach the end of the file.
-		while (fgets(buffer, LOG_RECALL_BUFSIZ, fptr))
+		// Pass it on line by line.
+		std::string::size_type start = 0;
+		while (start < tail.size())
 		{
-		  size_t len = strlen(buffer);
-		  int i = len - 1;
-		  while (i >= 0 && (buffer[i] == '\r' || buffer[i] == '\n')) // strip newline chars from the end of the string
-		  {
-			  buffer[i] = '\0';
-			  i--;
-		  }
-		  callback(LOG_LINE, buffer, userdata);
+			std::string::size_type eol = tail.find('\n', start);
+			if (eol == std::string::npos)
+			{
+				eol = tail.size();
+			}
+			std::string::size_type len = eol - start;
+			while (len > 0 && (tail[start + len - 1] == '\r' || tail[start + len - 1] == '\n')) // strip newline chars from the end of the string
+			{
+				--len;
+			}
+			callback(LOG_LINE, tail.substr(start, len), userdata);
+			start = eol + 1;
 		}
 
-		fclose(fptr);
 		callback(LOG_END, LLStringUtil::null, userdata);
 		return;
 	}
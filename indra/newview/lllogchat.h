@@ -51,6 +51,8 @@ public:
 	static void loadHistory(std::string const& filename, 
 		                    void (*callback)(ELogLineType,std::string,void*), 
 							void* userdata);
+	// Writes out the lines that saveHistory still has queued and stops its thread.
+	static void cleanupClass();
 private:
 	static std::string cleanFileName(std::string filename);
 };
@@ -45,6 +45,7 @@
 #include "llsd.h"
 #include "llsdutil_math.h"
 #include "llsdserialize.h"
+#include "llstl.h"
 #include "llthread.h"
 #include "llvfile.h"
 #include "llviewercontrol.h"
@@ -67,6 +68,7 @@
 #include "aicurl.h"
 
 #include "boost/lexical_cast.hpp"
+#include <boost/thread.hpp>
 
 #ifndef LL_WINDOWS
 #include "netdb.h"
@@ -99,11 +101,15 @@ U32 LLMeshRepository::sBytesReceived = 0;
 U32 LLMeshRepository::sHTTPRequestCount = 0;
 U32 LLMeshRepository::sHTTPRetryCount = 0;
 U32 LLMeshRepository::sLODProcessing = 0;
+U32 LLMeshRepository::sLODDecoding = 0;
 U32 LLMeshRepository::sLODPending = 0;
 
 U32 LLMeshRepository::sCacheBytesRead = 0;
 U32 LLMeshRepository::sCacheBytesWritten = 0;
+U32 LLMeshRepository::sDecodedCacheHits = 0;
 U32 LLMeshRepository::sPeakKbps = 0;
+U32 LLMeshRepository::sLastRezLODs = 0;
+F32 LLMeshRepository::sLastRezTime = 0.f;
 	
 
 const U32 MAX_TEXTURE_UPLOAD_RETRIES = 5;
@@ -209,6 +215,7 @@ void get_vertex_buffer_from_mesh(LLCDMeshData& mesh, LLModel::PhysicsMesh& res,
 S32 LLMeshRepoThread::sActiveHeaderRequests = 0;
 S32 LLMeshRepoThread::sActiveLODRequests = 0;
 U32	LLMeshRepoThread::sMaxConcurrentRequests = 1;
+bool LLMeshRepoThread::sUseDecodedLODCache = true;
 
 class LLMeshHeaderResponder : public LLHTTPClient::ResponderWithCompleted
 {
@@ -233,7 +240,7 @@ public:
 				LLMeshRepository::sHTTPRetryCount++;
 				LLMeshRepoThread::HeaderRequest req(mMeshParams);
 				LLMutexLock lock(gMeshRepo.mThread->mMutex);
-				gMeshRepo.mThread->mHeaderReqQ.push(req);
+				gMeshRepo.mThread->mHeaderReqQ.push_back(req);
 			}
 
 			LLMeshRepoThread::decActiveHeaderRequests();
@@ -557,11 +564,18 @@ LLMeshRepoThread::LLMeshRepoThread()
 { 
 	mMutex = new LLMutex();
 	mHeaderMutex = new LLMutex();
+	mDecodeMutex = new LLMutex();
+	mDecodeThreadsMutex = new LLMutex();
 	mSignal = new LLCondition();
 }
 
 LLMeshRepoThread::~LLMeshRepoThread()
 {
+	stopDecodeThreads();
+	delete mDecodeThreadsMutex;
+	mDecodeThreadsMutex = NULL;
+	delete mDecodeMutex;
+	mDecodeMutex = NULL;
 	delete mMutex;
 	mMutex = NULL;
 	delete mHeaderMutex;
@@ -600,14 +614,19 @@ void LLMeshRepoThread::run()
 				if (mMutex)
 				{
 					mMutex->lock();
+					if (mLODReqQ.empty())
+					{	//the main thread took the remaining requests back
+						mMutex->unlock();
+						break;
+					}
 					LODRequest req = mLODReqQ.front();
-					mLODReqQ.pop();
+					mLODReqQ.pop_front();
 					LLMeshRepository::sLODProcessing--;
 					mMutex->unlock();
 					if (!fetchMeshLOD(req.mMeshParams, req.mLOD, count))//failed, resubmit
 					{
 						mMutex->lock();
-						mLODReqQ.push(req);
+						mLODReqQ.push_back(req);
 						mMutex->unlock();
 					}
 				}
@@ -619,12 +638,12 @@ void LLMeshRepoThread::run()
 				{
 					mMutex->lock();
 					HeaderRequest req = mHeaderReqQ.front();
-					mHeaderReqQ.pop();
+					mHeaderReqQ.pop_front();
 					mMutex->unlock();
 					if (!fetchMeshHeader(req.mMeshParams, count))//failed, resubmit
 					{
 						mMutex->lock();
-						mHeaderReqQ.push(req) ;
+						mHeaderReqQ.push_back(req) ;
 						mMutex->unlock();
 					}
 				}
@@ -720,7 +739,7 @@ void LLMeshRepoThread::loadMeshLOD(const LLVolumeParams& mesh_params, S32 lod)
 	{ //if we have the header, request LOD byte range
 		LODRequest req(mesh_params, lod);
 		{
-			mLODReqQ.push(req);
+			mLODReqQ.push_back(req);
 			LLMeshRepository::sLODProcessing++;
 		}
 	}
@@ -737,7 +756,7 @@ void LLMeshRepoThread::loadMeshLOD(const LLVolumeParams& mesh_params, S32 lod)
 		}
 		else
 		{	//if no header request is pending, fetch header
-			mHeaderReqQ.push(req);
+			mHeaderReqQ.push_back(req);
 			mPendingLOD[mesh_params].push_back(lod);
 		}
 	}
@@ -823,6 +842,61 @@ bool LLMeshRepoThread::loadInfoFromVFS(const LLUUID& mesh_id, MeshHeaderInfo& in
 	return false;
 }
 
+//static
+LLUUID LLMeshRepoThread::getDecodedLODID(const LLVolumeParams& mesh_params, S32 lod)
+{
+	//the decoded faces depend on the LOD, the mirror and invert flags and the decoder itself
+	LLUUID salt;
+	salt.generate(llformat("decoded mesh lod %u %d %d", LLVolume::DECODED_FACES_VERSION, lod,
+						   mesh_params.getSculptType() & (LL_SCULPT_FLAG_MIRROR | LL_SCULPT_FLAG_INVERT)));
+	return mesh_params.getSculptID().combine(salt);
+}
+
+bool LLMeshRepoThread::loadDecodedLOD(const LLVolumeParams& mesh_params, S32 lod)
+{
+	LLVFile file(gVFS, getDecodedLODID(mesh_params, lod), LLAssetType::AT_MESH);
+	S32 size = file.getSize();
+	if (size <= 0)
+	{
+		return false;
+	}
+
+	std::vector<U8> buffer(size);
+	file.read(&buffer[0], size);
+
+	LLPointer<LLVolume> volume = new LLVolume(mesh_params, LLVolumeLODGroup::getVolumeScaleFromDetail(lod));
+	if (!volume->unpackDecodedFaces(&buffer[0], size) || volume->getNumFaces() <= 0)
+	{
+		LL_DEBUGS("MeshStreaming") << "Ignoring unusable decoded cache entry for mesh " << mesh_params.getSculptID()
+								   << " LOD " << lod << LL_ENDL;
+		return false;
+	}
+
+	LLMeshRepository::sCacheBytesRead += size;
+	LLMeshRepository::sDecodedCacheHits++;
+
+	LoadedMesh mesh(volume, mesh_params, lod);
+	{
+		LLMutexLock lock(mMutex);
+		mLoadedQ.push(mesh);
+	}
+	return true;
+}
+
+void LLMeshRepoThread::storeDecodedLOD(const LLVolume* volume, const LLVolumeParams& mesh_params, S32 lod)
+{
+	std::string data;
+	volume->packDecodedFaces(data);
+	S32 size = data.size();
+
+	LLVFile file(gVFS, getDecodedLODID(mesh_params, lod), LLAssetType::AT_MESH, LLVFile::WRITE);
+	if (file.getMaxSize() >= size || file.setMaxSize(size))
+	{
+		file.write((const U8*) data.data(), size);
+		LLMeshRepository::sCacheBytesWritten += size;
+	}
+}
+
 bool LLMeshRepoThread::fetchMeshSkinInfo(const LLUUID& mesh_id)
 {
 	MeshHeaderInfo info;
@@ -1007,7 +1081,17 @@ bool LLMeshRepoThread::fetchMeshLOD(const LLVolumeParams& mesh_params, S32 lod,
 	{
 		if(info.mVersion <= MAX_MESH_VERSION && info.mOffset >= 0 && info.mSize > 0)
 		{
-			if (loadInfoFromVFS(mesh_id, info, boost::bind(&LLMeshRepoThread::lodReceived, this, mesh_params, lod, _2, _3 )))
+			//a LOD that was decoded before is copied straight into a volume
+			if (sUseDecodedLODCache && loadDecodedLOD(mesh_params, lod))
+				return true;
+
+			bool refetch;
+			{
+				LLMutexLock lock(mMutex);
+				refetch = mRefetchLODs.erase(std::make_pair(mesh_params, lod)) > 0;
+			}
+
+			if (!refetch && loadInfoFromVFS(mesh_id, info, boost::bind(&LLMeshRepoThread::cachedLODReceived, this, mesh_params, lod, _2, _3 )))
 				return true;
 
 			//reading from VFS failed for whatever reason, fetch from sim
@@ -1090,7 +1174,7 @@ bool LLMeshRepoThread::headerReceived(const LLVolumeParams& mesh_params, U8* dat
 			for (U32 i = 0; i < iter->second.size(); ++i)
 			{
 				LODRequest req(mesh_params, iter->second[i]);
-				mLODReqQ.push(req);
+				mLODReqQ.push_back(req);
 				LLMeshRepository::sLODProcessing++;
 			}
 			mPendingLOD.erase(iter);
@@ -1113,6 +1197,12 @@ bool LLMeshRepoThread::lodReceived(const LLVolumeParams& mesh_params, S32 lod, U
 		AIStateMachine::StateTimer timer("getNumFaces");
 		if (volume->getNumFaces() > 0)
 		{
+			if (sUseDecodedLODCache)
+			{
+				AIStateMachine::StateTimer timer("storeDecodedLOD");
+				storeDecodedLOD(volume, mesh_params, lod);
+			}
+
 			AIStateMachine::StateTimer timer("LoadedMesh");
 			LoadedMesh mesh(volume, mesh_params, lod);
 			{
@@ -1127,6 +1217,163 @@ bool LLMeshRepoThread::lodReceived(const LLVolumeParams& mesh_params, S32 lod, U
 	return false;
 }
 
+bool LLMeshRepoThread::cachedLODReceived(const LLVolumeParams& mesh_params, S32 lod, U8* data, S32 data_size)
+{	//loadInfoFromVFS frees data when we return
+	U8* copy = new U8[data_size];
+	memcpy(copy, data, data_size);
+	queueLODDecode(DecodeRequest(mesh_params, lod, copy, data_size));
+	return true;
+}
+
+void LLMeshRepoThread::startDecodeThreads(S32 count)
+{
+	LLMutexLock lock(mDecodeThreadsMutex);
+	for (S32 i = 0; i < count; ++i)
+	{
+		LLMeshDecodeThread* thread = new LLMeshDecodeThread(this, i);
+		mDecodeThreads.push_back(thread);
+		thread->start();
+	}
+}
+
+void LLMeshRepoThread::stopDecodeThreads()
+{
+	//take the pool out first, so that queueLODDecode decodes on the spot from now on
+	std::vector<LLMeshDecodeThread*> threads;
+	{
+		LLMutexLock lock(mDecodeThreadsMutex);
+		threads.swap(mDecodeThreads);
+	}
+
+	for (std::vector<LLMeshDecodeThread*>::iterator iter = threads.begin(); iter != threads.end(); ++iter)
+	{
+		(*iter)->setQuitting();
+	}
+	for (std::vector<LLMeshDecodeThread*>::iterator iter = threads.begin(); iter != threads.end(); ++iter)
+	{	//a decode thread uses our mutexes and mLoadedQ, so it must be gone before we are
+		S32 timeout = 100;
+		while (!(*iter)->isStopped())
+		{
+			if (timeout-- == 0)
+			{
+				llwarns << "Still waiting for a mesh decode thread to stop." << llendl;
+			}
+			ms_sleep(10);
+		}
+	}
+	for_each(threads.begin(), threads.end(), DeletePointer());
+
+	LLMutexLock lock(mDecodeMutex);
+	while (!mDecodeQ.empty())
+	{
+		delete [] mDecodeQ.front().mData;
+		mDecodeQ.pop();
+	}
+	LLMeshRepository::sLODDecoding = 0;
+}
+
+void LLMeshRepoThread::queueLODDecode(const DecodeRequest& request)
+{ //could be called from any thread
+	mDecodeThreadsMutex->lock();
+	if (mDecodeThreads.empty())
+	{
+		mDecodeThreadsMutex->unlock();
+		decodeLOD(request);
+		return;
+	}
+
+	{
+		LLMutexLock lock(mDecodeMutex);
+		mDecodeQ.push(request);
+		LLMeshRepository::sLODDecoding++;
+	}
+
+	for (std::vector<LLMeshDecodeThread*>::iterator iter = mDecodeThreads.begin(); iter != mDecodeThreads.end(); ++iter)
+	{
+		(*iter)->wake();
+	}
+	mDecodeThreadsMutex->unlock();
+}
+
+bool LLMeshRepoThread::hasQueuedDecodes()
+{
+	LLMutexLock lock(mDecodeMutex);
+	return !mDecodeQ.empty();
+}
+
+bool LLMeshRepoThread::decodeNextLOD()
+{ //called from the decode threads
+	mDecodeMutex->lock();
+	if (mDecodeQ.empty())
+	{
+		mDecodeMutex->unlock();
+		return false;
+	}
+	DecodeRequest request = mDecodeQ.front();
+	mDecodeQ.pop();
+	mDecodeMutex->unlock();
+
+	decodeLOD(request);
+
+	LLMutexLock lock(mDecodeMutex);
+	LLMeshRepository::sLODDecoding--;
+	return true;
+}
+
+void LLMeshRepoThread::decodeLOD(const DecodeRequest& request)
+{
+	if (lodReceived(request.mMeshParams, request.mLOD, request.mData, request.mSize))
+	{
+		if (request.mCacheBytes > 0)
+		{	//good fetch from sim, write to VFS for caching
+			LLVFile file(gVFS, request.mMeshParams.getSculptID(), LLAssetType::AT_MESH, LLVFile::WRITE);
+
+			if (file.getSize() >= request.mOffset + request.mCacheBytes)
+			{
+				file.seek(request.mOffset);
+				file.write(request.mData, request.mCacheBytes);
+				LLMeshRepository::sCacheBytesWritten += request.mCacheBytes;
+			}
+		}
+	}
+	else if (request.mCacheBytes == 0)
+	{	//the VFS copy is bad, fetch this LOD from the sim instead
+		LLMutexLock lock(mMutex);
+		mRefetchLODs.insert(std::make_pair(request.mMeshParams, request.mLOD));
+		mLODReqQ.push_back(LODRequest(request.mMeshParams, request.mLOD));
+		LLMeshRepository::sLODProcessing++;
+	}
+
+	delete [] request.mData;
+}
+
+LLMeshDecodeThread::LLMeshDecodeThread(LLMeshRepoThread* owner, S32 index)
+: LLThread(llformat("mesh decode %d", index)),
+  mOwner(owner)
+{
+}
+
+//virtual
+bool LLMeshDecodeThread::runCondition()
+{
+	return mOwner->hasQueuedDecodes();
+}
+
+//virtual
+void LLMeshDecodeThread::run()
+{
+	while (1)
+	{
+		//sleeps until queueLODDecode wakes us
+		checkPause();
+		if (isQuitting())
+		{
+			break;
+		}
+		mOwner->decodeNextLOD();
+	}
+}
+
 bool LLMeshRepoThread::skinInfoReceived(const LLUUID& mesh_id, U8* data, S32 data_size)
 {
 	LLSD skin;
@@ -1523,8 +1770,10 @@ void LLMeshUploadThread::wholeModelToLLSD(LLSD& dest, bool include_textures)
 				{
 					if(texture->hasSavedRawImage())
 					{											
+						// The saved raw image may share its pixels with the texture's raw image and
+						// convertToUploadFile() scales in place, so work on a copy if it is shared.
 						LLPointer<LLImageJ2C> upload_file =
-							LLViewerTextureList::convertToUploadFile(texture->getSavedRawImage());
+							LLViewerTextureList::convertToUploadFile(texture->getSavedRawImage()->duplicate());
 						texture_str.write((const char*) upload_file->getData(), upload_file->getDataSize());
 					}
 				}
@@ -1795,25 +2044,9 @@ void LLMeshLODResponder::completedRaw(LLChannelDescriptors const& channels,
 		buffer->readAfter(channels.in(), NULL, data, data_size);
 	}
 
-	if (gMeshRepo.mThread->lodReceived(mMeshParams, mLOD, data, data_size))
-	{
-		AIStateMachine::StateTimer timer("FileOpen");
-		//good fetch from sim, write to VFS for caching
-		LLVFile file(gVFS, mMeshParams.getSculptID(), LLAssetType::AT_MESH, LLVFile::WRITE);
-
-		S32 offset = mOffset;
-		S32 size = mRequestedBytes;
-
-		if (file.getSize() >= offset+size)
-		{
-			AIStateMachine::StateTimer timer("WriteData");
-			file.seek(offset);
-			file.write(data, size);
-			LLMeshRepository::sCacheBytesWritten += size;
-		}
-	}
-
-	delete [] data;
+	//decoded, and written to the VFS when good, by the decode threads; they own data now
+	AIStateMachine::StateTimer timer("queueLODDecode");
+	gMeshRepo.mThread->queueLODDecode(LLMeshRepoThread::DecodeRequest(mMeshParams, mLOD, data, data_size, mOffset, mRequestedBytes));
 }
 
 void LLMeshSkinInfoResponder::completedRaw(LLChannelDescriptors const& channels,
@@ -2037,7 +2270,7 @@ void LLMeshHeaderResponder::completedRaw(LLChannelDescriptors const& channels,
 			LLMeshRepository::sHTTPRetryCount++;
 			LLMeshRepoThread::HeaderRequest req(mMeshParams);
 			LLMutexLock lock(gMeshRepo.mThread->mMutex);
-			gMeshRepo.mThread->mHeaderReqQ.push(req);
+			gMeshRepo.mThread->mHeaderReqQ.push_back(req);
 
 			return;
 		}
@@ -2137,7 +2370,10 @@ void LLMeshHeaderResponder::completedRaw(LLChannelDescriptors const& channels,
 LLMeshRepository::LLMeshRepository()
 : mMeshMutex(NULL),
   mMeshThreadCount(0),
-  mThread(NULL)
+  mThread(NULL),
+  mRezzing(false),
+  mRezLODs(0),
+  mRezDecodedCacheHits(0)
 {
 
 }
@@ -2160,6 +2396,16 @@ void LLMeshRepository::init()
 	
 	mThread = new LLMeshRepoThread();
 	mThread->start();
+
+	S32 decode_threads = gSavedSettings.getS32("MeshDecodeThreads");
+	if (decode_threads == 0)
+	{	//leave the other cores to the main thread and the texture decoders
+		decode_threads = llclamp((S32)boost::thread::hardware_concurrency() / 2, 1, 4);
+	}
+	if (decode_threads > 0)
+	{	//otherwise LODs are decoded by whichever thread received them
+		mThread->startDecodeThreads(decode_threads);
+	}
 }
 
 void LLMeshRepository::shutdown()
@@ -2211,6 +2457,15 @@ S32 LLMeshRepository::loadMesh(LLVOVolume* vobj, const LLVolumeParams& mesh_para
 			mLoadingMeshes[detail][mesh_params].insert(vobj->getID());
 			mPendingRequests.push_back(LLMeshRepoThread::LODRequest(mesh_params, detail));
 			LLMeshRepository::sLODPending++;
+
+			if (!mRezzing)
+			{
+				mRezzing = true;
+				mRezTimer.reset();
+				mRezLODs = 0;
+				mRezDecodedCacheHits = sDecodedCacheHits;
+			}
+			mRezLODs++;
 		}
 	}
 
@@ -2272,6 +2527,8 @@ void LLMeshRepository::notifyLoadedMeshes()
 { //called from main thread
 	static const LLCachedControl<U32> max_concurrent_requests("MeshMaxConcurrentRequests");
 	LLMeshRepoThread::sMaxConcurrentRequests = max_concurrent_requests;
+	static const LLCachedControl<bool> decoded_lod_cache("MeshDecodedLODCache");
+	LLMeshRepoThread::sUseDecodedLODCache = decoded_lod_cache;
 
 	//update inventory
 	if (!mInventoryQ.empty())
@@ -2370,47 +2627,24 @@ void LLMeshRepository::notifyLoadedMeshes()
 
 		if (push_count > 0)
 		{
-			//calculate "score" for pending requests
-
-			//create score map
-			std::map<LLUUID, F32> score_map;
-
-			for (U32 i = 0; i < 4; ++i)
-			{
-				for (mesh_load_map::iterator iter = mLoadingMeshes[i].begin();  iter != mLoadingMeshes[i].end(); ++iter)
-				{
-					F32 max_score = 0.f;
-					for (std::set<LLUUID>::iterator obj_iter = iter->second.begin(); obj_iter != iter->second.end(); ++obj_iter)
-					{
-						LLViewerObject* object = gObjectList.findObject(*obj_iter);
-
-						if (object)
-						{
-							LLDrawable* drawable = object->mDrawable;
-							if (drawable)
-							{
-								F32 cur_score = drawable->getRadius()/llmax(drawable->mDistanceWRTCamera, 1.f);
-								max_score = llmax(max_score, cur_score);
-							}
-						}
-					}
-				
-					score_map[iter->first.getSculptID()] = max_score;
-				}
-			}
-
-			//set "score" for pending requests
-			for (std::vector<LLMeshRepoThread::LODRequest>::iterator iter = mPendingRequests.begin(); iter != mPendingRequests.end(); ++iter)
-			{
-				iter->mScore = score_map[iter->mMeshParams.getSculptID()];
-			}
+			//score the requests by what their objects cover on screen right now
+			reprioritizeRequests();
 
 			//sort by "score"
-			std::sort(mPendingRequests.begin(), mPendingRequests.end(), LLMeshRepoThread::CompareScoreGreater());
+			std::stable_sort(mPendingRequests.begin(), mPendingRequests.end(), LLMeshRepoThread::CompareScoreGreater());
+
+			//off screen meshes only get what on screen ones leave: they wait until nothing else is loading
+			bool busy = LLMeshRepoThread::sActiveHeaderRequests > 0 || LLMeshRepoThread::sActiveLODRequests > 0 ||
+						!mThread->mHeaderReqQ.empty() || !mThread->mLODReqQ.empty();
 
 			while (!mPendingRequests.empty() && push_count > 0)
 			{
 				LLMeshRepoThread::LODRequest& request = mPendingRequests.front();
+				if (request.mScore <= 0.f && busy)
+				{
+					break;
+				}
+				busy = busy || request.mScore > 0.f;
 				mThread->loadMeshLOD(request.mMeshParams, request.mLOD);
 				mPendingRequests.erase(mPendingRequests.begin());
 				LLMeshRepository::sLODPending--;
@@ -2440,11 +2674,87 @@ void LLMeshRepository::notifyLoadedMeshes()
 		}
 	
 		mThread->notifyLoadedMeshes();
+
+		if (mRezzing && mPendingRequests.empty() &&
+			mLoadingMeshes[0].empty() && mLoadingMeshes[1].empty() && mLoadingMeshes[2].empty() && mLoadingMeshes[3].empty())
+		{
+			mRezzing = false;
+			sLastRezLODs = mRezLODs;
+			sLastRezTime = mRezTimer.getElapsedTimeF32();
+			LL_DEBUGS("MeshStreaming") << "Rezzed " << mRezLODs << " mesh LODs in " << sLastRezTime << " seconds, "
+									   << sDecodedCacheHits - mRezDecodedCacheHits << " from the decoded cache." << LL_ENDL;
+		}
 	}
 
 	mThread->mSignal->signal();
 }
 
+F32 LLMeshRepository::getLoadScore(const LLVolumeParams& mesh_params, S32 lod)
+{
+	F32 score = 0.f;
+
+	mesh_load_map::iterator iter = mLoadingMeshes[lod].find(mesh_params);
+	if (iter != mLoadingMeshes[lod].end())
+	{
+		for (std::set<LLUUID>::iterator obj_iter = iter->second.begin(); obj_iter != iter->second.end(); ++obj_iter)
+		{
+			LLVOVolume* vobj = (LLVOVolume*) gObjectList.findObject(*obj_iter);
+			if (vobj)
+			{
+				score = llmax(score, vobj->getMeshLoadScore());
+			}
+		}
+	}
+
+	return score;
+}
+
+void LLMeshRepository::reprioritizeRequests()
+{
+	bool on_screen_waiting = false;
+	for (std::vector<LLMeshRepoThread::LODRequest>::iterator iter = mPendingRequests.begin(); iter != mPendingRequests.end(); ++iter)
+	{
+		iter->mScore = getLoadScore(iter->mMeshParams, iter->mLOD);
+		on_screen_waiting = on_screen_waiting || iter->mScore > 0.f;
+	}
+
+	//LOD requests the repo thread did not send yet; once sent they are left to complete,
+	//a mesh LOD is small and aborting would waste what was already transferred
+	std::deque<LLMeshRepoThread::LODRequest>& lod_queue = mThread->mLODReqQ;
+	for (std::deque<LLMeshRepoThread::LODRequest>::iterator iter = lod_queue.begin(); iter != lod_queue.end(); )
+	{
+		iter->mScore = getLoadScore(iter->mMeshParams, iter->mLOD);
+		if (iter->mScore <= 0.f && on_screen_waiting)
+		{	//went off screen while something on screen waits, make room for that
+			mPendingRequests.push_back(*iter);
+			iter = lod_queue.erase(iter);
+			LLMeshRepository::sLODProcessing--;
+			LLMeshRepository::sLODPending++;
+		}
+		else
+		{
+			++iter;
+		}
+	}
+	std::stable_sort(lod_queue.begin(), lod_queue.end(), LLMeshRepoThread::CompareScoreGreater());
+
+	//header requests score with the LODs that wait for them
+	std::deque<LLMeshRepoThread::HeaderRequest>& header_queue = mThread->mHeaderReqQ;
+	for (std::deque<LLMeshRepoThread::HeaderRequest>::iterator iter = header_queue.begin(); iter != header_queue.end(); ++iter)
+	{
+		iter->mScore = 0.f;
+		LLMeshRepoThread::pending_lod_map::iterator pending = mThread->mPendingLOD.find(iter->mMeshParams);
+		if (pending != mThread->mPendingLOD.end())
+		{
+			for (std::vector<S32>::iterator lod = pending->second.begin(); lod != pending->second.end(); ++lod)
+			{
+				iter->mScore = llmax(iter->mScore, getLoadScore(iter->mMeshParams, *lod));
+			}
+		}
+	}
+	std::stable_sort(header_queue.begin(), header_queue.end(), LLMeshRepoThread::CompareScoreGreater());
+}
+
 void LLMeshRepository::notifySkinInfoReceived(LLMeshSkinInfo& info)
 {
 	mSkinMap[info.mMeshID] = info;
@@ -29,6 +29,7 @@
 
 #include "llassettype.h"
 #include "llmodel.h"
+#include "lltimer.h"
 #include "lluuid.h"
 #include "llviewertexture.h"
 #include "llvolume.h"
@@ -41,6 +42,7 @@
 #include "aistatemachinethread.h"
 
 #include <boost/function.hpp>
+#include <deque>
 
 class LLVOVolume;
 class LLMeshResponder;
@@ -215,6 +217,23 @@ public:
 
 };
 
+class LLMeshRepoThread;
+
+//one of a pool of threads that decode mesh LODs for LLMeshRepoThread, so that
+//unzipping, parsing and unpacking the faces of many meshes uses more than one core
+class LLMeshDecodeThread : public LLThread
+{
+public:
+	LLMeshDecodeThread(LLMeshRepoThread* owner, S32 index);
+
+protected:
+	/*virtual*/ bool runCondition();
+	/*virtual*/ void run();
+
+private:
+	LLMeshRepoThread* mOwner;
+};
+
 class LLMeshRepoThread : public LLThread
 {
 public:
@@ -222,6 +241,7 @@ public:
 	static S32 sActiveHeaderRequests;
 	static S32 sActiveLODRequests;
 	static U32 sMaxConcurrentRequests;
+	static bool sUseDecodedLODCache;
 
 	LLMutex*	mMutex;
 	LLMutex*	mHeaderMutex;
@@ -236,10 +256,11 @@ public:
 	class HeaderRequest
 	{ 
 	public:
-		const LLVolumeParams mMeshParams;
+		LLVolumeParams mMeshParams;
+		F32 mScore;
 
 		HeaderRequest(const LLVolumeParams&  mesh_params)
-			: mMeshParams(mesh_params)
+			: mMeshParams(mesh_params), mScore(0.f)
 		{
 		}
 
@@ -268,6 +289,11 @@ public:
 		{
 			return lhs.mScore > rhs.mScore; // greatest = first
 		}
+
+		bool operator()(const HeaderRequest& lhs, const HeaderRequest& rhs)
+		{
+			return lhs.mScore > rhs.mScore;
+		}
 	};
 	
 
@@ -310,11 +336,11 @@ public:
 	//queue of completed Decomposition info requests
 	std::queue<LLModel::Decomposition*> mDecompositionQ;
 
-	//queue of requested headers
-	std::queue<HeaderRequest> mHeaderReqQ;
+	//queue of requested headers, reordered by LLMeshRepository::reprioritizeRequests
+	std::deque<HeaderRequest> mHeaderReqQ;
 
-	//queue of requested LODs
-	std::queue<LODRequest> mLODReqQ;
+	//queue of requested LODs, reordered by LLMeshRepository::reprioritizeRequests
+	std::deque<LODRequest> mLODReqQ;
 
 	//queue of unavailable LODs (either asset doesn't exist or asset doesn't have desired LOD)
 	std::queue<LODRequest> mUnavailableQ;
@@ -326,6 +352,32 @@ public:
 	typedef std::map<LLVolumeParams, std::vector<S32> > pending_lod_map;
 	pending_lod_map mPendingLOD;
 
+	//LOD data waiting for the decode threads, protected by mDecodeMutex
+	class DecodeRequest
+	{
+	public:
+		LLVolumeParams mMeshParams;
+		S32 mLOD;
+		U8* mData;			//owned by the request
+		S32 mSize;
+		S32 mOffset;		//where a good fetch from the sim goes in the VFS copy of the asset
+		S32 mCacheBytes;	//how much of it goes there, 0 for data read from the VFS
+
+		DecodeRequest(const LLVolumeParams& mesh_params, S32 lod, U8* data, S32 size, S32 offset = 0, S32 cache_bytes = 0)
+			: mMeshParams(mesh_params), mLOD(lod), mData(data), mSize(size), mOffset(offset), mCacheBytes(cache_bytes)
+		{
+		}
+	};
+	std::queue<DecodeRequest> mDecodeQ;
+	LLMutex* mDecodeMutex;
+	//the pool, protected by mDecodeThreadsMutex; never taken while holding mDecodeMutex,
+	//as a decode thread's runCondition takes mDecodeMutex under its own run condition lock
+	LLMutex* mDecodeThreadsMutex;
+	std::vector<LLMeshDecodeThread*> mDecodeThreads;
+
+	//LODs whose VFS copy failed to decode, fetched from the sim instead (protected by mMutex)
+	std::set<std::pair<LLVolumeParams, S32> > mRefetchLODs;
+
 	static std::string constructUrl(LLUUID mesh_id);
 
 	LLMeshRepoThread();
@@ -339,6 +391,7 @@ public:
 	bool fetchMeshLOD(const LLVolumeParams& mesh_params, S32 lod, U32& count);
 	bool headerReceived(const LLVolumeParams& mesh_params, U8* data, S32 data_size);
 	bool lodReceived(const LLVolumeParams& mesh_params, S32 lod, U8* data, S32 data_size);
+	bool cachedLODReceived(const LLVolumeParams& mesh_params, S32 lod, U8* data, S32 data_size);
 	bool skinInfoReceived(const LLUUID& mesh_id, U8* data, S32 data_size);
 	bool decompositionReceived(const LLUUID& mesh_id, U8* data, S32 data_size);
 	bool physicsShapeReceived(const LLUUID& mesh_id, U8* data, S32 data_size);
@@ -347,6 +400,20 @@ public:
 	bool getMeshHeaderInfo(const LLUUID& mesh_id, const char* block_name, MeshHeaderInfo& info);
 	bool loadInfoFromVFS(const LLUUID& mesh_id, MeshHeaderInfo& info, boost::function<bool(const LLUUID&, U8*, S32)> fn);
 
+	//second cache tier: LODs as decoded by LLVolume::unpackVolumeFaces, stored in the VFS
+	//next to the mesh asset under an id derived from the mesh id, LOD and sculpt flags
+	static LLUUID getDecodedLODID(const LLVolumeParams& mesh_params, S32 lod);
+	bool loadDecodedLOD(const LLVolumeParams& mesh_params, S32 lod);
+	void storeDecodedLOD(const LLVolume* volume, const LLVolumeParams& mesh_params, S32 lod);
+
+	//decode pool; with no decode threads, queueLODDecode decodes right away
+	void startDecodeThreads(S32 count);
+	void stopDecodeThreads();
+	void queueLODDecode(const DecodeRequest& request);	//takes ownership of request.mData
+	bool hasQueuedDecodes();
+	bool decodeNextLOD();								//returns false when the queue was empty
+	void decodeLOD(const DecodeRequest& request);
+
 	void notifyLoadedMeshes();
 	S32 getActualMeshLOD(const LLVolumeParams& mesh_params, S32 lod);
 	
@@ -484,9 +551,13 @@ public:
 	static U32 sHTTPRetryCount;
 	static U32 sLODPending;
 	static U32 sLODProcessing;
+	static U32 sLODDecoding;
 	static U32 sCacheBytesRead;
 	static U32 sCacheBytesWritten;
+	static U32 sDecodedCacheHits;
 	static U32 sPeakKbps;
+	static U32 sLastRezLODs;		//LODs requested in the last burst of mesh loading
+	static F32 sLastRezTime;		//seconds from the first request of that burst until every LOD was loaded
 	
 	static F32 getStreamingCost(LLSD& header, F32 radius, S32* bytes = NULL, S32* visible_bytes = NULL, S32 detail = -1, F32 *unscaled_value = NULL);
 
@@ -526,6 +597,12 @@ public:
 
 	S32 getMeshSize(const LLUUID& mesh_id, S32 lod);
 
+	//best LLVOVolume::getMeshLoadScore of the objects waiting for a LOD
+	F32 getLoadScore(const LLVolumeParams& mesh_params, S32 lod);
+	//rescores the requests that were not sent yet, and takes LOD requests for meshes that
+	//went off screen back from the repo thread when on screen ones wait (called with its mMutex locked)
+	void reprioritizeRequests();
+
 	typedef std::map<LLVolumeParams, std::set<LLUUID> > mesh_load_map;
 	mesh_load_map mLoadingMeshes[4];
 
@@ -587,6 +664,13 @@ public:
 
 	std::string mGetMeshCapability;
 
+	//time to rez: measured from the first LOD request after the repository was idle
+	//until no LOD is pending or loading anymore
+	LLTimer mRezTimer;
+	bool mRezzing;
+	U32 mRezLODs;
+	U32 mRezDecodedCacheHits;
+
 };
 
 extern LLMeshRepository gMeshRepo;
@@ -784,6 +784,15 @@ bool idle_startup()
 				msg->mPacketRing->setUseOutThrottle(TRUE);
 				msg->mPacketRing->setOutBandwidth(outBandwidth);
 			}
+			if (gSavedSettings.getBOOL("MessageReceiveThread"))
+			{
+				msg->mPacketRing->startReceiveThread(msg->mSocket);
+			}
+			std::string capture_file = gSavedSettings.getString("MessageCaptureFile");
+			if (!capture_file.empty())
+			{
+				msg->startPacketCapture(gDirUtilp->getExpandedFilename(LL_PATH_LOGS, capture_file));
+			}
 		}
 
 		LL_INFOS("AppInit") << "Message System Initialized." << LL_ENDL;
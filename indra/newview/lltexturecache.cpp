@@ -27,6 +27,7 @@
 #include "llviewerprecompiledheaders.h"
 
 #include "lltexturecache.h"
+#include "lltexturecacheshards.h"
 
 #include "llapr.h"
 #include "lldir.h"
@@ -45,11 +46,17 @@
 //  First TEXTURE_CACHE_ENTRY_SIZE bytes of each texture in texture.entries in same order
 // cache/textures/[0-F]/UUID.texture
 //  Actual texture body files
+// cache/textures/texture.shard.[0-F], cache/textures/texture.shards
+//  Or, with TextureCacheShards, all bodies in 16 append-only files (see lltexturecacheshards.h)
+// cache/texture.journal
+//  JournalRecords of changed entries not yet written to texture.entries
 
 //note: there is no good to define 1024 for TEXTURE_CACHE_ENTRY_SIZE while FIRST_PACKET_SIZE is 600 on sim side.
 const S32 TEXTURE_CACHE_ENTRY_SIZE = FIRST_PACKET_SIZE;//1024;
 const F32 TEXTURE_CACHE_PURGE_AMOUNT = .20f; // % amount to reduce the cache by when it exceeds its limit
 const F32 TEXTURE_CACHE_LRU_SIZE = .10f; // % amount for LRU list (low overhead to regenerate)
+const U32 JOURNAL_RECORD_MAGIC = 0x4c4e524a; // "JRNL"
+const U32 JOURNAL_CHECKPOINT_RECORDS = 4096; // write texture.entries once the journal has this many records
 
 static std::queue<LLUUID> sgDelayedPurgeQueue;
 
@@ -457,8 +464,7 @@ bool LLTextureCacheRemoteWorker::doRead()
 	// Fourth state / stage : read the rest of the data from the UUID based cached file
 	if (!done && (mState == BODY))
 	{
-		std::string filename = mCache->getTextureFileName(mID);
-		S32 filesize = LLAPRFile::size(filename);
+		S32 filesize = mCache->getBodySize(mID);
 
 		if (filesize && (filesize + TEXTURE_CACHE_ENTRY_SIZE) > mOffset)
 		{
@@ -498,7 +504,7 @@ bool LLTextureCacheRemoteWorker::doRead()
 			mReadData = data;
 
 			// Read the data at last
-			S32 bytes_read = LLAPRFile::readEx(filename, 
+			S32 bytes_read = mCache->readBody(mID,
 											 mReadData + data_offset,
 											 file_offset, file_size);
 			if (bytes_read != file_size)
@@ -516,7 +522,7 @@ bool LLTextureCacheRemoteWorker::doRead()
 		{
 			// No body, we're done.
 			mDataSize = llmax(TEXTURE_CACHE_ENTRY_SIZE - mOffset, 0);
-			lldebugs << "No body file for: " << filename << llendl;
+			lldebugs << "No body file for: " << mID << llendl;
 		}	
 		// Nothing else to do at that point...
 		done = true;
@@ -637,12 +643,8 @@ bool LLTextureCacheRemoteWorker::doWrite()
 		S32 file_size = mDataSize - TEXTURE_CACHE_ENTRY_SIZE;
 		
 		{
-			// build the cache file name from the UUID
-			std::string filename = mCache->getTextureFileName(mID);			
-// 			llinfos << "Writing Body: " << filename << " Bytes: " << file_offset+file_size << llendl;
-			S32 bytes_written = LLAPRFile::writeEx(	filename, 
-													mWriteData + TEXTURE_CACHE_ENTRY_SIZE,
-													0, file_size);
+// 			llinfos << "Writing Body: " << mID << " Bytes: " << file_size << llendl;
+			S32 bytes_written = mCache->writeBody(mID, mWriteData + TEXTURE_CACHE_ENTRY_SIZE, file_size);
 			if (bytes_written <= 0)
 			{
 				llwarns << "LLTextureCacheWorker: "  << mID
@@ -737,19 +739,61 @@ void LLTextureCacheWorker::endWork(S32 param, bool aborted)
 
 //////////////////////////////////////////////////////////////////////////////
 
+// Rewrites the most fragmented body shard on the cache thread.
+class LLTextureCacheCompactWorker : public LLWorkerClass
+{
+public:
+	LLTextureCacheCompactWorker(LLTextureCache* cache)
+		: LLWorkerClass(cache, "LLTextureCacheCompactWorker"),
+		  mCache(cache)
+	{
+	}
+
+	void compact() { addWork(0, LLWorkerThread::PRIORITY_LOW); }
+	bool complete() { return checkWork(); }
+
+	virtual bool doWork(S32 param)
+	{
+		LLTimer timer;
+		S64 reclaimed = mCache->mShards->compact();
+		LL_INFOS("TextureCache") << "Compacted a texture cache shard: reclaimed " << reclaimed / 1024
+				<< " kB in " << timer.getElapsedTimeF32() << "s" << LL_ENDL;
+		return true;
+	}
+
+private:
+	virtual void startWork(S32 param) {}
+	virtual void endWork(S32 param, bool aborted) {}
+
+	LLTextureCache* mCache;
+};
+
+//////////////////////////////////////////////////////////////////////////////
+
 LLTextureCache::LLTextureCache(bool threaded)
 	: LLWorkerThread("TextureCache", threaded),
 	  mHeaderAPRFile(NULL),
 	  mReadOnly(TRUE), //do not allow to change the texture cache until setReadOnly() is called.
 	  mTexturesSizeTotal(0),
-	  mDoPurge(FALSE)
+	  mDoPurge(FALSE),
+	  mShards(NULL),
+	  mCompactWorker(NULL),
+	  mJournalRecords(0),
+	  mJournalBatchSize(64)
 {
 }
 
 LLTextureCache::~LLTextureCache()
 {
+	if (mCompactWorker)
+	{
+		mCompactWorker->scheduleDelete();
+		mCompactWorker = NULL;
+	}
 	clearDeleteList();
 	writeUpdatedEntries();
+	delete mShards;		// writes the shard index
+	mShards = NULL;
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -759,6 +803,8 @@ S32 LLTextureCache::update(F32 max_time_ms)
 {
 	static LLFrameTimer timer;
 	static const F32 MAX_TIME_INTERVAL = 300.f; //seconds.
+	static LLFrameTimer compact_timer;
+	static const F32 COMPACT_CHECK_INTERVAL = 10.f; //seconds.
 
 	S32 res;
 	res = LLWorkerThread::update(max_time_ms);
@@ -795,12 +841,34 @@ S32 LLTextureCache::update(F32 max_time_ms)
 		responder->completed(success);
 	}
 	
+	// Write behind the entries changed this frame, unless a worker is busy with the headers.
+	if (mHeaderMutex.try_lock())
+	{
+		flushDirtyEntries();
+		mHeaderMutex.unlock();
+	}
+
 	if(!res && timer.getElapsedTimeF32() > MAX_TIME_INTERVAL)
 	{
 		timer.reset();
 		writeUpdatedEntries();
 	}
 
+	if (mCompactWorker && mCompactWorker->complete())
+	{
+		mCompactWorker->scheduleDelete();
+		mCompactWorker = NULL;
+	}
+	if (!res && !mCompactWorker && mShards && !mReadOnly && compact_timer.getElapsedTimeF32() > COMPACT_CHECK_INTERVAL)
+	{
+		compact_timer.reset();
+		if (mShards->needsCompaction())
+		{
+			mCompactWorker = new LLTextureCacheCompactWorker(this);
+			mCompactWorker->compact();
+		}
+	}
+
 	return res;
 }
 
@@ -823,6 +891,54 @@ std::string LLTextureCache::getTextureFileName(const LLUUID& id)
 	return filename;
 }
 
+S32 LLTextureCache::getBodySize(const LLUUID& id)
+{
+	if (mShards)
+	{
+		return mShards->getSize(id);
+	}
+	return LLAPRFile::size(getTextureFileName(id));
+}
+
+S32 LLTextureCache::readBody(const LLUUID& id, U8* buffer, S32 offset, S32 size)
+{
+	if (mShards)
+	{
+		return mShards->read(id, buffer, offset, size);
+	}
+	return LLAPRFile::readEx(getTextureFileName(id), buffer, offset, size);
+}
+
+S32 LLTextureCache::writeBody(const LLUUID& id, const U8* data, S32 size)
+{
+	if (mShards)
+	{
+		return mShards->write(id, data, size);
+	}
+	return LLAPRFile::writeEx(getTextureFileName(id), (void*)data, 0, size);
+}
+
+bool LLTextureCache::bodyExists(const LLUUID& id)
+{
+	if (mShards)
+	{
+		return mShards->getSize(id) > 0;
+	}
+	return LLAPRFile::isExist(getTextureFileName(id));
+}
+
+void LLTextureCache::removeBody(const LLUUID& id)
+{
+	if (mShards)
+	{
+		mShards->remove(id);
+	}
+	else
+	{
+		LLAPRFile::remove(getTextureFileName(id));
+	}
+}
+
 //debug
 BOOL LLTextureCache::isInCache(const LLUUID& id) 
 {
@@ -875,11 +991,14 @@ BOOL LLTextureCache::isInLocal(const LLUUID& id)
 
 //static
 const S32 MAX_REASONABLE_FILE_SIZE = 512*1024*1024; // 512 MB
-F32 LLTextureCache::sHeaderCacheVersion = 1.8f;
+const F32 HEADER_CACHE_VERSION = 1.8f;
+const F32 SHARDED_HEADER_CACHE_VERSION = 1.9f; // same entries, bodies in texture.shard.N
+F32 LLTextureCache::sHeaderCacheVersion = HEADER_CACHE_VERSION;
 U32 LLTextureCache::sCacheMaxEntries = MAX_REASONABLE_FILE_SIZE / TEXTURE_CACHE_ENTRY_SIZE;
 S64 LLTextureCache::sCacheMaxTexturesSize = 0; // no limit
 const char* entries_filename = "texture.entries";
 const char* cache_filename = "texture.cache";
+const char* journal_filename = "texture.journal";
 const char* old_textures_dirname = "textures";
 //change the location of the texture cache to prevent from being deleted by old version viewers.
 const char* textures_dirname = "texturecache";
@@ -890,6 +1009,7 @@ void LLTextureCache::setDirNames(ELLPath location)
 
 	mHeaderEntriesFileName = gDirUtilp->getExpandedFilename(location, textures_dirname, entries_filename);
 	mHeaderDataFileName = gDirUtilp->getExpandedFilename(location, textures_dirname, cache_filename);
+	mHeaderJournalFileName = gDirUtilp->getExpandedFilename(location, textures_dirname, journal_filename);
 	mTexturesDirName = gDirUtilp->getExpandedFilename(location, textures_dirname);
 }
 
@@ -963,17 +1083,48 @@ S64 LLTextureCache::initCache(ELLPath location, S64 max_size, BOOL texture_cache
 		}
 	}
 	
+	// Switching between body layouts changes the version, which purges the cache.
+	bool use_shards = gSavedSettings.getBOOL("TextureCacheShards");
+	mJournalBatchSize = llmax(gSavedSettings.getU32("TextureCacheJournalBatch"), (U32)1);
+	sHeaderCacheVersion = use_shards ? SHARDED_HEADER_CACHE_VERSION : HEADER_CACHE_VERSION;
+
 	if (!mReadOnly)
 	{
 		LLFile::mkdir(mTexturesDirName);
 		
 		const char* subdirs = "0123456789abcdef";
-		for (S32 i=0; i<16; i++)
+		for (S32 i=0; i<16 && !use_shards; i++)
 		{
 			std::string dirname = mTexturesDirName + gDirUtilp->getDirDelimiter() + subdirs[i];
 			LLFile::mkdir(dirname);
 		}
 	}
+	if (use_shards)
+	{
+		LLTimer timer;
+		mShards = new LLTextureCacheShards;
+		if (mShards->open(mTexturesDirName + gDirUtilp->getDirDelimiter(), mReadOnly))
+		{
+			LL_INFOS("TextureCache") << "Opened texture cache shards: " << mShards->getLiveBytes() / (1024 * 1024) << " MB live, "
+					<< mShards->getGarbageBytes() / (1024 * 1024) << " MB garbage in " << timer.getElapsedTimeF32() << "s" << LL_ENDL;
+		}
+		else
+		{
+			LL_WARNS("TextureCache") << "Could not open the texture cache shards, using one file per texture" << LL_ENDL;
+			delete mShards;
+			mShards = NULL;
+			sHeaderCacheVersion = HEADER_CACHE_VERSION;
+			if (!mReadOnly)
+			{
+				// Don't leave what we did manage to open or create behind.
+				LLTextureCacheShards::removeFiles(mTexturesDirName + gDirUtilp->getDirDelimiter());
+			}
+			for (S32 i=0; i<16 && !mReadOnly; i++)
+			{
+				LLFile::mkdir(mTexturesDirName + gDirUtilp->getDirDelimiter() + "0123456789abcdef"[i]);
+			}
+		}
+	}
 	readHeaderCache();
 	purgeTextures(true); // calc mTexturesSize and make some room in the texture cache if we need it
 
@@ -1096,12 +1247,7 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
 		// Remove this entry from the LRU if it exists
 		mLRU.erase(id);
 		// Read the entry
-		idx_entry_map_t::iterator iter = mUpdatedEntryMap.find(idx);
-		if(iter != mUpdatedEntryMap.end())
-		{
-			entry = iter->second;
-		}
-		else
+		if (!findPendingEntry(idx, entry))
 		{
 			readEntryFromHeaderImmediately(idx, entry);
 		}
@@ -1112,7 +1258,7 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
 			//erase this entry and the cached texture from the cache.
 			std::string tex_filename = getTextureFileName(id);
 			removeEntry(idx, entry, tex_filename);
-			mUpdatedEntryMap.erase(idx);
+			queueEntryWrite(idx, entry);
 			idx = -1;
 		}
 	}
@@ -1120,39 +1266,114 @@ S32 LLTextureCache::openAndReadEntry(const LLUUID& id, Entry& entry, bool create
 }
 
 //mHeaderMutex is locked before calling this.
-void LLTextureCache::writeEntryToHeaderImmediately(S32& idx, Entry& entry, bool write_header)
-{	
-	LLAPRFile* aprfile;
-	S32 bytes_written;
-	S32 offset = sizeof(EntriesInfo) + idx * sizeof(Entry);
-	if(write_header)
-	{
-		aprfile = openHeaderEntriesFile(false, 0);		
-		bytes_written = aprfile->write((U8*)&mHeaderEntriesInfo, sizeof(EntriesInfo));
-		if(bytes_written != sizeof(EntriesInfo))
+//queue a changed entry for the journal, see flushDirtyEntries().
+void LLTextureCache::queueEntryWrite(S32 idx, const Entry& entry)
+{
+	mDirtyEntryMap[idx] = entry;
+	mUpdatedEntryMap.erase(idx);
+	if (mDirtyEntryMap.size() >= mJournalBatchSize)
+	{
+		flushDirtyEntries();
+	}
+}
+
+//mHeaderMutex is locked before calling this.
+//returns the newest copy of an entry that isn't in texture.entries yet.
+bool LLTextureCache::findPendingEntry(S32 idx, Entry& entry)
+{
+	idx_entry_map_t::const_iterator iter = mDirtyEntryMap.find(idx);
+	if (iter == mDirtyEntryMap.end())
+	{
+		iter = mUpdatedEntryMap.find(idx);
+		if (iter == mUpdatedEntryMap.end())
 		{
-			clearCorruptedCache(); //clear the cache.
-			idx = -1; //mark the idx invalid.
-			return;
+			iter = mJournalEntryMap.find(idx);
+			if (iter == mJournalEntryMap.end())
+			{
+				return false;
+			}
 		}
+	}
+	entry = iter->second;
+	return true;
+}
 
-		mHeaderAPRFile->seek(APR_SET, offset);
+bool LLTextureCache::hasPendingEntries() const
+{
+	return !mDirtyEntryMap.empty() || !mUpdatedEntryMap.empty() || !mJournalEntryMap.empty();
+}
+
+//mHeaderMutex is locked before calling this.
+//appends all dirty entries to the journal in one write. texture.entries
+//itself is only written at checkpoints, when the journal gets long.
+void LLTextureCache::flushDirtyEntries()
+{
+	if (mDirtyEntryMap.empty() || mReadOnly)
+	{
+		return;
 	}
-	else
+
+	std::vector<JournalRecord> records(mDirtyEntryMap.size());
+	S32 i = 0;
+	for (idx_entry_map_t::iterator iter = mDirtyEntryMap.begin(); iter != mDirtyEntryMap.end(); ++iter)
 	{
-		aprfile = openHeaderEntriesFile(false, offset);
+		JournalRecord& record = records[i++];
+		record.mMagic = JOURNAL_RECORD_MAGIC;
+		record.mIdx = iter->first;
+		record.mEntries = mHeaderEntriesInfo.mEntries;
+		record.mEntry = iter->second;
+		mJournalEntryMap[iter->first] = iter->second;
 	}
-	bytes_written = aprfile->write((void*)&entry, (S32)sizeof(Entry));
-	if(bytes_written != sizeof(Entry))
+	mDirtyEntryMap.clear();
+
+	S32 size = (S32)(records.size() * sizeof(JournalRecord));
+	S32 bytes_written = LLAPRFile::writeEx(mHeaderJournalFileName, &records[0], -1, size);
+	mJournalRecords += records.size();
+	if (bytes_written != size || mJournalRecords >= JOURNAL_CHECKPOINT_RECORDS)
 	{
-		clearCorruptedCache(); //clear the cache.
-		idx = -1; //mark the idx invalid.
+		// Checkpoint: everything pending goes to texture.entries and the journal starts over.
+		openHeaderEntriesFile(false, 0);
+		updatedHeaderEntriesFile();
+		closeHeaderEntriesFile();
+	}
+}
 
+//mHeaderMutex is locked before calling this.
+//picks up the entries that were journaled but never made it to texture.entries, e.g. after a crash.
+void LLTextureCache::replayJournal()
+{
+	mJournalRecords = 0;
+	if (!LLAPRFile::isExist(mHeaderJournalFileName))
+	{
 		return;
 	}
 
-	closeHeaderEntriesFile();
-	mUpdatedEntryMap.erase(idx);
+	S32 count = LLAPRFile::size(mHeaderJournalFileName) / (S32)sizeof(JournalRecord);
+	S32 replayed = 0;
+	if (count > 0)
+	{
+		std::vector<JournalRecord> records(count);
+		count = LLAPRFile::readEx(mHeaderJournalFileName, &records[0], 0, count * sizeof(JournalRecord)) / (S32)sizeof(JournalRecord);
+		for (S32 i = 0; i < count; i++)
+		{
+			const JournalRecord& record = records[i];
+			if (record.mMagic != JOURNAL_RECORD_MAGIC || record.mIdx < 0 || (U32)record.mIdx >= record.mEntries)
+			{
+				break; // torn write at the end
+			}
+			mJournalEntryMap[record.mIdx] = record.mEntry;
+			mHeaderEntriesInfo.mEntries = llmax(mHeaderEntriesInfo.mEntries, record.mEntries);
+			++replayed;
+		}
+	}
+	llinfos << "Replayed " << replayed << " texture cache entries from the journal" << llendl;
+
+	if (!mReadOnly && mJournalEntryMap.empty())
+	{
+		LLAPRFile::remove(mHeaderJournalFileName);
+	}
+	// Otherwise openAndReadEntries() writes them to texture.entries and removes the journal,
+	// or, when read-only, lays them over the entries it reads and leaves both files alone.
 }
 
 //mHeaderMutex is locked before calling this.
@@ -1186,12 +1407,20 @@ void LLTextureCache::updateEntryTimeStamp(S32 idx, Entry& entry)
 		if (!mReadOnly)
 		{
 			entry.mTime = time(NULL);
-			mUpdatedEntryMap[idx] = entry;
+			idx_entry_map_t::iterator iter = mDirtyEntryMap.find(idx);
+			if (iter != mDirtyEntryMap.end())
+			{
+				iter->second = entry; // going to the journal anyway
+			}
+			else
+			{
+				mUpdatedEntryMap[idx] = entry;
+			}
 		}
 	}
 }
 
-//update an existing entry, write to header file immediately.
+//update an existing entry, written behind through the journal.
 bool LLTextureCache::updateEntry(S32& idx, Entry& entry, S32 new_image_size, S32 new_data_size)
 {
 	S32 new_body_size = llmax(0, new_data_size - TEXTURE_CACHE_ENTRY_SIZE);
@@ -1206,15 +1435,11 @@ bool LLTextureCache::updateEntry(S32& idx, Entry& entry, S32 new_image_size, S32
 			
 		lockHeaders();
 
-		bool update_header = false;
 		if(entry.mImageSize < 0) //is a brand-new entry
 			{
 			mHeaderIDMap[entry.mID] = idx;
 			mTexturesSizeMap[entry.mID] = new_body_size;
 			mTexturesSizeTotal += new_body_size;
-			
-			// Update Header
-			update_header = true;
 			}
 		else if (entry.mBodySize != new_body_size)
 		{
@@ -1227,7 +1452,7 @@ bool LLTextureCache::updateEntry(S32& idx, Entry& entry, S32 new_image_size, S32
 		entry.mImageSize = new_image_size; 
 		entry.mBodySize = new_body_size;
 		
-		writeEntryToHeaderImmediately(idx, entry, update_header);
+		queueEntryWrite(idx, entry); // the journal record carries the new header entry count
 	
 		if (mTexturesSizeTotal > sCacheMaxTexturesSize)
 		{
@@ -1254,8 +1479,12 @@ U32 LLTextureCache::openAndReadEntries(std::vector<Entry>& entries)
 	mFreeList.clear();
 	mTexturesSizeTotal = 0;
 
+	//a read-only cache can't fold the journal of the viewer that owns it into texture.entries,
+	//so the journaled entries are laid over what is read from the file instead.
+	bool overlay = mReadOnly && hasPendingEntries();
+
 	LLAPRFile* aprfile = NULL; 
-	if(mUpdatedEntryMap.empty())
+	if(mReadOnly || !hasPendingEntries())
 	{
 		aprfile = openHeaderEntriesFile(true, (S32)sizeof(EntriesInfo));
 	}
@@ -1273,6 +1502,10 @@ U32 LLTextureCache::openAndReadEntries(std::vector<Entry>& entries)
 	{
 		Entry entry;
 		S32 bytes_read = aprfile->read((void*)(&entry), (S32)sizeof(Entry));
+		if (overlay && findPendingEntry(idx, entry))
+		{
+			bytes_read = sizeof(Entry); //entries added since the last checkpoint are only in the journal
+		}
 		if (bytes_read < sizeof(Entry))
 		{
 			llwarns << "Corrupted header entries, failed at " << idx << " / " << num_entries << llendl;
@@ -1321,7 +1554,7 @@ void LLTextureCache::writeEntriesAndClose(const std::vector<Entry>& entries)
 void LLTextureCache::writeUpdatedEntries()
 {
 	lockHeaders();
-	if (!mReadOnly && !mUpdatedEntryMap.empty())
+	if (!mReadOnly && hasPendingEntries())
 	{
 		openHeaderEntriesFile(false, 0);
 		updatedHeaderEntriesFile();
@@ -1333,7 +1566,7 @@ void LLTextureCache::writeUpdatedEntries()
 //mHeaderMutex is locked and mHeaderAPRFile is created before calling this.
 void LLTextureCache::updatedHeaderEntriesFile()
 {
-	if (!mReadOnly && !mUpdatedEntryMap.empty() && mHeaderAPRFile)
+	if (!mReadOnly && hasPendingEntries() && mHeaderAPRFile)
 	{
 		//entriesInfo
 		mHeaderAPRFile->seek(APR_SET, 0);
@@ -1344,11 +1577,22 @@ void LLTextureCache::updatedHeaderEntriesFile()
 			return;
 		}
 		
+		//merge the pending entries, newest copy wins
+		idx_entry_map_t entries = mJournalEntryMap;
+		for (idx_entry_map_t::iterator iter = mUpdatedEntryMap.begin(); iter != mUpdatedEntryMap.end(); ++iter)
+		{
+			entries[iter->first] = iter->second;
+		}
+		for (idx_entry_map_t::iterator iter = mDirtyEntryMap.begin(); iter != mDirtyEntryMap.end(); ++iter)
+		{
+			entries[iter->first] = iter->second;
+		}
+
 		//write each updated entry
 		S32 entry_size = (S32)sizeof(Entry);
 		S32 prev_idx = -1;
 		S32 delta_idx;
-		for (idx_entry_map_t::iterator iter = mUpdatedEntryMap.begin(); iter != mUpdatedEntryMap.end(); ++iter)
+		for (idx_entry_map_t::iterator iter = entries.begin(); iter != entries.end(); ++iter)
 		{
 			delta_idx = iter->first - prev_idx - 1;
 			prev_idx = iter->first;
@@ -1365,6 +1609,15 @@ void LLTextureCache::updatedHeaderEntriesFile()
 			}
 		}
 		mUpdatedEntryMap.clear();
+		mDirtyEntryMap.clear();
+		mJournalEntryMap.clear();
+
+		//everything journaled is in texture.entries now
+		mJournalRecords = 0;
+		if (LLAPRFile::isExist(mHeaderJournalFileName))
+		{
+			LLAPRFile::remove(mHeaderJournalFileName);
+		}
 	}
 }
 //----------------------------------------------------------------------------
@@ -1387,6 +1640,10 @@ void LLTextureCache::readHeaderCache()
 	}
 	else
 	{
+		if (!hasPendingEntries())
+		{
+			replayJournal(); // otherwise we wrote the journal ourselves and openAndReadEntries() checkpoints it
+		}
 		std::vector<Entry> entries;
 		U32 num_entries = openAndReadEntries(entries);
 		if (num_entries)
@@ -1495,7 +1752,7 @@ void LLTextureCache::clearCorruptedCache()
 		LLFile::mkdir(mTexturesDirName);
 		
 		const char* subdirs = "0123456789abcdef";
-		for (S32 i=0; i<16; i++)
+		for (S32 i=0; i<16 && !mShards; i++)
 		{
 			std::string dirname = mTexturesDirName + gDirUtilp->getDirDelimiter() + subdirs[i];
 			LLFile::mkdir(dirname);
@@ -1507,6 +1764,18 @@ void LLTextureCache::clearCorruptedCache()
 
 void LLTextureCache::purgeAllTextures(bool purge_directories)
 {
+	if (mShards)
+	{
+		if (purge_directories)
+		{
+			delete mShards;		// the files go with the directory below
+			mShards = NULL;
+		}
+		else
+		{
+			mShards->clear();
+		}
+	}
 	if (!mReadOnly)
 	{
 		const char* subdirs = "0123456789abcdef";
@@ -1522,6 +1791,11 @@ void LLTextureCache::purgeAllTextures(bool purge_directories)
 				LLFile::rmdir(dirname);
 			}
 		}
+		if (!mShards)
+		{
+			// Also when the shards are off now, or failed to open: left alone they'd stay on disk forever.
+			LLTextureCacheShards::removeFiles(mTexturesDirName + delem);
+		}
 		if (purge_directories)
 		{
 			gDirUtilp->deleteFilesInDir(mTexturesDirName, mask);
@@ -1534,6 +1808,13 @@ void LLTextureCache::purgeAllTextures(bool purge_directories)
 	mFreeList.clear();
 	mTexturesSizeTotal = 0;
 	mUpdatedEntryMap.clear();
+	mDirtyEntryMap.clear();
+	mJournalEntryMap.clear();
+	mJournalRecords = 0;
+	if (!mReadOnly && LLAPRFile::isExist(mHeaderJournalFileName))
+	{
+		LLAPRFile::remove(mHeaderJournalFileName);
+	}
 
 	// Info with 0 entries
 	mHeaderEntriesInfo.mVersion = sHeaderCacheVersion;
@@ -1639,7 +1920,7 @@ void LLTextureCache::purgeTextures(bool validate)
 			if (uuididx == validate_idx)
 			{
  				LL_DEBUGS("TextureCache") << "Validating: " << filename << "Size: " << entries[idx].mBodySize << LL_ENDL;
-				S32 bodysize = LLAPRFile::size(filename);
+				S32 bodysize = getBodySize(entries[idx].mID);
 				if (bodysize != entries[idx].mBodySize)
 				{
 					LL_WARNS("TextureCache") << "TEXTURE CACHE BODY HAS BAD SIZE: " << bodysize << " != " << entries[idx].mBodySize
@@ -1882,7 +2163,7 @@ void LLTextureCache::removeCachedTexture(const LLUUID& id)
 		mTexturesSizeMap.erase(id);
 	}
 	mHeaderIDMap.erase(id);
-	LLAPRFile::remove(getTextureFileName(id));		
+	removeBody(id);
 }
 
 //called after mHeaderMutex is locked.
@@ -1894,7 +2175,7 @@ void LLTextureCache::removeEntry(S32 idx, Entry& entry, std::string& filename)
 	{
 		if (entry.mBodySize == 0)	// Always attempt to remove when mBodySize > 0.
 		{
-		  if (LLAPRFile::isExist(filename))		// Sanity check. Shouldn't exist when body size is 0.
+		  if (bodyExists(entry.mID))		// Sanity check. Shouldn't exist when body size is 0.
 		  {
 			  LL_WARNS("TextureCache") << "Entry has body size of zero but file " << filename << " exists. Deleting this file, too." << LL_ENDL;
 		  }
@@ -1914,7 +2195,14 @@ void LLTextureCache::removeEntry(S32 idx, Entry& entry, std::string& filename)
 
 	if (file_maybe_exists)
 	{
-		LLAPRFile::remove(filename);
+		if (mShards)
+		{
+			mShards->remove(entry.mID);
+		}
+		else
+		{
+			LLAPRFile::remove(filename);
+		}
 	}
 }
 
@@ -1928,11 +2216,12 @@ bool LLTextureCache::removeFromCache(const LLUUID& id)
 
 		Entry entry;
 		S32 idx = openAndReadEntry(id, entry, false);
+		entry.mID = id;		// removeEntry() needs it for the shards even if there is no entry
 		std::string tex_filename = getTextureFileName(id);
 		removeEntry(idx, entry, tex_filename);
 		if (idx >= 0)
 		{			
-			writeEntryToHeaderImmediately(idx, entry);					
+			queueEntryWrite(idx, entry);
 			ret = true;
 		}
 
@@ -36,12 +36,15 @@
 
 class LLImageFormatted;
 class LLTextureCacheWorker;
+class LLTextureCacheCompactWorker;
+class LLTextureCacheShards;
 
 class LLTextureCache : public LLWorkerThread
 {
 	friend class LLTextureCacheWorker;
 	friend class LLTextureCacheRemoteWorker;
 	friend class LLTextureCacheLocalFileWorker;
+	friend class LLTextureCacheCompactWorker;
 
 private:
 	// Entries
@@ -68,6 +71,14 @@ private:
 		S32 mBodySize; // size of body file in body cache
 		U32 mTime; // seconds since 1/1/1970
 	};
+	// A record of the write-behind journal (texture.journal), see flushDirtyEntries().
+	struct JournalRecord
+	{
+		U32 mMagic;
+		S32 mIdx;
+		U32 mEntries; // mHeaderEntriesInfo.mEntries when the record was written
+		Entry mEntry;
+	};
 
 	
 public:
@@ -159,9 +170,19 @@ private:
 	U32 openAndReadEntries(std::vector<Entry>& entries);
 	void writeEntriesAndClose(const std::vector<Entry>& entries);
 	void readEntryFromHeaderImmediately(S32& idx, Entry& entry) ;
-	void writeEntryToHeaderImmediately(S32& idx, Entry& entry, bool write_header = false) ;
+	void queueEntryWrite(S32 idx, const Entry& entry);
+	bool findPendingEntry(S32 idx, Entry& entry);
+	bool hasPendingEntries() const;
+	void flushDirtyEntries();
+	void replayJournal();
 	void removeEntry(S32 idx, Entry& entry, std::string& filename);
 	void removeCachedTexture(const LLUUID& id) ;
+	// Body storage, either the sharded store or one file per texture.
+	S32 getBodySize(const LLUUID& id);
+	S32 readBody(const LLUUID& id, U8* buffer, S32 offset, S32 size);
+	S32 writeBody(const LLUUID& id, const U8* data, S32 size);
+	bool bodyExists(const LLUUID& id);
+	void removeBody(const LLUUID& id);
 	S32 getHeaderCacheEntry(const LLUUID& id, Entry& entry);
 	S32 setHeaderCacheEntry(const LLUUID& id, Entry& entry, S32 imagesize, S32 datasize);
 	void writeUpdatedEntries() ;
@@ -191,6 +212,7 @@ private:
 	// HEADERS (Include first mip)
 	std::string mHeaderEntriesFileName;
 	std::string mHeaderDataFileName;
+	std::string mHeaderJournalFileName;
 	EntriesInfo mHeaderEntriesInfo;
 	std::set<S32> mFreeList; // deleted entries
 	std::set<LLUUID> mLRU;
@@ -203,9 +225,19 @@ private:
 	size_map_t mTexturesSizeMap;
 	S64 mTexturesSizeTotal;
 	LLAtomic32<BOOL> mDoPurge;
+	LLTextureCacheShards* mShards;			// NULL when using one file per texture
+	LLTextureCacheCompactWorker* mCompactWorker;
 
 	typedef std::map<S32, Entry> idx_entry_map_t;
-	idx_entry_map_t mUpdatedEntryMap;
+	idx_entry_map_t mUpdatedEntryMap;	// time stamp changes only, written every few minutes
+	// Changed entries are written behind: mDirtyEntryMap is appended to the
+	// journal by flushDirtyEntries() and moves to mJournalEntryMap, which goes
+	// to texture.entries at the next checkpoint (updatedHeaderEntriesFile()).
+	// Lookups check mDirtyEntryMap, mUpdatedEntryMap, mJournalEntryMap, then the file.
+	idx_entry_map_t mDirtyEntryMap;
+	idx_entry_map_t mJournalEntryMap;
+	U32 mJournalRecords;				// in the journal file since the last checkpoint
+	U32 mJournalBatchSize;				// flush the journal early once this many entries are dirty
 
 	// Statics
 	static F32 sHeaderCacheVersion;
@@ -0,0 +1,683 @@
+/**
+ * @file lltexturecacheshards.cpp
+ * @brief Append-only sharded storage for texture cache bodies.
+ *
+ * $LicenseInfo:firstyear=2000&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "llviewerprecompiledheaders.h"
+
+#include "lltexturecacheshards.h"
+
+#include "llfile.h"
+
+#include <algorithm>
+
+#if LL_WINDOWS
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+	const U32 RECORD_MAGIC = 0x31425854;		// "TXB1"
+	const U32 INDEX_MAGIC = 0x58495854;			// "TXIX"
+	const U32 INDEX_VERSION = 1;
+	const S32 TOMBSTONE = -1;					// RecordHeader::mSize of a removal
+
+	// Offsets are S32 and go through fseek(long), keep well clear of 2 GB.
+	const S64 MAX_SHARD_SIZE = 0x60000000;
+
+	// Don't bother rewriting a shard for less than this, or while less than
+	// half of it is garbage.
+	const S64 COMPACT_MIN_GARBAGE = 16 * 1024 * 1024;
+
+	struct RecordHeader
+	{
+		U32 mMagic;
+		S32 mSize;
+		LLUUID mID;
+	};
+
+	struct IndexHeader
+	{
+		U32 mMagic;
+		U32 mVersion;
+		S32 mCount;
+		S32 mShardEnd[LLTextureCacheShards::NUM_SHARDS];
+	};
+
+	struct IndexEntry
+	{
+		LLUUID mID;
+		S32 mOffset;
+		S32 mSize;
+	};
+
+	const S32 RECORD_HEADER_SIZE = sizeof(RecordHeader);
+
+	bool truncate_file(LLFILE* fp, S32 size)
+	{
+		fflush(fp);
+#if LL_WINDOWS
+		return _chsize(_fileno(fp), size) == 0;
+#else
+		return ftruncate(fileno(fp), size) == 0;
+#endif
+	}
+
+	bool offset_less(const std::pair<LLUUID, S32>& a, const std::pair<LLUUID, S32>& b)
+	{
+		return a.second < b.second;
+	}
+}
+
+LLTextureCacheShards::LLTextureCacheShards()
+:	mReadOnly(false),
+	mLiveBytes(0)
+{
+}
+
+LLTextureCacheShards::~LLTextureCacheShards()
+{
+	close();
+}
+
+//static
+std::string LLTextureCacheShards::getShardFileName(const std::string& prefix, S32 shard)
+{
+	return llformat("%stexture.shard.%x", prefix.c_str(), shard);
+}
+
+//static
+std::string LLTextureCacheShards::getIndexFileName(const std::string& prefix)
+{
+	return prefix + "texture.shards";
+}
+
+//static
+void LLTextureCacheShards::removeFiles(const std::string& prefix)
+{
+	for (S32 i = 0; i < NUM_SHARDS; ++i)
+	{
+		std::string filename = getShardFileName(prefix, i);
+		LLFile::remove_nowarn(filename);
+		LLFile::remove_nowarn(filename + ".tmp");
+	}
+	LLFile::remove_nowarn(getIndexFileName(prefix));
+	LLFile::remove_nowarn(getIndexFileName(prefix) + ".tmp");
+}
+
+bool LLTextureCacheShards::open(const std::string& prefix, bool read_only)
+{
+	close();
+	mPrefix = prefix;
+	mReadOnly = read_only;
+	for (S32 i = 0; i < NUM_SHARDS; ++i)
+	{
+		if (!openShard(i))
+		{
+			llwarns << "Could not open texture cache shard " << getShardFileName(i) << llendl;
+			close();
+			return false;
+		}
+	}
+	readIndex();
+	return true;
+}
+
+// Sets mEnd to the physical file size; readIndex() decides what to trust.
+bool LLTextureCacheShards::openShard(S32 shard)
+{
+	Shard& s = mShards[shard];
+	std::string filename = getShardFileName(shard);
+	s.mFP = LLFile::fopen(filename, mReadOnly ? "rb" : "r+b");
+	if (!s.mFP && !mReadOnly)
+	{
+		s.mFP = LLFile::fopen(filename, "w+b");
+	}
+	if (!s.mFP)
+	{
+		s.mEnd = 0;
+		return mReadOnly;		// a read-only cache may simply not have this shard yet
+	}
+	fseek(s.mFP, 0, SEEK_END);
+	s.mEnd = (S32)llmin((S64)ftell(s.mFP), MAX_SHARD_SIZE);
+	s.mGarbage = 0;
+	return true;
+}
+
+void LLTextureCacheShards::close()
+{
+	if (!mPrefix.empty() && !mReadOnly)
+	{
+		writeIndex();
+	}
+	for (S32 i = 0; i < NUM_SHARDS; ++i)
+	{
+		Shard& s = mShards[i];
+		LLMutexLock lock(&s.mMutex);
+		if (s.mFP)
+		{
+			LLFile::close(s.mFP);
+			s.mFP = NULL;
+		}
+		s.mEnd = 0;
+		s.mGarbage = 0;
+	}
+	LLMutexLock lock(&mIndexMutex);
+	mIndex.clear();
+	mLiveBytes = 0;
+	mPrefix.clear();
+}
+
+void LLTextureCacheShards::clear()
+{
+	for (S32 i = 0; i < NUM_SHARDS; ++i)
+	{
+		mShards[i].mMutex.lock();
+	}
+	{
+		LLMutexLock lock(&mIndexMutex);
+		mIndex.clear();
+		mLiveBytes = 0;
+		for (S32 i = 0; i < NUM_SHARDS; ++i)
+		{
+			Shard& s = mShards[i];
+			if (s.mFP && !mReadOnly && !truncate_file(s.mFP, 0))
+			{
+				llwarns << "Could not truncate " << getShardFileName(i) << llendl;
+			}
+			s.mEnd = 0;
+			s.mGarbage = 0;
+		}
+	}
+	for (S32 i = NUM_SHARDS - 1; i >= 0; --i)
+	{
+		mShards[i].mMutex.unlock();
+	}
+	if (!mReadOnly)
+	{
+		LLFile::remove_nowarn(getIndexFileName());
+	}
+}
+
+// Only called from open(), before anyone else can see us.
+void LLTextureCacheShards::readIndex()
+{
+	LLMutexLock lock(&mIndexMutex);
+	mIndex.clear();
+	mLiveBytes = 0;
+
+	bool valid[NUM_SHARDS];
+	S64 used[NUM_SHARDS];
+	for (S32 i = 0; i < NUM_SHARDS; ++i)
+	{
+		valid[i] = false;
+		used[i] = 0;
+	}
+
+	std::string filename = getIndexFileName();
+	LLFILE* fp = LLFile::fopen(filename, "rb");
+	if (fp)
+	{
+		IndexHeader header;
+		if (fread(&header, sizeof(header), 1, fp) == 1 &&
+			header.mMagic == INDEX_MAGIC && header.mVersion == INDEX_VERSION && header.mCount >= 0)
+		{
+			std::vector<IndexEntry> entries(header.mCount);
+			if (header.mCount == 0 ||
+				fread(&entries[0], sizeof(IndexEntry), header.mCount, fp) == (size_t)header.mCount)
+			{
+				for (S32 i = 0; i < NUM_SHARDS; ++i)
+				{
+					valid[i] = mShards[i].mFP && header.mShardEnd[i] == mShards[i].mEnd;
+				}
+				mIndex.rehash(header.mCount);
+				for (S32 i = 0; i < header.mCount; ++i)
+				{
+					const IndexEntry& entry = entries[i];
+					S32 shard = getShard(entry.mID);
+					if (valid[shard] && entry.mOffset >= RECORD_HEADER_SIZE && entry.mSize >= 0 &&
+						(S64)entry.mOffset + entry.mSize <= mShards[shard].mEnd)
+					{
+						Location& loc = mIndex[entry.mID];
+						loc.mOffset = entry.mOffset;
+						loc.mSize = entry.mSize;
+						mLiveBytes += entry.mSize;
+						used[shard] += RECORD_HEADER_SIZE + entry.mSize;
+					}
+				}
+			}
+		}
+		LLFile::close(fp);
+
+		// Until close() writes a fresh one, a crash must cause a rescan rather
+		// than trusting an index that no longer matches the shards.
+		if (!mReadOnly)
+		{
+			LLFile::remove(filename);
+		}
+	}
+
+	for (S32 i = 0; i < NUM_SHARDS; ++i)
+	{
+		if (valid[i])
+		{
+			mShards[i].mGarbage = llmax(mShards[i].mEnd - used[i], (S64)0);
+		}
+		else if (mShards[i].mFP && mShards[i].mEnd > 0)
+		{
+			scanShard(i);
+		}
+	}
+}
+
+void LLTextureCacheShards::scanShard(S32 shard)
+{
+	Shard& s = mShards[shard];
+	llinfos << "Rebuilding the index of " << getShardFileName(shard) << " (" << s.mEnd << " bytes)" << llendl;
+
+	S32 offset = 0;
+	S64 used = 0;
+	fseek(s.mFP, 0, SEEK_SET);
+	while ((S64)offset + RECORD_HEADER_SIZE <= s.mEnd)
+	{
+		RecordHeader header;
+		if (fread(&header, RECORD_HEADER_SIZE, 1, s.mFP) != 1 || header.mMagic != RECORD_MAGIC ||
+			header.mSize < TOMBSTONE || getShard(header.mID) != shard ||
+			(S64)offset + RECORD_HEADER_SIZE + llmax(header.mSize, 0) > s.mEnd)
+		{
+			break;		// torn write at the end, or garbage: drop everything from here
+		}
+		index_map_t::iterator iter = mIndex.find(header.mID);
+		if (iter != mIndex.end())
+		{
+			mLiveBytes -= iter->second.mSize;
+			used -= RECORD_HEADER_SIZE + iter->second.mSize;
+			mIndex.erase(iter);
+		}
+		S32 body_size = llmax(header.mSize, 0);
+		if (header.mSize != TOMBSTONE)
+		{
+			Location& loc = mIndex[header.mID];
+			loc.mOffset = offset + RECORD_HEADER_SIZE;
+			loc.mSize = body_size;
+			mLiveBytes += body_size;
+			used += RECORD_HEADER_SIZE + body_size;
+		}
+		offset += RECORD_HEADER_SIZE + body_size;
+		fseek(s.mFP, offset, SEEK_SET);
+	}
+
+	if (offset < s.mEnd)
+	{
+		llwarns << "Discarding " << s.mEnd - offset << " trailing bytes of " << getShardFileName(shard) << llendl;
+		if (!mReadOnly)
+		{
+			truncate_file(s.mFP, offset);
+		}
+		s.mEnd = offset;
+	}
+	s.mGarbage = s.mEnd - used;
+}
+
+void LLTextureCacheShards::writeIndex()
+{
+	std::string filename = getIndexFileName();
+	std::string tmpname = filename + ".tmp";
+	LLFILE* fp = LLFile::fopen(tmpname, "wb");
+	if (!fp)
+	{
+		llwarns << "Could not write " << tmpname << ", the shards will be rescanned on the next start" << llendl;
+		return;
+	}
+
+	IndexHeader header;
+	std::vector<IndexEntry> entries;
+	{
+		LLMutexLock lock(&mIndexMutex);
+		header.mMagic = INDEX_MAGIC;
+		header.mVersion = INDEX_VERSION;
+		header.mCount = (S32)mIndex.size();
+		for (S32 i = 0; i < NUM_SHARDS; ++i)
+		{
+			header.mShardEnd[i] = mShards[i].mEnd;
+		}
+		entries.reserve(mIndex.size());
+		for (index_map_t::const_iterator iter = mIndex.begin(); iter != mIndex.end(); ++iter)
+		{
+			IndexEntry entry;
+			entry.mID = iter->first;
+			entry.mOffset = iter->second.mOffset;
+			entry.mSize = iter->second.mSize;
+			entries.push_back(entry);
+		}
+	}
+	for (S32 i = 0; i < NUM_SHARDS; ++i)
+	{
+		LLMutexLock lock(&mShards[i].mMutex);
+		if (mShards[i].mFP)
+		{
+			fflush(mShards[i].mFP);
+		}
+	}
+
+	bool success = fwrite(&header, sizeof(header), 1, fp) == 1 &&
+		(entries.empty() || fwrite(&entries[0], sizeof(IndexEntry), entries.size(), fp) == entries.size());
+	success = (LLFile::close(fp) == 0) && success;
+	if (success)
+	{
+		LLFile::remove_nowarn(filename);
+		success = LLFile::rename(tmpname, filename) == 0;
+	}
+	if (!success)
+	{
+		llwarns << "Failed to write " << filename << ", the shards will be rescanned on the next start" << llendl;
+		LLFile::remove_nowarn(tmpname);
+	}
+}
+
+S32 LLTextureCacheShards::getSize(const LLUUID& id)
+{
+	LLMutexLock lock(&mIndexMutex);
+	index_map_t::const_iterator iter = mIndex.find(id);
+	return iter == mIndex.end() ? 0 : iter->second.mSize;
+}
+
+S32 LLTextureCacheShards::read(const LLUUID& id, U8* buffer, S32 offset, S32 size)
+{
+	Shard& s = mShards[getShard(id)];
+	LLMutexLock lock(&s.mMutex);
+	if (!s.mFP)
+	{
+		return 0;
+	}
+	Location loc;
+	{
+		LLMutexLock lock2(&mIndexMutex);
+		index_map_t::const_iterator iter = mIndex.find(id);
+		if (iter == mIndex.end())
+		{
+			return 0;
+		}
+		loc = iter->second;
+	}
+	if (offset < 0 || offset >= loc.mSize || size <= 0)
+	{
+		return 0;
+	}
+	size = llmin(size, loc.mSize - offset);
+	if (fseek(s.mFP, loc.mOffset + offset, SEEK_SET) != 0)
+	{
+		return 0;
+	}
+	return (S32)fread(buffer, 1, size, s.mFP);
+}
+
+S32 LLTextureCacheShards::write(const LLUUID& id, const U8* data, S32 size)
+{
+	if (mReadOnly || size < 0)
+	{
+		return 0;
+	}
+	S32 shard = getShard(id);
+	Shard& s = mShards[shard];
+	LLMutexLock lock(&s.mMutex);
+	if (!s.mFP)
+	{
+		return 0;
+	}
+	// mEnd only changes under the shard mutex, which we hold.
+	S32 end = s.mEnd;
+	if ((S64)end + RECORD_HEADER_SIZE + size > MAX_SHARD_SIZE)
+	{
+		llwarns << "Texture cache shard " << shard << " is full, not caching " << id << llendl;
+		return 0;
+	}
+
+	RecordHeader header;
+	header.mMagic = RECORD_MAGIC;
+	header.mSize = size;
+	header.mID = id;
+	if (fseek(s.mFP, end, SEEK_SET) != 0 ||
+		fwrite(&header, RECORD_HEADER_SIZE, 1, s.mFP) != 1 ||
+		(size && fwrite(data, 1, size, s.mFP) != (size_t)size) ||
+		fflush(s.mFP) != 0)
+	{
+		// mEnd is unchanged, the next append overwrites the partial record.
+		llwarns << "Failed to write " << id << " to texture cache shard " << shard << llendl;
+		return 0;
+	}
+
+	LLMutexLock lock2(&mIndexMutex);
+	Location& loc = mIndex[id];
+	if (loc.mOffset > 0)
+	{
+		mLiveBytes -= loc.mSize;
+		s.mGarbage += RECORD_HEADER_SIZE + loc.mSize;
+	}
+	loc.mOffset = end + RECORD_HEADER_SIZE;
+	loc.mSize = size;
+	mLiveBytes += size;
+	s.mEnd = end + RECORD_HEADER_SIZE + size;
+	return size;
+}
+
+void LLTextureCacheShards::remove(const LLUUID& id)
+{
+	if (mReadOnly)
+	{
+		return;
+	}
+	Shard& s = mShards[getShard(id)];
+	LLMutexLock lock(&s.mMutex);
+	{
+		LLMutexLock lock2(&mIndexMutex);
+		index_map_t::iterator iter = mIndex.find(id);
+		if (iter == mIndex.end())
+		{
+			return;
+		}
+		mLiveBytes -= iter->second.mSize;
+		s.mGarbage += RECORD_HEADER_SIZE + iter->second.mSize;
+		mIndex.erase(iter);
+	}
+	if (!s.mFP)
+	{
+		return;
+	}
+
+	// Record the removal, so a rescan after a crash doesn't bring it back.
+	RecordHeader header;
+	header.mMagic = RECORD_MAGIC;
+	header.mSize = TOMBSTONE;
+	header.mID = id;
+	S32 end = s.mEnd;
+	if ((S64)end + RECORD_HEADER_SIZE <= MAX_SHARD_SIZE &&
+		fseek(s.mFP, end, SEEK_SET) == 0 &&
+		fwrite(&header, RECORD_HEADER_SIZE, 1, s.mFP) == 1)
+	{
+		LLMutexLock lock2(&mIndexMutex);
+		s.mEnd = end + RECORD_HEADER_SIZE;
+		s.mGarbage += RECORD_HEADER_SIZE;
+	}
+}
+
+bool LLTextureCacheShards::needsCompaction()
+{
+	LLMutexLock lock(&mIndexMutex);
+	for (S32 i = 0; i < NUM_SHARDS; ++i)
+	{
+		if (mShards[i].mGarbage > COMPACT_MIN_GARBAGE && mShards[i].mGarbage * 2 > mShards[i].mEnd)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+S64 LLTextureCacheShards::compact()
+{
+	S32 worst = -1;
+	{
+		LLMutexLock lock(&mIndexMutex);
+		S64 most = COMPACT_MIN_GARBAGE;
+		for (S32 i = 0; i < NUM_SHARDS; ++i)
+		{
+			if (mShards[i].mGarbage > most && mShards[i].mGarbage * 2 > mShards[i].mEnd)
+			{
+				most = mShards[i].mGarbage;
+				worst = i;
+			}
+		}
+	}
+	return worst < 0 ? 0 : compactShard(worst);
+}
+
+// Copies the live records into a new file and swaps it in. The shard stays
+// locked for the duration, which only stalls the 1/NUM_SHARDS of the cache
+// that lives in it.
+S64 LLTextureCacheShards::compactShard(S32 shard)
+{
+	if (mReadOnly)
+	{
+		return 0;
+	}
+	Shard& s = mShards[shard];
+	LLMutexLock lock(&s.mMutex);
+	if (!s.mFP)
+	{
+		return 0;
+	}
+
+	std::vector<std::pair<LLUUID, S32> > live;
+	{
+		LLMutexLock lock2(&mIndexMutex);
+		for (index_map_t::const_iterator iter = mIndex.begin(); iter != mIndex.end(); ++iter)
+		{
+			if (getShard(iter->first) == shard)
+			{
+				live.push_back(std::make_pair(iter->first, iter->second.mOffset));
+			}
+		}
+	}
+	// Read the old file front to back.
+	std::sort(live.begin(), live.end(), offset_less);
+
+	std::string filename = getShardFileName(shard);
+	std::string tmpname = filename + ".tmp";
+	LLFILE* out = LLFile::fopen(tmpname, "wb");
+	if (!out)
+	{
+		return 0;
+	}
+
+	std::vector<S32> new_offsets;
+	new_offsets.reserve(live.size());
+	std::vector<U8> buffer;
+	S32 new_end = 0;
+	bool success = true;
+	for (size_t i = 0; i < live.size() && success; ++i)
+	{
+		RecordHeader header;
+		S32 old_offset = live[i].second - RECORD_HEADER_SIZE;
+		success = fseek(s.mFP, old_offset, SEEK_SET) == 0 &&
+			fread(&header, RECORD_HEADER_SIZE, 1, s.mFP) == 1 &&
+			header.mMagic == RECORD_MAGIC && header.mID == live[i].first && header.mSize >= 0;
+		if (success)
+		{
+			buffer.resize(header.mSize + RECORD_HEADER_SIZE);
+			memcpy(&buffer[0], &header, RECORD_HEADER_SIZE);		/* Flawfinder: ignore */
+			success = (header.mSize == 0 || fread(&buffer[RECORD_HEADER_SIZE], 1, header.mSize, s.mFP) == (size_t)header.mSize) &&
+				fwrite(&buffer[0], 1, buffer.size(), out) == buffer.size();
+		}
+		new_offsets.push_back(new_end + RECORD_HEADER_SIZE);
+		new_end += (S32)buffer.size();
+	}
+	success = (LLFile::close(out) == 0) && success;
+	if (!success)
+	{
+		llwarns << "Compaction of " << filename << " failed, keeping it as is" << llendl;
+		LLFile::remove_nowarn(tmpname);
+		return 0;
+	}
+
+	LLFile::close(s.mFP);
+	s.mFP = NULL;
+	LLFile::remove_nowarn(filename);
+	bool renamed = LLFile::rename(tmpname, filename) == 0;
+	s.mFP = LLFile::fopen(filename, "r+b");
+	if (!s.mFP)
+	{
+		s.mFP = LLFile::fopen(filename, "w+b");
+	}
+
+	LLMutexLock lock2(&mIndexMutex);
+	S64 reclaimed = s.mEnd - new_end;
+	if (!renamed || !s.mFP)
+	{
+		// The old file is gone: forget its contents. LLTextureCache notices
+		// the missing bodies and refetches them.
+		llwarns << "Lost " << filename << " during compaction" << llendl;
+		for (size_t i = 0; i < live.size(); ++i)
+		{
+			index_map_t::iterator iter = mIndex.find(live[i].first);
+			if (iter != mIndex.end())
+			{
+				mLiveBytes -= iter->second.mSize;
+				mIndex.erase(iter);
+			}
+		}
+		new_end = 0;
+		reclaimed = s.mEnd;
+	}
+	else
+	{
+		// Writes and removals to this shard need its mutex, so nothing moved.
+		for (size_t i = 0; i < live.size(); ++i)
+		{
+			mIndex[live[i].first].mOffset = new_offsets[i];
+		}
+	}
+	s.mEnd = new_end;
+	s.mGarbage = 0;
+	return reclaimed;
+}
+
+S64 LLTextureCacheShards::getLiveBytes()
+{
+	LLMutexLock lock(&mIndexMutex);
+	return mLiveBytes;
+}
+
+S64 LLTextureCacheShards::getGarbageBytes()
+{
+	LLMutexLock lock(&mIndexMutex);
+	S64 garbage = 0;
+	for (S32 i = 0; i < NUM_SHARDS; ++i)
+	{
+		garbage += mShards[i].mGarbage;
+	}
+	return garbage;
+}
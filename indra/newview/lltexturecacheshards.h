@@ -0,0 +1,119 @@
+/**
+ * @file lltexturecacheshards.h
+ * @brief Append-only sharded storage for texture cache bodies.
+ *
+ * $LicenseInfo:firstyear=2000&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLTEXTURECACHESHARDS_H
+#define LL_LLTEXTURECACHESHARDS_H
+
+#include "llthread.h"
+#include "lluuid.h"
+#include "sguuidhash.h"
+
+// Replaces the one-file-per-texture body cache (texturecache/[0-f]/UUID.texture)
+// with NUM_SHARDS append-only files, so reads and writes no longer open and
+// close a file each, and purging doesn't need a directory scan.
+//
+// texturecache/texture.shard.N
+//  Sequence of RecordHeader + body. A newer record for the same UUID
+//  supersedes older ones, the old bytes become garbage until compaction.
+// texturecache/texture.shards
+//  Index of all live records, written on close() and read with one fread
+//  on open(). A shard whose size doesn't match the index is rescanned.
+//
+// Thread safety: each shard has its own mutex around its file, the index
+// has another. Lock order is shard, then index.
+class LLTextureCacheShards
+{
+public:
+	enum { NUM_SHARDS = 16 };		// must be a power of two
+
+	LLTextureCacheShards();
+	~LLTextureCacheShards();
+
+	// prefix is the cache directory including the trailing delimiter.
+	bool open(const std::string& prefix, bool read_only);
+	void close();					// writes the index
+	void clear();					// drops every body, leaves empty shards open
+
+	// Deletes the shards and the index under prefix (and what a crash left of
+	// their temporary copies). Also for when no LLTextureCacheShards is open,
+	// e.g. after switching to one file per texture.
+	static void removeFiles(const std::string& prefix);
+
+	// Body size in bytes, 0 if there is none (like LLAPRFile::size() of a missing file).
+	S32 getSize(const LLUUID& id);
+	S32 read(const LLUUID& id, U8* buffer, S32 offset, S32 size);
+	S32 write(const LLUUID& id, const U8* data, S32 size);
+	void remove(const LLUUID& id);
+
+	// True when some shard is mostly garbage. compact() rewrites the worst
+	// such shard and returns the number of bytes reclaimed.
+	bool needsCompaction();
+	S64 compact();
+
+	S64 getLiveBytes();
+	S64 getGarbageBytes();
+
+private:
+	struct Location
+	{
+		S32 mOffset;				// of the body, past its RecordHeader
+		S32 mSize;
+	};
+	typedef boost::unordered_map<LLUUID, Location> index_map_t;
+
+	struct Shard
+	{
+		Shard() : mFP(NULL), mEnd(0), mGarbage(0) {}
+		LLMutex mMutex;				// guards mFP
+		LLFILE* mFP;
+		S32 mEnd;					// guarded by mIndexMutex (and mMutex for writers)
+		S64 mGarbage;				// guarded by mIndexMutex
+	};
+
+	static S32 getShard(const LLUUID& id)	{ return id.mData[0] & (NUM_SHARDS - 1); }
+	std::string getShardFileName(S32 shard) const	{ return getShardFileName(mPrefix, shard); }
+	std::string getIndexFileName() const			{ return getIndexFileName(mPrefix); }
+	static std::string getShardFileName(const std::string& prefix, S32 shard);
+	static std::string getIndexFileName(const std::string& prefix);
+
+	bool openShard(S32 shard);
+	void readIndex();
+	void writeIndex();
+	void scanShard(S32 shard);		// mIndexMutex and the shard's mutex locked
+	S64 compactShard(S32 shard);
+
+private:
+	std::string mPrefix;
+	bool mReadOnly;
+
+	Shard mShards[NUM_SHARDS];
+
+	LLMutex mIndexMutex;
+	index_map_t mIndex;
+	S64 mLiveBytes;
+};
+
+#endif // LL_LLTEXTURECACHESHARDS_H
@@ -1889,7 +1889,7 @@ void LLTextureFetchWorker::endWork(S32 param, bool aborted)
 {
 	if (mDecodeHandle != 0)
 	{
-		mFetcher->mImageDecodeThread->abortRequest(mDecodeHandle, false);
+		mFetcher->mImageDecodeThread->abortDecode(mDecodeHandle);
 		mDecodeHandle = 0;
 	}
 	mFormattedImage = NULL;
@@ -35,6 +35,7 @@
 #include "lllfsthread.h"
 #include "llui.h"
 #include "llimageworker.h"
+#include "llpixelbufferring.h"
 #include "llrender.h"
 
 #include "aicurlperservice.h"
@@ -663,7 +664,9 @@ void LLGLTexMemBar::draw()
 #endif
 	//----------------------------------------------------------------------------
 
-	text = llformat("Textures: %d Fetch: %d(%d) Pkts:%d(%d) Cache R/W: %d/%d LFS:%d IW:%d RAW:%d(%d) HTTP:%d/%d/%d/%d DEC:%d CRE:%d ",
+	LLImageDecodeThread::Stats decode_stats = LLAppViewer::getImageDecodeThread()->getStats();
+	LLPixelBufferRing::Stats pbo_stats = LLPixelBufferRing::getStats();
+	text = llformat("Textures: %d Fetch: %d(%d) Pkts:%d(%d) Cache R/W: %d/%d LFS:%d IW:%d RAW:%d(%d) HTTP:%d/%d/%d/%d DEC:%d(%dx %.0f/%.0fms) CRE:%d PBO:%d/%dKB(%d) ",
 					gTextureList.getNumImages(),
 					LLAppViewer::getTextureFetch()->getNumRequests(), LLAppViewer::getTextureFetch()->getNumDeletes(),
 					LLAppViewer::getTextureFetch()->mPacketCount, LLAppViewer::getTextureFetch()->mBadPacketCount, 
@@ -675,8 +678,10 @@ void LLGLTexMemBar::draw()
 					AICurlInterface::getNumHTTPQueued(),
 					AICurlInterface::getNumHTTPAdded(),
 					AICurlInterface::getNumHTTPRunning(),
-					LLAppViewer::getImageDecodeThread()->getPending(), 
-					gTextureList.mCreateTextureList.size());
+					decode_stats.mQueued, decode_stats.mWorkers,
+					decode_stats.mLatency * 1000.f, decode_stats.mDecodeTime * 1000.f,
+					gTextureList.mCreateTextureList.size(),
+					pbo_stats.mUploads, pbo_stats.mUploadBytes / 1024, pbo_stats.mDirect);
 
 	LLFontGL::getFontMonospace()->renderUTF8(text, 0, 0, v_offset + line_height*2,
 									 text_color, LLFontGL::LEFT, LLFontGL::TOP);
@@ -77,6 +77,8 @@
 #include "llworldmapview.h"
 #include "llnetmap.h"
 #include "llrender.h"
+#include "llpacketcapture.h"
+#include "llpixelbufferring.h"
 #include "aistatemachine.h"
 #include "aithreadsafe.h"
 #include "lldrawpoolbump.h"
@@ -435,6 +437,12 @@ static bool handleWLSkyDetailChanged(const LLSD&)
 	return true;
 }
 
+static bool handleTextureUploadRingSizeChanged(const LLSD& newvalue)
+{
+	LLPixelBufferRing::setSize(newvalue.asInteger() * 1024 * 1024);
+	return true;
+}
+
 static bool handleResetVertexBuffersChanged(const LLSD&)
 {
 	if (gPipeline.isInit())
@@ -626,6 +634,17 @@ bool handleAscentAvatarModifier(const LLSD& newvalue)
 	return true;
 }
 
+static bool handleMessageReplayFileChanged(const LLSD& newvalue)
+{
+	std::string filename = newvalue.asString();
+	if (!filename.empty() && gMessageSystem)
+	{
+		LLPacketReplay::start(gMessageSystem, gDirUtilp->getExpandedFilename(LL_PATH_LOGS, filename),
+							   gSavedSettings.getF32("MessageReplaySpeed"), gAgent.getRegionHost());
+	}
+	return true;
+}
+
 // [Ansariel: Display name support]
 static bool handlePhoenixNameSystemChanged(const LLSD& newvalue)
 {
@@ -748,6 +767,7 @@ void settings_setup_listeners()
 	gSavedSettings.getControl("RenderUseVAO")->getSignal()->connect(boost::bind(&handleResetVertexBuffersChanged, _2));
 	gSavedSettings.getControl("RenderVBOMappingDisable")->getSignal()->connect(boost::bind(&handleResetVertexBuffersChanged, _2));
 	gSavedSettings.getControl("RenderPreferStreamDraw")->getSignal()->connect(boost::bind(&handleResetVertexBuffersChanged, _2));
+	gSavedSettings.getControl("TextureUploadRingSize")->getSignal()->connect(boost::bind(&handleTextureUploadRingSizeChanged, _2));
 	gSavedSettings.getControl("WLSkyDetail")->getSignal()->connect(boost::bind(&handleWLSkyDetailChanged, _2));
 	gSavedSettings.getControl("NumpadControl")->getSignal()->connect(boost::bind(&handleNumpadControlChanged, _2));
 	gSavedSettings.getControl("JoystickAxis0")->getSignal()->connect(boost::bind(&handleJoystickChanged, _2));
@@ -826,6 +846,9 @@ void settings_setup_listeners()
 
 	gSavedSettings.getControl("CurlMaxTotalConcurrentConnections")->getSignal()->connect(boost::bind(&AICurlInterface::handleCurlMaxTotalConcurrentConnections, _2));
 	gSavedSettings.getControl("CurlConcurrentConnectionsPerService")->getSignal()->connect(boost::bind(&AICurlInterface::handleCurlConcurrentConnectionsPerService, _2));
+	gSavedSettings.getControl("CurlAdaptiveConcurrency")->getSignal()->connect(boost::bind(&AICurlInterface::handleCurlAdaptiveConcurrency, _2));
+	gSavedSettings.getControl("CurlMinConcurrentConnectionsPerService")->getSignal()->connect(boost::bind(&AICurlInterface::handleCurlAdaptiveConcurrency, _2));
+	gSavedSettings.getControl("MessageReplayFile")->getSignal()->connect(boost::bind(&handleMessageReplayFileChanged, _2));
 	gSavedSettings.getControl("NoVerifySSLCert")->getSignal()->connect(boost::bind(&AICurlInterface::handleNoVerifySSLCert, _2));
 
 	gSavedSettings.getControl("CurlTimeoutDNSLookup")->getValidateSignal()->connect(boost::bind(&validateCurlTimeoutDNSLookup, _2));
@@ -800,6 +800,7 @@ void LLViewerMedia::updateMedia(void *dummy_arg)
 	
 	// Enable/disable the plugin read thread
 	LLPluginProcessParent::setUseReadThread(gSavedSettings.getBOOL("PluginUseReadThread"));
+	LLPluginProcessParent::setUseBinaryMessages(gSavedSettings.getBOOL("PluginBinaryMessages"));
 	
 	// HACK: we always try to keep a spare running webkit plugin around to improve launch times.
 	createSpareBrowserMediaSource();
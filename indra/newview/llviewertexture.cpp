@@ -610,6 +610,7 @@ LLViewerTexture::~LLViewerTexture()
 void LLViewerTexture::init(bool firstinit)
 {
 	mMaxVirtualSize = 0.f;
+	mPrioritizedVirtualSize = 0.f;
 	mNeedsGLTexture = FALSE ;
 	mMaxVirtualSizeResetInterval = 1;
 	mMaxVirtualSizeResetCounter = mMaxVirtualSizeResetInterval ;
@@ -713,6 +714,13 @@ void LLViewerTexture::addTextureStats(F32 virtual_size, BOOL needs_gltexture) co
 	{
 		mMaxVirtualSize = virtual_size;
 	}	
+
+	// Same 25% the texture list ignores priority changes below.
+	if (mMaxVirtualSize > mPrioritizedVirtualSize * 1.25f)
+	{
+		mPrioritizedVirtualSize = mMaxVirtualSize;
+		dirtyDecodePriority();
+	}
 }
 
 void LLViewerTexture::resetTextureStats()
@@ -1246,9 +1254,9 @@ void LLViewerFetchedTexture::addToCreateTexture()
 						}
 
 						{
-							//make a duplicate in case somebody else is using this raw image
-							mRawImage = mRawImage->duplicate(); 
-							mRawImage->scale(w >> i, h >> i) ;					
+							//scale into a new image in case somebody else is using this raw image
+							LLPointer<LLImageRawView> view = new LLImageRawView(mRawImage);
+							mRawImage = new LLImageRaw(view.get(), w >> i, h >> i);
 						}
 					}
 				}
@@ -1320,6 +1328,8 @@ BOOL LLViewerFetchedTexture::createTexture(S32 usename/*= 0*/)
 			mOrigWidth = mRawImage->getWidth();
 			mOrigHeight = mRawImage->getHeight();
 
+			//copy on write: the saved or cached raw image, or a loaded callback, may share these pixels.
+			mRawImage = mRawImage->duplicate();
 			
 			if (mBoostLevel == BOOST_PREVIEW)
 			{ 
@@ -1370,7 +1380,8 @@ BOOL LLViewerFetchedTexture::createTexture(S32 usename/*= 0*/)
 		
 		//if(!(res = insertToAtlas()))
 		//{
-			res = mGLTexturep->createGLTexture(mRawDiscardLevel, mRawImage, usename, TRUE, mBoostLevel);
+			LLPointer<LLImageRawView> view = new LLImageRawView(mRawImage);
+			res = mGLTexturep->createGLTexture(mRawDiscardLevel, view, usename, TRUE, mBoostLevel);
 			//resetFaceAtlas() ;
 		//}
 		setActive() ;
@@ -1479,6 +1490,7 @@ F32 LLViewerFetchedTexture::calcDecodePriority()
 	}
 #endif
 	
+	mPrioritizedVirtualSize = mMaxVirtualSize;
 	if (mNeedsCreateTexture)
 	{
 		return mDecodePriority; // no change while waiting to create
@@ -1648,6 +1660,22 @@ void LLViewerFetchedTexture::setDecodePriority(F32 priority)
 	}
 }
 
+//virtual
+void LLViewerFetchedTexture::setBoostLevel(S32 level)
+{
+	if (level != mBoostLevel)
+	{
+		LLViewerTexture::setBoostLevel(level);
+		dirtyDecodePriority();
+	}
+}
+
+//virtual
+void LLViewerFetchedTexture::dirtyDecodePriority() const
+{
+	gTextureList.dirtyDecodePriority(const_cast<LLViewerFetchedTexture*>(this));
+}
+
 void LLViewerFetchedTexture::setAdditionalDecodePriority(F32 priority)
 {
 	priority = llclamp(priority, 0.f, 1.f);
@@ -2632,9 +2660,9 @@ void LLViewerFetchedTexture::setCachedRawImage()
 				return;
 			}
 			{
-				//make a duplicate in case somebody else is using this raw image
-				mRawImage = mRawImage->duplicate(); 
-				mRawImage->scale(w >> i, h >> i) ;
+				//scale into a new image in case somebody else is using this raw image
+				LLPointer<LLImageRawView> view = new LLImageRawView(mRawImage);
+				mRawImage = new LLImageRaw(view.get(), w >> i, h >> i);
 			}
 		}
 		if(mCachedRawImage.notNull())
@@ -2677,7 +2705,8 @@ void LLViewerFetchedTexture::saveRawImage()
 	}
 
 	mSavedRawDiscardLevel = mRawDiscardLevel ;
-	mSavedRawImage = new LLImageRaw(mRawImage->getData(), mRawImage->getWidth(), mRawImage->getHeight(), mRawImage->getComponents()) ;
+	//share the pixels rather than copy them; whoever scales either in place duplicate()s first.
+	mSavedRawImage = mRawImage ;
 
 	if(mForceToSaveRawImage && mSavedRawDiscardLevel <= mDesiredSavedRawDiscardLevel)
 	{
@@ -182,9 +182,13 @@ private:
 	
 	static bool isMemoryForTextureLow() ;
 protected:
+	// Called when the virtual size grew enough that the decode priority is out of date.
+	virtual void dirtyDecodePriority() const {}
+
 	LLUUID mID;
 
 	mutable F32 mMaxVirtualSize;	// The largest virtual size of the image, in pixels - how much data to we need?	
+	mutable F32 mPrioritizedVirtualSize;	// mMaxVirtualSize the decode priority was last calculated with.
 	mutable S32  mMaxVirtualSizeResetCounter ;
 	mutable S32  mMaxVirtualSizeResetInterval;
 	mutable F32 mAdditionalDecodePriority;  // priority add to mDecodePriority.
@@ -281,6 +285,7 @@ public:
 	/*virtual*/ S8 getType() const ;
 	/*virtual*/ void forceImmediateUpdate() ;
 	/*virtual*/ void dump() ;
+	/*virtual*/ void setBoostLevel(S32 level);
 
 	// Set callbacks to get called when the image gets updated with higher 
 	// resolution versions.
@@ -393,6 +398,7 @@ public:
 	
 protected:
 	/*virtual*/ void switchToCachedImage();
+	/*virtual*/ void dirtyDecodePriority() const;
 	S32 getCurrentDiscardLevelForFetching() ;
 
 private:
@@ -458,8 +464,15 @@ protected:
 	// doing if you use it for anything else! - djs
 	LLPointer<LLImageRaw> mAuxRawImage;
 
-	//keep a copy of mRawImage for some special purposes
-	//when mForceToSaveRawImage is set.
+	//keep mRawImage for some special purposes when mForceToSaveRawImage is set.
+	//It shares its pixels with mRawImage (and with mCachedRawImage, which may
+	//share them too), so anything that changes pixels in place: scale(),
+	//biasedScaleToPowerOfTwo(), expandToPowerOfTwo(), contractToPowerOfTwo(),
+	//clear(), fill(), setSubImage(), verticalFlip(), copy*() and composite*()
+	//into it — must go through LLImageRaw::duplicate() first. Reading, encoding,
+	//views and the constructors that scale from a view into a new image are safe.
+	//The same holds for the raw images handed to loaded callbacks and returned
+	//by getRawImage(), getCachedRawImage() and getSavedRawImage().
 	BOOL mForceToSaveRawImage ;
 	BOOL mSaveRawImage;
 	LLPointer<LLImageRaw> mSavedRawImage;
@@ -296,6 +296,7 @@ void LLViewerTextureList::shutdown()
 	// Flush all of the references
 	mLoadingStreamList.clear();
 	mCreateTextureList.clear();
+	mDirtyPriorityList.clear();
 	
 	mUUIDMap.clear();
 	
@@ -622,6 +623,7 @@ void LLViewerTextureList::addImage(LLViewerFetchedTexture *new_image)
 	
 	addImageToList(new_image);
 	mUUIDMap[image_id] = new_image;
+	mDirtyPriorityList.insert(new_image);
 }
 
 
@@ -633,6 +635,7 @@ void LLViewerTextureList::deleteImage(LLViewerFetchedTexture *image)
 		{
 			mCallbackList.erase(image);
 		}
+		mDirtyPriorityList.erase(image);
 
 		llverify(mUUIDMap.erase(image->getID()) == 1);
 		sNumImages--;
@@ -650,9 +653,18 @@ void LLViewerTextureList::dirtyImage(LLViewerFetchedTexture *image)
 	mDirtyTextureList.insert(image);
 }
 
+void LLViewerTextureList::dirtyDecodePriority(LLViewerFetchedTexture *image)
+{
+	if (mInitialized && image->isInImageList())
+	{
+		mDirtyPriorityList.insert(image);
+	}
+}
+
 ////////////////////////////////////////////////////////////////////////////
 static LLFastTimer::DeclareTimer FTM_IMAGE_MARK_DIRTY("Dirty Images");
 static LLFastTimer::DeclareTimer FTM_IMAGE_UPDATE_PRIORITIES("Prioritize");
+static LLFastTimer::DeclareTimer FTM_IMAGE_UPDATE_DIRTY_PRIORITIES("Prioritize Changed");
 static LLFastTimer::DeclareTimer FTM_IMAGE_CALLBACKS("Callbacks");
 static LLFastTimer::DeclareTimer FTM_IMAGE_FETCH("Fetch");
 static LLFastTimer::DeclareTimer FTM_IMAGE_CREATE("Create");
@@ -713,6 +725,11 @@ void LLViewerTextureList::updateImages(F32 max_time)
 	{
 		LLFastTimer t(FTM_IMAGE_CREATE);
 		max_time = llmax(max_time, total_max_time*.50f); // at least 50% of max_time
+		static const LLCachedControl<F32> upload_budget("TextureUploadBudget");
+		if (upload_budget > 0.f)
+		{
+			max_time = llmin(max_time, upload_budget * .001f);
+		}
 		max_time -= updateImagesCreateTextures(max_time);
 	}
 	
@@ -769,6 +786,23 @@ void LLViewerTextureList::clearFetchingRequests()
 
 void LLViewerTextureList::updateImagesDecodePriorities()
 {
+	// Images whose virtual size grew or whose boost level changed get their new priority
+	// this frame; the round robin below only has to catch the ones that became less important.
+	if (!mDirtyPriorityList.empty())
+	{
+		LLFastTimer t(FTM_IMAGE_UPDATE_DIRTY_PRIORITIES);
+		image_list_t dirty_list;
+		dirty_list.swap(mDirtyPriorityList);
+		for (image_list_t::iterator iter = dirty_list.begin(); iter != dirty_list.end(); ++iter)
+		{
+			LLViewerFetchedTexture* imagep = *iter;
+			if (imagep->isInImageList() && !imagep->isDeleted() && !imagep->isDeletionCandidate())
+			{
+				updateDecodePriority(imagep);
+			}
+		}
+	}
+
 	// Update the decode priority for N images each frame
 	{
         static const S32 MAX_PRIO_UPDATES = gSavedSettings.getS32("TextureFetchUpdatePriorities");         // default: 32
@@ -843,23 +877,30 @@ void LLViewerTextureList::updateImagesDecodePriorities()
 			{
 				continue;
 			}
-			imagep->processTextureStats();
-			F32 old_priority = imagep->getDecodePriority();
-			F32 old_priority_test = llmax(old_priority, 0.0f);
-			F32 decode_priority = imagep->calcDecodePriority();
-			F32 decode_priority_test = llmax(decode_priority, 0.0f);
-			// Ignore < 20% difference
-			if ((decode_priority_test < old_priority_test * .8f) ||
-				(decode_priority_test > old_priority_test * 1.25f))
-			{
-				removeImageFromList(imagep);
-				imagep->setDecodePriority(decode_priority);
-				addImageToList(imagep);
-			}
+			updateDecodePriority(imagep);
 		}
 	}
 }
 
+void LLViewerTextureList::updateDecodePriority(LLViewerFetchedTexture* imagep)
+{
+	imagep->processTextureStats();
+	F32 old_priority = imagep->getDecodePriority();
+	F32 old_priority_test = llmax(old_priority, 0.0f);
+	F32 decode_priority = imagep->calcDecodePriority();
+	F32 decode_priority_test = llmax(decode_priority, 0.0f);
+	mDirtyPriorityList.erase(imagep);
+	// Ignore < 20% difference
+	if ((decode_priority_test < old_priority_test * .8f) ||
+		(decode_priority_test > old_priority_test * 1.25f))
+	{
+		// mImageList is ordered by decode priority, so this moves the image to its new place.
+		removeImageFromList(imagep);
+		imagep->setDecodePriority(decode_priority);
+		addImageToList(imagep);
+	}
+}
+
 /*
  static U8 get_image_type(LLViewerFetchedTexture* imagep, LLHost target_host)
  {
@@ -89,6 +89,8 @@ public:
 	LLViewerFetchedTexture *findImage(const LLUUID &image_id);
 
 	void dirtyImage(LLViewerFetchedTexture *image);
+	// Recalculate the decode priority of image next frame instead of when the round robin gets to it.
+	void dirtyDecodePriority(LLViewerFetchedTexture *image);
 	
 	// Using image stats, determine what images are necessary, and perform image updates.
 	void updateImages(F32 max_time);
@@ -117,6 +119,7 @@ public:
 	
 private:
 	void updateImagesDecodePriorities();
+	void updateDecodePriority(LLViewerFetchedTexture* imagep);
 	F32  updateImagesCreateTextures(F32 max_time);
 	F32  updateImagesFetchTextures(F32 max_time);
 	void updateImagesUpdateStats();
@@ -177,6 +180,7 @@ public:
 	image_list_t mLoadingStreamList;
 	image_list_t mCreateTextureList;
 	image_list_t mCallbackList;
+	image_list_t mDirtyPriorityList;
 
 	// Note: just raw pointers because they are never referenced, just compared against
 	std::set<LLViewerFetchedTexture*> mDirtyTextureList;
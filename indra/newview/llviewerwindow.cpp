@@ -687,12 +687,19 @@ public:
 					LLMeshRepository::sHTTPRetryCount));
 				ypos += y_inc;
 
-				addText(xpos, ypos, llformat("%d/%d Mesh LOD Pending/Processing", LLMeshRepository::sLODPending, LLMeshRepository::sLODProcessing));
+				addText(xpos, ypos, llformat("%d/%d/%d Mesh LOD Pending/Processing/Decoding", LLMeshRepository::sLODPending, LLMeshRepository::sLODProcessing,
+					LLMeshRepository::sLODDecoding));
 				ypos += y_inc;
 
 				addText(xpos, ypos, llformat("%.3f/%.3f MB Mesh Cache Read/Write ", LLMeshRepository::sCacheBytesRead/(1024.f*1024.f), LLMeshRepository::sCacheBytesWritten/(1024.f*1024.f)));
 
 				ypos += y_inc;
+
+				addText(xpos, ypos, llformat("%d Mesh LODs From Decoded Cache", LLMeshRepository::sDecodedCacheHits));
+				ypos += y_inc;
+
+				addText(xpos, ypos, llformat("%.2f s To Rez %d Mesh LODs", LLMeshRepository::sLastRezTime, LLMeshRepository::sLastRezLODs));
+				ypos += y_inc;
 			}
 
 			LLVertexBuffer::sBindCount = LLImageGL::sBindCount = 
@@ -1117,6 +1117,21 @@ void LLVOVolume::notifyMeshLoaded()
 	gPipeline.markRebuild(mDrawable, LLDrawable::REBUILD_GEOMETRY, TRUE);
 }
 
+F32 LLVOVolume::getMeshLoadScore() const
+{
+	if (!isVisible())
+	{
+		return 0.f;
+	}
+
+	F32 score = llmax(getPixelArea(), 1.f);
+	if (getVolume() && !getVolume()->isMeshAssetLoaded())
+	{	//the first LOD replaces a placeholder, a later one only refines the mesh
+		score *= 4.f;
+	}
+	return score;
+}
+
 // sculpt replaces generate() for sculpted surfaces
 void LLVOVolume::sculpt()
 {	
@@ -1126,6 +1141,7 @@ void LLVOVolume::sculpt()
 		U16 sculpt_width = 0;
 		S8 sculpt_components = 0;
 		const U8* sculpt_data = NULL;
+		S32 sculpt_row_stride = 0;
 	
 		S32 discard_level = mSculptTexture->getCachedRawImageLevel();
 		LLImageRaw* raw_image = mSculptTexture->getCachedRawImage() ;
@@ -1183,13 +1199,16 @@ void LLVOVolume::sculpt()
 		}
 		else
 		{					
-			sculpt_height = raw_image->getHeight();
-			sculpt_width = raw_image->getWidth();
-			sculpt_components = raw_image->getComponents();		
+			//read the cached map in place through a view rather than from a copy.
+			LLPointer<LLImageRawView> view = new LLImageRawView(raw_image);
+			sculpt_height = view->getHeight();
+			sculpt_width = view->getWidth();
+			sculpt_components = view->getComponents();		
 					   
-			sculpt_data = raw_image->getData();
+			sculpt_data = view->getData();
+			sculpt_row_stride = view->getRowStride();
 		}
-		getVolume()->sculpt(sculpt_width, sculpt_height, sculpt_components, sculpt_data, discard_level);
+		getVolume()->sculpt(sculpt_width, sculpt_height, sculpt_components, sculpt_data, discard_level, sculpt_row_stride);
 
 		//notify rebuild any other VOVolumes that reference this sculpty volume
 		for (S32 i = 0; i < mSculptTexture->getNumVolumes(); ++i)
@@ -318,6 +318,10 @@ public:
 	void setSculptChanged(BOOL has_changed) { mSculptChanged = has_changed; }
 
 	void notifyMeshLoaded();
+
+	// How much loading a LOD of our mesh matters right now: the pixel area we
+	// cover, boosted while nothing of the mesh is shown yet. 0 when off screen.
+	F32 getMeshLoadScore() const;
 	
 	// Returns 'true' iff the media data for this object is in flight
 	bool isMediaDataBeingFetched() const;
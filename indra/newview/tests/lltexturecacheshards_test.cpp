@@ -0,0 +1,269 @@
+/**
+ * @file lltexturecacheshards_test.cpp
+ * @brief Tests and warm-start timing for the sharded texture cache body store.
+ *
+ * $LicenseInfo:firstyear=2000&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+// Precompiled header: almost always required for newview cpp files
+#include "../llviewerprecompiledheaders.h"
+// Class to test
+#include "../lltexturecacheshards.h"
+// Dependencies
+#include "llfile.h"
+#include "lltimer.h"
+
+// Tut header
+#include "../test/lltut.h"
+
+namespace
+{
+	U8 expected_byte(const LLUUID& id, S32 offset)
+	{
+		return (U8)(id.mData[1] + offset * 7);
+	}
+
+	// An id living in the given shard.
+	LLUUID id_in_shard(S32 shard)
+	{
+		LLUUID id;
+		id.generate();
+		id.mData[0] = (U8)((id.mData[0] & ~(LLTextureCacheShards::NUM_SHARDS - 1)) | shard);
+		return id;
+	}
+
+	void fill(std::vector<U8>& buffer, const LLUUID& id, S32 size)
+	{
+		buffer.resize(size);
+		for (S32 i = 0; i < size; ++i)
+		{
+			buffer[i] = expected_byte(id, i);
+		}
+	}
+}
+
+// -------------------------------------------------------------------------------------------
+// TUT
+// -------------------------------------------------------------------------------------------
+
+namespace tut
+{
+	// Test wrapper declarations
+	struct texturecacheshards_test
+	{
+		std::string mPrefix;
+
+		texturecacheshards_test()
+		{
+			LLUUID random;
+			random.generate();
+			std::ostringstream oStr;
+#if LL_WINDOWS
+			oStr << "texturecacheshards-test-" << random << "-";
+#else
+			oStr << "/tmp/texturecacheshards-test-" << random << "-";
+#endif
+			mPrefix = oStr.str();
+		}
+		~texturecacheshards_test()
+		{
+			for (S32 i = 0; i < LLTextureCacheShards::NUM_SHARDS; ++i)
+			{
+				LLFile::remove_nowarn(llformat("%stexture.shard.%x", mPrefix.c_str(), i));
+				LLFile::remove_nowarn(llformat("%stexture.shard.%x.tmp", mPrefix.c_str(), i));
+			}
+			LLFile::remove_nowarn(mPrefix + "texture.shards");
+		}
+
+		void ensure_body(LLTextureCacheShards& shards, const LLUUID& id, S32 size)
+		{
+			std::vector<U8> buffer(size + 1);
+			ensure_equals("body size", shards.getSize(id), size);
+			ensure_equals("bytes read", shards.read(id, &buffer[0], 0, size + 1), size);
+			ensure_equals("first byte", buffer[0], expected_byte(id, 0));
+			ensure_equals("last byte", buffer[size - 1], expected_byte(id, size - 1));
+		}
+	};
+
+	// Tut templating thingamagic: test group, object and test instance
+	typedef test_group<texturecacheshards_test> texturecacheshards_t;
+	typedef texturecacheshards_t::object texturecacheshards_object_t;
+	tut::texturecacheshards_t tut_texturecacheshards("texturecacheshards");
+
+	template<> template<>
+	void texturecacheshards_object_t::test<1>()
+	{
+		// Bodies survive a clean reopen (index) and a crash (rescan), removals too.
+		std::vector<LLUUID> ids;
+		std::vector<U8> buffer;
+		{
+			LLTextureCacheShards shards;
+			ensure("open", shards.open(mPrefix, false));
+			for (S32 i = 0; i < 64; ++i)
+			{
+				ids.push_back(id_in_shard(i % LLTextureCacheShards::NUM_SHARDS));
+				fill(buffer, ids[i], 1000 + i * 37);
+				ensure_equals("write", shards.write(ids[i], &buffer[0], (S32)buffer.size()), (S32)buffer.size());
+			}
+			// Partial read at an offset.
+			U8 byte;
+			ensure_equals("offset read", shards.read(ids[3], &byte, 10, 1), 1);
+			ensure_equals("offset byte", byte, expected_byte(ids[3], 10));
+			shards.remove(ids[0]);
+			ensure_equals("removed", shards.getSize(ids[0]), 0);
+		}
+
+		LLTextureCacheShards shards;
+		ensure("reopen", shards.open(mPrefix, false));
+		ensure_equals("removed after reopen", shards.getSize(ids[0]), 0);
+		for (S32 i = 1; i < 64; ++i)
+		{
+			ensure_body(shards, ids[i], 1000 + i * 37);
+		}
+
+		// Forget the index, as if we crashed: the shards get rescanned.
+		shards.close();
+		LLFile::remove(mPrefix + "texture.shards");
+		ensure("reopen without index", shards.open(mPrefix, false));
+		ensure_equals("removed after rescan", shards.getSize(ids[0]), 0);
+		for (S32 i = 1; i < 64; ++i)
+		{
+			ensure_body(shards, ids[i], 1000 + i * 37);
+		}
+	}
+
+	template<> template<>
+	void texturecacheshards_object_t::test<2>()
+	{
+		// Compaction drops overwritten and removed bodies and keeps the rest readable.
+		const S32 BODY_SIZE = 1024 * 1024;
+		LLTextureCacheShards shards;
+		ensure("open", shards.open(mPrefix, false));
+		std::vector<LLUUID> ids;
+		std::vector<U8> buffer;
+		for (S32 i = 0; i < 24; ++i)
+		{
+			ids.push_back(id_in_shard(5));
+			fill(buffer, ids[i], BODY_SIZE);
+			ensure_equals("write", shards.write(ids[i], &buffer[0], BODY_SIZE), BODY_SIZE);
+		}
+		ensure("nothing to compact yet", !shards.needsCompaction());
+		for (S32 i = 0; i < 20; ++i)
+		{
+			shards.remove(ids[i]);
+		}
+		ensure("needs compaction", shards.needsCompaction());
+		ensure("reclaimed", shards.compact() >= 20 * BODY_SIZE);
+		ensure("compacted", !shards.needsCompaction());
+		ensure_equals("no garbage left", shards.getGarbageBytes(), (S64)0);
+		for (S32 i = 20; i < 24; ++i)
+		{
+			ensure_body(shards, ids[i], BODY_SIZE);
+		}
+		shards.close();
+		ensure("reopen", shards.open(mPrefix, false));
+		for (S32 i = 20; i < 24; ++i)
+		{
+			ensure_body(shards, ids[i], BODY_SIZE);
+		}
+	}
+
+	template<> template<>
+	void texturecacheshards_object_t::test<3>()
+	{
+		// Warm start timing. Set LL_TEXTURECACHE_BENCH_MB=2048 for a full size cache.
+		S32 cache_mb = 32;
+		const char* env = getenv("LL_TEXTURECACHE_BENCH_MB");
+		if (env && atoi(env) > 0)
+		{
+			cache_mb = atoi(env);
+		}
+		// Roughly the body size distribution of a busy region: mostly small, some big.
+		const S32 sizes[] = { 4 * 1024, 16 * 1024, 32 * 1024, 64 * 1024, 256 * 1024 };
+		const S32 num_sizes = sizeof(sizes) / sizeof(sizes[0]);
+
+		std::vector<LLUUID> ids;
+		std::vector<S32> body_sizes;
+		S64 total = 0;
+		{
+			LLTextureCacheShards shards;
+			ensure("open", shards.open(mPrefix, false));
+			std::vector<U8> buffer(sizes[num_sizes - 1]);
+			while (total < (S64)cache_mb * 1024 * 1024)
+			{
+				LLUUID id;
+				id.generate();
+				S32 size = sizes[ids.size() % num_sizes];
+				buffer[0] = expected_byte(id, 0);
+				buffer[size - 1] = expected_byte(id, size - 1);
+				ensure_equals("write", shards.write(id, &buffer[0], size), size);
+				ids.push_back(id);
+				body_sizes.push_back(size);
+				total += size;
+			}
+		}
+
+		LLTimer timer;
+		LLTextureCacheShards shards;
+		ensure("warm open", shards.open(mPrefix, false));
+		F32 index_time = timer.getElapsedTimeF32();
+		ensure_equals("live bytes", shards.getLiveBytes(), total);
+
+		shards.close();
+		LLFile::remove(mPrefix + "texture.shards");
+		timer.reset();
+		ensure("rescan open", shards.open(mPrefix, false));
+		F32 scan_time = timer.getElapsedTimeF32();
+		ensure_equals("live bytes after rescan", shards.getLiveBytes(), total);
+
+		for (size_t i = 0; i < ids.size(); i += 97)
+		{
+			ensure_equals("body size", shards.getSize(ids[i]), body_sizes[i]);
+		}
+
+		llinfos << "Texture cache warm start, " << ids.size() << " bodies, " << total / (1024 * 1024)
+				<< " MB: index " << index_time << "s, rescan " << scan_time << "s" << llendl;
+	}
+
+	template<> template<>
+	void texturecacheshards_object_t::test<4>()
+	{
+		// removeFiles() cleans up without an open LLTextureCacheShards, as after switching the shards off.
+		{
+			LLTextureCacheShards shards;
+			ensure("open", shards.open(mPrefix, false));
+			std::vector<U8> buffer;
+			LLUUID id = id_in_shard(3);
+			fill(buffer, id, 1000);
+			ensure_equals("write", shards.write(id, &buffer[0], 1000), 1000);
+		}
+		ensure("index written", LLFile::isfile(mPrefix + "texture.shards"));
+		ensure("shard written", LLFile::isfile(mPrefix + "texture.shard.3"));
+
+		LLTextureCacheShards::removeFiles(mPrefix);
+		for (S32 i = 0; i < LLTextureCacheShards::NUM_SHARDS; ++i)
+		{
+			ensure(llformat("shard %x removed", i), !LLFile::isfile(llformat("%stexture.shard.%x", mPrefix.c_str(), i)));
+		}
+		ensure("index removed", !LLFile::isfile(mPrefix + "texture.shards"));
+	}
+}
@@ -0,0 +1,227 @@
+/**
+ * @file llsdarena_tut.cpp
+ * @date 2011-06
+ * @brief LLSDArenaDocument test cases.
+ *
+ * $LicenseInfo:firstyear=2007&license=viewergpl$
+ * 
+ * Copyright (c) 2007-2009, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "lltut.h"
+#include "llformat.h"
+#include "llsdarena.h"
+#include "llsdserialize.h"
+
+
+namespace tut
+{
+	struct llsdarena_data
+	{
+		LLSD makeSample()
+		{
+			LLSD sd;
+			sd["integer"] = 42;
+			sd["real"] = 2.5;
+			sd["short"] = "short";
+			sd["long"] = "a string too long to be stored inline";
+			sd["true"] = true;
+			LLUUID id;
+			id.generate();
+			sd["uuid"] = id;
+			sd["date"] = LLDate(12345.0);
+			sd["uri"] = LLURI("http://www.secondlife.com/");
+			LLSD::Binary binary;
+			for (S32 i = 0; i < 100; ++i)
+			{
+				binary.push_back((U8)i);
+			}
+			sd["binary"] = binary;
+			sd["undef"] = LLSD();
+			sd["array"].append(1);
+			sd["array"].append("two");
+			sd["array"].append(LLSD::emptyMap());
+			sd["map"]["inner"]["deeper"] = LLSD::emptyArray();
+			return sd;
+		}
+	};
+	typedef test_group<llsdarena_data> llsdarena_test;
+	typedef llsdarena_test::object llsdarena_object;
+	tut::llsdarena_test tarena("llsdarena");
+
+	template<> template<>
+	void llsdarena_object::test<1>()
+	{
+		LLSD sd = makeSample();
+		LLSDArenaDocument document;
+		document.assign(sd);
+		const LLSDArenaValue& root = document.root();
+
+		ensure("map", root.isMap());
+		ensure_equals("size", root.size(), sd.size());
+		ensure_equals("integer", root["integer"].asInteger(), 42);
+		ensure_equals("real", root["real"].asReal(), 2.5);
+		ensure_equals("short", root["short"].asString(), std::string("short"));
+		ensure_equals("long", root["long"].asString(), sd["long"].asString());
+		ensure("true", root["true"].asBoolean());
+		ensure_equals("uuid", root["uuid"].asUUID(), sd["uuid"].asUUID());
+		ensure_equals("date", root["date"].asDate().secondsSinceEpoch(), 12345.0);
+		ensure_equals("uri", root["uri"].asURI().asString(), std::string("http://www.secondlife.com/"));
+		ensure_equals("binary", root["binary"].asBinary(), sd["binary"].asBinary());
+		ensure("undef", root.has("undef") && root["undef"].isUndefined());
+		ensure_equals("array", root["array"].size(), 3);
+		ensure_equals("array string", root["array"][1].asString(), std::string("two"));
+		ensure("array map", root["array"][2].isMap());
+		ensure("deep", root["map"]["inner"]["deeper"].isArray());
+		ensure_equals("copy", root.asLLSD(), sd);
+	}
+
+	template<> template<>
+	void llsdarena_object::test<2>()
+	{
+		// Misses and conversions behave like LLSD.
+		LLSDArenaDocument document;
+		ensure("empty", document.root().isUndefined());
+		document.assign(makeSample());
+		const LLSDArenaValue& root = document.root();
+		ensure("missing key", root["missing"].isUndefined());
+		ensure("index in map", root[0].isUndefined());
+		ensure("out of range", root["array"][3].isUndefined());
+		ensure("negative", root["array"][-1].isUndefined());
+		ensure("key in array", root["array"]["integer"].isUndefined());
+		ensure_equals("scalar size", root["integer"].size(), 0);
+		ensure_equals("integer as string", root["integer"].asString(), std::string("42"));
+		ensure_equals("integer as real", root["array"][0].asReal(), 1.0);
+		ensure_equals("real as integer", root["real"].asInteger(), 2);
+
+		S32 count = 0;
+		std::string last;
+		for (LLSDArenaValue::map_const_iterator iter = root.beginMap(); iter != root.endMap(); ++iter)
+		{
+			ensure("sorted", last < iter->first);
+			last = iter->first;
+			++count;
+		}
+		ensure_equals("map iteration", count, root.size());
+		ensure("array iterators of a map", root.beginArray() == root.endArray());
+	}
+
+	template<> template<>
+	void llsdarena_object::test<3>()
+	{
+		// Straight from the parsers.
+		LLSD sd = makeSample();
+		std::ostringstream binary;
+		LLSDSerialize::toBinary(sd, binary);
+		std::ostringstream xml;
+		LLSDSerialize::toXML(sd, xml);
+		std::ostringstream notation;
+		LLSDSerialize::toNotation(sd, notation);
+
+		LLSDArenaDocument document;
+		std::istringstream binary_stream(binary.str());
+		ensure("binary", LLSDSerialize::fromBinary(document, binary_stream, binary.str().size()) > 0);
+		ensure_equals("binary document", document.root().asLLSD(), sd);
+
+		std::istringstream xml_stream(xml.str());
+		ensure("xml", LLSDSerialize::fromXML(document, xml_stream) > 0);
+		ensure_equals("xml document", document.root().asLLSD(), sd);
+
+		std::istringstream notation_stream(notation.str());
+		ensure("notation", LLSDSerialize::fromNotation(document, notation_stream, notation.str().size()) > 0);
+		ensure_equals("notation document", document.root().asLLSD(), sd);
+
+		std::istringstream bad_stream("{'a':i1,'b':[");
+		ensure_equals("failure", LLSDSerialize::fromNotation(document, bad_stream, LLSDSerialize::SIZE_UNLIMITED),
+					  (S32)LLSDParser::PARSE_FAILURE);
+		ensure("cleared", document.root().isUndefined());
+	}
+
+	template<> template<>
+	void llsdarena_object::test<4>()
+	{
+		// Keys are stored once, duplicates keep the first value.
+		LLSD array = LLSD::emptyArray();
+		for (S32 i = 0; i < 1000; ++i)
+		{
+			LLSD item;
+			item["name"] = llformat("item %d", i);
+			item["id"] = i;
+			array.append(item);
+		}
+		LLSDArenaDocument document(1024);
+		document.assign(array);
+		ensure_equals("keys", document.getKeyCount(), 2);
+		ensure_equals("last", document.root()[999]["id"].asInteger(), 999);
+		ensure_equals("copy", document.root().asLLSD(), array);
+
+		std::istringstream istr("{'a':i1,'b':i2,'a':i3}");
+		ensure("parse", LLSDSerialize::fromNotation(document, istr, LLSDSerialize::SIZE_UNLIMITED) > 0);
+		ensure_equals("duplicates", document.root().size(), 2);
+		ensure_equals("first wins", document.root()["a"].asInteger(), 1);
+
+		document.clear();
+		ensure("clear", document.root().isUndefined());
+		ensure_equals("clear keys", document.getKeyCount(), 0);
+		ensure_equals("clear bytes", document.getArenaBytes(), (size_t)0);
+	}
+
+	template<> template<>
+	void llsdarena_object::test<5>()
+	{
+		// A long string as the root: its bytes must survive the clear() at the start of the parse.
+		std::string long_string;
+		for (S32 i = 0; i < 400; ++i)
+		{
+			long_string += (char)('a' + i % 26);
+		}
+		std::ostringstream notation;
+		LLSDSerialize::toNotation(LLSD(long_string), notation);
+
+		// 400 bytes get a large chunk of their own in a 1024 byte chunked document.
+		LLSDArenaDocument fresh(1024);
+		std::istringstream fresh_stream(notation.str());
+		ensure("parse new", LLSDSerialize::fromNotation(fresh, fresh_stream, notation.str().size()) > 0);
+		ensure_equals("new document", fresh.root().asString(), long_string);
+		ensure("new document bytes", fresh.getArenaBytes() >= long_string.size());
+
+		// In a reused document, a previous parse left chunks behind.
+		LLSDArenaDocument reused(1024);
+		reused.assign(makeSample());
+		std::istringstream reused_stream(notation.str());
+		ensure("parse reused", LLSDSerialize::fromNotation(reused, reused_stream, notation.str().size()) > 0);
+		ensure_equals("reused document", reused.root().asString(), long_string);
+		ensure("reused document bytes", reused.getArenaBytes() >= long_string.size());
+
+		// A shorter one that goes into the current chunk.
+		std::string medium(long_string, 0, 100);
+		reused.assign(makeSample());
+		reused.assign(LLSD(medium));
+		ensure_equals("reused medium", reused.root().asString(), medium);
+		ensure("reused medium bytes", reused.getArenaBytes() >= medium.size());
+	}
+}
@@ -42,6 +42,13 @@
 #include "llsdserialize.h"
 #include "lltut.h"
 #include "llformat.h"
+#include "lltimer.h"
+
+#ifdef LL_STANDALONE
+# include <zlib.h>
+#else
+# include "zlib/zlib.h"
+#endif
 
 // These tests take too long to run on Windows. JC
 // Yeah, who cares if windows works or not, right? Phoenix
@@ -1439,6 +1446,435 @@ namespace tut
 		ensureBinaryAndNotation("map", test);
 		ensureBinaryAndXML("map", test);
 	}
+
+	/**
+	 * @class LLSDRebuildVisitor
+	 * @brief Builds the LLSD back from the visitor events, and counts the
+	 * items and bytes of an inventory fetch like payload on the way.
+	 */
+	class LLSDRebuildVisitor : public LLSDParserVisitor
+	{
+	public:
+		LLSDRebuildVisitor() : mItems(0), mNameBytes(0), mInName(false) { }
+
+		/*virtual*/ void startMap() { push(LLSD::emptyMap()); }
+		/*virtual*/ void key(const std::string& name)
+		{
+			mKey = name;
+			mInName = (name == "name");
+		}
+		/*virtual*/ void endMap() { pop(); }
+		/*virtual*/ void startArray() { push(LLSD::emptyArray()); }
+		/*virtual*/ void endArray() { pop(); }
+		/*virtual*/ void value(const LLSD& data)
+		{
+			if (mInName)
+			{
+				++mItems;
+				mNameBytes += data.asString().size();
+				mInName = false;
+			}
+			place(data);
+		}
+
+		LLSD mResult;
+		S32 mItems;
+		size_t mNameBytes;
+
+	private:
+		LLSD& place(const LLSD& data)
+		{
+			if (mStack.empty())
+			{
+				mResult = data;
+				return mResult;
+			}
+			LLSD& parent = *mStack.back();
+			if (parent.isMap())
+			{
+				return parent[mKey] = data;
+			}
+			parent.append(data);
+			return parent[parent.size() - 1];
+		}
+		void push(const LLSD& data)
+		{
+			mInName = false;
+			mStack.push_back(&place(data));
+		}
+		void pop() { mStack.pop_back(); }
+
+		std::vector<LLSD*> mStack;
+		std::string mKey;
+		bool mInName;
+	};
+
+	/**
+	 * @class LLSDCountVisitor
+	 * @brief What a streaming consumer would do: only look at the item
+	 * names, without keeping anything else.
+	 */
+	class LLSDCountVisitor : public LLSDParserVisitor
+	{
+	public:
+		LLSDCountVisitor() : mItems(0), mNameBytes(0), mInName(false) { }
+
+		/*virtual*/ void key(const std::string& name) { mInName = (name == "name"); }
+		/*virtual*/ void value(const LLSD& data)
+		{
+			if (mInName)
+			{
+				++mItems;
+				mNameBytes += data.asString().size();
+				mInName = false;
+			}
+		}
+
+		S32 mItems;
+		size_t mNameBytes;
+
+	private:
+		bool mInName;
+	};
+
+	class TestLLSDVisitorParsing
+	{
+	public:
+		TestLLSDVisitorParsing() {}
+
+		// Shaped like a FetchInventoryDescendents2 reply.
+		static LLSD makeInventory(S32 folders, S32 items_per_folder)
+		{
+			LLSD result;
+			LLSD& folder_array = result["folders"] = LLSD::emptyArray();
+			for (S32 f = 0; f < folders; ++f)
+			{
+				LLSD folder;
+				LLUUID folder_id;
+				folder_id.generate();
+				folder["folder_id"] = folder_id;
+				folder["owner_id"] = LLUUID::null;
+				folder["agent_id"] = LLUUID::null;
+				folder["version"] = f;
+				folder["descendents"] = items_per_folder;
+				folder["categories"] = LLSD::emptyArray();
+				LLSD& items = folder["items"] = LLSD::emptyArray();
+				for (S32 i = 0; i < items_per_folder; ++i)
+				{
+					LLSD item;
+					LLUUID item_id;
+					item_id.generate();
+					item["item_id"] = item_id;
+					item["parent_id"] = folder_id;
+					item["asset_id"] = item_id;
+					item["name"] = llformat("Inventory item %d in folder %d", i, f);
+					item["desc"] = "(No Description)";
+					item["type"] = i % 20;
+					item["inv_type"] = i % 18;
+					item["flags"] = 0;
+					item["created_at"] = 1300000000 + i;
+					LLSD& permissions = item["permissions"];
+					permissions["creator_id"] = LLUUID::null;
+					permissions["owner_id"] = LLUUID::null;
+					permissions["base_mask"] = (S32)0x7fffffff;
+					permissions["owner_mask"] = (S32)0x7fffffff;
+					permissions["is_owner_group"] = false;
+					LLSD& sale_info = item["sale_info"];
+					sale_info["sale_price"] = 10;
+					sale_info["sale_type"] = 0;
+					items.append(item);
+				}
+				folder_array.append(folder);
+			}
+			return result;
+		}
+
+		void ensureVisited(const std::string& msg, LLPointer<LLSDParser> parser, const std::string& serialized, const LLSD& expected)
+		{
+			std::istringstream istr(serialized);
+			LLSDRebuildVisitor visitor;
+			S32 count = parser->parse(istr, visitor, serialized.size());
+			ensure((msg + " parse").c_str(), count > 0);
+			ensure_equals((msg + " rebuilt").c_str(), visitor.mResult, expected);
+		}
+
+		void benchmark(const std::string& name, LLPointer<LLSDParser> tree_parser, LLPointer<LLSDParser> visit_parser,
+					   const std::string& serialized, S32 items)
+		{
+			LLTimer timer;
+			LLSD tree;
+			std::istringstream tree_stream(serialized);
+			S32 tree_count = tree_parser->parse(tree_stream, tree, serialized.size());
+			F32 tree_seconds = timer.getElapsedTimeF32();
+
+			timer.reset();
+			LLSDCountVisitor visitor;
+			std::istringstream visit_stream(serialized);
+			S32 visit_count = visit_parser->parse(visit_stream, visitor, serialized.size());
+			F32 visit_seconds = timer.getElapsedTimeF32();
+
+			ensure_equals((name + " parse count").c_str(), visit_count, tree_count);
+			ensure_equals((name + " item count").c_str(), visitor.mItems, items);
+			llinfos << "Parsed " << serialized.size() << " bytes of " << name << " inventory: tree "
+					<< tree_seconds << " seconds, visitor " << visit_seconds << " seconds" << llendl;
+		}
+	};
+
+	typedef tut::test_group<TestLLSDVisitorParsing> TestLLSDVisitorParsingGroup;
+	typedef TestLLSDVisitorParsingGroup::object TestLLSDVisitorParsingObject;
+	TestLLSDVisitorParsingGroup gTestLLSDVisitorParsingGroup("llsd visitor parsing");
+
+	template<> template<> 
+	void TestLLSDVisitorParsingObject::test<1>()
+	{
+		// Events, in order.
+		class LLSDTraceVisitor : public LLSDParserVisitor
+		{
+		public:
+			/*virtual*/ void startMap() { mTrace += "{"; }
+			/*virtual*/ void key(const std::string& name) { mTrace += name + ":"; }
+			/*virtual*/ void endMap() { mTrace += "}"; }
+			/*virtual*/ void startArray() { mTrace += "["; }
+			/*virtual*/ void endArray() { mTrace += "]"; }
+			/*virtual*/ void value(const LLSD& data) { mTrace += data.asString() + ","; }
+			std::string mTrace;
+		};
+
+		const std::string doc("{'a':i1,'b':['x',{'c':r2.5},[]],'d':{}}");
+		LLPointer<LLSDParser> parser = new LLSDNotationParser;
+		LLSD sd;
+		std::istringstream tree_istr(doc);
+		S32 tree_count = parser->parse(tree_istr, sd, LLSDSerialize::SIZE_UNLIMITED);
+		ensure_equals("tree parse count", tree_count, 8);
+
+		std::istringstream istr(doc);
+		LLSDTraceVisitor visitor;
+		ensure_equals("parse count", parser->parse(istr, visitor, LLSDSerialize::SIZE_UNLIMITED), tree_count);
+		ensure_equals("trace", visitor.mTrace, std::string("{a:1,b:[x,{c:2.5,}[]]d:{}}"));
+
+		LLSDTraceVisitor tree_visitor;
+		tree_visitor.visit(sd);
+		ensure_equals("visit", tree_visitor.mTrace, visitor.mTrace);
+	}
+
+	template<> template<> 
+	void TestLLSDVisitorParsingObject::test<2>()
+	{
+		LLSD inventory = makeInventory(3, 5);
+		std::ostringstream notation;
+		notation << LLSDNotationStreamer(inventory);
+		std::ostringstream binary;
+		LLSDSerialize::toBinary(inventory, binary);
+		std::ostringstream xml;
+		LLSDSerialize::toXML(inventory, xml);
+
+		ensureVisited("notation", new LLSDNotationParser, notation.str(), inventory);
+		ensureVisited("binary", new LLSDBinaryParser, binary.str(), inventory);
+		ensureVisited("xml", new LLSDXMLParser, xml.str(), inventory);
+	}
+
+	template<> template<> 
+	void TestLLSDVisitorParsingObject::test<3>()
+	{
+		// Visiting a parser that doesn't report the events itself.
+		LLSD inventory = makeInventory(2, 2);
+		LLSDRebuildVisitor visitor;
+		visitor.visit(inventory);
+		ensure_equals("visited", visitor.mResult, inventory);
+		ensure_equals("visited items", visitor.mItems, 4);
+	}
+
+	template<> template<> 
+	void TestLLSDVisitorParsingObject::test<4>()
+	{
+		std::istringstream istr("{'a':i1,'b':[i2,");
+		LLSDCountVisitor visitor;
+		LLPointer<LLSDParser> parser = new LLSDNotationParser;
+		ensure_equals("truncated", parser->parse(istr, visitor, LLSDSerialize::SIZE_UNLIMITED),
+					  (S32)LLSDParser::PARSE_FAILURE);
+	}
+
+	template<> template<> 
+	void TestLLSDVisitorParsingObject::test<5>()
+	{
+		// A few megabytes, like the fetch of a large inventory.
+		const S32 folders = 200;
+		const S32 items_per_folder = 50;
+		LLSD inventory = makeInventory(folders, items_per_folder);
+		std::ostringstream notation;
+		notation << LLSDNotationStreamer(inventory);
+		std::ostringstream binary;
+		LLSDSerialize::toBinary(inventory, binary);
+		std::ostringstream xml;
+		LLSDSerialize::toXML(inventory, xml);
+
+		S32 items = folders * items_per_folder;
+		benchmark("notation", new LLSDNotationParser, new LLSDNotationParser, notation.str(), items);
+		benchmark("binary", new LLSDBinaryParser, new LLSDBinaryParser, binary.str(), items);
+		benchmark("xml", new LLSDXMLParser, new LLSDXMLParser, xml.str(), items);
+	}
+
+	class TestLLSDZip
+	{
+	public:
+		TestLLSDZip() {}
+
+		// Shaped like one face of a mesh LOD block.
+		static LLSD makeFace(S32 vertices)
+		{
+			LLSD face;
+			LLSD::Binary positions(vertices * 6);
+			LLSD::Binary normals(vertices * 6);
+			LLSD::Binary tex_coords(vertices * 4);
+			LLSD::Binary triangles(vertices * 6);
+			for (S32 i = 0; i < vertices * 6; ++i)
+			{
+				positions[i] = (U8)(i * 7 + (i / 6) % 13);
+				normals[i] = (U8)(i % 11 + i / 64);
+				triangles[i] = (U8)((i / 2) % vertices);
+			}
+			for (S32 i = 0; i < vertices * 4; ++i)
+			{
+				tex_coords[i] = (U8)(i % 255);
+			}
+			face["Position"] = positions;
+			face["Normal"] = normals;
+			face["TexCoord0"] = tex_coords;
+			face["TriangleList"] = triangles;
+			LLSD& domain = face["PositionDomain"];
+			domain["Min"].append(-0.5);
+			domain["Min"].append(-0.5);
+			domain["Min"].append(-0.5);
+			domain["Max"].append(0.5);
+			domain["Max"].append(0.5);
+			domain["Max"].append(0.5);
+			return face;
+		}
+	};
+
+	typedef tut::test_group<TestLLSDZip> TestLLSDZipGroup;
+	typedef TestLLSDZipGroup::object TestLLSDZipObject;
+	TestLLSDZipGroup gTestLLSDZipGroup("llsd zip");
+
+	template<> template<> 
+	void TestLLSDZipObject::test<1>()
+	{
+		LLSD mesh;
+		mesh.append(makeFace(20000));
+		mesh.append(makeFace(100));
+		std::string zipped = zip_llsd(mesh);
+		ensure("compressed", !zipped.empty());
+
+		// The stream is left right after the block.
+		std::istringstream istr(zipped + "next");
+		LLSD result;
+		ensure("unzip", unzip_llsd(result, istr, zipped.size()));
+		ensure_equals("round trip", result, mesh);
+		std::string next;
+		istr >> next;
+		ensure_equals("position", next, std::string("next"));
+
+		ensure_equals("same result with reused buffers", zip_llsd(mesh), zipped);
+	}
+
+	template<> template<> 
+	void TestLLSDZipObject::test<2>()
+	{
+		LLSD mesh = makeFace(1000);
+		std::string zipped = zip_llsd(mesh);
+		LLSD result;
+
+		std::istringstream truncated(zipped.substr(0, zipped.size() / 2));
+		ensure("truncated", !unzip_llsd(result, truncated, zipped.size() / 2));
+
+		std::string corrupt = zipped;
+		corrupt[corrupt.size() - 1] ^= 0xff;
+		std::istringstream corrupt_stream(corrupt);
+		ensure("checksum", !unzip_llsd(result, corrupt_stream, corrupt.size()));
+
+		std::istringstream garbage("this is not compressed");
+		ensure("garbage", !unzip_llsd(result, garbage, 22));
+
+		// A failed unzip leaves the caller's data alone.
+		ensure("untouched", result.isUndefined());
+	}
+
+	template<> template<> 
+	void TestLLSDZipObject::test<3>()
+	{
+		// Blocks written with the old header still load.
+		LLSD mesh = makeFace(100);
+		std::ostringstream raw;
+		raw << "<? LLSD/Binary ?>\n";
+		LLSDSerialize::toBinary(mesh, raw);
+		std::string source = raw.str();
+
+		uLongf size = compressBound(source.size());
+		std::string zipped(size, '\0');
+		ensure("compress", compress((Bytef*)&zipped[0], &size, (const Bytef*)source.data(), source.size()) == Z_OK);
+		zipped.resize(size);
+
+		std::istringstream istr(zipped);
+		LLSD result;
+		ensure("unzip", unzip_llsd(result, istr, zipped.size()));
+		ensure_equals("legacy header", result, mesh);
+	}
+
+	template<> template<> 
+	void TestLLSDZipObject::test<4>()
+	{
+		// Against inflating the whole block first and parsing a copy of it,
+		// as unzip_llsd used to.
+		const S32 blocks = 50;
+		std::vector<std::string> zipped;
+		LLTimer timer;
+		for (S32 i = 0; i < blocks; ++i)
+		{
+			LLSD mesh;
+			mesh.append(makeFace(4000 + i * 100));
+			mesh.append(makeFace(500));
+			zipped.push_back(zip_llsd(mesh));
+		}
+		F32 zip_seconds = timer.getElapsedTimeF32();
+
+		timer.reset();
+		for (S32 i = 0; i < blocks; ++i)
+		{
+			std::istringstream istr(zipped[i]);
+			LLSD result;
+			ensure("unzip", unzip_llsd(result, istr, zipped[i].size()));
+		}
+		F32 stream_seconds = timer.getElapsedTimeF32();
+
+		timer.reset();
+		for (S32 i = 0; i < blocks; ++i)
+		{
+			std::string inflated;
+			z_stream strm;
+			memset(&strm, 0, sizeof(strm));
+			inflateInit(&strm);
+			strm.next_in = (Bytef*)zipped[i].data();
+			strm.avail_in = zipped[i].size();
+			U8 out[65536];
+			S32 ret;
+			do
+			{
+				strm.next_out = out;
+				strm.avail_out = sizeof(out);
+				ret = inflate(&strm, Z_NO_FLUSH);
+				inflated.append((char*)out, sizeof(out) - strm.avail_out);
+			}
+			while (ret == Z_OK);
+			inflateEnd(&strm);
+			std::istringstream istr(inflated);
+			LLSD result;
+			ensure("copy", LLSDSerialize::fromBinary(result, istr, inflated.size()) > 0);
+		}
+		F32 copy_seconds = timer.getElapsedTimeF32();
+
+		llinfos << "Zipped " << blocks << " mesh blocks in " << zip_seconds << " seconds; unzipped them in "
+				<< stream_seconds << " seconds, " << copy_seconds << " seconds through a copy" << llendl;
+	}
 }
 
 #endif
@@ -39,6 +39,7 @@
 #include "llquaternion.h"
 #include "lltemplatemessagebuilder.h"
 #include "lltemplatemessagereader.h"
+#include "lltimer.h"
 #include "llversionserver.h"
 #include "message_prehash.h"
 #include "u64.h"
@@ -109,7 +110,8 @@ namespace tut
 		{
 			numberMap[1] = &messageTemplate;
 			const U32 bufferSize = 1024;
-			U8 buffer[bufferSize];
+			// The reader reads from the packet buffer, so that has to outlive this function.
+			static U8 buffer[bufferSize];
 			// zero out the packet ID field
 			memset(buffer, 0, LL_PACKET_ID_SIZE);
 			U32 builtSize = builder->buildMessage(buffer, bufferSize, offset);
@@ -970,5 +972,56 @@ namespace tut
 		ensure_equals("Ensure unchanged buffer ", strlen(outBuffer), 0);
 		delete reader;
 	}
+
+	template<> template<>
+	void LLTemplateMessageBuilderTestObject::test<46>()
+		// decode a message with many block instances over and over, like an object update
+	{
+		LLMessageTemplate messageTemplate = defaultTemplate();
+		LLMessageBlock* block = new LLMessageBlock(_PREHASH_Test0, MBT_VARIABLE);
+		block->addVariable(const_cast<char*>(_PREHASH_Test0), MVT_U32, 4);
+		block->addVariable(const_cast<char*>(_PREHASH_Test1), MVT_LLVector3, 12);
+		messageTemplate.addBlock(block);
+		LLTemplateMessageBuilder* builder = defaultBuilder(messageTemplate);
+		const S32 blocks = 60;
+		for (S32 i = 0; i < blocks; ++i)
+		{
+			if (i)
+			{
+				builder->nextBlock(_PREHASH_Test0);
+			}
+			builder->addU32(_PREHASH_Test0, i);
+			builder->addVector3(_PREHASH_Test1, LLVector3((F32)i, 1.f, 2.f));
+		}
+		const U32 bufferSize = 1024;
+		U8 buffer[bufferSize];
+		memset(buffer, 0, LL_PACKET_ID_SIZE);
+		U32 builtSize = builder->buildMessage(buffer, bufferSize, 0);
+		delete builder;
+
+		numberMap[1] = &messageTemplate;
+		LLTemplateMessageReader* reader = new LLTemplateMessageReader(numberMap);
+		const S32 repeats = 10000;
+		LLTimer timer;
+		for (S32 r = 0; r < repeats; ++r)
+		{
+			reader->clearMessage();
+			reader->validateMessage(buffer, builtSize, LLHost());
+			reader->readMessage(buffer, LLHost());
+			ensure_equals("Ensure block count", reader->getNumberOfBlocks(_PREHASH_Test0), blocks);
+			for (S32 i = 0; i < blocks; ++i)
+			{
+				U32 outValue;
+				LLVector3 outVector;
+				reader->getU32(_PREHASH_Test0, _PREHASH_Test0, outValue, i);
+				reader->getVector3(_PREHASH_Test0, _PREHASH_Test1, outVector, i);
+				ensure_equals("Ensure U32", outValue, (U32)i);
+				ensure_equals("Ensure LLVector3", outVector, LLVector3((F32)i, 1.f, 2.f));
+			}
+		}
+		llinfos << "Decoded and read " << repeats << " messages of " << blocks << " blocks in "
+				<< timer.getElapsedTimeF32() << " seconds" << llendl;
+		delete reader;
+	}
 }
 
@@ -0,0 +1,251 @@
+/**
+ * @file llvfs_tut.cpp
+ * @brief Tests and timing for the stdio and memory mapped LLVFS data paths.
+ *
+ * $LicenseInfo:firstyear=2002&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "lltut.h"
+
+#include "llvfs.h"
+#include "llfile.h"
+#include "llstl.h"
+#include "lltimer.h"
+
+namespace
+{
+	const S32 NUM_FILES = 64;
+	const S32 FILE_SIZE = 256 * 1024;
+	const S32 NUM_THREADS = 4;
+	const S32 PASSES = 8;
+
+	U8 expected_byte(S32 file, S32 offset)
+	{
+		return (U8)((file * 31 + offset) & 0xFF);
+	}
+
+	// Reads every file PASSES times; thread 0 also rewrites its files so
+	// readers and a writer contend on the data file like the cache threads do.
+	class VFSWorker : public LLThread
+	{
+	public:
+		VFSWorker(LLVFS* vfs, const std::vector<LLUUID>& ids, S32 index)
+		:	LLThread("VFS test worker"),
+			mVFS(vfs),
+			mIDs(ids),
+			mIndex(index),
+			mErrors(0)
+		{
+		}
+
+		/*virtual*/ void run()
+		{
+			std::vector<U8> buffer(FILE_SIZE);
+			for (S32 pass = 0; pass < PASSES; ++pass)
+			{
+				for (S32 i = 0; i < NUM_FILES; ++i)
+				{
+					S32 file = (i + mIndex * 7) % NUM_FILES;
+					if (mIndex == 0 && (file & 3) == 0)
+					{
+						for (S32 j = 0; j < FILE_SIZE; ++j)
+						{
+							buffer[j] = expected_byte(file, j);
+						}
+						mVFS->storeData(mIDs[file], LLAssetType::AT_TEXTURE, &buffer[0], 0, FILE_SIZE);
+						continue;
+					}
+					S32 read = mVFS->getData(mIDs[file], LLAssetType::AT_TEXTURE, &buffer[0], 0, FILE_SIZE);
+					if (read != FILE_SIZE ||
+						buffer[0] != expected_byte(file, 0) ||
+						buffer[FILE_SIZE - 1] != expected_byte(file, FILE_SIZE - 1))
+					{
+						++mErrors;
+					}
+				}
+			}
+		}
+
+		LLVFS* mVFS;
+		const std::vector<LLUUID>& mIDs;
+		S32 mIndex;
+		S32 mErrors;
+	};
+}
+
+namespace tut
+{
+	struct vfs_data
+	{
+		std::string mIndexFile;
+		std::string mDataFile;
+		std::vector<LLUUID> mIDs;
+
+		vfs_data()
+		{
+			LLUUID random;
+			random.generate();
+			std::ostringstream oStr;
+#if LL_WINDOWS
+			oStr << "llvfs-test-" << random;
+#else
+			oStr << "/tmp/llvfs-test-" << random;
+#endif
+			mIndexFile = oStr.str() + ".index";
+			mDataFile = oStr.str() + ".data";
+			for (S32 i = 0; i < NUM_FILES; ++i)
+			{
+				mIDs.push_back(LLUUID::generateNewID());
+			}
+		}
+
+		~vfs_data()
+		{
+			LLFile::remove(mIndexFile);
+			LLFile::remove(mDataFile);
+			LLVFS::sUseMappedData = false;
+		}
+
+		LLVFS* create(bool mapped)
+		{
+			LLFile::remove(mIndexFile);
+			LLFile::remove(mDataFile);
+			LLVFS::sUseMappedData = mapped;
+			return LLVFS::createLLVFS(mIndexFile, mDataFile, FALSE, NUM_FILES * FILE_SIZE * 2, FALSE);
+		}
+
+		void fill(LLVFS* vfs)
+		{
+			std::vector<U8> buffer(FILE_SIZE);
+			for (S32 i = 0; i < NUM_FILES; ++i)
+			{
+				for (S32 j = 0; j < FILE_SIZE; ++j)
+				{
+					buffer[j] = expected_byte(i, j);
+				}
+				vfs->setMaxSize(mIDs[i], LLAssetType::AT_TEXTURE, FILE_SIZE);
+				ensure_equals("store", vfs->storeData(mIDs[i], LLAssetType::AT_TEXTURE, &buffer[0], 0, FILE_SIZE), FILE_SIZE);
+			}
+		}
+
+		// Returns seconds taken, fails on any corrupted read.
+		F32 hammer(LLVFS* vfs)
+		{
+			std::vector<VFSWorker*> workers;
+			for (S32 i = 0; i < NUM_THREADS; ++i)
+			{
+				workers.push_back(new VFSWorker(vfs, mIDs, i));
+			}
+			LLTimer timer;
+			for (S32 i = 0; i < NUM_THREADS; ++i)
+			{
+				workers[i]->start();
+			}
+			S32 errors = 0;
+			for (S32 i = 0; i < NUM_THREADS; ++i)
+			{
+				while (!workers[i]->isStopped())
+				{
+					ms_sleep(1);
+				}
+				errors += workers[i]->mErrors;
+			}
+			F32 elapsed = timer.getElapsedTimeF32();
+			for_each(workers.begin(), workers.end(), DeletePointer());
+			ensure_equals("corrupted reads", errors, 0);
+			return elapsed;
+		}
+	};
+	typedef test_group<vfs_data> vfs_test;
+	typedef vfs_test::object vfs_object;
+	tut::vfs_test tvfs("vfs");
+
+	template<> template<>
+	void vfs_object::test<1>()
+	{
+		// Mapped and stdio paths must see the same bytes.
+		LLVFS* vfs = create(true);
+		ensure("created", vfs != NULL);
+		ensure("mapped", vfs->isMapped());
+		fill(vfs);
+		delete vfs;
+
+		LLVFS::sUseMappedData = false;
+		vfs = LLVFS::createLLVFS(mIndexFile, mDataFile, TRUE, 0, FALSE);
+		ensure("reopened", vfs != NULL);
+		std::vector<U8> buffer(FILE_SIZE);
+		for (S32 i = 0; i < NUM_FILES; ++i)
+		{
+			ensure_equals("size", vfs->getData(mIDs[i], LLAssetType::AT_TEXTURE, &buffer[0], 0, FILE_SIZE), FILE_SIZE);
+			ensure_equals("first byte", buffer[0], expected_byte(i, 0));
+			ensure_equals("last byte", buffer[FILE_SIZE - 1], expected_byte(i, FILE_SIZE - 1));
+		}
+		delete vfs;
+	}
+
+	template<> template<>
+	void vfs_object::test<2>()
+	{
+		// Multi-threaded read/write timing, stdio vs. mapped.
+		LLVFS* vfs = create(false);
+		ensure("stdio created", vfs != NULL && !vfs->isMapped());
+		fill(vfs);
+		F32 stdio_time = hammer(vfs);
+		delete vfs;
+
+		vfs = create(true);
+		ensure("mapped created", vfs != NULL && vfs->isMapped());
+		fill(vfs);
+		F32 mapped_time = hammer(vfs);
+		delete vfs;
+
+		llinfos << "VFS " << NUM_THREADS << " threads x " << PASSES << " passes x "
+				<< NUM_FILES << " files of " << FILE_SIZE << " bytes: stdio "
+				<< stdio_time << "s, mapped " << mapped_time << "s" << llendl;
+	}
+
+	template<> template<>
+	void vfs_object::test<3>()
+	{
+		// Punch holes, then compact: every surviving file must read back intact.
+		LLVFS* vfs = create(false);
+		ensure("created", vfs != NULL);
+		fill(vfs);
+		for (S32 i = 0; i < NUM_FILES; i += 2)
+		{
+			vfs->removeFile(mIDs[i], LLAssetType::AT_TEXTURE);
+		}
+		ensure("space for a big file", vfs->checkAvailable(FILE_SIZE * NUM_FILES));
+		ensure("moved data", vfs->defragment(10.f) > 0);
+		ensure_equals("nothing left to move", vfs->defragment(10.f), 0);
+
+		std::vector<U8> buffer(FILE_SIZE);
+		for (S32 i = 1; i < NUM_FILES; i += 2)
+		{
+			ensure_equals("size", vfs->getData(mIDs[i], LLAssetType::AT_TEXTURE, &buffer[0], 0, FILE_SIZE), FILE_SIZE);
+			ensure_equals("first byte", buffer[0], expected_byte(i, 0));
+			ensure_equals("last byte", buffer[FILE_SIZE - 1], expected_byte(i, FILE_SIZE - 1));
+		}
+		delete vfs;
+	}
+}
@@ -0,0 +1,204 @@
+/** 
+ * @file plugin_message_bench.cpp
+ * @brief Measures plugin message round trips with XML and with binary messages.
+ *
+ * $LicenseInfo:firstyear=2008&license=viewergpl$
+ * 
+ * Copyright (c) 2008-2009, Linden Research, Inc.
+ * 
+ * Second Life Viewer Source Code
+ * The source code in this file ("Source Code") is provided by Linden Lab
+ * to you under the terms of the GNU General Public License, version 2.0
+ * ("GPL"), unless you have obtained a separate licensing agreement
+ * ("Other License"), formally executed by you and Linden Lab.  Terms of
+ * the GPL can be found in doc/GPL-license.txt in this distribution, or
+ * online at http://secondlifegrid.net/programs/open_source/licensing/gplv2
+ * 
+ * There are special exceptions to the terms and conditions of the GPL as
+ * it is applied to this Source Code. View the full text of the exception
+ * in the file doc/FLOSS-exception.txt in this software distribution, or
+ * online at
+ * http://secondlifegrid.net/programs/open_source/licensing/flossexception
+ * 
+ * By copying, modifying or distributing this software, you acknowledge
+ * that you have read and understood your obligations described above,
+ * and agree to abide by those obligations.
+ * 
+ * ALL LINDEN LAB SOURCE CODE IS PROVIDED "AS IS." LINDEN LAB MAKES NO
+ * WARRANTIES, EXPRESS, IMPLIED OR OTHERWISE, REGARDING ITS ACCURACY,
+ * COMPLETENESS OR PERFORMANCE.
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "lltimer.h"
+#include "llapr.h"
+#include "llerrorcontrol.h"
+#include "llpluginprocessparent.h"
+#include "llpluginmessageclasses.h"
+
+// Runs basic_plugin_example in SLPlugin, once with XML and once with binary
+// messages, and sends it "poke" messages: first one at a time, waiting for
+// each "pokeback" (round trip latency), then all at once (throughput).
+// The pokes carry the parameters of a mouse event, the most frequent message
+// the viewer sends to a media plugin.
+//
+// It also times generate() and parse() of a typical "updated" message, which
+// is the part of the cost that the viewer process pays for every message.
+
+class PluginMessageBenchReceiver : public LLPluginProcessParentOwner
+{
+	LOG_CLASS(PluginMessageBenchReceiver);
+
+public:
+	PluginMessageBenchReceiver() : mPokebacks(0)
+	{
+	}
+
+	/* virtual */ void receivePluginMessage(const LLPluginMessage &message)
+	{
+		if(message.getClass() == LLPLUGIN_MESSAGE_CLASS_BASIC && message.getName() == "pokeback")
+		{
+			++mPokebacks;
+		}
+	}
+
+	/* virtual */ void receivedShutdown()
+	{
+	}
+
+	S32 mPokebacks;
+};
+
+static LLPluginMessage makePoke(S32 i)
+{
+	LLPluginMessage message(LLPLUGIN_MESSAGE_CLASS_BASIC, "poke");
+	message.setValue("event", "move");
+	message.setValueS32("button", 0);
+	message.setValueS32("x", i % 1024);
+	message.setValueS32("y", i % 768);
+	message.setValue("modifiers", "");
+	return message;
+}
+
+static void benchCodec(bool binary, S32 count)
+{
+	LLPluginMessage message(LLPLUGIN_MESSAGE_CLASS_MEDIA, "updated");
+	message.setValueS32("left", 0);
+	message.setValueS32("top", 0);
+	message.setValueS32("right", 1024);
+	message.setValueS32("bottom", 768);
+	message.setValueReal("current_time", 12.5);
+	message.setValueReal("duration", 180.0);
+	message.setValueReal("current_rate", 1.0);
+
+	LLTimer timer;
+	size_t bytes = 0;
+	for(S32 i = 0; i < count; ++i)
+	{
+		std::string buffer = message.generate(binary);
+		LLPluginMessage parsed;
+		parsed.parse(buffer);
+		bytes = buffer.size();
+	}
+	F64 seconds = timer.getElapsedTimeF64();
+
+	LL_INFOS("plugin_message_bench") << (binary ? "binary" : "XML") << " generate + parse of updated: "
+		<< bytes << " bytes, " << seconds * 1000000.0 / count << " us/message" << LL_ENDL;
+}
+
+static bool idleUntil(LLPluginProcessParent *plugin, PluginMessageBenchReceiver &receiver, S32 pokebacks)
+{
+	while(receiver.mPokebacks < pokebacks)
+	{
+		if(plugin->isDone())
+		{
+			return false;
+		}
+		plugin->idle();
+	}
+	return true;
+}
+
+static void benchPlugin(bool binary, const std::string &launcher_name, const std::string &plugin_dir, const std::string &plugin_name, S32 count)
+{
+	LLPluginProcessParent::setUseBinaryMessages(binary);
+
+	PluginMessageBenchReceiver receiver;
+	LLPluginProcessParent *plugin = new LLPluginProcessParent(&receiver);
+	plugin->setSleepTime(1.0 / 100.0);
+	plugin->init(launcher_name, plugin_dir, plugin_name, false);
+
+	while(!plugin->isRunning())
+	{
+		if(plugin->isDone())
+		{
+			LL_WARNS("plugin_message_bench") << "plugin failed to launch" << LL_ENDL;
+			delete plugin;
+			return;
+		}
+		plugin->idle();
+		ms_sleep(10);
+	}
+
+	// Round trips, one at a time.
+	LLTimer timer;
+	for(S32 i = 0; i < count; ++i)
+	{
+		plugin->sendMessage(makePoke(i));
+		if(!idleUntil(plugin, receiver, i + 1))
+		{
+			break;
+		}
+	}
+	F64 latency = timer.getElapsedTimeF64();
+
+	// Throughput, all messages in flight at once.
+	timer.reset();
+	for(S32 i = 0; i < count; ++i)
+	{
+		plugin->sendMessage(makePoke(i));
+	}
+	idleUntil(plugin, receiver, 2 * count);
+	F64 throughput = timer.getElapsedTimeF64();
+
+	LL_INFOS("plugin_message_bench") << (binary ? "binary" : "XML") << " messages: "
+		<< latency * 1000000.0 / count << " us/round trip, "
+		<< count / throughput << " messages/s (" << receiver.mPokebacks << " of " << 2 * count << " pokebacks)" << LL_ENDL;
+
+	delete plugin;
+}
+
+int main(int argc, char **argv)
+{
+	ll_init_apr();
+
+	// Set up llerror logging 
+	{
+		LLError::initForApplication(".");
+		LLError::setDefaultLevel(LLError::LEVEL_INFO);
+	}
+
+	if(argc < 4)
+	{
+		LL_ERRS("plugin_message_bench") << "usage: " << argv[0] << " launcher_filename plugin_dir plugin_filename [count]" << LL_ENDL;
+	}
+
+	std::string launcher_name = argv[1];
+	std::string plugin_dir = argv[2];
+	std::string plugin_name = argv[3];
+	S32 count = 10000;
+	if(argc >= 5)
+	{
+		count = llmax(1, atoi(argv[4]));
+	}
+
+	benchCodec(false, count);
+	benchCodec(true, count);
+
+	benchPlugin(false, launcher_name, plugin_dir, plugin_name, count);
+	benchPlugin(true, launcher_name, plugin_dir, plugin_name, count);
+
+	return 0;
+}